@@ -0,0 +1,81 @@
+#include "Adafruit_ADS1X15.h"
+
+namespace {
+
+constexpr uint16_t kDataRates[] = {8, 16, 32, 64, 128, 250, 475, 860};
+
+}  // namespace
+
+void Adafruit_ADS1115::startADCReading(uint16_t mux, bool continuous) {
+  // Config register write: pointer byte and two data bytes
+  record_transfer(3, 0);
+  channel_ = (mux >> 12) & 0x3;
+  conversion_end_us_ = native_hal::now_us() + conversion_time_us();
+
+  float volts = inputs_[channel_];
+  if (noise_ > 0) {
+    noise_state_ = noise_state_ * 1664525 + 1013904223;
+    volts += noise_ * ((noise_state_ >> 8) / float(1 << 24) * 2 - 1);
+  }
+  const float counts = volts / full_scale() * 32768;
+  result_ = constrain(lroundf(counts), -32768L, 32767L);
+  conversions_++;
+}
+
+bool Adafruit_ADS1115::conversionComplete() {
+  // Config register read: pointer byte, then two data bytes
+  record_transfer(1, 2);
+  return native_hal::now_us() >= conversion_end_us_;
+}
+
+int16_t Adafruit_ADS1115::getLastConversionResults() {
+  record_transfer(1, 2);
+  return result_;
+}
+
+int16_t Adafruit_ADS1115::readADC_SingleEnded(uint8_t channel) {
+  startADCReading(ADS1X15_REG_CONFIG_MUX_SINGLE_0 + (channel << 12), false);
+  // Blocking read: wait for the conversion on the virtual clock
+  native_hal::set_time_us(conversion_end_us_);
+  return getLastConversionResults();
+}
+
+float Adafruit_ADS1115::computeVolts(int16_t counts) {
+  return counts * full_scale() / 32768;
+}
+
+void Adafruit_ADS1115::set_input_voltage(int channel, float volts) {
+  if (channel >= 0 && channel < 4) {
+    inputs_[channel] = volts;
+  }
+}
+
+float Adafruit_ADS1115::full_scale() const {
+  switch (gain_) {
+    case GAIN_TWOTHIRDS:
+      return 6.144;
+    case GAIN_ONE:
+      return 4.096;
+    case GAIN_TWO:
+      return 2.048;
+    case GAIN_FOUR:
+      return 1.024;
+    case GAIN_EIGHT:
+      return 0.512;
+    case GAIN_SIXTEEN:
+    default:
+      return 0.256;
+  }
+}
+
+uint32_t Adafruit_ADS1115::conversion_time_us() const {
+  const uint16_t sps = kDataRates[(rate_ >> 5) & 0x7];
+  return 1000000 / sps;
+}
+
+void Adafruit_ADS1115::record_transfer(size_t bytes_written,
+                                       size_t bytes_read) {
+  if (wire_) {
+    wire_->record_transfer(bytes_written, bytes_read);
+  }
+}
@@ -0,0 +1,83 @@
+#ifndef HALMET_NATIVE_ADAFRUIT_ADS1X15_H_
+#define HALMET_NATIVE_ADAFRUIT_ADS1X15_H_
+
+#include <Arduino.h>
+#include <Wire.h>
+
+#include <cstdint>
+
+#define ADS1X15_REG_CONFIG_MUX_SINGLE_0 (0x4000)
+#define ADS1X15_REG_CONFIG_MUX_SINGLE_1 (0x5000)
+#define ADS1X15_REG_CONFIG_MUX_SINGLE_2 (0x6000)
+#define ADS1X15_REG_CONFIG_MUX_SINGLE_3 (0x7000)
+
+#define RATE_ADS1115_8SPS (0x0000)
+#define RATE_ADS1115_16SPS (0x0020)
+#define RATE_ADS1115_32SPS (0x0040)
+#define RATE_ADS1115_64SPS (0x0060)
+#define RATE_ADS1115_128SPS (0x0080)
+#define RATE_ADS1115_250SPS (0x00A0)
+#define RATE_ADS1115_475SPS (0x00C0)
+#define RATE_ADS1115_860SPS (0x00E0)
+
+typedef enum {
+  GAIN_TWOTHIRDS = 0x0000,
+  GAIN_ONE = 0x0200,
+  GAIN_TWO = 0x0400,
+  GAIN_FOUR = 0x0600,
+  GAIN_EIGHT = 0x0800,
+  GAIN_SIXTEEN = 0x0A00
+} adsGain_t;
+
+/**
+ * @brief Simulated ADS1115.
+ *
+ * Single-ended input voltages are set with set_input_voltage(). A
+ * conversion completes after the nominal conversion time of the selected
+ * data rate on the virtual clock. Optional pseudo-random noise is added to
+ * each conversion. Register accesses are recorded on the I2C bus.
+ */
+class Adafruit_ADS1115 {
+ public:
+  bool begin(uint8_t address = 0x48, TwoWire* wire = &Wire) {
+    wire_ = wire;
+    return true;
+  }
+
+  void setGain(adsGain_t gain) { gain_ = gain; }
+  adsGain_t getGain() { return gain_; }
+  void setDataRate(uint16_t rate) { rate_ = rate; }
+  uint16_t getDataRate() { return rate_; }
+
+  void startADCReading(uint16_t mux, bool continuous);
+  bool conversionComplete();
+  int16_t getLastConversionResults();
+  int16_t readADC_SingleEnded(uint8_t channel);
+  float computeVolts(int16_t counts);
+
+  /// Set the voltage at a single-ended input.
+  void set_input_voltage(int channel, float volts);
+  /// Add uniformly distributed noise of +-amplitude volts to conversions.
+  void set_noise(float amplitude) { noise_ = amplitude; }
+
+  uint32_t get_conversions() const { return conversions_; }
+
+ private:
+  float full_scale() const;
+  uint32_t conversion_time_us() const;
+  void record_transfer(size_t bytes_written, size_t bytes_read);
+
+  TwoWire* wire_ = nullptr;
+  adsGain_t gain_ = GAIN_TWOTHIRDS;
+  uint16_t rate_ = RATE_ADS1115_128SPS;
+  float inputs_[4] = {};
+  float noise_ = 0;
+  uint32_t noise_state_ = 1;
+
+  int channel_ = 0;
+  uint64_t conversion_end_us_ = 0;
+  int16_t result_ = 0;
+  uint32_t conversions_ = 0;
+};
+
+#endif  // HALMET_NATIVE_ADAFRUIT_ADS1X15_H_
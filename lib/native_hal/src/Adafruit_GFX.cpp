@@ -0,0 +1,33 @@
+#include "Adafruit_GFX.h"
+
+void Adafruit_GFX::fillRect(int16_t x, int16_t y, int16_t w, int16_t h,
+                            uint16_t color) {
+  for (int16_t yy = y; yy < y + h; yy++) {
+    for (int16_t xx = x; xx < x + w; xx++) {
+      drawPixel(xx, yy, color);
+    }
+  }
+}
+
+size_t Adafruit_GFX::write(uint8_t c) {
+  if (c == '\n') {
+    cursor_x_ = 0;
+    cursor_y_ += 8 * text_size_;
+    return 1;
+  }
+  if (c == '\r') {
+    return 1;
+  }
+  // Five glyph columns and one column of spacing
+  for (int col = 0; col < 5; col++) {
+    const uint8_t bits = ((c * 37 + col * 11) ^ (c >> 1)) & 0x7f;
+    for (int row = 0; row < 7; row++) {
+      if (bits & (1 << row)) {
+        fillRect(cursor_x_ + col * text_size_, cursor_y_ + row * text_size_,
+                 text_size_, text_size_, text_color_);
+      }
+    }
+  }
+  cursor_x_ += 6 * text_size_;
+  return 1;
+}
@@ -0,0 +1,50 @@
+#ifndef HALMET_NATIVE_ADAFRUIT_GFX_H_
+#define HALMET_NATIVE_ADAFRUIT_GFX_H_
+
+#include <Arduino.h>
+
+#include <cstdint>
+
+/**
+ * @brief Graphics base class stand-in.
+ *
+ * Text is rendered in 6x8 pixel cells like the Adafruit default font. The
+ * glyphs are not the real font, but each character has a distinct,
+ * deterministic pixel pattern, which is what matters for measuring display
+ * updates.
+ */
+class Adafruit_GFX : public Print {
+ public:
+  Adafruit_GFX(int16_t width, int16_t height)
+      : raw_width_{width}, raw_height_{height} {}
+
+  virtual void drawPixel(int16_t x, int16_t y, uint16_t color) = 0;
+
+  void fillRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color);
+
+  void setCursor(int16_t x, int16_t y) {
+    cursor_x_ = x;
+    cursor_y_ = y;
+  }
+  void setTextSize(uint8_t size) { text_size_ = size ? size : 1; }
+  void setTextColor(uint16_t color) { text_color_ = color; }
+  void setRotation(uint8_t rotation) { rotation_ = rotation & 3; }
+  uint8_t getRotation() const { return rotation_; }
+
+  int16_t width() const { return rotation_ & 1 ? raw_height_ : raw_width_; }
+  int16_t height() const { return rotation_ & 1 ? raw_width_ : raw_height_; }
+
+  size_t write(uint8_t c) override;
+  using Print::write;
+
+ protected:
+  const int16_t raw_width_;
+  const int16_t raw_height_;
+  uint8_t rotation_ = 0;
+  int16_t cursor_x_ = 0;
+  int16_t cursor_y_ = 0;
+  uint8_t text_size_ = 1;
+  uint16_t text_color_ = 1;
+};
+
+#endif  // HALMET_NATIVE_ADAFRUIT_GFX_H_
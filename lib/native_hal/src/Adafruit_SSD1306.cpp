@@ -0,0 +1,51 @@
+#include "Adafruit_SSD1306.h"
+
+#include <utility>
+
+void Adafruit_SSD1306::display() {
+  ssd1306_command(SSD1306_PAGEADDR);
+  ssd1306_command(0);
+  ssd1306_command(0xff);
+  ssd1306_command(SSD1306_COLUMNADDR);
+  ssd1306_command(0);
+  ssd1306_command(raw_width_ - 1);
+  // The real driver sends the buffer in chunks of the Wire buffer size,
+  // each preceded by a data control byte
+  const size_t kChunk = 31;
+  for (size_t pos = 0; pos < buffer_.size(); pos += kChunk) {
+    wire_->record_transfer(1 + std::min(kChunk, buffer_.size() - pos), 0);
+  }
+}
+
+void Adafruit_SSD1306::drawPixel(int16_t x, int16_t y, uint16_t color) {
+  if (x < 0 || y < 0 || x >= width() || y >= height()) {
+    return;
+  }
+  switch (rotation_) {
+    case 1:
+      std::swap(x, y);
+      x = raw_width_ - x - 1;
+      break;
+    case 2:
+      x = raw_width_ - x - 1;
+      y = raw_height_ - y - 1;
+      break;
+    case 3:
+      std::swap(x, y);
+      y = raw_height_ - y - 1;
+      break;
+  }
+  uint8_t& byte = buffer_[x + (y / 8) * raw_width_];
+  const uint8_t mask = 1 << (y & 7);
+  switch (color) {
+    case SSD1306_WHITE:
+      byte |= mask;
+      break;
+    case SSD1306_BLACK:
+      byte &= ~mask;
+      break;
+    case SSD1306_INVERSE:
+      byte ^= mask;
+      break;
+  }
+}
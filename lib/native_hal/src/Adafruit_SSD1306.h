@@ -0,0 +1,63 @@
+#ifndef HALMET_NATIVE_ADAFRUIT_SSD1306_H_
+#define HALMET_NATIVE_ADAFRUIT_SSD1306_H_
+
+#include <Wire.h>
+
+#include "Adafruit_GFX.h"
+
+#include <cstdint>
+#include <vector>
+
+#define SSD1306_BLACK 0
+#define SSD1306_WHITE 1
+#define SSD1306_INVERSE 2
+
+#define SSD1306_SWITCHCAPVCC 0x02
+#define SSD1306_COLUMNADDR 0x21
+#define SSD1306_PAGEADDR 0x22
+
+/**
+ * @brief Simulated SSD1306 OLED display.
+ *
+ * Keeps the framebuffer in the same page layout as the real driver. The
+ * simulated panel contents are not tracked; commands and data writes are
+ * recorded on the I2C bus.
+ */
+class Adafruit_SSD1306 : public Adafruit_GFX {
+ public:
+  Adafruit_SSD1306(uint8_t width, uint8_t height, TwoWire* wire = &Wire,
+                   int8_t reset_pin = -1, uint32_t clock_during = 400000UL,
+                   uint32_t clock_after = 100000UL)
+      : Adafruit_GFX(width, height),
+        wire_{wire},
+        buffer_(width * ((height + 7) / 8)) {}
+
+  bool begin(uint8_t vcc_state = SSD1306_SWITCHCAPVCC, uint8_t address = 0,
+             bool reset = true, bool periph_begin = true) {
+    return true;
+  }
+
+  void clearDisplay() { std::fill(buffer_.begin(), buffer_.end(), 0); }
+
+  /// Send the whole framebuffer.
+  void display();
+
+  uint8_t* getBuffer() { return buffer_.data(); }
+
+  void ssd1306_command(uint8_t command) {
+    // Control byte and command byte
+    wire_->record_transfer(2, 0);
+    commands_++;
+  }
+
+  void drawPixel(int16_t x, int16_t y, uint16_t color) override;
+
+  uint32_t get_commands() const { return commands_; }
+
+ private:
+  TwoWire* wire_;
+  std::vector<uint8_t> buffer_;
+  uint32_t commands_ = 0;
+};
+
+#endif  // HALMET_NATIVE_ADAFRUIT_SSD1306_H_
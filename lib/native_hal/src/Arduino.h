@@ -0,0 +1,162 @@
+#ifndef HALMET_NATIVE_ARDUINO_H_
+#define HALMET_NATIVE_ARDUINO_H_
+
+// Host stand-in for the subset of the ESP32 Arduino core used by HALMET.
+
+#include <algorithm>
+#include <cmath>
+#include <cstdarg>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+
+#include "WString.h"
+#include "native_hal.h"
+
+#define IRAM_ATTR
+#define PROGMEM
+
+using std::max;
+using std::min;
+
+template <typename T, typename L, typename H>
+constexpr T constrain(T value, L low, H high) {
+  return value < low ? low : (value > high ? high : value);
+}
+
+// Time. These follow the virtual clock of native_hal. C linkage, because the
+// NMEA 2000 library declares them that way on non-Arduino platforms.
+extern "C" {
+uint32_t millis();
+uint32_t micros();
+void delay(uint32_t ms);
+void delayMicroseconds(uint32_t us);
+}
+
+// GPIO
+
+enum gpio_num_t : int {
+  GPIO_NUM_NC = -1,
+  GPIO_NUM_0 = 0, GPIO_NUM_1, GPIO_NUM_2, GPIO_NUM_3, GPIO_NUM_4, GPIO_NUM_5,
+  GPIO_NUM_6, GPIO_NUM_7, GPIO_NUM_8, GPIO_NUM_9, GPIO_NUM_10, GPIO_NUM_11,
+  GPIO_NUM_12, GPIO_NUM_13, GPIO_NUM_14, GPIO_NUM_15, GPIO_NUM_16,
+  GPIO_NUM_17, GPIO_NUM_18, GPIO_NUM_19, GPIO_NUM_20, GPIO_NUM_21,
+  GPIO_NUM_22, GPIO_NUM_23, GPIO_NUM_24, GPIO_NUM_25, GPIO_NUM_26,
+  GPIO_NUM_27, GPIO_NUM_28, GPIO_NUM_29, GPIO_NUM_30, GPIO_NUM_31,
+  GPIO_NUM_32, GPIO_NUM_33, GPIO_NUM_34, GPIO_NUM_35, GPIO_NUM_36,
+  GPIO_NUM_37, GPIO_NUM_38, GPIO_NUM_39, GPIO_NUM_MAX
+};
+
+constexpr uint8_t LOW = 0;
+constexpr uint8_t HIGH = 1;
+
+constexpr uint8_t INPUT = 0x01;
+constexpr uint8_t OUTPUT = 0x03;
+constexpr uint8_t INPUT_PULLUP = 0x05;
+constexpr uint8_t INPUT_PULLDOWN = 0x09;
+
+constexpr int RISING = 0x01;
+constexpr int FALLING = 0x02;
+constexpr int CHANGE = 0x03;
+
+void pinMode(uint8_t pin, uint8_t mode);
+int digitalRead(uint8_t pin);
+void digitalWrite(uint8_t pin, uint8_t level);
+
+inline int digitalPinToInterrupt(int pin) { return pin; }
+void attachInterrupt(uint8_t pin, void (*handler)(), int mode);
+void attachInterruptArg(uint8_t pin, void (*handler)(void*), void* arg,
+                        int mode);
+void detachInterrupt(uint8_t pin);
+
+// Print and Serial
+
+class Print {
+ public:
+  virtual ~Print() = default;
+
+  virtual size_t write(uint8_t c) = 0;
+  virtual size_t write(const uint8_t* buffer, size_t size) {
+    size_t n = 0;
+    while (size--) {
+      n += write(*buffer++);
+    }
+    return n;
+  }
+  size_t write(const char* str) {
+    return write(reinterpret_cast<const uint8_t*>(str), strlen(str));
+  }
+
+  size_t print(const char* str) { return write(str); }
+  size_t print(const String& str) { return write(str.c_str()); }
+  size_t print(char c) { return write(static_cast<uint8_t>(c)); }
+  size_t print(int value) { return print(String(value)); }
+  size_t print(unsigned int value) { return print(String(value)); }
+  size_t print(long value) { return print(String(value)); }
+  size_t print(unsigned long value) { return print(String(value)); }
+  size_t print(double value, int decimals = 2) {
+    return print(String(value, decimals));
+  }
+
+  size_t println() { return write("\r\n"); }
+  template <typename T>
+  size_t println(const T& value) {
+    return print(value) + println();
+  }
+
+  size_t printf(const char* format, ...)
+      __attribute__((format(printf, 2, 3))) {
+    char buf[256];
+    va_list args;
+    va_start(args, format);
+    const int len = vsnprintf(buf, sizeof(buf), format, args);
+    va_end(args);
+    if (len < 0) {
+      return 0;
+    }
+    return write(reinterpret_cast<const uint8_t*>(buf),
+                 std::min<size_t>(len, sizeof(buf) - 1));
+  }
+};
+
+/// Serial port stand-in writing to stdout.
+class HardwareSerial : public Print {
+ public:
+  void begin(unsigned long baud) {}
+  size_t write(uint8_t c) override;
+  size_t write(const uint8_t* buffer, size_t size) override;
+  using Print::write;
+  int availableForWrite() { return 128; }
+};
+
+extern HardwareSerial Serial;
+
+// FreeRTOS. Tasks run on host threads; ticks are real milliseconds.
+
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+typedef uint32_t TickType_t;
+typedef void* TaskHandle_t;
+typedef void (*TaskFunction_t)(void*);
+typedef void* SemaphoreHandle_t;
+
+constexpr BaseType_t pdPASS = 1;
+constexpr BaseType_t pdTRUE = 1;
+constexpr BaseType_t pdFALSE = 0;
+constexpr TickType_t portMAX_DELAY = 0xffffffff;
+constexpr TickType_t portTICK_PERIOD_MS = 1;
+#define pdMS_TO_TICKS(ms) (static_cast<TickType_t>(ms))
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t function, const char* name,
+                                   uint32_t stack_size, void* arg,
+                                   UBaseType_t priority, TaskHandle_t* handle,
+                                   BaseType_t core);
+void vTaskDelay(TickType_t ticks);
+
+// Recursive mutexes
+SemaphoreHandle_t xSemaphoreCreateRecursiveMutex();
+BaseType_t xSemaphoreTakeRecursive(SemaphoreHandle_t mutex, TickType_t ticks);
+BaseType_t xSemaphoreGiveRecursive(SemaphoreHandle_t mutex);
+void vSemaphoreDelete(SemaphoreHandle_t mutex);
+
+#endif  // HALMET_NATIVE_ARDUINO_H_
@@ -0,0 +1,49 @@
+#include "NMEA2000_native.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+// Extended frame overhead: SOF, 29-bit identifier, control, CRC, ACK, EOF
+// and interframe space
+constexpr int kFrameOverheadBits = 67;
+constexpr int kBitTimeUs = 4;
+
+}  // namespace
+
+void tNMEA2000_native::inject_frame(unsigned long id, unsigned char len,
+                                    const unsigned char* buf) {
+  Frame frame;
+  frame.id = id;
+  frame.len = std::min<unsigned char>(len, 8);
+  memcpy(frame.data, buf, frame.len);
+  rx_frames_.push_back(frame);
+}
+
+bool tNMEA2000_native::CANSendFrame(unsigned long id, unsigned char len,
+                                    const unsigned char* buf, bool wait_sent) {
+  if (tx_blocked_) {
+    return false;
+  }
+  frames_sent_++;
+  bus_time_us_ += (kFrameOverheadBits + 8 * len) * kBitTimeUs;
+  if (observer_) {
+    observer_(id, len, buf);
+  }
+  return true;
+}
+
+bool tNMEA2000_native::CANGetFrame(unsigned long& id, unsigned char& len,
+                                   unsigned char* buf) {
+  if (rx_frames_.empty()) {
+    return false;
+  }
+  const Frame& frame = rx_frames_.front();
+  id = frame.id;
+  len = frame.len;
+  memcpy(buf, frame.data, frame.len);
+  rx_frames_.pop_front();
+  frames_received_++;
+  return true;
+}
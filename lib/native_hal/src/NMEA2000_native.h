@@ -0,0 +1,57 @@
+#ifndef HALMET_NATIVE_NMEA2000_NATIVE_H_
+#define HALMET_NATIVE_NMEA2000_NATIVE_H_
+
+#include <NMEA2000.h>
+
+#include <cstdint>
+#include <deque>
+#include <functional>
+
+/**
+ * @brief NMEA 2000 CAN driver for the simulated bus.
+ *
+ * Sent frames are counted and passed to an optional observer. Received
+ * frames are injected by the simulation and picked up by ParseMessages().
+ */
+class tNMEA2000_native : public tNMEA2000 {
+ public:
+  using FrameObserver = std::function<void(unsigned long id, unsigned char len,
+                                           const unsigned char* buf)>;
+
+  /// Queue a frame as if it had been received from the bus.
+  void inject_frame(unsigned long id, unsigned char len,
+                    const unsigned char* buf);
+
+  void set_frame_observer(FrameObserver observer) { observer_ = observer; }
+
+  /// Make CANSendFrame() fail, as with a full controller transmit buffer.
+  void set_tx_blocked(bool blocked) { tx_blocked_ = blocked; }
+
+  uint32_t get_frames_sent() const { return frames_sent_; }
+  uint32_t get_frames_received() const { return frames_received_; }
+
+  /// Bus time used by the sent frames at 250 kbit/s, without bit stuffing.
+  uint64_t get_bus_time_us() const { return bus_time_us_; }
+
+ protected:
+  struct Frame {
+    unsigned long id;
+    unsigned char len;
+    unsigned char data[8];
+  };
+
+  bool CANSendFrame(unsigned long id, unsigned char len,
+                    const unsigned char* buf, bool wait_sent = true) override;
+  bool CANOpen() override { return true; }
+  bool CANGetFrame(unsigned long& id, unsigned char& len,
+                   unsigned char* buf) override;
+
+  FrameObserver observer_;
+  std::deque<Frame> rx_frames_;
+  bool tx_blocked_ = false;
+  uint32_t frames_sent_ = 0;
+  uint32_t frames_received_ = 0;
+  uint64_t bus_time_us_ = 0;
+};
+
+#endif  // HALMET_NATIVE_NMEA2000_NATIVE_H_
@@ -0,0 +1,234 @@
+#include "OneWire.h"
+
+#include "native_hal.h"
+
+#include <cmath>
+#include <cstring>
+
+namespace {
+
+constexpr uint8_t kFamilyDS18B20 = 0x28;
+
+// Standard speed timing: reset pulse and presence detect, and one time slot
+constexpr uint32_t kResetUs = 960;
+constexpr uint32_t kSlotUs = 70;
+
+constexpr uint8_t kSkipRom = 0xCC;
+constexpr uint8_t kMatchRom = 0x55;
+constexpr uint8_t kSearchRom = 0xF0;
+constexpr uint8_t kConvertT = 0x44;
+constexpr uint8_t kReadScratchpad = 0xBE;
+constexpr uint8_t kWriteScratchpad = 0x4E;
+constexpr uint8_t kReadPowerSupply = 0xB4;
+
+// Configuration register bits 5-6 select 9-12 bit resolution
+int resolution_bits(const uint8_t* scratchpad) {
+  return 9 + ((scratchpad[4] >> 5) & 0x3);
+}
+
+uint32_t conversion_time_us(int bits) { return 750000 >> (12 - bits); }
+
+}  // namespace
+
+void OneWire::busy(uint32_t duration_us) {
+  busy_us_ += duration_us;
+  native_hal::advance_time_us(duration_us);
+}
+
+void OneWire::update_conversion(Device& device) {
+  if (!device.converting || native_hal::now_us() < device.conversion_done_us) {
+    return;
+  }
+  device.converting = false;
+  const int bits = resolution_bits(device.scratchpad);
+  int16_t raw = lroundf(device.celsius(device.conversion_done_us) * 16);
+  // The undefined low bits of a lower resolution read as zero
+  raw &= ~((1 << (12 - bits)) - 1);
+  device.scratchpad[0] = raw & 0xff;
+  device.scratchpad[1] = (raw >> 8) & 0xff;
+  device.scratchpad[8] = crc8(device.scratchpad, 8);
+}
+
+uint8_t OneWire::reset() {
+  busy(kResetUs);
+  for (auto& device : devices_) {
+    device.selected = false;
+  }
+  state_ = State::kRomCommand;
+  return devices_.empty() ? 0 : 1;
+}
+
+void OneWire::write_bit(uint8_t v) {
+  busy(kSlotUs);
+  state_ = State::kIdle;
+}
+
+uint8_t OneWire::read_bit() {
+  busy(kSlotUs);
+  uint8_t bit = 1;
+  for (auto& device : devices_) {
+    if (!device.selected) {
+      continue;
+    }
+    if (state_ == State::kReadPowerSupply && device.parasite) {
+      bit = 0;
+    }
+    if (state_ == State::kConverting) {
+      update_conversion(device);
+      if (device.converting) {
+        bit = 0;
+      }
+    }
+  }
+  return bit;
+}
+
+void OneWire::write(uint8_t v, uint8_t power) {
+  busy(8 * kSlotUs);
+  switch (state_) {
+    case State::kRomCommand:
+      if (v == kSkipRom) {
+        for (auto& device : devices_) {
+          device.selected = true;
+        }
+        state_ = State::kFunctionCommand;
+      } else if (v == kMatchRom) {
+        byte_index_ = 0;
+        state_ = State::kMatchRom;
+      } else {
+        state_ = State::kIdle;
+      }
+      break;
+    case State::kMatchRom:
+      match_rom_[byte_index_++] = v;
+      if (byte_index_ == 8) {
+        for (auto& device : devices_) {
+          device.selected = memcmp(device.rom, match_rom_, 8) == 0;
+        }
+        state_ = State::kFunctionCommand;
+      }
+      break;
+    case State::kFunctionCommand:
+      byte_index_ = 0;
+      if (v == kConvertT) {
+        for (auto& device : devices_) {
+          if (device.selected) {
+            update_conversion(device);
+            device.converting = true;
+            device.conversion_done_us =
+                native_hal::now_us() +
+                conversion_time_us(resolution_bits(device.scratchpad));
+          }
+        }
+        state_ = State::kConverting;
+      } else if (v == kReadScratchpad) {
+        state_ = State::kReadScratchpad;
+      } else if (v == kWriteScratchpad) {
+        state_ = State::kWriteScratchpad;
+      } else if (v == kReadPowerSupply) {
+        state_ = State::kReadPowerSupply;
+      } else {
+        state_ = State::kIdle;
+      }
+      break;
+    case State::kWriteScratchpad:
+      // TH, TL and the configuration register
+      for (auto& device : devices_) {
+        if (device.selected) {
+          device.scratchpad[2 + byte_index_] =
+              byte_index_ == 2 ? (v & 0x60) | 0x1f : v;
+          device.scratchpad[8] = crc8(device.scratchpad, 8);
+        }
+      }
+      if (++byte_index_ == 3) {
+        state_ = State::kIdle;
+      }
+      break;
+    default:
+      state_ = State::kIdle;
+      break;
+  }
+}
+
+void OneWire::write_bytes(const uint8_t* buf, uint16_t count, bool power) {
+  for (uint16_t ii = 0; ii < count; ii++) {
+    write(buf[ii], power);
+  }
+}
+
+uint8_t OneWire::read() {
+  busy(8 * kSlotUs);
+  if (state_ != State::kReadScratchpad) {
+    return 0xff;
+  }
+  // Open-drain bus: the selected devices' bits are ANDed
+  uint8_t value = 0xff;
+  for (auto& device : devices_) {
+    if (device.selected) {
+      update_conversion(device);
+      value &= byte_index_ < 9 ? device.scratchpad[byte_index_] : 0xff;
+    }
+  }
+  byte_index_++;
+  return value;
+}
+
+void OneWire::read_bytes(uint8_t* buf, uint16_t count) {
+  for (uint16_t ii = 0; ii < count; ii++) {
+    buf[ii] = read();
+  }
+}
+
+void OneWire::select(const uint8_t rom[8]) {
+  write(kMatchRom);
+  write_bytes(rom, 8);
+}
+
+void OneWire::skip() { write(kSkipRom); }
+
+bool OneWire::search(uint8_t* new_addr, bool search_mode) {
+  // One Search ROM pass: reset, command, and three slots per ROM bit
+  reset();
+  write(kSearchRom);
+  busy(64 * 3 * kSlotUs);
+  state_ = State::kIdle;
+  if (search_index_ >= devices_.size()) {
+    return false;
+  }
+  memcpy(new_addr, devices_[search_index_++].rom, 8);
+  return true;
+}
+
+uint8_t OneWire::crc8(const uint8_t* addr, uint8_t len) {
+  uint8_t crc = 0;
+  while (len--) {
+    uint8_t byte = *addr++;
+    for (int ii = 0; ii < 8; ii++) {
+      const uint8_t mix = (crc ^ byte) & 0x01;
+      crc >>= 1;
+      if (mix) {
+        crc ^= 0x8c;
+      }
+      byte >>= 1;
+    }
+  }
+  return crc;
+}
+
+void OneWire::add_ds18b20(uint64_t serial,
+                          std::function<float(uint64_t time_us)> celsius,
+                          bool parasite) {
+  Device device = {};
+  device.rom[0] = kFamilyDS18B20;
+  for (int ii = 1; ii < 7; ii++) {
+    device.rom[ii] = (serial >> (8 * (ii - 1))) & 0xff;
+  }
+  device.rom[7] = crc8(device.rom, 7);
+  device.celsius = celsius;
+  device.parasite = parasite;
+  // Power-on state: 85 C, TH 75 C, TL 70 C, 12-bit resolution
+  const uint8_t power_on[8] = {0x50, 0x05, 0x4b, 0x46, 0x7f, 0xff, 0x0c, 0x10};
+  memcpy(device.scratchpad, power_on, 8);
+  device.scratchpad[8] = crc8(device.scratchpad, 8);
+  devices_.push_back(device);
+}
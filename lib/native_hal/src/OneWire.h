@@ -0,0 +1,85 @@
+#ifndef HALMET_NATIVE_ONEWIRE_H_
+#define HALMET_NATIVE_ONEWIRE_H_
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+/**
+ * @brief Simulated 1-Wire bus with DS18B20 temperature sensors.
+ *
+ * Implements the Arduino OneWire interface. Sensors are attached with
+ * add_ds18b20() and answer the ROM commands, Convert T, Read and Write
+ * Scratchpad and Read Power Supply like the real chips: a conversion takes
+ * the datasheet time of the configured resolution, and until it is done the
+ * scratchpad holds the previous result. Every reset and time slot blocks and
+ * advances the virtual clock by its standard-speed duration.
+ */
+class OneWire {
+ public:
+  OneWire(uint8_t pin) {}
+
+  uint8_t reset();
+  void write_bit(uint8_t v);
+  uint8_t read_bit();
+  void write(uint8_t v, uint8_t power = 0);
+  void write_bytes(const uint8_t* buf, uint16_t count, bool power = 0);
+  uint8_t read();
+  void read_bytes(uint8_t* buf, uint16_t count);
+  void select(const uint8_t rom[8]);
+  void skip();
+  void depower() {}
+
+  void reset_search() { search_index_ = 0; }
+  bool search(uint8_t* new_addr, bool search_mode = true);
+
+  static uint8_t crc8(const uint8_t* addr, uint8_t len);
+
+  /**
+   * @brief Attach a simulated DS18B20.
+   *
+   * @param serial 48-bit serial number of the ROM code
+   * @param celsius Temperature at a virtual time in microseconds
+   * @param parasite Whether the sensor is parasite powered
+   */
+  void add_ds18b20(uint64_t serial,
+                   std::function<float(uint64_t time_us)> celsius,
+                   bool parasite = false);
+
+  /// Total time the bus has been busy, in microseconds.
+  uint64_t get_busy_us() const { return busy_us_; }
+
+ private:
+  enum class State {
+    kIdle,
+    kRomCommand,
+    kMatchRom,
+    kFunctionCommand,
+    kConverting,
+    kReadScratchpad,
+    kWriteScratchpad,
+    kReadPowerSupply,
+  };
+
+  struct Device {
+    uint8_t rom[8];
+    std::function<float(uint64_t time_us)> celsius;
+    bool parasite;
+    uint8_t scratchpad[9];
+    bool converting;
+    uint64_t conversion_done_us;
+    bool selected;
+  };
+
+  void busy(uint32_t duration_us);
+  void update_conversion(Device& device);
+
+  std::vector<Device> devices_;
+  State state_ = State::kIdle;
+  uint8_t match_rom_[8] = {};
+  int byte_index_ = 0;
+  size_t search_index_ = 0;
+  uint64_t busy_us_ = 0;
+};
+
+#endif  // HALMET_NATIVE_ONEWIRE_H_
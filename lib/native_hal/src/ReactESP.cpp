@@ -0,0 +1,135 @@
+#include "ReactESP.h"
+
+#include <algorithm>
+
+namespace reactesp {
+
+ReactESP* ReactESP::app = nullptr;
+
+TimedReaction::TimedReaction(uint64_t interval_us, react_callback callback,
+                             bool repeat)
+    : Reaction(callback),
+      interval_us_{interval_us},
+      due_us_{native_hal::now_us() + interval_us},
+      repeat_{repeat} {}
+
+ISRReaction::ISRReaction(uint8_t pin_number, int mode,
+                         react_callback callback)
+    : Reaction(callback), pin_number_{pin_number} {
+  attachInterruptArg(pin_number_, isr, this, mode);
+}
+
+ISRReaction::~ISRReaction() { detachInterrupt(pin_number_); }
+
+void ISRReaction::isr(void* arg) {
+  auto* reaction = static_cast<ISRReaction*>(arg);
+  if (!reaction->removed_) {
+    reaction->callback_();
+  }
+}
+
+void ReactESP::tick() {
+  for (size_t ii = 0; ii < tick_.size(); ii++) {
+    if (!tick_[ii]->removed_) {
+      tick_[ii]->callback_();
+    }
+  }
+
+  // Run due reactions in due time order. Callbacks may add or remove
+  // reactions, so the list is searched again after each one.
+  const uint64_t now = native_hal::now_us();
+  while (true) {
+    TimedReaction* next = nullptr;
+    for (auto* reaction : timed_) {
+      if (!reaction->removed_ && reaction->due_us_ <= now &&
+          (next == nullptr || reaction->due_us_ < next->due_us_)) {
+        next = reaction;
+      }
+    }
+    if (next == nullptr) {
+      break;
+    }
+    if (next->repeat_) {
+      next->due_us_ += std::max<uint64_t>(next->interval_us_, 1);
+      // Don't try to catch up with repeats missed during a long stall
+      if (next->due_us_ <= now) {
+        next->due_us_ = now + std::max<uint64_t>(next->interval_us_, 1);
+      }
+    } else {
+      next->removed_ = true;
+    }
+    next->callback_();
+  }
+
+  collect_removed();
+}
+
+DelayReaction* ReactESP::onDelay(uint32_t delay_ms, react_callback callback) {
+  return onDelayMicros(uint64_t(delay_ms) * 1000, callback);
+}
+
+DelayReaction* ReactESP::onDelayMicros(uint64_t delay_us,
+                                       react_callback callback) {
+  auto* reaction = new DelayReaction(delay_us, callback);
+  timed_.push_back(reaction);
+  return reaction;
+}
+
+RepeatReaction* ReactESP::onRepeat(uint32_t interval_ms,
+                                   react_callback callback) {
+  return onRepeatMicros(uint64_t(interval_ms) * 1000, callback);
+}
+
+RepeatReaction* ReactESP::onRepeatMicros(uint64_t interval_us,
+                                         react_callback callback) {
+  auto* reaction = new RepeatReaction(interval_us, callback);
+  timed_.push_back(reaction);
+  return reaction;
+}
+
+ISRReaction* ReactESP::onInterrupt(uint8_t pin_number, int mode,
+                                   react_callback callback) {
+  auto* reaction = new ISRReaction(pin_number, mode, callback);
+  isr_.push_back(reaction);
+  return reaction;
+}
+
+TickReaction* ReactESP::onTick(react_callback callback) {
+  auto* reaction = new TickReaction(callback);
+  tick_.push_back(reaction);
+  return reaction;
+}
+
+void ReactESP::remove(Reaction* reaction) {
+  if (reaction) {
+    reaction->removed_ = true;
+  }
+}
+
+uint64_t ReactESP::get_next_due_us() const {
+  uint64_t next = UINT64_MAX;
+  for (const auto* reaction : timed_) {
+    if (!reaction->removed_) {
+      next = std::min(next, reaction->due_us_);
+    }
+  }
+  return next;
+}
+
+void ReactESP::collect_removed() {
+  auto collect = [](auto& reactions) {
+    auto it = std::remove_if(reactions.begin(), reactions.end(), [](auto* r) {
+      if (r->removed_) {
+        delete r;
+        return true;
+      }
+      return false;
+    });
+    reactions.erase(it, reactions.end());
+  };
+  collect(timed_);
+  collect(tick_);
+  collect(isr_);
+}
+
+}  // namespace reactesp
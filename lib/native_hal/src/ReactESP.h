@@ -0,0 +1,111 @@
+#ifndef HALMET_NATIVE_REACTESP_H_
+#define HALMET_NATIVE_REACTESP_H_
+
+#include <Arduino.h>
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+/**
+ * @brief Host stand-in for the ReactESP event loop.
+ *
+ * Same interface as ReactESP for the reaction types HALMET uses, driven by
+ * the native_hal virtual clock. Interrupt reactions run when the simulation
+ * changes the pin level, like an ISR would.
+ */
+namespace reactesp {
+
+using react_callback = std::function<void()>;
+
+class ReactESP;
+
+class Reaction {
+ public:
+  explicit Reaction(react_callback callback) : callback_{callback} {}
+  virtual ~Reaction() = default;
+
+ protected:
+  friend class ReactESP;
+  react_callback callback_;
+  bool removed_ = false;
+};
+
+class TimedReaction : public Reaction {
+ public:
+  TimedReaction(uint64_t interval_us, react_callback callback, bool repeat);
+
+  uint64_t get_due_us() const { return due_us_; }
+
+ protected:
+  friend class ReactESP;
+  const uint64_t interval_us_;
+  uint64_t due_us_;
+  const bool repeat_;
+};
+
+class DelayReaction : public TimedReaction {
+ public:
+  DelayReaction(uint64_t interval_us, react_callback callback)
+      : TimedReaction(interval_us, callback, false) {}
+};
+
+class RepeatReaction : public TimedReaction {
+ public:
+  RepeatReaction(uint64_t interval_us, react_callback callback)
+      : TimedReaction(interval_us, callback, true) {}
+};
+
+class ISRReaction : public Reaction {
+ public:
+  ISRReaction(uint8_t pin_number, int mode, react_callback callback);
+  ~ISRReaction() override;
+
+ protected:
+  static void isr(void* arg);
+  const uint8_t pin_number_;
+};
+
+class TickReaction : public Reaction {
+ public:
+  using Reaction::Reaction;
+};
+
+class ReactESP {
+ public:
+  ReactESP(bool singleton = true) {
+    if (singleton) {
+      app = this;
+    }
+  }
+
+  /// Run the tick reactions and all timed reactions that are due.
+  void tick();
+
+  DelayReaction* onDelay(uint32_t delay_ms, react_callback callback);
+  DelayReaction* onDelayMicros(uint64_t delay_us, react_callback callback);
+  RepeatReaction* onRepeat(uint32_t interval_ms, react_callback callback);
+  RepeatReaction* onRepeatMicros(uint64_t interval_us,
+                                 react_callback callback);
+  ISRReaction* onInterrupt(uint8_t pin_number, int mode,
+                           react_callback callback);
+  TickReaction* onTick(react_callback callback);
+
+  void remove(Reaction* reaction);
+
+  /// Virtual time of the next timed reaction, or UINT64_MAX if none.
+  uint64_t get_next_due_us() const;
+
+  static ReactESP* app;
+
+ private:
+  void collect_removed();
+
+  std::vector<TimedReaction*> timed_;
+  std::vector<TickReaction*> tick_;
+  std::vector<ISRReaction*> isr_;
+};
+
+}  // namespace reactesp
+
+#endif  // HALMET_NATIVE_REACTESP_H_
@@ -0,0 +1,112 @@
+#ifndef HALMET_NATIVE_WSTRING_H_
+#define HALMET_NATIVE_WSTRING_H_
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+/**
+ * @brief Arduino String, backed by std::string.
+ *
+ * Only the members used by HALMET and its dependencies are provided.
+ */
+class String : public std::string {
+ public:
+  String() = default;
+  String(const char* str) : std::string(str ? str : "") {}
+  String(const std::string& str) : std::string(str) {}
+  String(char c) : std::string(1, c) {}
+  String(int value) : std::string(std::to_string(value)) {}
+  String(unsigned int value) : std::string(std::to_string(value)) {}
+  String(long value) : std::string(std::to_string(value)) {}
+  String(unsigned long value) : std::string(std::to_string(value)) {}
+  String(float value, unsigned int decimals = 2) {
+    char buf[32];
+    snprintf(buf, sizeof(buf), "%.*f", decimals, value);
+    assign(buf);
+  }
+  String(double value, unsigned int decimals = 2)
+      : String(static_cast<float>(value), decimals) {}
+
+  unsigned int length() const { return size(); }
+  bool isEmpty() const { return empty(); }
+
+  int indexOf(char c, unsigned int from = 0) const {
+    const size_t pos = find(c, from);
+    return pos == npos ? -1 : static_cast<int>(pos);
+  }
+  int indexOf(const String& str, unsigned int from = 0) const {
+    const size_t pos = find(str, from);
+    return pos == npos ? -1 : static_cast<int>(pos);
+  }
+
+  String substring(unsigned int begin) const {
+    return begin < size() ? String(substr(begin)) : String();
+  }
+  String substring(unsigned int begin, unsigned int end) const {
+    if (begin >= size() || end <= begin) {
+      return String();
+    }
+    return String(substr(begin, end - begin));
+  }
+
+  bool startsWith(const String& prefix) const {
+    return compare(0, prefix.size(), prefix) == 0;
+  }
+  bool endsWith(const String& suffix) const {
+    return size() >= suffix.size() &&
+           compare(size() - suffix.size(), suffix.size(), suffix) == 0;
+  }
+
+  void trim() {
+    const size_t first = find_first_not_of(" \t\r\n");
+    if (first == npos) {
+      clear();
+      return;
+    }
+    const size_t last = find_last_not_of(" \t\r\n");
+    assign(substr(first, last - first + 1));
+  }
+
+  void replace(const String& from, const String& to) {
+    if (from.empty()) {
+      return;
+    }
+    size_t pos = 0;
+    while ((pos = find(from, pos)) != npos) {
+      std::string::replace(pos, from.size(), to);
+      pos += to.size();
+    }
+  }
+
+  long toInt() const { return strtol(c_str(), nullptr, 10); }
+  float toFloat() const { return strtof(c_str(), nullptr); }
+
+  String& operator+=(const String& rhs) {
+    append(rhs);
+    return *this;
+  }
+  String& operator+=(const char* rhs) {
+    append(rhs);
+    return *this;
+  }
+  String& operator+=(char rhs) {
+    push_back(rhs);
+    return *this;
+  }
+};
+
+inline String operator+(const String& lhs, const String& rhs) {
+  String result(lhs);
+  result += rhs;
+  return result;
+}
+inline String operator+(const String& lhs, const char* rhs) {
+  return lhs + String(rhs);
+}
+inline String operator+(const char* lhs, const String& rhs) {
+  return String(lhs) + rhs;
+}
+
+#endif  // HALMET_NATIVE_WSTRING_H_
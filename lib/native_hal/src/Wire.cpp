@@ -0,0 +1,15 @@
+#include "Wire.h"
+
+#include "native_hal.h"
+
+TwoWire Wire(0);
+
+void TwoWire::record_transfer(size_t bytes_written, size_t bytes_read) {
+  const size_t bytes = 1 + bytes_written + bytes_read;
+  transactions_++;
+  bytes_ += bytes;
+  // Nine clocks per byte (eight bits and ACK) plus start and stop
+  const uint64_t duration_us = (9 * bytes + 2) * 1000000ULL / clock_;
+  busy_us_ += duration_us;
+  native_hal::advance_time_us(duration_us);
+}
@@ -0,0 +1,69 @@
+#ifndef HALMET_NATIVE_WIRE_H_
+#define HALMET_NATIVE_WIRE_H_
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @brief I2C bus stand-in.
+ *
+ * Writes go nowhere. The device stand-ins report their transfers through
+ * record_transfer(), so that the bus traffic and the time the bus is busy
+ * can be measured. Transfers block like on the device: each one advances
+ * the virtual clock by its duration.
+ */
+class TwoWire {
+ public:
+  TwoWire(uint8_t bus_num = 0) {}
+
+  bool begin(int sda = -1, int scl = -1, uint32_t frequency = 0) {
+    if (frequency) {
+      clock_ = frequency;
+    }
+    return true;
+  }
+
+  void setClock(uint32_t frequency) { clock_ = frequency; }
+  uint32_t getClock() const { return clock_; }
+
+  void beginTransmission(uint8_t address) { pending_ = 0; }
+  size_t write(uint8_t data) {
+    pending_++;
+    return 1;
+  }
+  size_t write(const uint8_t* data, size_t size) {
+    pending_ += size;
+    return size;
+  }
+  uint8_t endTransmission(bool send_stop = true) {
+    record_transfer(pending_, 0);
+    pending_ = 0;
+    return 0;
+  }
+
+  uint8_t requestFrom(uint8_t address, uint8_t size) {
+    record_transfer(0, size);
+    return size;
+  }
+  int available() { return 0; }
+  int read() { return 0; }
+
+  /// Account for one transaction: address byte plus the payload bytes.
+  void record_transfer(size_t bytes_written, size_t bytes_read);
+
+  uint32_t get_transactions() const { return transactions_; }
+  uint64_t get_bytes() const { return bytes_; }
+  /// Total time the bus has been busy, in microseconds.
+  uint64_t get_busy_us() const { return busy_us_; }
+
+ private:
+  uint32_t clock_ = 100000;
+  size_t pending_ = 0;
+  uint32_t transactions_ = 0;
+  uint64_t bytes_ = 0;
+  uint64_t busy_us_ = 0;
+};
+
+extern TwoWire Wire;
+
+#endif  // HALMET_NATIVE_WIRE_H_
@@ -0,0 +1,60 @@
+#ifndef HALMET_NATIVE_DRIVER_PCNT_H_
+#define HALMET_NATIVE_DRIVER_PCNT_H_
+
+// Host stand-in for the subset of the ESP-IDF (legacy) pulse counter driver
+// used by HALMET. The simulated units count the edges driven on their pulse
+// pins by native_hal::set_pin_level(), including those of the pulse
+// generators. Only counting up on rising or falling edges is modelled.
+
+#include <cstdint>
+
+typedef int esp_err_t;
+
+#ifndef ESP_OK
+#define ESP_OK 0
+#define ESP_FAIL -1
+#define ESP_ERR_INVALID_ARG 0x102
+#endif
+
+#define PCNT_PIN_NOT_USED (-1)
+
+enum pcnt_unit_t : int {
+  PCNT_UNIT_0, PCNT_UNIT_1, PCNT_UNIT_2, PCNT_UNIT_3,
+  PCNT_UNIT_4, PCNT_UNIT_5, PCNT_UNIT_6, PCNT_UNIT_7,
+  PCNT_UNIT_MAX
+};
+
+enum pcnt_channel_t : int { PCNT_CHANNEL_0, PCNT_CHANNEL_1, PCNT_CHANNEL_MAX };
+
+enum pcnt_count_mode_t : int { PCNT_COUNT_DIS, PCNT_COUNT_INC, PCNT_COUNT_DEC };
+
+enum pcnt_ctrl_mode_t : int {
+  PCNT_MODE_KEEP, PCNT_MODE_REVERSE, PCNT_MODE_DISABLE
+};
+
+struct pcnt_config_t {
+  int pulse_gpio_num;
+  int ctrl_gpio_num;
+  pcnt_ctrl_mode_t lctrl_mode;
+  pcnt_ctrl_mode_t hctrl_mode;
+  pcnt_count_mode_t pos_mode;
+  pcnt_count_mode_t neg_mode;
+  int16_t counter_h_lim;
+  int16_t counter_l_lim;
+  pcnt_unit_t unit;
+  pcnt_channel_t channel;
+};
+
+esp_err_t pcnt_unit_config(const pcnt_config_t* config);
+
+/// Ignore pulses shorter than filter_val APB clock (80 MHz) cycles.
+esp_err_t pcnt_set_filter_value(pcnt_unit_t unit, uint16_t filter_val);
+esp_err_t pcnt_filter_enable(pcnt_unit_t unit);
+esp_err_t pcnt_filter_disable(pcnt_unit_t unit);
+
+esp_err_t pcnt_counter_pause(pcnt_unit_t unit);
+esp_err_t pcnt_counter_resume(pcnt_unit_t unit);
+esp_err_t pcnt_counter_clear(pcnt_unit_t unit);
+esp_err_t pcnt_get_counter_value(pcnt_unit_t unit, int16_t* count);
+
+#endif  // HALMET_NATIVE_DRIVER_PCNT_H_
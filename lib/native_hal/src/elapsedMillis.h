@@ -0,0 +1,21 @@
+#ifndef HALMET_NATIVE_ELAPSEDMILLIS_H_
+#define HALMET_NATIVE_ELAPSEDMILLIS_H_
+
+#include <Arduino.h>
+
+/// Milliseconds since construction or the last assignment.
+class elapsedMillis {
+ public:
+  elapsedMillis() : start_{millis()} {}
+  elapsedMillis(uint32_t value) : start_{millis() - value} {}
+  operator uint32_t() const { return millis() - start_; }
+  elapsedMillis& operator=(uint32_t value) {
+    start_ = millis() - value;
+    return *this;
+  }
+
+ private:
+  uint32_t start_;
+};
+
+#endif  // HALMET_NATIVE_ELAPSEDMILLIS_H_
@@ -0,0 +1,17 @@
+#ifndef HALMET_NATIVE_ESP_MAC_H_
+#define HALMET_NATIVE_ESP_MAC_H_
+
+#include <cstdint>
+
+typedef int esp_err_t;
+
+/// Fixed MAC address of the simulated board.
+inline esp_err_t esp_efuse_mac_get_default(uint8_t* mac) {
+  const uint8_t kMac[6] = {0x24, 0x0a, 0xc4, 0x00, 0x00, 0x01};
+  for (int ii = 0; ii < 6; ii++) {
+    mac[ii] = kMac[ii];
+  }
+  return 0;
+}
+
+#endif  // HALMET_NATIVE_ESP_MAC_H_
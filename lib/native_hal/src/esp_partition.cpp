@@ -0,0 +1,110 @@
+#include "esp_partition.h"
+
+#include "native_hal.h"
+
+#include <cstring>
+#include <vector>
+
+namespace {
+
+constexpr uint32_t kSectorSize = 4096;
+constexpr uint32_t kPageSize = 256;
+
+// Typical SPI flash timings: sector erase, page program, and the command
+// overhead and per-byte time of a read at 40 MHz
+constexpr uint32_t kSectorEraseUs = 45000;
+constexpr uint32_t kPageProgramUs = 700;
+constexpr uint32_t kReadCommandUs = 2;
+constexpr float kReadByteUs = 0.2;
+
+struct SimulatedPartition {
+  esp_partition_t partition;
+  std::vector<uint8_t> data;
+};
+
+SimulatedPartition partitions[] = {
+    {{ESP_PARTITION_TYPE_DATA, esp_partition_subtype_t(0x40), 0x3cc000,
+      0x4000, "enghours", false},
+     {}},
+};
+
+SimulatedPartition* find(const esp_partition_t* partition) {
+  for (auto& simulated : partitions) {
+    if (&simulated.partition == partition) {
+      if (simulated.data.empty()) {
+        simulated.data.assign(partition->size, 0xff);
+      }
+      return &simulated;
+    }
+  }
+  return nullptr;
+}
+
+}  // namespace
+
+const esp_partition_t* esp_partition_find_first(esp_partition_type_t type,
+                                                esp_partition_subtype_t subtype,
+                                                const char* label) {
+  for (const auto& simulated : partitions) {
+    const esp_partition_t& partition = simulated.partition;
+    if (partition.type == type &&
+        (subtype == ESP_PARTITION_SUBTYPE_ANY ||
+         partition.subtype == subtype) &&
+        (label == nullptr || strcmp(partition.label, label) == 0)) {
+      return &partition;
+    }
+  }
+  return nullptr;
+}
+
+esp_err_t esp_partition_read(const esp_partition_t* partition,
+                             size_t src_offset, void* dst, size_t size) {
+  SimulatedPartition* simulated = find(partition);
+  if (simulated == nullptr) {
+    return ESP_ERR_INVALID_ARG;
+  }
+  if (src_offset + size > partition->size) {
+    return ESP_ERR_INVALID_SIZE;
+  }
+  memcpy(dst, simulated->data.data() + src_offset, size);
+  native_hal::advance_time_us(kReadCommandUs + uint32_t(kReadByteUs * size));
+  return ESP_OK;
+}
+
+esp_err_t esp_partition_write(const esp_partition_t* partition,
+                              size_t dst_offset, const void* src,
+                              size_t size) {
+  SimulatedPartition* simulated = find(partition);
+  if (simulated == nullptr) {
+    return ESP_ERR_INVALID_ARG;
+  }
+  if (dst_offset + size > partition->size) {
+    return ESP_ERR_INVALID_SIZE;
+  }
+  // Programming can only clear bits
+  const uint8_t* bytes = static_cast<const uint8_t*>(src);
+  for (size_t ii = 0; ii < size; ii++) {
+    simulated->data[dst_offset + ii] &= bytes[ii];
+  }
+  if (size > 0) {
+    const uint32_t pages =
+        (dst_offset + size - 1) / kPageSize - dst_offset / kPageSize + 1;
+    native_hal::advance_time_us(pages * kPageProgramUs);
+  }
+  return ESP_OK;
+}
+
+esp_err_t esp_partition_erase_range(const esp_partition_t* partition,
+                                    size_t offset, size_t size) {
+  SimulatedPartition* simulated = find(partition);
+  if (simulated == nullptr) {
+    return ESP_ERR_INVALID_ARG;
+  }
+  if (offset % kSectorSize != 0 || size % kSectorSize != 0 ||
+      offset + size > partition->size) {
+    return ESP_ERR_INVALID_SIZE;
+  }
+  memset(simulated->data.data() + offset, 0xff, size);
+  native_hal::advance_time_us(size / kSectorSize * kSectorEraseUs);
+  return ESP_OK;
+}
@@ -0,0 +1,55 @@
+#ifndef HALMET_NATIVE_ESP_PARTITION_H_
+#define HALMET_NATIVE_ESP_PARTITION_H_
+
+// Host stand-in for the subset of the ESP-IDF partition API used by HALMET.
+// The partition table holds the data partitions of halmet_partitions.csv,
+// backed by RAM with NOR flash semantics: erasing sets 4 kB sectors to 0xff
+// and writing can only clear bits. Erases and writes block and advance the
+// virtual clock by typical SPI flash timings.
+
+#include <cstddef>
+#include <cstdint>
+
+typedef int esp_err_t;
+
+#ifndef ESP_OK
+#define ESP_OK 0
+#define ESP_FAIL -1
+#define ESP_ERR_INVALID_ARG 0x102
+#endif
+#define ESP_ERR_INVALID_SIZE 0x104
+
+enum esp_partition_type_t : int {
+  ESP_PARTITION_TYPE_APP = 0x00,
+  ESP_PARTITION_TYPE_DATA = 0x01,
+};
+
+enum esp_partition_subtype_t : int {
+  ESP_PARTITION_SUBTYPE_DATA_NVS = 0x02,
+  ESP_PARTITION_SUBTYPE_DATA_SPIFFS = 0x82,
+  ESP_PARTITION_SUBTYPE_ANY = 0xff,
+};
+
+struct esp_partition_t {
+  esp_partition_type_t type;
+  esp_partition_subtype_t subtype;
+  uint32_t address;
+  uint32_t size;
+  char label[17];
+  bool encrypted;
+};
+
+const esp_partition_t* esp_partition_find_first(esp_partition_type_t type,
+                                                esp_partition_subtype_t subtype,
+                                                const char* label);
+
+esp_err_t esp_partition_read(const esp_partition_t* partition,
+                             size_t src_offset, void* dst, size_t size);
+
+esp_err_t esp_partition_write(const esp_partition_t* partition,
+                              size_t dst_offset, const void* src, size_t size);
+
+esp_err_t esp_partition_erase_range(const esp_partition_t* partition,
+                                    size_t offset, size_t size);
+
+#endif  // HALMET_NATIVE_ESP_PARTITION_H_
@@ -0,0 +1,368 @@
+#include "native_hal.h"
+
+#include <Arduino.h>
+#include <driver/pcnt.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+HardwareSerial Serial;
+
+namespace {
+
+std::atomic<uint64_t> virtual_time_us{0};
+
+constexpr int kNumPins = GPIO_NUM_MAX;
+
+struct Pin {
+  uint8_t mode = INPUT;
+  int level = LOW;
+  int interrupt_mode = 0;
+  void (*handler)() = nullptr;
+  void (*handler_arg)(void*) = nullptr;
+  void* arg = nullptr;
+  // Time of the last level change
+  uint64_t last_edge_us = 0;
+};
+
+Pin pins[kNumPins];
+
+// GPIO interrupt handler calls
+std::atomic<uint64_t> interrupt_count{0};
+
+struct PulseCounterUnit {
+  pcnt_config_t config;
+  bool configured = false;
+  bool running = true;
+  bool filter_enabled = false;
+  uint16_t filter_cycles = 0;
+  int16_t count = 0;
+};
+
+PulseCounterUnit pulse_counter_units[PCNT_UNIT_MAX];
+
+// APB clock cycles per microsecond, the unit of the PCNT glitch filter
+constexpr uint64_t kAPBCyclesPerUs = 80;
+
+struct PulseGenerator {
+  int pin;
+  std::function<float(uint64_t)> frequency_hz;
+  uint64_t next_edge_us;
+};
+
+std::vector<PulseGenerator> pulse_generators;
+
+// A stopped pulse generator asks for the frequency again after this time
+constexpr uint64_t kGeneratorIdleUs = 10000;
+
+std::map<String, String>& configurations() {
+  static std::map<String, String> configurations;
+  return configurations;
+}
+
+bool valid_pin(int pin) { return pin >= 0 && pin < kNumPins; }
+
+bool valid_unit(pcnt_unit_t unit) { return unit >= 0 && unit < PCNT_UNIT_MAX; }
+
+/// Count an edge on the pulse counter units attached to pin. level_us is how
+/// long the level before the edge lasted.
+void count_edge(int pin, bool rising, uint64_t level_us) {
+  for (PulseCounterUnit& unit : pulse_counter_units) {
+    const pcnt_config_t& config = unit.config;
+    if (!unit.configured || !unit.running || config.pulse_gpio_num != pin) {
+      continue;
+    }
+    if (unit.filter_enabled &&
+        level_us * kAPBCyclesPerUs < unit.filter_cycles) {
+      continue;
+    }
+    const pcnt_count_mode_t mode = rising ? config.pos_mode : config.neg_mode;
+    if (mode != PCNT_COUNT_INC) {
+      continue;
+    }
+    // The hardware counter resets to zero on reaching the high limit
+    unit.count++;
+    if (config.counter_h_lim > 0 && unit.count >= config.counter_h_lim) {
+      unit.count = 0;
+    }
+  }
+}
+
+/// Move the clock forward to time_us, generating the pulse generator edges
+/// on the way.
+void move_time_to(uint64_t time_us) {
+  // Interrupt handlers run from here don't move the clock, but be safe
+  static bool generating = false;
+  while (!generating) {
+    PulseGenerator* next = nullptr;
+    for (PulseGenerator& generator : pulse_generators) {
+      if (generator.next_edge_us <= time_us &&
+          (next == nullptr || generator.next_edge_us < next->next_edge_us)) {
+        next = &generator;
+      }
+    }
+    if (next == nullptr) {
+      break;
+    }
+    const uint64_t edge_us = next->next_edge_us;
+    if (edge_us > virtual_time_us.load()) {
+      virtual_time_us = edge_us;
+    }
+    const float frequency = next->frequency_hz(edge_us);
+    if (frequency > 0) {
+      generating = true;
+      native_hal::set_pin_level(next->pin,
+                                native_hal::get_pin_level(next->pin) == LOW);
+      generating = false;
+      next->next_edge_us = edge_us + uint64_t(500000 / frequency);
+    } else {
+      next->next_edge_us = edge_us + kGeneratorIdleUs;
+    }
+  }
+  uint64_t current = virtual_time_us.load();
+  while (time_us > current &&
+         !virtual_time_us.compare_exchange_weak(current, time_us)) {
+  }
+}
+
+}  // namespace
+
+namespace native_hal {
+
+uint64_t now_us() { return virtual_time_us.load(); }
+
+void set_time_us(uint64_t time_us) { move_time_to(time_us); }
+
+void advance_time_us(uint64_t delta_us) {
+  move_time_to(virtual_time_us.load() + delta_us);
+}
+
+void set_pulse_generator(int pin,
+                         std::function<float(uint64_t time_us)> frequency_hz) {
+  if (!valid_pin(pin)) {
+    return;
+  }
+  pulse_generators.erase(
+      std::remove_if(pulse_generators.begin(), pulse_generators.end(),
+                     [pin](const PulseGenerator& generator) {
+                       return generator.pin == pin;
+                     }),
+      pulse_generators.end());
+  if (frequency_hz) {
+    pulse_generators.push_back({pin, frequency_hz, now_us()});
+  }
+}
+
+void set_pin_level(int pin, int level) {
+  if (!valid_pin(pin)) {
+    return;
+  }
+  Pin& p = pins[pin];
+  const int previous = p.level;
+  p.level = level ? HIGH : LOW;
+  const bool rising = previous == LOW && p.level == HIGH;
+  const bool falling = previous == HIGH && p.level == LOW;
+  if (rising || falling) {
+    const uint64_t now = now_us();
+    count_edge(pin, rising, now - p.last_edge_us);
+    p.last_edge_us = now;
+  }
+  const bool fire = (rising && (p.interrupt_mode & RISING)) ||
+                    (falling && (p.interrupt_mode & FALLING));
+  if (!fire) {
+    return;
+  }
+  if (p.handler) {
+    interrupt_count++;
+    p.handler();
+  } else if (p.handler_arg) {
+    interrupt_count++;
+    p.handler_arg(p.arg);
+  }
+}
+
+uint64_t get_interrupt_count() { return interrupt_count; }
+
+int get_pin_level(int pin) { return valid_pin(pin) ? pins[pin].level : LOW; }
+
+void set_configuration(const String& config_path, const String& json) {
+  configurations()[config_path] = json;
+}
+
+String get_configuration(const String& config_path) {
+  auto it = configurations().find(config_path);
+  return it == configurations().end() ? String() : it->second;
+}
+
+}  // namespace native_hal
+
+extern "C" {
+
+uint32_t millis() { return native_hal::now_us() / 1000; }
+
+uint32_t micros() { return native_hal::now_us(); }
+
+void delay(uint32_t ms) { native_hal::advance_time_ms(ms); }
+
+void delayMicroseconds(uint32_t us) { native_hal::advance_time_us(us); }
+}
+
+void pinMode(uint8_t pin, uint8_t mode) {
+  if (!valid_pin(pin)) {
+    return;
+  }
+  pins[pin].mode = mode;
+  if (mode == INPUT_PULLUP) {
+    pins[pin].level = HIGH;
+  }
+}
+
+int digitalRead(uint8_t pin) { return native_hal::get_pin_level(pin); }
+
+void digitalWrite(uint8_t pin, uint8_t level) {
+  if (valid_pin(pin)) {
+    pins[pin].level = level ? HIGH : LOW;
+  }
+}
+
+void attachInterrupt(uint8_t pin, void (*handler)(), int mode) {
+  if (valid_pin(pin)) {
+    pins[pin].handler = handler;
+    pins[pin].handler_arg = nullptr;
+    pins[pin].interrupt_mode = mode;
+  }
+}
+
+void attachInterruptArg(uint8_t pin, void (*handler)(void*), void* arg,
+                        int mode) {
+  if (valid_pin(pin)) {
+    pins[pin].handler = nullptr;
+    pins[pin].handler_arg = handler;
+    pins[pin].arg = arg;
+    pins[pin].interrupt_mode = mode;
+  }
+}
+
+void detachInterrupt(uint8_t pin) {
+  if (valid_pin(pin)) {
+    pins[pin].handler = nullptr;
+    pins[pin].handler_arg = nullptr;
+    pins[pin].interrupt_mode = 0;
+  }
+}
+
+esp_err_t pcnt_unit_config(const pcnt_config_t* config) {
+  if (!valid_unit(config->unit) || !valid_pin(config->pulse_gpio_num)) {
+    return ESP_ERR_INVALID_ARG;
+  }
+  PulseCounterUnit& unit = pulse_counter_units[config->unit];
+  unit = PulseCounterUnit{};
+  unit.config = *config;
+  unit.configured = true;
+  return ESP_OK;
+}
+
+esp_err_t pcnt_set_filter_value(pcnt_unit_t unit, uint16_t filter_val) {
+  // The filter threshold register is 10 bits wide
+  if (!valid_unit(unit) || filter_val > 1023) {
+    return ESP_ERR_INVALID_ARG;
+  }
+  pulse_counter_units[unit].filter_cycles = filter_val;
+  return ESP_OK;
+}
+
+esp_err_t pcnt_filter_enable(pcnt_unit_t unit) {
+  if (!valid_unit(unit)) {
+    return ESP_ERR_INVALID_ARG;
+  }
+  pulse_counter_units[unit].filter_enabled = true;
+  return ESP_OK;
+}
+
+esp_err_t pcnt_filter_disable(pcnt_unit_t unit) {
+  if (!valid_unit(unit)) {
+    return ESP_ERR_INVALID_ARG;
+  }
+  pulse_counter_units[unit].filter_enabled = false;
+  return ESP_OK;
+}
+
+esp_err_t pcnt_counter_pause(pcnt_unit_t unit) {
+  if (!valid_unit(unit)) {
+    return ESP_ERR_INVALID_ARG;
+  }
+  pulse_counter_units[unit].running = false;
+  return ESP_OK;
+}
+
+esp_err_t pcnt_counter_resume(pcnt_unit_t unit) {
+  if (!valid_unit(unit)) {
+    return ESP_ERR_INVALID_ARG;
+  }
+  pulse_counter_units[unit].running = true;
+  return ESP_OK;
+}
+
+esp_err_t pcnt_counter_clear(pcnt_unit_t unit) {
+  if (!valid_unit(unit)) {
+    return ESP_ERR_INVALID_ARG;
+  }
+  pulse_counter_units[unit].count = 0;
+  return ESP_OK;
+}
+
+esp_err_t pcnt_get_counter_value(pcnt_unit_t unit, int16_t* count) {
+  if (!valid_unit(unit) || count == nullptr) {
+    return ESP_ERR_INVALID_ARG;
+  }
+  *count = pulse_counter_units[unit].count;
+  return ESP_OK;
+}
+
+size_t HardwareSerial::write(uint8_t c) { return fwrite(&c, 1, 1, stdout); }
+
+size_t HardwareSerial::write(const uint8_t* buffer, size_t size) {
+  return fwrite(buffer, 1, size, stdout);
+}
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t function, const char* name,
+                                   uint32_t stack_size, void* arg,
+                                   UBaseType_t priority, TaskHandle_t* handle,
+                                   BaseType_t core) {
+  std::thread(function, arg).detach();
+  if (handle) {
+    *handle = nullptr;
+  }
+  return pdPASS;
+}
+
+void vTaskDelay(TickType_t ticks) {
+  std::this_thread::sleep_for(std::chrono::milliseconds(ticks));
+}
+
+SemaphoreHandle_t xSemaphoreCreateRecursiveMutex() {
+  return new std::recursive_timed_mutex();
+}
+
+BaseType_t xSemaphoreTakeRecursive(SemaphoreHandle_t mutex, TickType_t ticks) {
+  auto* m = static_cast<std::recursive_timed_mutex*>(mutex);
+  if (ticks == portMAX_DELAY) {
+    m->lock();
+    return pdTRUE;
+  }
+  return m->try_lock_for(std::chrono::milliseconds(ticks)) ? pdTRUE : pdFALSE;
+}
+
+BaseType_t xSemaphoreGiveRecursive(SemaphoreHandle_t mutex) {
+  static_cast<std::recursive_timed_mutex*>(mutex)->unlock();
+  return pdTRUE;
+}
+
+void vSemaphoreDelete(SemaphoreHandle_t mutex) {
+  delete static_cast<std::recursive_timed_mutex*>(mutex);
+}
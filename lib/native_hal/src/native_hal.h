@@ -0,0 +1,69 @@
+#ifndef HALMET_NATIVE_HAL_H_
+#define HALMET_NATIVE_HAL_H_
+
+#include <cstdint>
+#include <functional>
+
+#include "WString.h"
+
+/**
+ * @brief Scripting interface of the native (host) HAL.
+ *
+ * Time is virtual: millis() and micros() only move when the simulation
+ * advances the clock. Digital inputs are set by the simulation; level
+ * changes run the attached interrupt handlers synchronously, as a real
+ * interrupt would preempt the main loop.
+ */
+namespace native_hal {
+
+/// Current virtual time in microseconds.
+uint64_t now_us();
+
+/// Set the virtual clock. Time never runs backwards.
+void set_time_us(uint64_t time_us);
+
+void advance_time_us(uint64_t delta_us);
+
+inline void advance_time_ms(uint32_t delta_ms) {
+  advance_time_us(uint64_t(delta_ms) * 1000);
+}
+
+/// Drive a GPIO input, run any matching interrupt handler and count the edge
+/// on the pulse counter units attached to the pin.
+void set_pin_level(int pin, int level);
+
+/**
+ * @brief Drive a digital input with a square wave.
+ *
+ * frequency_hz is called at every edge with the edge time and returns the
+ * signal frequency from then on, or 0 to hold the level for a while. Edges
+ * are generated whenever the clock moves past them, also while a reaction
+ * advances the clock, e.g. during an I2C transfer. Interrupt handlers thus
+ * see the exact edge times, as real ISRs preempting the loop would.
+ *
+ * Replaces any earlier generator on the pin; an empty function removes it.
+ */
+void set_pulse_generator(int pin,
+                         std::function<float(uint64_t time_us)> frequency_hz);
+
+/// Number of GPIO interrupt handler calls so far, i.e. the ISRs the device
+/// CPU would have taken.
+uint64_t get_interrupt_count();
+
+/// Last level written to or set on a pin.
+int get_pin_level(int pin);
+
+/**
+ * @brief Provide the stored configuration of a Configurable.
+ *
+ * load_configuration() on an object with the same config path applies json
+ * through set_configuration(), like reading it from flash on the device.
+ */
+void set_configuration(const String& config_path, const String& json);
+
+/// Stored configuration of config_path, or an empty string.
+String get_configuration(const String& config_path);
+
+}  // namespace native_hal
+
+#endif  // HALMET_NATIVE_HAL_H_
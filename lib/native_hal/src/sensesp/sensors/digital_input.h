@@ -0,0 +1,50 @@
+#ifndef HALMET_NATIVE_SENSESP_SENSORS_DIGITAL_INPUT_H_
+#define HALMET_NATIVE_SENSESP_SENSORS_DIGITAL_INPUT_H_
+
+#include <Arduino.h>
+#include <ReactESP.h>
+#include <WString.h>
+
+#include "sensesp/system/configurable.h"
+#include "sensesp/system/valueproducer.h"
+
+namespace sensesp {
+
+/**
+ * @brief Host stand-in for the SensESP DigitalInputCounter.
+ *
+ * Counts the interrupts of the pin and emits the count every read_delay
+ * ms, as the SensESP implementation does. Unlike that, it may be destroyed,
+ * which removes its reactions.
+ */
+class DigitalInputCounter : public Configurable, public IntProducer {
+ public:
+  DigitalInputCounter(uint8_t pin, int pin_mode, int interrupt_type,
+                      unsigned int read_delay, String config_path = "")
+      : Configurable{config_path}, pin_{pin}, read_delay_{read_delay} {
+    pinMode(pin, pin_mode);
+    interrupt_reaction_ = reactesp::ReactESP::app->onInterrupt(
+        pin, interrupt_type, [this]() { counter_++; });
+    read_reaction_ = reactesp::ReactESP::app->onRepeat(read_delay_, [this]() {
+      const int count = counter_;
+      counter_ = 0;
+      this->emit(count);
+    });
+  }
+
+  ~DigitalInputCounter() {
+    reactesp::ReactESP::app->remove(interrupt_reaction_);
+    reactesp::ReactESP::app->remove(read_reaction_);
+  }
+
+ protected:
+  uint8_t pin_;
+  unsigned int read_delay_;
+  volatile unsigned int counter_ = 0;
+  reactesp::ISRReaction* interrupt_reaction_;
+  reactesp::RepeatReaction* read_reaction_;
+};
+
+}  // namespace sensesp
+
+#endif  // HALMET_NATIVE_SENSESP_SENSORS_DIGITAL_INPUT_H_
@@ -0,0 +1,62 @@
+#ifndef HALMET_NATIVE_SENSESP_SIGNALK_SIGNALK_OUTPUT_H_
+#define HALMET_NATIVE_SENSESP_SIGNALK_SIGNALK_OUTPUT_H_
+
+#include <WString.h>
+
+#include "sensesp/transforms/transform.h"
+
+namespace sensesp {
+
+/**
+ * @brief Host stand-in for the SensESP SKMetadata.
+ */
+class SKMetadata {
+ public:
+  SKMetadata(String units = "", String display_name = "",
+             String description = "", String short_name = "",
+             float timeout = -1.0)
+      : units_{units},
+        display_name_{display_name},
+        description_{description},
+        short_name_{short_name},
+        timeout_{timeout} {}
+
+  String units_;
+  String display_name_;
+  String description_;
+  String short_name_;
+  float timeout_;
+};
+
+/**
+ * @brief Host stand-in for the SensESP SKOutput.
+ *
+ * Passes the values on unchanged. There is no websocket; the batched
+ * deltas are measured by the SKDeltaBatcher in front of the outputs.
+ */
+template <typename T>
+class SKOutput : public SymmetricTransform<T> {
+ public:
+  SKOutput(String sk_path, String config_path = "",
+           SKMetadata* meta = nullptr)
+      : SymmetricTransform<T>{config_path}, sk_path_{sk_path}, meta_{meta} {}
+
+  void set_input(T new_value, uint8_t input_channel = 0) override {
+    this->emit(new_value);
+  }
+
+  const String& get_sk_path() const { return sk_path_; }
+
+ protected:
+  String sk_path_;
+  SKMetadata* meta_;
+};
+
+typedef SKOutput<float> SKOutputFloat;
+typedef SKOutput<int> SKOutputInt;
+typedef SKOutput<bool> SKOutputBool;
+typedef SKOutput<String> SKOutputString;
+
+}  // namespace sensesp
+
+#endif  // HALMET_NATIVE_SENSESP_SIGNALK_SIGNALK_OUTPUT_H_
@@ -0,0 +1,80 @@
+#ifndef HALMET_NATIVE_SENSESP_SYSTEM_CONFIGURABLE_H_
+#define HALMET_NATIVE_SENSESP_SYSTEM_CONFIGURABLE_H_
+
+#include <ArduinoJson.h>
+#include <WString.h>
+
+#include "native_hal.h"
+
+namespace sensesp {
+
+/**
+ * @brief Host stand-in for the SensESP Configurable.
+ *
+ * load_configuration() reads the JSON registered for the config path with
+ * native_hal::set_configuration(), and save_configuration() stores it back
+ * there, so a simulation can start from any saved configuration.
+ */
+class Configurable {
+ public:
+  Configurable(String config_path = "", String description = "",
+               int sort_order = 1000)
+      : config_path_{config_path},
+        description_{description},
+        sort_order_{sort_order} {}
+  virtual ~Configurable() = default;
+
+  virtual void get_configuration(JsonObject& config) {}
+  virtual bool set_configuration(const JsonObject& config) { return false; }
+  virtual String get_config_schema() { return "{}"; }
+
+  virtual void load_configuration() {
+    if (config_path_ == "") {
+      return;
+    }
+    const String json = native_hal::get_configuration(config_path_);
+    if (json == "") {
+      return;
+    }
+    JsonDocument doc;
+    if (deserializeJson(doc, json.c_str())) {
+      return;
+    }
+    const JsonObject config = doc.as<JsonObject>();
+    set_configuration(config);
+  }
+
+  virtual void save_configuration() {
+    if (config_path_ == "") {
+      return;
+    }
+    JsonDocument doc;
+    JsonObject config = doc.to<JsonObject>();
+    get_configuration(config);
+    std::string json;
+    serializeJson(doc, json);
+    native_hal::set_configuration(config_path_, json.c_str());
+  }
+
+  Configurable* set_description(String description) {
+    description_ = description;
+    return this;
+  }
+  const String& get_description() const { return description_; }
+
+  Configurable* set_sort_order(int sort_order) {
+    sort_order_ = sort_order;
+    return this;
+  }
+  int get_sort_order() const { return sort_order_; }
+
+  const String config_path_;
+
+ protected:
+  String description_;
+  int sort_order_;
+};
+
+}  // namespace sensesp
+
+#endif  // HALMET_NATIVE_SENSESP_SYSTEM_CONFIGURABLE_H_
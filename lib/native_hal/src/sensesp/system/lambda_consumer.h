@@ -0,0 +1,28 @@
+#ifndef HALMET_NATIVE_SENSESP_SYSTEM_LAMBDA_CONSUMER_H_
+#define HALMET_NATIVE_SENSESP_SYSTEM_LAMBDA_CONSUMER_H_
+
+#include <functional>
+
+#include "sensesp/system/valueconsumer.h"
+
+namespace sensesp {
+
+/**
+ * @brief Host stand-in for the SensESP LambdaConsumer.
+ */
+template <class IN>
+class LambdaConsumer : public ValueConsumer<IN> {
+ public:
+  LambdaConsumer(std::function<void(IN)> function) : function_{function} {}
+
+  void set_input(IN new_value, uint8_t input_channel = 0) override {
+    function_(new_value);
+  }
+
+ protected:
+  std::function<void(IN)> function_;
+};
+
+}  // namespace sensesp
+
+#endif  // HALMET_NATIVE_SENSESP_SYSTEM_LAMBDA_CONSUMER_H_
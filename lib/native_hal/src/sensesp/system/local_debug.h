@@ -0,0 +1,20 @@
+#ifndef HALMET_NATIVE_SENSESP_SYSTEM_LOCAL_DEBUG_H_
+#define HALMET_NATIVE_SENSESP_SYSTEM_LOCAL_DEBUG_H_
+
+#include <cstdio>
+
+#include "native_hal.h"
+
+// Log lines go to stderr, prefixed with the virtual time in milliseconds,
+// keeping stdout free for simulation output.
+#define NATIVE_HAL_LOG(level, fmt, ...)                                     \
+  fprintf(stderr, "%10.3f %c " fmt "\n", native_hal::now_us() / 1000.0, \
+          level, ##__VA_ARGS__)
+
+#define debugE(fmt, ...) NATIVE_HAL_LOG('E', fmt, ##__VA_ARGS__)
+#define debugW(fmt, ...) NATIVE_HAL_LOG('W', fmt, ##__VA_ARGS__)
+#define debugI(fmt, ...) NATIVE_HAL_LOG('I', fmt, ##__VA_ARGS__)
+#define debugD(fmt, ...) NATIVE_HAL_LOG('D', fmt, ##__VA_ARGS__)
+#define debugV(fmt, ...) NATIVE_HAL_LOG('V', fmt, ##__VA_ARGS__)
+
+#endif  // HALMET_NATIVE_SENSESP_SYSTEM_LOCAL_DEBUG_H_
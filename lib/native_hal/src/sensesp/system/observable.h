@@ -0,0 +1,30 @@
+#ifndef HALMET_NATIVE_SENSESP_SYSTEM_OBSERVABLE_H_
+#define HALMET_NATIVE_SENSESP_SYSTEM_OBSERVABLE_H_
+
+#include <functional>
+#include <vector>
+
+namespace sensesp {
+
+/**
+ * @brief Host stand-in for the SensESP Observable.
+ */
+class Observable {
+ public:
+  void attach(std::function<void()> observer) {
+    observers_.push_back(observer);
+  }
+
+  void notify() {
+    for (auto& observer : observers_) {
+      observer();
+    }
+  }
+
+ private:
+  std::vector<std::function<void()>> observers_;
+};
+
+}  // namespace sensesp
+
+#endif  // HALMET_NATIVE_SENSESP_SYSTEM_OBSERVABLE_H_
@@ -0,0 +1,28 @@
+#ifndef HALMET_NATIVE_SENSESP_SYSTEM_VALUECONSUMER_H_
+#define HALMET_NATIVE_SENSESP_SYSTEM_VALUECONSUMER_H_
+
+#include <WString.h>
+
+#include <cstdint>
+
+namespace sensesp {
+
+/**
+ * @brief Host stand-in for the SensESP ValueConsumer.
+ */
+template <typename T>
+class ValueConsumer {
+ public:
+  virtual ~ValueConsumer() = default;
+
+  virtual void set_input(T new_value, uint8_t input_channel = 0) {}
+};
+
+typedef ValueConsumer<float> FloatConsumer;
+typedef ValueConsumer<int> IntConsumer;
+typedef ValueConsumer<bool> BoolConsumer;
+typedef ValueConsumer<String> StringConsumer;
+
+}  // namespace sensesp
+
+#endif  // HALMET_NATIVE_SENSESP_SYSTEM_VALUECONSUMER_H_
@@ -0,0 +1,61 @@
+#ifndef HALMET_NATIVE_SENSESP_SYSTEM_VALUEPRODUCER_H_
+#define HALMET_NATIVE_SENSESP_SYSTEM_VALUEPRODUCER_H_
+
+#include <Arduino.h>
+#include <WString.h>
+
+#include "sensesp/system/observable.h"
+#include "sensesp/system/valueconsumer.h"
+
+namespace sensesp {
+
+template <typename C, typename P>
+class Transform;
+
+/**
+ * @brief Host stand-in for the SensESP ValueProducer.
+ *
+ * emit() stores the value and passes it on to all connected consumers.
+ */
+template <typename T>
+class ValueProducer : virtual public Observable {
+ public:
+  ValueProducer() {}
+  ValueProducer(const T& initial_value) : output(initial_value) {}
+
+  virtual const T& get() const { return output; }
+
+  /// Connect a consumer. The value is converted to the consumer's type.
+  template <typename CT>
+  void connect_to(ValueConsumer<CT>* consumer, uint8_t input_channel = 0) {
+    this->attach([this, consumer, input_channel]() {
+      consumer->set_input(CT(this->get()), input_channel);
+    });
+  }
+
+  template <typename CT, typename T2>
+  Transform<CT, T2>* connect_to(Transform<CT, T2>* consumer,
+                                uint8_t input_channel = 0) {
+    this->attach([this, consumer, input_channel]() {
+      consumer->set_input(CT(this->get()), input_channel);
+    });
+    return consumer;
+  }
+
+  void emit(T new_value) {
+    output = new_value;
+    this->notify();
+  }
+
+ protected:
+  T output = {};
+};
+
+typedef ValueProducer<float> FloatProducer;
+typedef ValueProducer<int> IntProducer;
+typedef ValueProducer<bool> BoolProducer;
+typedef ValueProducer<String> StringProducer;
+
+}  // namespace sensesp
+
+#endif  // HALMET_NATIVE_SENSESP_SYSTEM_VALUEPRODUCER_H_
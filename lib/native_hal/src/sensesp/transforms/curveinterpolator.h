@@ -0,0 +1,75 @@
+#ifndef HALMET_NATIVE_SENSESP_TRANSFORMS_CURVEINTERPOLATOR_H_
+#define HALMET_NATIVE_SENSESP_TRANSFORMS_CURVEINTERPOLATOR_H_
+
+#include <WString.h>
+
+#include <set>
+
+#include "sensesp/transforms/transform.h"
+
+namespace sensesp {
+
+/**
+ * @brief Host stand-in for the SensESP CurveInterpolator.
+ *
+ * Interpolates exactly as the SensESP implementation does, including the
+ * implicit (0, 0) sample below the first one. The samples can't be
+ * configured through JSON.
+ */
+class CurveInterpolator : public FloatTransform {
+ public:
+  class Sample {
+   public:
+    Sample() {}
+    Sample(float input, float output) : input{input}, output{output} {}
+
+    bool operator<(const Sample& other) const { return input < other.input; }
+
+    float input = 0;
+    float output = 0;
+  };
+
+  CurveInterpolator(std::set<Sample>* defaults = nullptr,
+                    const String& config_path = "")
+      : FloatTransform{config_path} {
+    if (defaults != nullptr) {
+      samples_ = *defaults;
+    }
+  }
+
+  void set_input(float input, uint8_t input_channel = 0) override {
+    float x0 = 0.0;
+    float y0 = 0.0;
+    auto it = samples_.begin();
+    while (it != samples_.end()) {
+      if (input > it->input) {
+        x0 = it->input;
+        y0 = it->output;
+      } else {
+        break;
+      }
+      it++;
+    }
+    if (it != samples_.end()) {
+      const float x1 = it->input;
+      const float y1 = it->output;
+      this->emit((y0 * (x1 - input) + y1 * (input - x0)) / (x1 - x0));
+    } else {
+      this->emit(y0);
+    }
+  }
+
+  void clear_samples() { samples_.clear(); }
+  void add_sample(const Sample& sample) { samples_.insert(sample); }
+  const std::set<Sample>& get_samples() const { return samples_; }
+
+  CurveInterpolator* set_input_title(String title) { return this; }
+  CurveInterpolator* set_output_title(String title) { return this; }
+
+ protected:
+  std::set<Sample> samples_;
+};
+
+}  // namespace sensesp
+
+#endif  // HALMET_NATIVE_SENSESP_TRANSFORMS_CURVEINTERPOLATOR_H_
@@ -0,0 +1,51 @@
+#ifndef HALMET_NATIVE_SENSESP_TRANSFORMS_FREQUENCY_H_
+#define HALMET_NATIVE_SENSESP_TRANSFORMS_FREQUENCY_H_
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <WString.h>
+
+#include "sensesp/transforms/transform.h"
+
+namespace sensesp {
+
+/**
+ * @brief Host stand-in for the SensESP Frequency transform.
+ *
+ * Converts the counts to a frequency over the time since the previous
+ * input, times the configurable multiplier.
+ */
+class Frequency : public Transform<int, float> {
+ public:
+  Frequency(float multiplier = 1.0, String config_path = "")
+      : Transform<int, float>{config_path}, multiplier_{multiplier} {
+    load_configuration();
+  }
+
+  void set_input(int input, uint8_t input_channel = 0) override {
+    const uint32_t now = millis();
+    const uint32_t elapsed_ms = now - last_update_ms_;
+    last_update_ms_ = now;
+    this->emit(multiplier_ * 1000. * input / elapsed_ms);
+  }
+
+  void get_configuration(JsonObject& config) override {
+    config["multiplier"] = multiplier_;
+  }
+
+  bool set_configuration(const JsonObject& config) override {
+    if (!config.containsKey("multiplier")) {
+      return false;
+    }
+    multiplier_ = config["multiplier"];
+    return true;
+  }
+
+ protected:
+  float multiplier_;
+  uint32_t last_update_ms_ = 0;
+};
+
+}  // namespace sensesp
+
+#endif  // HALMET_NATIVE_SENSESP_TRANSFORMS_FREQUENCY_H_
@@ -0,0 +1,78 @@
+#ifndef HALMET_NATIVE_SENSESP_TRANSFORMS_LAMBDA_TRANSFORM_H_
+#define HALMET_NATIVE_SENSESP_TRANSFORMS_LAMBDA_TRANSFORM_H_
+
+#include <ArduinoJson.h>
+#include <WString.h>
+
+#include <functional>
+
+#include "sensesp/transforms/transform.h"
+
+namespace sensesp {
+
+/**
+ * @brief Configuration key and UI title of a LambdaTransform parameter.
+ */
+struct ParamInfo {
+  const char* key;
+  const char* description;
+};
+
+/**
+ * @brief Host stand-in for the SensESP LambdaTransform.
+ *
+ * The parameterless form and the form with one parameter are provided. The
+ * parameter is loaded from the configuration under the key of its
+ * ParamInfo.
+ */
+template <class IN, class OUT, class P1 = void>
+class LambdaTransform : public Transform<IN, OUT> {
+ public:
+  LambdaTransform(std::function<OUT(IN, P1)> function, P1 param1,
+                  const ParamInfo* param_info, String config_path = "")
+      : Transform<IN, OUT>{config_path},
+        function_{function},
+        param1_{param1},
+        param_info_{param_info} {
+    this->load_configuration();
+  }
+
+  void set_input(IN input, uint8_t input_channel = 0) override {
+    this->emit(function_(input, param1_));
+  }
+
+  void get_configuration(JsonObject& config) override {
+    config[param_info_[0].key] = param1_;
+  }
+
+  bool set_configuration(const JsonObject& config) override {
+    if (!config.containsKey(param_info_[0].key)) {
+      return false;
+    }
+    param1_ = config[param_info_[0].key].template as<P1>();
+    return true;
+  }
+
+ protected:
+  std::function<OUT(IN, P1)> function_;
+  P1 param1_;
+  const ParamInfo* param_info_;
+};
+
+template <class IN, class OUT>
+class LambdaTransform<IN, OUT, void> : public Transform<IN, OUT> {
+ public:
+  LambdaTransform(std::function<OUT(IN)> function, String config_path = "")
+      : Transform<IN, OUT>{config_path}, function_{function} {}
+
+  void set_input(IN input, uint8_t input_channel = 0) override {
+    this->emit(function_(input));
+  }
+
+ protected:
+  std::function<OUT(IN)> function_;
+};
+
+}  // namespace sensesp
+
+#endif  // HALMET_NATIVE_SENSESP_TRANSFORMS_LAMBDA_TRANSFORM_H_
@@ -0,0 +1,48 @@
+#ifndef HALMET_NATIVE_SENSESP_TRANSFORMS_LINEAR_H_
+#define HALMET_NATIVE_SENSESP_TRANSFORMS_LINEAR_H_
+
+#include <ArduinoJson.h>
+#include <WString.h>
+
+#include "sensesp/transforms/transform.h"
+
+namespace sensesp {
+
+/**
+ * @brief Host stand-in for the SensESP Linear transform.
+ */
+class Linear : public FloatTransform {
+ public:
+  Linear(float multiplier, float offset, const String& config_path = "")
+      : FloatTransform{config_path},
+        multiplier_{multiplier},
+        offset_{offset} {
+    load_configuration();
+  }
+
+  void set_input(float input, uint8_t input_channel = 0) override {
+    this->emit(multiplier_ * input + offset_);
+  }
+
+  void get_configuration(JsonObject& config) override {
+    config["multiplier"] = multiplier_;
+    config["offset"] = offset_;
+  }
+
+  bool set_configuration(const JsonObject& config) override {
+    if (!config.containsKey("multiplier") || !config.containsKey("offset")) {
+      return false;
+    }
+    multiplier_ = config["multiplier"];
+    offset_ = config["offset"];
+    return true;
+  }
+
+ protected:
+  float multiplier_;
+  float offset_;
+};
+
+}  // namespace sensesp
+
+#endif  // HALMET_NATIVE_SENSESP_TRANSFORMS_LINEAR_H_
@@ -0,0 +1,68 @@
+#ifndef HALMET_NATIVE_SENSESP_TRANSFORMS_MOVING_AVERAGE_H_
+#define HALMET_NATIVE_SENSESP_TRANSFORMS_MOVING_AVERAGE_H_
+
+#include <ArduinoJson.h>
+#include <WString.h>
+
+#include <vector>
+
+#include "sensesp/transforms/transform.h"
+
+namespace sensesp {
+
+/**
+ * @brief Host stand-in for the SensESP MovingAverage.
+ *
+ * Averages as the SensESP implementation does: the first input fills the
+ * whole window, and each later one replaces the oldest sample.
+ */
+class MovingAverage : public FloatTransform {
+ public:
+  MovingAverage(int sample_size, float multiplier = 1.0,
+                String config_path = "")
+      : FloatTransform{config_path},
+        sample_size_{sample_size},
+        multiplier_{multiplier} {
+    load_configuration();
+  }
+
+  void set_input(float input, uint8_t input_channel = 0) override {
+    if (buf_.empty()) {
+      buf_.resize(sample_size_, input);
+      this->output = multiplier_ * input;
+    } else {
+      this->output += -multiplier_ * buf_[ptr_] / sample_size_;
+      buf_[ptr_] = input;
+      this->output += multiplier_ * input / sample_size_;
+      ptr_ = (ptr_ + 1) % sample_size_;
+    }
+    this->notify();
+  }
+
+  void get_configuration(JsonObject& config) override {
+    config["multiplier"] = multiplier_;
+    config["sample_size"] = sample_size_;
+  }
+
+  bool set_configuration(const JsonObject& config) override {
+    if (!config.containsKey("multiplier") ||
+        !config.containsKey("sample_size")) {
+      return false;
+    }
+    multiplier_ = config["multiplier"];
+    sample_size_ = config["sample_size"];
+    buf_.clear();
+    ptr_ = 0;
+    return true;
+  }
+
+ protected:
+  std::vector<float> buf_;
+  int ptr_ = 0;
+  int sample_size_;
+  float multiplier_;
+};
+
+}  // namespace sensesp
+
+#endif  // HALMET_NATIVE_SENSESP_TRANSFORMS_MOVING_AVERAGE_H_
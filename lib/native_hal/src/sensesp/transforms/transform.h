@@ -0,0 +1,40 @@
+#ifndef HALMET_NATIVE_SENSESP_TRANSFORMS_TRANSFORM_H_
+#define HALMET_NATIVE_SENSESP_TRANSFORMS_TRANSFORM_H_
+
+#include <WString.h>
+
+#include "sensesp/system/configurable.h"
+#include "sensesp/system/valueconsumer.h"
+#include "sensesp/system/valueproducer.h"
+
+namespace sensesp {
+
+/**
+ * @brief Host stand-in for the SensESP TransformBase.
+ */
+class TransformBase : public Configurable {
+ public:
+  TransformBase(String config_path = "") : Configurable{config_path} {}
+};
+
+template <typename C, typename P>
+class Transform : public TransformBase,
+                  public ValueConsumer<C>,
+                  public ValueProducer<P> {
+ public:
+  Transform(String config_path = "") : TransformBase{config_path} {}
+};
+
+template <typename T>
+class SymmetricTransform : public Transform<T, T> {
+ public:
+  SymmetricTransform(String config_path = "") : Transform<T, T>{config_path} {}
+};
+
+typedef SymmetricTransform<float> FloatTransform;
+typedef SymmetricTransform<int> IntegerTransform;
+typedef SymmetricTransform<bool> BooleanTransform;
+
+}  // namespace sensesp
+
+#endif  // HALMET_NATIVE_SENSESP_TRANSFORMS_TRANSFORM_H_
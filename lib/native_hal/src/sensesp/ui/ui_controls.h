@@ -0,0 +1,48 @@
+#ifndef HALMET_NATIVE_SENSESP_UI_UI_CONTROLS_H_
+#define HALMET_NATIVE_SENSESP_UI_UI_CONTROLS_H_
+
+#include <ArduinoJson.h>
+#include <WString.h>
+
+#include "sensesp/system/configurable.h"
+
+namespace sensesp {
+
+/**
+ * @brief Host stand-in for the SensESP CheckboxConfig.
+ *
+ * The value is loaded from the configuration registered for the config path
+ * under the key "value".
+ */
+class CheckboxConfig : public Configurable {
+ public:
+  CheckboxConfig(bool value, String title, String config_path = "",
+                 String description = "", int sort_order = 1000)
+      : Configurable{config_path, description, sort_order},
+        value_{value},
+        title_{title} {
+    load_configuration();
+  }
+
+  bool get_value() const { return value_; }
+
+  void get_configuration(JsonObject& config) override {
+    config["value"] = value_;
+  }
+
+  bool set_configuration(const JsonObject& config) override {
+    if (!config.containsKey("value")) {
+      return false;
+    }
+    value_ = config["value"];
+    return true;
+  }
+
+ protected:
+  bool value_;
+  String title_;
+};
+
+}  // namespace sensesp
+
+#endif  // HALMET_NATIVE_SENSESP_UI_UI_CONTROLS_H_
@@ -0,0 +1,443 @@
+#include "ads1115_scanner.h"
+
+#include "reaction_profiler.h"
+
+#include <ReactESP.h>
+
+#include <sensesp/system/local_debug.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+namespace halmet {
+
+namespace {
+
+// Single-ended input multiplexer settings, indexed by channel
+constexpr uint16_t kChannelMux[ADS1115Scanner::kNumChannels] = {
+    ADS1X15_REG_CONFIG_MUX_SINGLE_0, ADS1X15_REG_CONFIG_MUX_SINGLE_1,
+    ADS1X15_REG_CONFIG_MUX_SINGLE_2, ADS1X15_REG_CONFIG_MUX_SINGLE_3};
+
+struct GainOption {
+  uint16_t full_scale_mv;
+  adsGain_t gain;
+};
+
+constexpr GainOption kGainOptions[] = {
+    {6144, GAIN_TWOTHIRDS}, {4096, GAIN_ONE},   {2048, GAIN_TWO},
+    {1024, GAIN_FOUR},      {512, GAIN_EIGHT}, {256, GAIN_SIXTEEN}};
+
+struct DataRateOption {
+  uint16_t sps;
+  uint16_t config;
+};
+
+constexpr DataRateOption kDataRateOptions[] = {
+    {8, RATE_ADS1115_8SPS},     {16, RATE_ADS1115_16SPS},
+    {32, RATE_ADS1115_32SPS},   {64, RATE_ADS1115_64SPS},
+    {128, RATE_ADS1115_128SPS}, {250, RATE_ADS1115_250SPS},
+    {475, RATE_ADS1115_475SPS}, {860, RATE_ADS1115_860SPS}};
+
+constexpr uint8_t kMaxOversampling = 64;
+constexpr uint32_t kMinIntervalMs = 10;
+
+// The ADS1115 internal oscillator is specified to +-10%. The chip is not
+// polled before the nominal conversion time plus this margin has elapsed.
+constexpr float kConversionTimeMargin = 1.1;
+
+// Initial estimate of the I2C time per conversion: three register writes to
+// start the conversion and one register read for the result, at 100 kHz.
+// Replaced by the measured value after the first statistics period.
+constexpr uint32_t kDefaultBusTimePerConversionUs = 1800;
+
+// The ADC can't convert more than back-to-back; leave some slack for the
+// event loop latency between conversions.
+constexpr float kMaxADCUtilization = 0.9;
+
+constexpr float kDefaultBusBudgetPercent = 25;
+
+// How often per-channel sample rates are computed and reported
+constexpr uint32_t kStatisticsIntervalMs = 10000;
+
+}  // namespace
+
+ADS1115Channel::ADS1115Channel(ADS1115Scanner* scanner, int channel,
+                               const ADS1115ChannelSettings& settings,
+                               const String& config_path)
+    : sensesp::FloatProducer{},
+      sensesp::Configurable{config_path},
+      scanner_{scanner},
+      channel_{channel},
+      settings_{settings} {
+  load_configuration();
+  apply_settings();
+}
+
+void ADS1115Channel::apply_settings() {
+  // Fall back to the nearest supported setting if the configuration holds
+  // an unsupported value. The range is never made narrower than requested
+  // to avoid clipping.
+  GainOption gain = kGainOptions[0];
+  for (const auto& option : kGainOptions) {
+    if (option.full_scale_mv >= settings_.full_scale_mv) {
+      gain = option;
+    }
+  }
+  gain_ = gain.gain;
+  settings_.full_scale_mv = gain.full_scale_mv;
+
+  DataRateOption data_rate = kDataRateOptions[0];
+  for (const auto& option : kDataRateOptions) {
+    if (option.sps <= settings_.data_rate_sps) {
+      data_rate = option;
+    }
+  }
+  data_rate_config_ = data_rate.config;
+  settings_.data_rate_sps = data_rate.sps;
+
+  settings_.oversampling =
+      constrain(settings_.oversampling, 1, kMaxOversampling);
+  if (settings_.interval_ms < kMinIntervalMs) {
+    settings_.interval_ms = kMinIntervalMs;
+  }
+
+  conversion_time_us_ =
+      kConversionTimeMargin * 1000000. / settings_.data_rate_sps;
+  volts_per_count_ = settings_.full_scale_mv / 1000. / 32768.;
+  effective_interval_ms_ = settings_.interval_ms;
+
+  accumulator_ = 0;
+  accumulated_ = 0;
+}
+
+float ADS1115Channel::get_effective_resolution_uv() const {
+  return 1e6 * volts_per_count_ / sqrtf(settings_.oversampling);
+}
+
+void ADS1115Channel::emit_counts(int32_t sum, uint8_t samples) {
+  if (samples == 0) {
+    return;
+  }
+  if (scanner_->trace_ != nullptr) {
+    scanner_->trace_->record_adc_counts(channel_, sum, samples);
+  }
+  sample_count_++;
+  this->emit(volts_per_count_ * sum / samples);
+}
+
+String ADS1115Channel::get_config_schema() {
+  return R"###({
+  "type": "object",
+  "properties": {
+    "full_scale_mv": {
+      "title": "Full-scale range (mV)",
+      "type": "integer",
+      "enum": [6144, 4096, 2048, 1024, 512, 256]
+    },
+    "data_rate_sps": {
+      "title": "Data rate (samples/s)",
+      "type": "integer",
+      "enum": [8, 16, 32, 64, 128, 250, 475, 860]
+    },
+    "oversampling": {
+      "title": "Conversions averaged per value",
+      "type": "integer",
+      "minimum": 1,
+      "maximum": 64
+    },
+    "interval_ms": {
+      "title": "Output interval (ms)",
+      "type": "integer",
+      "minimum": 10
+    }
+  }
+})###";
+}
+
+bool ADS1115Channel::set_configuration(const JsonObject& config) {
+  const String expected[] = {"full_scale_mv", "data_rate_sps", "oversampling",
+                             "interval_ms"};
+  for (const auto& str : expected) {
+    if (!config.containsKey(str)) {
+      debugE("ADS1115Channel: Missing configuration key %s", str.c_str());
+      return false;
+    }
+  }
+  // Read into int first, so that out-of-range values are clamped instead of
+  // wrapping around in the narrower settings fields
+  const int full_scale_mv = config["full_scale_mv"];
+  const int data_rate_sps = config["data_rate_sps"];
+  const int oversampling = config["oversampling"];
+  const int interval_ms = config["interval_ms"];
+  settings_.full_scale_mv = constrain(full_scale_mv, 0, UINT16_MAX);
+  settings_.data_rate_sps = constrain(data_rate_sps, 0, UINT16_MAX);
+  settings_.oversampling = constrain(oversampling, 1, kMaxOversampling);
+  settings_.interval_ms = std::max(interval_ms, 0);
+  apply_settings();
+  if (scanner_ != nullptr) {
+    scanner_->update_schedule();
+  }
+  return true;
+}
+
+void ADS1115Channel::get_configuration(JsonObject& config) {
+  config["full_scale_mv"] = settings_.full_scale_mv;
+  config["data_rate_sps"] = settings_.data_rate_sps;
+  config["oversampling"] = settings_.oversampling;
+  config["interval_ms"] = settings_.interval_ms;
+}
+
+ADS1115Scanner::ADS1115Scanner(Adafruit_ADS1115* ads1115, int alert_rdy_pin,
+                               const String& config_path)
+    : sensesp::Configurable{config_path},
+      ads1115_{ads1115},
+      alert_rdy_pin_{alert_rdy_pin},
+      bus_budget_percent_{kDefaultBusBudgetPercent},
+      bus_time_per_conversion_us_{kDefaultBusTimePerConversionUs} {
+  load_configuration();
+
+  statistics_start_ms_ = millis();
+  ProfiledRepeat("ADS1115 statistics", kStatisticsIntervalMs,
+                 [this]() { this->update_statistics(); });
+
+  if (ads1115_ == nullptr) {
+    return;
+  }
+
+  if (alert_rdy_pin_ >= 0) {
+    // ALERT/RDY is an open-drain output, asserted low when a single-shot
+    // conversion completes.
+    pinMode(alert_rdy_pin_, INPUT_PULLUP);
+    ProfiledInterrupt("ADS1115 ALERT/RDY", alert_rdy_pin_, FALLING,
+                      [this]() { conversion_ready_flag_ = true; });
+  }
+
+  ProfiledRepeat("ADS1115 scanner", 1, [this]() { this->tick(); });
+}
+
+ADS1115Channel* ADS1115Scanner::enable_channel(
+    int channel, const ADS1115ChannelSettings& settings,
+    const String& config_path) {
+  if (channel < 0 || channel >= kNumChannels) {
+    debugE("ADS1115Scanner: Invalid channel %d", channel);
+    return nullptr;
+  }
+  if (channels_[channel] == nullptr) {
+    channels_[channel] =
+        new ADS1115Channel(this, channel, settings, config_path);
+  }
+  channels_[channel]->next_due_ms_ = millis();
+  update_schedule();
+  return channels_[channel];
+}
+
+float ADS1115Scanner::get_sample_rate(int channel) const {
+  if (channel < 0 || channel >= kNumChannels ||
+      channels_[channel] == nullptr) {
+    return 0;
+  }
+  return channels_[channel]->get_sample_rate();
+}
+
+void ADS1115Scanner::update_schedule() {
+  // Conversions per second and the resulting ADC and bus load if every
+  // channel ran at its configured interval.
+  float adc_load = 0;
+  float bus_load = 0;
+  for (const auto* ch : channels_) {
+    if (ch == nullptr) {
+      continue;
+    }
+    const float conversions_per_s =
+        1000. * ch->settings_.oversampling / ch->settings_.interval_ms;
+    adc_load += conversions_per_s * ch->conversion_time_us_ / 1e6;
+    bus_load += conversions_per_s * bus_time_per_conversion_us_ / 1e6;
+  }
+
+  interval_scale_ = 1;
+  if (adc_load / kMaxADCUtilization > interval_scale_) {
+    interval_scale_ = adc_load / kMaxADCUtilization;
+  }
+  if (bus_load / (bus_budget_percent_ / 100.) > interval_scale_) {
+    interval_scale_ = bus_load / (bus_budget_percent_ / 100.);
+  }
+
+  for (auto* ch : channels_) {
+    if (ch != nullptr) {
+      ch->effective_interval_ms_ =
+          ceilf(ch->settings_.interval_ms * interval_scale_);
+    }
+  }
+
+  if (interval_scale_ > 1) {
+    debugW(
+        "ADS1115Scanner: Requested rates exceed the I2C budget; intervals "
+        "stretched by %.2f",
+        interval_scale_);
+  }
+}
+
+void ADS1115Scanner::tick() {
+  const uint32_t now = millis();
+  const uint32_t start_us = micros();
+
+  ADS1115Channel* finished_channel = nullptr;
+  int32_t sum = 0;
+  uint8_t samples = 0;
+
+  if (active_channel_ >= 0 && conversion_ready()) {
+    ADS1115Channel* ch = channels_[active_channel_];
+    ch->accumulator_ += ads1115_->getLastConversionResults();
+    ch->accumulated_++;
+    if (ch->accumulated_ >= ch->settings_.oversampling) {
+      sum = ch->accumulator_;
+      samples = ch->accumulated_;
+      ch->accumulator_ = 0;
+      ch->accumulated_ = 0;
+      finished_channel = ch;
+    }
+    active_channel_ = -1;
+  }
+
+  if (active_channel_ < 0) {
+    const int channel = next_due_channel(now);
+    if (channel >= 0) {
+      start_conversion(channel, now);
+    }
+  }
+
+  const uint32_t stall_us = micros() - start_us;
+  if (stall_us > max_stall_us_) {
+    max_stall_us_ = stall_us;
+  }
+  bus_time_us_ += stall_us;
+
+  // Emit outside of the measured section; the time spent in the downstream
+  // transforms is not caused by the scanner.
+  if (finished_channel != nullptr) {
+    finished_channel->emit_counts(sum, samples);
+  }
+}
+
+int ADS1115Scanner::next_due_channel(uint32_t now) const {
+  for (int ii = 1; ii <= kNumChannels; ii++) {
+    const int channel = (last_channel_ + ii) % kNumChannels;
+    const ADS1115Channel* ch = channels_[channel];
+    if (ch == nullptr) {
+      continue;
+    }
+    // A channel that has started an oversampled value stays due until all
+    // of its conversions are done.
+    if (ch->accumulated_ > 0 ||
+        static_cast<int32_t>(now - ch->next_due_ms_) >= 0) {
+      return channel;
+    }
+  }
+  return -1;
+}
+
+void ADS1115Scanner::start_conversion(int channel, uint32_t now) {
+  ADS1115Channel* ch = channels_[channel];
+
+  conversion_ready_flag_ = false;
+  ads1115_->setGain(ch->gain_);
+  ads1115_->setDataRate(ch->data_rate_config_);
+  ads1115_->startADCReading(kChannelMux[channel], /*continuous=*/false);
+
+  active_channel_ = channel;
+  last_channel_ = channel;
+  conversion_start_us_ = micros();
+  conversions_++;
+
+  if (ch->accumulated_ == 0) {
+    // First conversion of a new output value
+    ch->next_due_ms_ += ch->effective_interval_ms_;
+    if (static_cast<int32_t>(now - ch->next_due_ms_) >= 0) {
+      // We have fallen behind by more than a full interval; don't try to
+      // catch up with a burst of samples.
+      ch->next_due_ms_ = now + ch->effective_interval_ms_;
+    }
+  }
+}
+
+bool ADS1115Scanner::conversion_ready() {
+  if (conversion_ready_flag_) {
+    return true;
+  }
+  const ADS1115Channel* ch = channels_[active_channel_];
+  if (micros() - conversion_start_us_ < ch->conversion_time_us_) {
+    return false;
+  }
+  // Either no ALERT/RDY pin is available or the edge was missed: ask the chip.
+  return ads1115_->conversionComplete();
+}
+
+void ADS1115Scanner::update_statistics() {
+  const uint32_t now = millis();
+  const uint32_t elapsed_ms = now - statistics_start_ms_;
+  statistics_start_ms_ = now;
+
+  if (elapsed_ms > 0) {
+    bus_utilization_ = bus_time_us_ / (1000. * elapsed_ms);
+  }
+  if (conversions_ > 0) {
+    bus_time_per_conversion_us_ = bus_time_us_ / conversions_;
+  }
+  bus_time_us_ = 0;
+  conversions_ = 0;
+
+  for (auto* ch : channels_) {
+    if (ch == nullptr) {
+      continue;
+    }
+    ch->sample_rate_ = elapsed_ms > 0 ? 1000. * ch->sample_count_ / elapsed_ms
+                                      : 0;
+    ch->sample_count_ = 0;
+    debugD(
+        "ADS1115 channel %d: +-%d mV, %d SPS x%d, %.2f values/s, "
+        "%.1f uV resolution",
+        ch->channel_, ch->settings_.full_scale_mv, ch->settings_.data_rate_sps,
+        ch->settings_.oversampling, ch->sample_rate_,
+        ch->get_effective_resolution_uv());
+  }
+  debugD(
+      "ADS1115 scanner: %.1f%% I2C bus time, %u us per conversion, "
+      "interval scale %.2f, max loop stall %u us",
+      100 * bus_utilization_, bus_time_per_conversion_us_, interval_scale_,
+      max_stall_us_);
+
+  // Re-plan with the measured bus time per conversion
+  update_schedule();
+}
+
+String ADS1115Scanner::get_config_schema() {
+  return R"###({
+  "type": "object",
+  "properties": {
+    "bus_budget_percent": {
+      "title": "I2C bus time budget (%)",
+      "type": "number",
+      "minimum": 1,
+      "maximum": 100
+    }
+  }
+})###";
+}
+
+bool ADS1115Scanner::set_configuration(const JsonObject& config) {
+  if (!config.containsKey("bus_budget_percent")) {
+    debugE("ADS1115Scanner: Missing configuration key bus_budget_percent");
+    return false;
+  }
+  bus_budget_percent_ = config["bus_budget_percent"];
+  bus_budget_percent_ = constrain(bus_budget_percent_, 1.f, 100.f);
+  update_schedule();
+  return true;
+}
+
+void ADS1115Scanner::get_configuration(JsonObject& config) {
+  config["bus_budget_percent"] = bus_budget_percent_;
+}
+
+}  // namespace halmet
@@ -0,0 +1,213 @@
+#ifndef HALMET_SRC_ADS1115_SCANNER_H_
+#define HALMET_SRC_ADS1115_SCANNER_H_
+
+#include "sensor_trace.h"
+
+#include <Arduino.h>
+#include <WString.h>
+
+#include <Adafruit_ADS1X15.h>
+
+#include <sensesp/system/configurable.h>
+#include <sensesp/system/valueproducer.h>
+
+#include <cstdint>
+
+namespace halmet {
+
+class ADS1115Scanner;
+
+/**
+ * @brief Sampling parameters of a single ADS1115 channel.
+ *
+ * Values are in user-facing units; they are translated to ADS1115 register
+ * settings when applied.
+ */
+struct ADS1115ChannelSettings {
+  // PGA full-scale range in millivolts: 6144, 4096, 2048, 1024, 512 or 256
+  uint16_t full_scale_mv;
+  // Data rate in samples per second: 8, 16, 32, 64, 128, 250, 475 or 860
+  uint16_t data_rate_sps;
+  // Number of conversions averaged into one output value
+  uint8_t oversampling;
+  // Interval between consecutive output values
+  uint32_t interval_ms;
+};
+
+/**
+ * @brief A configurable ADS1115 input channel.
+ *
+ * Emits the input voltage (V) at the ADS1115 pin. Instances are created by
+ * ADS1115Scanner::enable_channel().
+ */
+class ADS1115Channel : public sensesp::FloatProducer,
+                       public sensesp::Configurable {
+ public:
+  ADS1115Channel(ADS1115Scanner* scanner, int channel,
+                 const ADS1115ChannelSettings& settings,
+                 const String& config_path);
+
+  const ADS1115ChannelSettings& get_settings() const { return settings_; }
+
+  /// Measured output rate (Hz) over the last statistics period.
+  float get_sample_rate() const { return sample_rate_; }
+
+  /// Output interval after the scanner has applied the I2C time budget.
+  uint32_t get_effective_interval() const { return effective_interval_ms_; }
+
+  /**
+   * @brief Estimated resolution of an output value (uV).
+   *
+   * One LSB of the selected range, reduced by the square root of the
+   * oversampling factor. This assumes at least one LSB of uncorrelated noise
+   * at the input, which is the case for the resistive senders on HALMET.
+   */
+  float get_effective_resolution_uv() const;
+
+  /**
+   * @brief Emit the average of samples conversion results.
+   *
+   * Called by the scanner once all conversions of an output value are done.
+   * A trace replay calls it with the recorded counts instead.
+   */
+  void emit_counts(int32_t sum, uint8_t samples);
+
+  String get_config_schema() override;
+  bool set_configuration(const JsonObject& config) override;
+  void get_configuration(JsonObject& config) override;
+
+ protected:
+  friend class ADS1115Scanner;
+
+  /// Translate settings_ to the ADS1115 register values below.
+  void apply_settings();
+
+  ADS1115Scanner* scanner_;
+  const int channel_;
+  ADS1115ChannelSettings settings_;
+
+  // Derived from settings_
+  adsGain_t gain_;
+  uint16_t data_rate_config_;
+  uint32_t conversion_time_us_;
+  float volts_per_count_;
+
+  // Scheduling and accumulation state, maintained by the scanner
+  uint32_t effective_interval_ms_;
+  uint32_t next_due_ms_ = 0;
+  int32_t accumulator_ = 0;
+  uint8_t accumulated_ = 0;
+  uint32_t sample_count_ = 0;
+  float sample_rate_ = 0;
+};
+
+/**
+ * @brief Non-blocking round-robin reader for the ADS1115 input channels.
+ *
+ * The scanner owns the ADS1115. It starts a single-shot conversion and
+ * returns to the event loop immediately. The result is collected on a later
+ * tick, either once the ALERT/RDY pin has signalled completion or, if no pin
+ * is wired, once the nominal conversion time has elapsed and the chip reports
+ * the conversion done. The scanner then moves on to the next enabled channel
+ * that is due and emits the measured voltage to that channel's producer.
+ *
+ * Each channel has its own gain, data rate and oversampling factor. The
+ * conversions of an oversampled value are interleaved with those of the
+ * other channels so that a heavily averaged tank input does not hold up a
+ * fast pressure input. If the configured rates would need more I2C bus time
+ * than the budget allows, all channel intervals are stretched by the same
+ * factor.
+ *
+ * Without an ADS1115, the scanner doesn't sample at all and only holds the
+ * channels, whose values are then fed by a trace replay.
+ */
+class ADS1115Scanner : public sensesp::Configurable {
+ public:
+  static constexpr int kNumChannels = 4;
+
+  ADS1115Scanner(Adafruit_ADS1115* ads1115, int alert_rdy_pin = -1,
+                 const String& config_path = "");
+
+  /**
+   * @brief Enable a channel for scanning.
+   *
+   * @param channel ADS1115 input channel, 0..3
+   * @param settings Default sampling parameters of the channel
+   * @param config_path Configuration path of the channel settings
+   * @return Producer emitting the channel input voltage (V), or nullptr if
+   * the channel number is invalid.
+   */
+  ADS1115Channel* enable_channel(int channel,
+                                 const ADS1115ChannelSettings& settings,
+                                 const String& config_path = "");
+
+  /// Measured sample rate of a channel (Hz) over the last statistics period.
+  float get_sample_rate(int channel) const;
+
+  /// Longest time (us) a single scanner tick has kept the event loop busy.
+  uint32_t get_max_stall_us() const { return max_stall_us_; }
+
+  void reset_max_stall() { max_stall_us_ = 0; }
+
+  /// Fraction of I2C bus time used by the scanner in the last period.
+  float get_bus_utilization() const { return bus_utilization_; }
+
+  /// Factor by which the channel intervals are stretched to meet the budget.
+  float get_interval_scale() const { return interval_scale_; }
+
+  /// Recompute the effective channel intervals after a settings change.
+  void update_schedule();
+
+  /// Record the count sums of all output values to trace.
+  void set_trace_writer(SensorTraceWriter* trace) { trace_ = trace; }
+
+  /// Channel object of an enabled channel, or nullptr.
+  ADS1115Channel* get_channel(int channel) const {
+    return channel >= 0 && channel < kNumChannels ? channels_[channel]
+                                                  : nullptr;
+  }
+
+  String get_config_schema() override;
+  bool set_configuration(const JsonObject& config) override;
+  void get_configuration(JsonObject& config) override;
+
+ protected:
+  friend class ADS1115Channel;
+
+  void tick();
+  void update_statistics();
+
+  /// Return the index of the next due channel after the current one, or -1.
+  int next_due_channel(uint32_t now) const;
+  void start_conversion(int channel, uint32_t now);
+  bool conversion_ready();
+
+  Adafruit_ADS1115* ads1115_;
+  int alert_rdy_pin_;
+  SensorTraceWriter* trace_ = nullptr;
+  ADS1115Channel* channels_[kNumChannels] = {};
+
+  // Maximum share of the I2C bus time the scanner may use, in percent
+  float bus_budget_percent_;
+
+  // Channel with a conversion in progress, or -1 if idle
+  int active_channel_ = -1;
+  // Channel that was sampled last; the round-robin search starts after it
+  int last_channel_ = kNumChannels - 1;
+  uint32_t conversion_start_us_ = 0;
+  volatile bool conversion_ready_flag_ = false;
+
+  // Average I2C time of one conversion (start, poll and readout)
+  uint32_t bus_time_per_conversion_us_;
+  uint32_t bus_time_us_ = 0;
+  uint32_t conversions_ = 0;
+  float bus_utilization_ = 0;
+  float interval_scale_ = 1;
+
+  uint32_t max_stall_us_ = 0;
+  uint32_t statistics_start_ms_ = 0;
+};
+
+}  // namespace halmet
+
+#endif  // HALMET_SRC_ADS1115_SCANNER_H_
@@ -0,0 +1,225 @@
+#include "analog_channels.h"
+
+#include "curve_lookup_table.h"
+#include "halmet_analog.h"
+
+#include <WString.h>
+
+#include <sensesp/system/lambda_consumer.h>
+#include <sensesp/system/local_debug.h>
+#include <sensesp/transforms/curveinterpolator.h>
+#include <sensesp/transforms/lambda_transform.h>
+#include <sensesp/transforms/linear.h>
+#include <sensesp/ui/ui_controls.h>
+
+#ifdef ENABLE_SIGNALK
+#include <sensesp/signalk/signalk_output.h>
+#endif
+
+namespace halmet {
+
+namespace {
+
+// Default fuel tank size, in m3
+constexpr float kTankDefaultSize = 120. / 1000;
+
+// Tank capacity reported in the NMEA 2000 fluid level PGN, in liters
+constexpr double kN2kTankCapacity = 200;
+
+constexpr float kDefaultLowPressureLimit = 100000;
+
+constexpr char kFillLevelCurveDescription[] =
+    "Piecewise linear conversion of the resistance to a "
+    "fill level ratio between 0 and 1.</p>"
+    "<p>Input values are resistances in ohms, outputs are the corresponding "
+    "fill level ratios (between 0 and 1).";
+
+constexpr char kPressureCurveDescription[] =
+    "Piecewise linear conversion of the resistance of the sender to a "
+    "pressure in Pascal. Input is resistance, output is pressure in Pascal.";
+
+// Signal K deadbands of the batched outputs
+constexpr float kResistanceMinChange = 1;       // ohm
+constexpr float kLevelMinChange = 0.001;        // ratio
+constexpr float kVolumeMinChange = 0.0001;      // m3
+constexpr float kPressureMinChange = 500;       // Pa
+
+#ifdef ENABLE_SIGNALK
+void ConnectSKOutput(sensesp::FloatProducer* producer, const char* sk_path,
+                     const char* config_path, sensesp::SKMetadata* metadata,
+                     float min_change, int sort_order,
+                     SKDeltaBatcher* sk_batcher) {
+  auto* sk_output =
+      new sensesp::SKOutputFloat(sk_path, config_path, metadata);
+  sk_output->set_sort_order(sort_order);
+  if (sk_batcher != nullptr) {
+    producer->connect_to(sk_batcher->add(sk_output->get_sk_path(), min_change))
+        ->connect_to(sk_output);
+  } else {
+    producer->connect_to(sk_output);
+  }
+}
+#endif
+
+sensesp::FloatProducer* TankSender(const AnalogChannel& channel,
+                                   const AnalogChannelOutputs& outputs,
+                                   sensesp::FloatProducer* resistance) {
+  const int sort_order = channel.sort_order;
+
+  // Resistance converted to relative value 0..1
+  auto* level = new CurveLookupTable(1, channel.curve_path);
+  level->set_input_title("Sender Resistance (ohms)")
+      ->set_output_title("Fill Level (ratio)")
+      ->set_description(kFillLevelCurveDescription)
+      ->set_sort_order(sort_order + 100);
+  if (level->get_samples().empty()) {
+    // If there's no prior configuration, provide a default curve
+    level->clear_samples();
+    level->add_sample(sensesp::CurveInterpolator::Sample(0, 0));
+    level->add_sample(sensesp::CurveInterpolator::Sample(900., 0.5));
+    level->add_sample(sensesp::CurveInterpolator::Sample(1800., 1));
+  }
+  resistance->connect_to(level);
+
+  // Level converted to remaining volume in m3
+  auto* volume =
+      new sensesp::Linear(kTankDefaultSize, 0, channel.secondary_path);
+  volume->set_description(channel.secondary_description);
+  volume->set_sort_order(sort_order + 200);
+  level->connect_to(volume);
+
+#ifdef ENABLE_SIGNALK
+  ConnectSKOutput(resistance, channel.sk_resistance_path,
+                  channel.sk_resistance_config_path,
+                  new sensesp::SKMetadata("ohm",
+                                          channel.sk_resistance_description,
+                                          channel.sk_resistance_description),
+                  kResistanceMinChange, sort_order + 300, outputs.sk_batcher);
+  ConnectSKOutput(level, channel.sk_value_path, channel.sk_value_config_path,
+                  new sensesp::SKMetadata("ratio",
+                                          channel.sk_value_display_name,
+                                          channel.sk_value_description),
+                  kLevelMinChange, sort_order + 400, outputs.sk_batcher);
+  ConnectSKOutput(volume, channel.sk_volume_path,
+                  channel.sk_volume_config_path,
+                  new sensesp::SKMetadata("m3", channel.sk_volume_display_name,
+                                          channel.sk_volume_description),
+                  kVolumeMinChange, sort_order + 500, outputs.sk_batcher);
+#endif
+
+#ifdef ENABLE_NMEA2000_OUTPUT
+  if (outputs.n2k_scheduler != nullptr) {
+    auto* n2k_tank_level_output = new N2kFluidLevelSender(
+        channel.n2k_path, channel.n2k_instance, channel.n2k_fluid_type,
+        kN2kTankCapacity, outputs.n2k_scheduler);
+    n2k_tank_level_output->set_sort_order(sort_order + 600);
+    volume->connect_to(&(n2k_tank_level_output->tank_level_consumer_));
+  }
+#endif
+
+  return volume;
+}
+
+sensesp::FloatProducer* PressureSender(const AnalogChannel& channel,
+                                       const AnalogChannelOutputs& outputs,
+                                       sensesp::FloatProducer* resistance) {
+  const int sort_order = channel.sort_order;
+
+  // Resistance converted to pressure in Pa
+  auto* pressure =
+      (new sensesp::CurveInterpolator(nullptr, channel.curve_path))
+          ->set_input_title("Sender Resistance (ohms)")
+          ->set_output_title("Pressure (Pa)");
+  pressure->set_description(kPressureCurveDescription);
+  pressure->set_sort_order(sort_order + 100);
+  if (pressure->get_samples().empty()) {
+    // If there's no prior configuration, provide a default curve
+    pressure->clear_samples();
+    pressure->add_sample(sensesp::CurveInterpolator::Sample(0, 0));
+    pressure->add_sample(sensesp::CurveInterpolator::Sample(900., 150000));
+    pressure->add_sample(sensesp::CurveInterpolator::Sample(1800., 300000));
+  }
+  resistance->connect_to(pressure);
+
+  const auto* low_pressure_limit =
+      new sensesp::ParamInfo[1]{{"low_pressure_limit", "Low Pressure Limit"}};
+
+  const auto alarm_pressure_low_comparator =
+      [](float pressure, float limit) -> bool { return pressure < limit; };
+
+  auto* low_pressure_alarm = new sensesp::LambdaTransform<float, bool, float>(
+      alarm_pressure_low_comparator,
+      kDefaultLowPressureLimit,  // Default value for parameter
+      low_pressure_limit,        // Parameter UI description
+      channel.secondary_path);
+  low_pressure_alarm->set_description(channel.secondary_description);
+  low_pressure_alarm->set_sort_order(sort_order + 150);
+  pressure->connect_to(low_pressure_alarm);
+
+#ifdef ENABLE_SIGNALK
+  ConnectSKOutput(resistance, channel.sk_resistance_path,
+                  channel.sk_resistance_config_path,
+                  new sensesp::SKMetadata("ohm",
+                                          channel.sk_resistance_description,
+                                          channel.sk_resistance_description),
+                  kResistanceMinChange, sort_order + 200, outputs.sk_batcher);
+  ConnectSKOutput(pressure, channel.sk_value_path, channel.sk_value_config_path,
+                  new sensesp::SKMetadata("Pa", channel.sk_value_display_name,
+                                          channel.sk_value_description),
+                  kPressureMinChange, sort_order + 300, outputs.sk_batcher);
+#endif
+
+#ifdef ENABLE_NMEA2000_OUTPUT
+  if (outputs.n2k_engine_dynamic_sender != nullptr) {
+    pressure->connect_to(
+        &(outputs.n2k_engine_dynamic_sender->oil_pressure_consumer_));
+    low_pressure_alarm->connect_to(
+        &(outputs.n2k_engine_dynamic_sender->low_oil_pressure_consumer_));
+  }
+#endif
+
+  return pressure;
+}
+
+}  // namespace
+
+sensesp::FloatProducer* AnalogChannelSender(
+    const AnalogChannel& channel, const AnalogChannelOutputs& outputs) {
+  auto* enable = new sensesp::CheckboxConfig(channel.enabled_by_default,
+                                             channel.enable_title,
+                                             channel.enabled_path);
+  enable->set_description(channel.enable_description);
+  enable->set_sort_order(channel.sort_order);
+  if (!enable->get_value()) {
+    return nullptr;
+  }
+  if (channel.adc >= outputs.num_scanners) {
+    debugE("%s: No ADS1115 with index %d", channel.display_name, channel.adc);
+    return nullptr;
+  }
+
+  const bool is_tank = channel.type == AnalogSenderType::kTank;
+  auto* resistance = AnalogResistanceSender(
+      outputs.scanners[channel.adc], channel.adc_channel,
+      channel.adc_settings_path,
+      is_tank ? kTankSenderADCSettings : kPressureSenderADCSettings,
+      channel.sort_order + 50);
+
+  auto* output = is_tank ? TankSender(channel, outputs, resistance)
+                         : PressureSender(channel, outputs, resistance);
+
+  if (channel.display_row >= 0 && outputs.display_renderer != nullptr) {
+    auto* display_renderer = outputs.display_renderer;
+    const int row = channel.display_row;
+    const char* title = channel.display_name;
+    const float scale = is_tank ? 100 : 1;
+    output->connect_to(new sensesp::LambdaConsumer<float>(
+        [display_renderer, row, title, scale](float value) {
+          PrintValue(display_renderer, row, title, scale * value);
+        }));
+  }
+
+  return output;
+}
+
+}  // namespace halmet
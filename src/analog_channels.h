@@ -0,0 +1,149 @@
+#ifndef HALMET_SRC_ANALOG_CHANNELS_H_
+#define HALMET_SRC_ANALOG_CHANNELS_H_
+
+#include "ads1115_scanner.h"
+#include "halmet_display.h"
+#include "n2k_scheduler.h"
+#include "n2k_senders.h"
+#include "sk_delta_batcher.h"
+
+#include <N2kTypes.h>
+
+#include <sensesp/system/valueproducer.h>
+
+#include <cstddef>
+#include <cstdint>
+
+namespace halmet {
+
+enum class AnalogSenderType : uint8_t {
+  // Resistive tank sender: fill level and remaining volume
+  kTank,
+  // Resistive oil pressure sender with a low pressure alarm
+  kPressure,
+};
+
+/**
+ * @brief Description of one resistive sender input.
+ *
+ * All strings are literals, so the table of channels can be constexpr. Use
+ * the HALMET_TANK_CHANNEL and HALMET_PRESSURE_CHANNEL macros to fill in the
+ * strings from the input name; the configuration paths are those of the
+ * hand-written channels they replace, so existing settings are kept.
+ */
+struct AnalogChannel {
+  AnalogSenderType type;
+  // Index into AnalogChannelOutputs::scanners and the ADS1115 input, 0..3
+  uint8_t adc;
+  uint8_t adc_channel;
+  bool enabled_by_default;
+  // Base of the UI sort orders of the channel's settings
+  int sort_order;
+  // OLED display row, or -1 to not show the channel
+  int8_t display_row;
+  // NMEA 2000 fluid level instance and type; tanks only
+  uint8_t n2k_instance;
+  tN2kFluidType n2k_fluid_type;
+
+  const char* display_name;
+  const char* enable_title;
+  const char* enable_description;
+  const char* enabled_path;
+  const char* adc_settings_path;
+  const char* curve_path;
+  // Level to volume conversion for tanks, low pressure alarm for pressure
+  // senders
+  const char* secondary_path;
+  const char* secondary_description;
+  const char* n2k_path;
+
+  // Signal K outputs: sender resistance, level or pressure, and volume
+  const char* sk_resistance_path;
+  const char* sk_resistance_config_path;
+  const char* sk_resistance_description;
+  const char* sk_value_path;
+  const char* sk_value_config_path;
+  const char* sk_value_display_name;
+  const char* sk_value_description;
+  const char* sk_volume_path;
+  const char* sk_volume_config_path;
+  const char* sk_volume_display_name;
+  const char* sk_volume_description;
+};
+
+// A tank sender on input `input` (e.g. "A1") reported at
+// tanks.<sk_fluid>.<input>
+#define HALMET_TANK_CHANNEL(adc, adc_channel, input, sk_fluid, n2k_fluid_type, \
+                            n2k_instance, enabled, sort_order, display_row)    \
+  {                                                                            \
+    halmet::AnalogSenderType::kTank, adc, adc_channel, enabled, sort_order,    \
+        display_row, n2k_instance, n2k_fluid_type, "Tank " input,              \
+        "Enable " input " Input",                                              \
+        "Enable analog tank level input " input                                \
+        ". Requires a reboot to take effect.",                                 \
+        "/Tank " input "/Enabled", "/Tank " input "/ADC Settings",             \
+        "/Tank " input "/Level Curve", "/Tank " input "/Total Volume",         \
+        "Total volume of tank " input " in m3", "/Tank " input "/NMEA 2000",   \
+        "tanks." sk_fluid "." input ".senderResistance",                       \
+        "/Tank " input "/Sender Resistance",                                   \
+        "Input " input " sender resistance",                                   \
+        "tanks." sk_fluid "." input ".currentLevel",                           \
+        "/Tank " input "/Current Level", "Tank " input " level",               \
+        "Tank " input " level",                                                \
+        "tanks." sk_fluid "." input ".currentVolume",                          \
+        "/Tank " input "/Current Volume", "Tank " input " volume",             \
+        "Calculated tank " input " remaining volume"                           \
+  }
+
+// An oil pressure sender on input `input` reported at sk_path, connected to
+// the engine dynamic parameters PGN
+#define HALMET_PRESSURE_CHANNEL(adc, adc_channel, input, sk_path, enabled,    \
+                                sort_order, display_row)                      \
+  {                                                                           \
+    halmet::AnalogSenderType::kPressure, adc, adc_channel, enabled,           \
+        sort_order, display_row, 0, N2kft_Oil, "Pressure " input,             \
+        "Enable " input " Input",                                             \
+        "Enable analog pressure input " input                                 \
+        ". Requires a reboot to take effect.",                                \
+        "/Pressure " input "/Enabled", "/Pressure " input "/ADC Settings",    \
+        "/Pressure " input "/Pressure", "/Pressure " input                    \
+        "/Low Pressure Alarm",                                                \
+        "Alarm if the pressure falls below the set limit. Value in Pascal.",  \
+        nullptr, sk_path "SenderResistance",                                  \
+        "/Pressure " input "/Sender Resistance",                              \
+        "Input " input " sender resistance", sk_path,                         \
+        "/Pressure " input "/Current Pressure", "Oil Pressure",               \
+        "Main Engine Oil Pressure", nullptr, nullptr, nullptr, nullptr        \
+  }
+
+/**
+ * @brief The objects the analog channels connect their outputs to.
+ *
+ * Pointers that are null, e.g. with NMEA 2000 output disabled, are skipped.
+ */
+struct AnalogChannelOutputs {
+  // One scanner per ADS1115; the on-board converter is the first
+  ADS1115Scanner* const* scanners;
+  size_t num_scanners;
+  SKDeltaBatcher* sk_batcher;
+  N2kTxScheduler* n2k_scheduler;
+  N2kEngineParameterDynamicSender* n2k_engine_dynamic_sender;
+  SSD1306Renderer* display_renderer;
+};
+
+/**
+ * @brief Build the sensor pipeline of an analog channel.
+ *
+ * Creates the channel's enable checkbox and, if it is enabled, the ADC
+ * channel, the conversion curve, the Signal K outputs and the NMEA 2000
+ * connections.
+ *
+ * @return The tank volume or the pressure, or nullptr if the channel is
+ *   disabled.
+ */
+sensesp::FloatProducer* AnalogChannelSender(
+    const AnalogChannel& channel, const AnalogChannelOutputs& outputs);
+
+}  // namespace halmet
+
+#endif  // HALMET_SRC_ANALOG_CHANNELS_H_
@@ -1,42 +1,197 @@
 #ifndef HALMET_SRC_ANY_TRANSFORM_H_
 #define HALMET_SRC_ANY_TRANSFORM_H_
 
-#include <elapsedMillis.h>
+#include <Arduino.h>
+#include <ReactESP.h>
 #include <sensesp/transforms/transform.h>
 
-#include <array>
+#include <cstddef>
+#include <cstdint>
 
 namespace sensesp {
 
 /**
- * @brief A transform that returns true if any of the input values are true.
+ * @brief Base of the transforms that combine N boolean inputs.
  *
- * If any of the input values are older than the expiration duration, no
- * value is returned. Otherwise a value is emitted if any of the input values
- * is updated.
+ * Each input channel is a bit in a mask, with its own last update time.
+ * Channels that have never been updated are absent: they are left out of
+ * the result and don't hold back the output, so N can be the number of
+ * inputs that may be connected. Once a channel has been updated, it must
+ * stay fresh: whenever any present input is older than the expiration
+ * duration, no value is emitted. Otherwise a value is emitted when the
+ * result changes, when the inputs become fresh again, and every heartbeat
+ * interval.
+ * Updates to channels N and up are ignored.
  *
- * @tparam _Nm
+ * @tparam _Nm Number of inputs, at most 32
+ * @tparam P Output type
  */
+template <std::size_t _Nm, typename P>
+class BitmaskTransform : public sensesp::Transform<bool, P> {
+  static_assert(_Nm >= 1 && _Nm <= 32, "BitmaskTransform takes 1-32 inputs");
 
-template <std::size_t _Nm>
-class AnyTransform : public sensesp::Transform<bool, bool> {
  public:
-  AnyTransform(const String& config_path = "")
-      : Transform<bool, bool>(config_path), value_({}) {}
+  /**
+   * @param expiration_ms Inputs older than this are stale, or 0 for never
+   * @param heartbeat_ms Emit the unchanged result again at this interval,
+   *   or 0 to emit changes only
+   */
+  BitmaskTransform(uint32_t expiration_ms, uint32_t heartbeat_ms,
+                   const String& config_path)
+      : Transform<bool, P>(config_path), expiration_ms_{expiration_ms} {
+    if (heartbeat_ms > 0) {
+      reactesp::ReactESP::app->onRepeat(heartbeat_ms,
+                                        [this]() { this->heartbeat(); });
+    }
+  }
 
   virtual void set_input(bool input, uint8_t input_channel) {
-    value_[input_channel] = input;
-    for (const auto& item : value_) {
-      if (item) {
-        this->emit(true);
-        return;
-      }
+    if (input_channel >= _Nm) {
+      return;
+    }
+    const uint32_t mask = 1UL << input_channel;
+    if (input) {
+      values_ |= mask;
+    } else {
+      values_ &= ~mask;
+    }
+    updated_ |= mask;
+    const uint32_t now = millis();
+    last_update_[input_channel] = now;
+
+    if (!inputs_fresh(now)) {
+      // Emit the result again once all present inputs are fresh
+      has_output_ = false;
+      return;
+    }
+    const P result = compute(values_, updated_);
+    if (has_output_ && result == this->get()) {
+      return;
     }
-    this->emit(false);
+    has_output_ = true;
+    this->emit(result);
   }
 
+ protected:
+  /// Result for the input bitmask values of the present inputs. Bits of
+  /// absent inputs are 0 in both masks.
+  virtual P compute(uint32_t values, uint32_t present) = 0;
+
  private:
-  std::array<bool, _Nm> value_;
+  void heartbeat() {
+    if (!has_output_) {
+      return;
+    }
+    if (inputs_fresh(millis())) {
+      this->emit(this->get());
+    } else {
+      has_output_ = false;
+    }
+  }
+
+  bool inputs_fresh(uint32_t now) {
+    if (expiration_ms_ == 0 || static_cast<int32_t>(now - next_expiry_) <= 0) {
+      return true;
+    }
+    // Updates only move the expiry later, so next_expiry_ is a lower bound.
+    // Once it has passed, find the actual oldest present input.
+    uint32_t oldest = now;
+    for (std::size_t ii = 0; ii < _Nm; ii++) {
+      if ((updated_ & (1UL << ii)) &&
+          static_cast<int32_t>(last_update_[ii] - oldest) < 0) {
+        oldest = last_update_[ii];
+      }
+    }
+    next_expiry_ = oldest + expiration_ms_;
+    return static_cast<int32_t>(now - next_expiry_) <= 0;
+  }
+
+  const uint32_t expiration_ms_;
+  uint32_t values_ = 0;
+  // Inputs that have been updated at least once, i.e. are present
+  uint32_t updated_ = 0;
+  // No input expires before this time
+  uint32_t next_expiry_ = 0;
+  uint32_t last_update_[_Nm] = {};
+  bool has_output_ = false;
+};
+
+/**
+ * @brief A transform that returns true if any of the input values are true.
+ *
+ * @tparam _Nm
+ */
+template <std::size_t _Nm>
+class AnyTransform : public BitmaskTransform<_Nm, bool> {
+ public:
+  AnyTransform(uint32_t expiration_ms = 5000, uint32_t heartbeat_ms = 0,
+               const String& config_path = "")
+      : BitmaskTransform<_Nm, bool>(expiration_ms, heartbeat_ms,
+                                    config_path) {}
+
+ protected:
+  bool compute(uint32_t values, uint32_t present) override {
+    return values != 0;
+  }
+};
+
+/**
+ * @brief A transform that returns true if all of the present input values
+ * are true.
+ *
+ * @tparam _Nm
+ */
+template <std::size_t _Nm>
+class AllTransform : public BitmaskTransform<_Nm, bool> {
+ public:
+  AllTransform(uint32_t expiration_ms = 5000, uint32_t heartbeat_ms = 0,
+               const String& config_path = "")
+      : BitmaskTransform<_Nm, bool>(expiration_ms, heartbeat_ms,
+                                    config_path) {}
+
+ protected:
+  bool compute(uint32_t values, uint32_t present) override {
+    return values == present;
+  }
+};
+
+/**
+ * @brief A transform that returns true if more than half of the present
+ * input values are true.
+ *
+ * @tparam _Nm
+ */
+template <std::size_t _Nm>
+class MajorityTransform : public BitmaskTransform<_Nm, bool> {
+ public:
+  MajorityTransform(uint32_t expiration_ms = 5000, uint32_t heartbeat_ms = 0,
+                    const String& config_path = "")
+      : BitmaskTransform<_Nm, bool>(expiration_ms, heartbeat_ms,
+                                    config_path) {}
+
+ protected:
+  bool compute(uint32_t values, uint32_t present) override {
+    return 2 * __builtin_popcount(values) > __builtin_popcount(present);
+  }
+};
+
+/**
+ * @brief A transform that returns the number of true input values.
+ *
+ * @tparam _Nm
+ */
+template <std::size_t _Nm>
+class CountTransform : public BitmaskTransform<_Nm, int> {
+ public:
+  CountTransform(uint32_t expiration_ms = 5000, uint32_t heartbeat_ms = 0,
+                 const String& config_path = "")
+      : BitmaskTransform<_Nm, int>(expiration_ms, heartbeat_ms, config_path) {
+  }
+
+ protected:
+  int compute(uint32_t values, uint32_t present) override {
+    return __builtin_popcount(values);
+  }
 };
 
 }  // namespace sensesp
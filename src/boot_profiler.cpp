@@ -0,0 +1,158 @@
+#include "boot_profiler.h"
+
+#include "profiler_common.h"
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+
+#include <sensesp/system/local_debug.h>
+
+#include <cstring>
+
+namespace halmet {
+
+namespace {
+
+struct BootRecord {
+  const char* name;
+  uint32_t time_us;
+  uint32_t value;
+  bool is_event;
+};
+
+BootRecord records[kMaxBootPhases];
+int num_records = 0;
+
+const char* budget_name = nullptr;
+uint32_t budget_ms = 0;
+
+// Events are recorded on the loop task and on the NMEA 2000 task, and read
+// on the HTTP server task.
+ProfilerMutex boot_mutex;
+
+// Call with the lock held
+const BootRecord* find_record(const char* name) {
+  for (int ii = 0; ii < num_records; ii++) {
+    if (strcmp(records[ii].name, name) == 0) {
+      return &records[ii];
+    }
+  }
+  return nullptr;
+}
+
+// Call with the lock held
+void add_record(const char* name, uint32_t time_us, uint32_t value,
+                bool is_event) {
+  if (num_records >= kMaxBootPhases) {
+    return;
+  }
+  records[num_records++] = {name, time_us, value, is_event};
+}
+
+int copy_records(BootRecord* snapshot) {
+  ProfilerLock lock(boot_mutex);
+  memcpy(snapshot, records, num_records * sizeof(BootRecord));
+  return num_records;
+}
+
+}  // namespace
+
+void RecordBootPhase(const char* name) {
+  const uint32_t now_us = micros();
+  ProfilerLock lock(boot_mutex);
+  add_record(name, now_us, 0, false);
+}
+
+void RecordBootEvent(const char* name, uint32_t value) {
+  const uint32_t now_us = micros();
+  ProfilerLock lock(boot_mutex);
+  if (find_record(name) == nullptr) {
+    add_record(name, now_us, value, true);
+  }
+}
+
+uint32_t GetBootPhaseTime(const char* name) {
+  ProfilerLock lock(boot_mutex);
+  const BootRecord* record = find_record(name);
+  return record != nullptr ? record->time_us : 0;
+}
+
+void SetBootBudget(const char* name, uint32_t budget) {
+  budget_name = name;
+  budget_ms = budget;
+}
+
+void LogBootProfile() {
+  // Static to spare the caller's stack
+  static BootRecord snapshot[kMaxBootPhases];
+  const int count = copy_records(snapshot);
+
+  uint32_t previous_us = 0;
+  for (int ii = 0; ii < count; ii++) {
+    const BootRecord& record = snapshot[ii];
+    if (record.is_event) {
+      debugI("Boot: %9.1f ms  %s %u", record.time_us / 1e3, record.name,
+             record.value);
+    } else {
+      debugI("Boot: %9.1f ms  %s (%.1f ms)", record.time_us / 1e3,
+             record.name, (record.time_us - previous_us) / 1e3);
+      previous_us = record.time_us;
+    }
+  }
+
+  if (budget_name != nullptr) {
+    const uint32_t time_us = GetBootPhaseTime(budget_name);
+    if (time_us == 0) {
+      debugW("Boot: %s has not happened yet (budget %u ms)", budget_name,
+             budget_ms);
+    } else if (time_us > budget_ms * 1000) {
+      debugW("Boot: %s at %.1f ms, over the budget of %u ms", budget_name,
+             time_us / 1e3, budget_ms);
+    } else {
+      debugI("Boot: %s within the budget of %u ms", budget_name, budget_ms);
+    }
+  }
+}
+
+String GetBootProfileJSON() {
+  // Static; see AddProfileJSONHandler()
+  static BootRecord snapshot[kMaxBootPhases];
+  const int count = copy_records(snapshot);
+
+  JsonDocument doc;
+  doc["uptime_ms"] = millis();
+  JsonArray phases = doc["phases"].to<JsonArray>();
+  uint32_t previous_us = 0;
+  for (int ii = 0; ii < count; ii++) {
+    const BootRecord& record = snapshot[ii];
+    JsonObject phase = phases.add<JsonObject>();
+    phase["name"] = record.name;
+    phase["time_us"] = record.time_us;
+    if (record.is_event) {
+      phase["value"] = record.value;
+    } else {
+      phase["duration_us"] = record.time_us - previous_us;
+      previous_us = record.time_us;
+    }
+  }
+
+  if (budget_name != nullptr) {
+    const uint32_t time_us = GetBootPhaseTime(budget_name);
+    JsonObject budget = doc["budget"].to<JsonObject>();
+    budget["name"] = budget_name;
+    budget["budget_ms"] = budget_ms;
+    budget["met"] = time_us != 0 && time_us <= budget_ms * 1000;
+  }
+
+  String json;
+  serializeJson(doc, json);
+  return json;
+}
+
+#ifdef ARDUINO_ARCH_ESP32
+void AddBootProfileHandler(sensesp::HTTPServer* server) {
+  AddProfileJSONHandler(server, "/api/boot", GetBootProfileJSON);
+}
+#endif
+
+}  // namespace halmet
@@ -0,0 +1,58 @@
+#ifndef HALMET_SRC_BOOT_PROFILER_H_
+#define HALMET_SRC_BOOT_PROFILER_H_
+
+#include <WString.h>
+
+#include <cstdint>
+
+namespace sensesp {
+class HTTPServer;
+}
+
+namespace halmet {
+
+// Boot phase timing.
+//
+// setup() marks the end of each initialization phase with
+// RecordBootPhase(). Subsystems that complete their initialization later in
+// the event loop, e.g. the display or the 1-Wire bus search, mark their
+// completion the same way. One-off events such as the first NMEA 2000
+// message are recorded with RecordBootEvent(), which keeps only the first
+// call for each name.
+//
+// Times are micros() since the application started; the ROM and second
+// stage bootloaders, about 300 ms on an ESP32, come before that. All records
+// live in a static table that is safe to update from any task.
+
+// Maximum number of records. Further phases are not recorded.
+constexpr int kMaxBootPhases = 32;
+
+/// Record the end of a boot phase now.
+void RecordBootPhase(const char* name);
+
+/// Record an event with an optional value, unless name was recorded before.
+void RecordBootEvent(const char* name, uint32_t value = 0);
+
+/// micros() time of the first record called name, or 0 if there is none.
+uint32_t GetBootPhaseTime(const char* name);
+
+/**
+ * @brief Set a time budget for a boot phase or event.
+ *
+ * The boot report states whether the record called name arrived within
+ * budget_ms of the application start.
+ */
+void SetBootBudget(const char* name, uint32_t budget_ms);
+
+/// Print the boot phases to the debug log.
+void LogBootProfile();
+
+/// Return the boot phases as a JSON document.
+String GetBootProfileJSON();
+
+/// Serve the boot phases at /api/boot.
+void AddBootProfileHandler(sensesp::HTTPServer* server);
+
+}  // namespace halmet
+
+#endif  // HALMET_SRC_BOOT_PROFILER_H_
@@ -0,0 +1,118 @@
+#include "curve_lookup_table.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace halmet {
+
+namespace {
+
+// SensESP versions differ in the naming of the curve sample members
+
+template <typename S>
+auto sample_input(const S& sample, int) -> decltype(sample.input_) {
+  return sample.input_;
+}
+
+template <typename S>
+auto sample_input(const S& sample, long) -> decltype(sample.input) {
+  return sample.input;
+}
+
+template <typename S>
+auto sample_output(const S& sample, int) -> decltype(sample.output_) {
+  return sample.output_;
+}
+
+template <typename S>
+auto sample_output(const S& sample, long) -> decltype(sample.output) {
+  return sample.output;
+}
+
+}  // namespace
+
+CurveLookupTable::CurveLookupTable(float input_scale,
+                                   const String& config_path)
+    : sensesp::CurveInterpolator(nullptr, config_path),
+      input_scale_{input_scale} {}
+
+void CurveLookupTable::set_output_scale(float multiplier, float offset) {
+  output_multiplier_ = multiplier;
+  output_offset_ = offset;
+  table_valid_ = false;
+}
+
+bool CurveLookupTable::set_configuration(const JsonObject& config) {
+  table_valid_ = false;
+  return sensesp::CurveInterpolator::set_configuration(config);
+}
+
+float CurveLookupTable::interpolate(float input) const {
+  float x0 = 0.0;
+  float y0 = 0.0;
+  for (const auto& sample : get_samples()) {
+    const float x1 = sample_input(sample, 0);
+    const float y1 = sample_output(sample, 0);
+    if (input > x1) {
+      x0 = x1;
+      y0 = y1;
+      continue;
+    }
+    // CurveInterpolator divides by zero at a sample at x0
+    if (x1 == x0) {
+      return y1;
+    }
+    return (y0 * (x1 - input) + y1 * (input - x0)) / (x1 - x0);
+  }
+  return y0;
+}
+
+void CurveLookupTable::build_table() {
+  table_valid_ = true;
+  const auto& samples = get_samples();
+  const float max_input =
+      samples.empty() ? 0 : sample_input(*samples.rbegin(), 0);
+  if (max_input <= 0) {
+    // Degenerate curve; every input maps to the output at zero
+    position_scale_ = 0;
+  } else {
+    position_scale_ =
+        input_scale_ * kNumSegments * (1 << kFractionBits) / max_input;
+  }
+
+  float values[kNumSegments + 1];
+  float max_magnitude = 0;
+  for (int ii = 0; ii <= kNumSegments; ii++) {
+    values[ii] = output_multiplier_ *
+                     interpolate(max_input * ii / kNumSegments) +
+                 output_offset_;
+    max_magnitude = std::max(max_magnitude, std::fabs(values[ii]));
+  }
+  entry_scale_ = max_magnitude > 0 ? max_magnitude / kMaxEntry : 1;
+  for (int ii = 0; ii <= kNumSegments; ii++) {
+    table_[ii] = std::lround(values[ii] / entry_scale_);
+  }
+}
+
+void CurveLookupTable::set_input(float input, uint8_t input_channel) {
+  if (!table_valid_) {
+    build_table();
+  }
+  const float position = input * position_scale_;
+  int32_t entry;
+  if (!(position > 0)) {
+    // Also catches NaN inputs
+    entry = table_[0];
+  } else if (position >= kNumSegments << kFractionBits) {
+    entry = table_[kNumSegments];
+  } else {
+    const uint32_t fixed_position = static_cast<uint32_t>(position);
+    const uint32_t index = fixed_position >> kFractionBits;
+    const int32_t fraction = fixed_position & ((1 << kFractionBits) - 1);
+    const int32_t y0 = table_[index];
+    entry = y0 + (((table_[index + 1] - y0) * fraction) >> kFractionBits);
+  }
+  this->emit(entry * entry_scale_);
+}
+
+}  // namespace halmet
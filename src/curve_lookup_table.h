@@ -0,0 +1,76 @@
+#ifndef HALMET_SRC_CURVE_LOOKUP_TABLE_H_
+#define HALMET_SRC_CURVE_LOOKUP_TABLE_H_
+
+#include <ArduinoJson.h>
+#include <WString.h>
+
+#include <sensesp/transforms/curveinterpolator.h>
+
+#include <cstdint>
+
+namespace halmet {
+
+/**
+ * @brief CurveInterpolator compiled into a fixed-point lookup table.
+ *
+ * Configured and edited exactly like a sensesp::CurveInterpolator, whose
+ * configuration it shares. The curve is sampled once into a table of
+ * kNumSegments equal steps from zero to the largest sample input, which is
+ * rebuilt on the first input after a configuration change. Each input then
+ * costs one multiplication, a table lookup and an integer interpolation,
+ * independent of the number of curve samples.
+ *
+ * The inputs of the analog channels are proportional to the ADS1115 counts,
+ * so each table step covers a fixed number of counts. The table is exact
+ * except in the steps containing a curve sample; there, the error is at
+ * most a quarter of the step times the change of slope at the sample.
+ *
+ * Linear conversions before and after the curve can be fused into the
+ * table: the input is multiplied by input_scale first, e.g. to convert an
+ * ADC voltage to the resistance the curve is defined for, and the output
+ * multiplier and offset are applied to the table entries.
+ */
+class CurveLookupTable : public sensesp::CurveInterpolator {
+ public:
+  static constexpr int kNumSegments = 256;
+
+  CurveLookupTable(float input_scale = 1, const String& config_path = "");
+
+  void set_input(float input, uint8_t input_channel = 0) override;
+
+  /// Apply multiplier * value + offset to the curve output.
+  void set_output_scale(float multiplier, float offset = 0);
+
+  /// Rebuild the table on the next input, after add_sample() or
+  /// clear_samples().
+  void invalidate() { table_valid_ = false; }
+
+  bool set_configuration(const JsonObject& config) override;
+
+ protected:
+  // Table entries are scaled to at most this magnitude, so that the
+  // interpolation products fit in 32 bits
+  static constexpr int32_t kMaxEntry = 1 << 22;
+  // Fraction bits of the table position
+  static constexpr int kFractionBits = 8;
+
+  void build_table();
+
+  /// Curve output at input, as CurveInterpolator computes it.
+  float interpolate(float input) const;
+
+  const float input_scale_;
+  float output_multiplier_ = 1;
+  float output_offset_ = 0;
+
+  bool table_valid_ = false;
+  // Table position (with kFractionBits fraction bits) per input unit
+  float position_scale_ = 0;
+  // Output value of one table entry unit
+  float entry_scale_ = 0;
+  int32_t table_[kNumSegments + 1];
+};
+
+}  // namespace halmet
+
+#endif  // HALMET_SRC_CURVE_LOOKUP_TABLE_H_
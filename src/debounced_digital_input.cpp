@@ -0,0 +1,124 @@
+#include "debounced_digital_input.h"
+
+#include "reaction_profiler.h"
+
+#include <Arduino.h>
+#include <ReactESP.h>
+
+#include <sensesp/system/local_debug.h>
+
+namespace halmet {
+
+namespace {
+
+constexpr uint32_t kDefaultDebounceMs = 20;
+constexpr uint32_t kDefaultRefreshIntervalMs = 2000;
+
+}  // namespace
+
+DebouncedDigitalInput::DebouncedDigitalInput(uint8_t pin, int pin_mode,
+                                             const String& config_path)
+    : sensesp::Configurable{config_path},
+      pin_{pin},
+      debounce_ms_{kDefaultDebounceMs},
+      refresh_interval_ms_{kDefaultRefreshIntervalMs} {
+  load_configuration();
+
+  pinMode(pin, pin_mode);
+  state_ = digitalRead(pin);
+
+  ProfiledInterrupt("Debounced input edge", pin, CHANGE,
+                    [this]() { this->on_edge(); });
+  reactesp::ReactESP::app->onTick([this]() { this->check_edge(); });
+
+  // Emit the initial state once the consumers are connected. There is no
+  // edge to time it from.
+  reactesp::ReactESP::app->onDelay(0, [this]() {
+    edge_time_us_ = micros();
+    this->emit(state_);
+  });
+  if (refresh_interval_ms_ > 0) {
+    ProfiledRepeat("Debounced input refresh", refresh_interval_ms_,
+                   [this]() { this->emit(state_); });
+  }
+}
+
+void DebouncedDigitalInput::on_edge() {
+  const uint32_t now_us = micros();
+  if (!edge_pending_) {
+    first_edge_us_ = now_us;
+  }
+  last_edge_us_ = now_us;
+  edge_pending_ = true;
+}
+
+void DebouncedDigitalInput::check_edge() {
+  if (!edge_pending_ || confirm_reaction_ != nullptr) {
+    return;
+  }
+  confirm_reaction_ = reactesp::ReactESP::app->onDelay(
+      debounce_ms_, [this]() { this->confirm(); });
+}
+
+void DebouncedDigitalInput::confirm() {
+  confirm_reaction_ = nullptr;
+  const uint32_t debounce_us = debounce_ms_ * 1000;
+  const uint32_t quiet_us = micros() - last_edge_us_;
+  if (quiet_us < debounce_us) {
+    // Still bouncing; wait until the debounce time after the last edge
+    confirm_reaction_ = reactesp::ReactESP::app->onDelayMicros(
+        debounce_us - quiet_us, [this]() { this->confirm(); });
+    return;
+  }
+
+  // Edges from here on start a new change
+  const uint32_t first_edge_us = first_edge_us_;
+  edge_pending_ = false;
+  const bool level = digitalRead(pin_);
+  if (level != state_) {
+    state_ = level;
+    edge_time_us_ = first_edge_us;
+    this->emit(level);
+  }
+}
+
+String DebouncedDigitalInput::get_config_schema() {
+  return R"###({
+  "type": "object",
+  "properties": {
+    "debounce_ms": {
+      "title": "Debounce time (ms)",
+      "description": "Time the level must be stable to accept a change",
+      "type": "integer",
+      "minimum": 0
+    },
+    "refresh_interval_ms": {
+      "title": "Refresh interval (ms)",
+      "description": "Repeat the state at this interval; 0 sends changes only",
+      "type": "integer",
+      "minimum": 0
+    }
+  }
+})###";
+}
+
+bool DebouncedDigitalInput::set_configuration(const JsonObject& config) {
+  const String expected[] = {"debounce_ms", "refresh_interval_ms"};
+  for (const auto& str : expected) {
+    if (!config.containsKey(str)) {
+      debugE("DebouncedDigitalInput: Missing configuration key %s",
+             str.c_str());
+      return false;
+    }
+  }
+  debounce_ms_ = config["debounce_ms"];
+  refresh_interval_ms_ = config["refresh_interval_ms"];
+  return true;
+}
+
+void DebouncedDigitalInput::get_configuration(JsonObject& config) {
+  config["debounce_ms"] = debounce_ms_;
+  config["refresh_interval_ms"] = refresh_interval_ms_;
+}
+
+}  // namespace halmet
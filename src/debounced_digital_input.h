@@ -0,0 +1,68 @@
+#ifndef HALMET_SRC_DEBOUNCED_DIGITAL_INPUT_H_
+#define HALMET_SRC_DEBOUNCED_DIGITAL_INPUT_H_
+
+#include <Arduino.h>
+#include <ReactESP.h>
+#include <WString.h>
+
+#include <sensesp/system/configurable.h>
+#include <sensesp/system/valueproducer.h>
+
+#include <cstdint>
+
+namespace halmet {
+
+/**
+ * @brief Interrupt-driven, debounced digital input.
+ *
+ * Replaces the polling sensesp::DigitalInputState for alarm inputs. An
+ * interrupt on either edge timestamps the change with micros(). Once the
+ * level has been stable for the debounce time, it's read and emitted if it
+ * differs from the previous state. Bounces and glitches shorter than the
+ * debounce time are thus ignored, and a change is emitted the debounce time
+ * after the last bounce instead of up to a poll interval later.
+ *
+ * While the input doesn't change, the only work is a flag check per loop
+ * and the optional refresh: the current state is emitted again every
+ * refresh interval for consumers that expire their inputs, like the
+ * NMEA 2000 senders.
+ */
+class DebouncedDigitalInput : public sensesp::BoolProducer,
+                              public sensesp::Configurable {
+ public:
+  DebouncedDigitalInput(uint8_t pin, int pin_mode = INPUT,
+                        const String& config_path = "");
+
+  /// micros() time of the first edge of the last emitted change, or of the
+  /// emission of the initial state. Valid in the observers of the emitted
+  /// value.
+  uint32_t get_edge_time_us() const { return edge_time_us_; }
+
+  String get_config_schema() override;
+  bool set_configuration(const JsonObject& config) override;
+  void get_configuration(JsonObject& config) override;
+
+ protected:
+  void on_edge();
+  void check_edge();
+  void confirm();
+
+  const uint8_t pin_;
+  uint32_t debounce_ms_;
+  // Emit the current state again after this time, or never if 0
+  uint32_t refresh_interval_ms_;
+
+  // Written by the interrupt handler
+  volatile bool edge_pending_ = false;
+  volatile uint32_t first_edge_us_ = 0;
+  volatile uint32_t last_edge_us_ = 0;
+
+  // Last emitted state
+  bool state_ = false;
+  reactesp::DelayReaction* confirm_reaction_ = nullptr;
+  uint32_t edge_time_us_ = 0;
+};
+
+}  // namespace halmet
+
+#endif  // HALMET_SRC_DEBOUNCED_DIGITAL_INPUT_H_
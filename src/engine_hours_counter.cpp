@@ -0,0 +1,157 @@
+#include "engine_hours_counter.h"
+
+#include <ReactESP.h>
+
+#include <sensesp/system/local_debug.h>
+
+namespace halmet {
+
+namespace {
+
+// Limits the flash wear to one record per this many seconds of run time
+constexpr uint32_t kMinSaveIntervalS = 10;
+
+constexpr float kMsPerHour = 3600000;
+
+// Delay from a save or boot to erasing the next journal sector
+constexpr uint32_t kPrepareDelayMs = 2000;
+
+// Configured durations within this of the reported one are taken to be
+// unchanged, to allow for rounding in the configuration UI
+constexpr uint64_t kDurationToleranceMs = 1000;
+
+}  // namespace
+
+EngineHoursCounter::EngineHoursCounter(uint32_t save_interval_s,
+                                       const char* partition_label,
+                                       const String& config_path)
+    : sensesp::Transform<float, float>(config_path),
+      log_{partition_label},
+      save_interval_s_{save_interval_s} {
+  load_configuration();
+  if (save_interval_s_ < kMinSaveIntervalS) {
+    save_interval_s_ = kMinSaveIntervalS;
+  }
+
+  uint64_t journal_ms;
+  if (log_.recover(&journal_ms)) {
+    total_ms_ = journal_ms;
+  }
+  saved_ms_ = total_ms_;
+  reported_ms_ = total_ms_;
+  recovered_ = true;
+  debugI("Engine hours: %.2f h, journal read in %u us", total_ms_ / kMsPerHour,
+         log_.get_recovery_us());
+  schedule_prepare();
+}
+
+void EngineHoursCounter::set_input(float input, uint8_t input_channel) {
+  const uint32_t now = millis();
+  if (running_) {
+    const uint32_t elapsed_ms = now - last_input_ms_;
+    total_ms_ += elapsed_ms;
+    run_since_boot_ms_ += elapsed_ms;
+  }
+  last_input_ms_ = now;
+
+  const bool was_running = running_;
+  running_ = input != 0;
+  if (was_running && !running_) {
+    // Engine stopped; the power may be switched off next
+    save();
+  } else if (running_ &&
+             total_ms_ - saved_ms_ >= uint64_t(save_interval_s_) * 1000) {
+    save();
+  }
+
+  this->emit(total_ms_ / 1000.);
+}
+
+void EngineHoursCounter::save() {
+  if (total_ms_ == saved_ms_) {
+    return;
+  }
+  if (!log_.append(total_ms_)) {
+    debugE("Engine hours: Saving to flash failed");
+    return;
+  }
+  saved_ms_ = total_ms_;
+  schedule_prepare();
+  debugD(
+      "Engine hours: %.3f h saved in %u us (max %u us), %u erases since "
+      "boot, %.2f erases per engine hour",
+      total_ms_ / kMsPerHour, log_.get_last_append_us(),
+      log_.get_max_append_us(), log_.get_erases(), get_erases_per_hour());
+}
+
+void EngineHoursCounter::schedule_prepare() {
+  reactesp::ReactESP::app->onDelay(kPrepareDelayMs, [this]() {
+    if (!log_.prepare_next_sector()) {
+      debugE("Engine hours: Preparing the flash journal failed");
+    }
+  });
+}
+
+float EngineHoursCounter::get_erases_per_hour() const {
+  return run_since_boot_ms_ > 0
+             ? log_.get_erases() * kMsPerHour / run_since_boot_ms_
+             : 0;
+}
+
+String EngineHoursCounter::get_config_schema() {
+  return R"###({
+  "type": "object",
+  "properties": {
+    "duration": {
+      "title": "Total run time (s)",
+      "type": "number",
+      "minimum": 0
+    },
+    "save_interval_s": {
+      "title": "Flash save interval while running (s)",
+      "type": "integer",
+      "minimum": 10
+    }
+  }
+})###";
+}
+
+bool EngineHoursCounter::set_configuration(const JsonObject& config) {
+  if (!config.containsKey("duration")) {
+    debugE("EngineHoursCounter: Missing configuration key duration");
+    return false;
+  }
+  const double duration_s = config["duration"];
+  const uint64_t duration_ms = duration_s > 0 ? uint64_t(duration_s * 1000) : 0;
+  // Once the journal has been read, the total has moved on from the
+  // duration in a configuration read earlier
+  const uint64_t change_ms = duration_ms > reported_ms_
+                                 ? duration_ms - reported_ms_
+                                 : reported_ms_ - duration_ms;
+  const bool duration_edited =
+      !recovered_ || change_ms >= kDurationToleranceMs;
+  if (duration_edited) {
+    total_ms_ = duration_ms;
+  }
+  // Configurations saved by sensesp::TimeCounter have no save interval
+  if (config.containsKey("save_interval_s")) {
+    save_interval_s_ = config["save_interval_s"];
+    if (save_interval_s_ < kMinSaveIntervalS) {
+      save_interval_s_ = kMinSaveIntervalS;
+    }
+  }
+  if (recovered_ && duration_edited) {
+    // An edited total replaces the journal value
+    reported_ms_ = total_ms_;
+    save();
+  }
+  return true;
+}
+
+void EngineHoursCounter::get_configuration(JsonObject& config) {
+  reported_ms_ = total_ms_;
+  config["duration"] = total_ms_ / 1000.;
+  config["save_interval_s"] = save_interval_s_;
+}
+
+}  // namespace halmet
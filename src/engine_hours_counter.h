@@ -0,0 +1,80 @@
+#ifndef HALMET_SRC_ENGINE_HOURS_COUNTER_H_
+#define HALMET_SRC_ENGINE_HOURS_COUNTER_H_
+
+#include "flash_counter_log.h"
+
+#include <Arduino.h>
+#include <WString.h>
+
+#include <sensesp/transforms/transform.h>
+
+#include <cstdint>
+
+namespace halmet {
+
+/**
+ * @brief Engine run time counter, persisted in a flash journal.
+ *
+ * A replacement for sensesp::TimeCounter<float>: counts the time during
+ * which the input (the engine speed) is non-zero and emits the total in
+ * seconds. The total is kept in integer milliseconds, so it stays exact
+ * over the life of an engine.
+ *
+ * The total is appended to a FlashCounterLog in its own partition every
+ * save interval while the engine runs, and at once when it stops. At most
+ * one save interval of run time is lost on a power failure. On boot, the
+ * last journal record is restored. Without a journal record, e.g. on the
+ * first boot after replacing a TimeCounter, the configured duration is
+ * used. Journal sectors are erased in the event loop after a save, not
+ * while saving.
+ *
+ * A duration in the configuration only replaces the total if it differs
+ * from the one last reported, so saving a configuration page loaded a
+ * while ago keeps the run time counted since.
+ */
+class EngineHoursCounter : public sensesp::Transform<float, float> {
+ public:
+  static constexpr const char* kDefaultPartition = "enghours";
+
+  EngineHoursCounter(uint32_t save_interval_s = 60,
+                     const char* partition_label = kDefaultPartition,
+                     const String& config_path = "");
+
+  void set_input(float input, uint8_t input_channel = 0) override;
+
+  /// Total run time in milliseconds.
+  uint64_t get_total_ms() const { return total_ms_; }
+
+  const FlashCounterLog& get_log() const { return log_; }
+
+  /// Sector erases per hour of engine run time since boot.
+  float get_erases_per_hour() const;
+
+  String get_config_schema() override;
+  bool set_configuration(const JsonObject& config) override;
+  void get_configuration(JsonObject& config) override;
+
+ protected:
+  void save();
+  /// Erase the next journal sector once the event loop gets to it.
+  void schedule_prepare();
+
+  FlashCounterLog log_;
+  uint32_t save_interval_s_;
+
+  uint64_t total_ms_ = 0;
+  uint64_t saved_ms_ = 0;
+  // Total in the last configuration read
+  uint64_t reported_ms_ = 0;
+  // Run time counted since boot
+  uint64_t run_since_boot_ms_ = 0;
+  uint32_t last_input_ms_ = 0;
+  bool running_ = false;
+  // Set once the journal has been read; configuration changes made before
+  // that are not saved
+  bool recovered_ = false;
+};
+
+}  // namespace halmet
+
+#endif  // HALMET_SRC_ENGINE_HOURS_COUNTER_H_
@@ -0,0 +1 @@
+#include "expiring_flag_set.h"
@@ -0,0 +1,100 @@
+#ifndef HALMET_SRC_EXPIRING_FLAG_SET_H_
+#define HALMET_SRC_EXPIRING_FLAG_SET_H_
+
+#include "expiring_value.h"
+
+#include <cstddef>
+#include <cstdint>
+
+namespace sensesp {
+
+/**
+ * @brief A set of up to 32 boolean flags that each expire to false.
+ *
+ * Equivalent to an array of ExpiringValue<bool> with a common expiration
+ * duration and an expired value of false, but stored as bitmasks and a
+ * single 32-bit timestamp per flag. For the 24 engine status flags, this is
+ * 112 bytes instead of 192 (or 576 with the original 64-bit timestamps).
+ *
+ * The earliest expiry time of all set flags is cached, so computing the whole
+ * status word normally takes one time read and a mask operation. The
+ * per-flag timestamps are only scanned once that time has passed.
+ *
+ * @tparam N Number of flags
+ */
+template <std::size_t N>
+class ExpiringFlagSet {
+  static_assert(N <= 32, "ExpiringFlagSet holds at most 32 flags");
+
+ public:
+  ExpiringFlagSet(uint32_t expiration_duration)
+      : expiration_duration_{expiration_duration} {}
+
+  void update(std::size_t index, bool value) {
+    update(index, value, MillisClock::now());
+  }
+
+  void update(std::size_t index, bool value, uint32_t now) {
+    if (index >= N) {
+      return;
+    }
+    const uint32_t mask = 1UL << index;
+    if (value) {
+      values_ |= mask;
+    } else {
+      values_ &= ~mask;
+    }
+    last_update_[index] = now;
+    if (fresh_ == 0) {
+      next_expiry_ = now + expiration_duration_;
+    }
+    // Updating a flag can only move its expiry later, so next_expiry_
+    // stays a valid lower bound.
+    fresh_ |= mask;
+  }
+
+  /// Return all flags as a bitmask. Expired flags read as false.
+  uint32_t get() { return get(MillisClock::now()); }
+
+  uint32_t get(uint32_t now) {
+    if (fresh_ != 0 && static_cast<int32_t>(now - next_expiry_) > 0) {
+      expire(now);
+    }
+    return values_ & fresh_;
+  }
+
+  /// Return a single flag. An expired flag reads as false.
+  bool test(std::size_t index) { return index < N && (get() >> index) & 1; }
+
+ private:
+  void expire(uint32_t now) {
+    uint32_t oldest_age = 0;
+    bool any_fresh = false;
+    for (std::size_t ii = 0; ii < N; ii++) {
+      const uint32_t mask = 1UL << ii;
+      if ((fresh_ & mask) == 0) {
+        continue;
+      }
+      const uint32_t age = now - last_update_[ii];
+      if (age > expiration_duration_) {
+        fresh_ &= ~mask;
+      } else if (!any_fresh || age > oldest_age) {
+        oldest_age = age;
+        any_fresh = true;
+      }
+    }
+    next_expiry_ = now - oldest_age + expiration_duration_;
+  }
+
+  uint32_t values_ = 0;
+  // Flags that have been updated within the expiration duration
+  uint32_t fresh_ = 0;
+  // No flag expires before this time
+  uint32_t next_expiry_ = 0;
+  const uint32_t expiration_duration_;
+  uint32_t last_update_[N] = {};
+};
+
+}  // namespace sensesp
+
+#endif  // HALMET_SRC_EXPIRING_FLAG_SET_H_
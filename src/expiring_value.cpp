@@ -1 +1,9 @@
 #include "expiring_value.h"
+
+#include <Arduino.h>
+
+namespace sensesp {
+
+uint32_t MillisClock::now() { return millis(); }
+
+}  // namespace sensesp
@@ -1,55 +1,121 @@
 #ifndef HALMET_SRC_EXPIRING_VALUE_H_
 #define HALMET_SRC_EXPIRING_VALUE_H_
 
-#include <Arduino.h>
-
 #include <cstdint>
 
 namespace sensesp {
 
+/**
+ * @brief Default ExpiringValue time source: Arduino millis().
+ *
+ * Any type with a static uint32_t now() returning milliseconds can be used
+ * instead, e.g. a fake clock in host-side tests.
+ */
+struct MillisClock {
+  static uint32_t now();
+};
+
+namespace expiring_value_detail {
+
+// Expiration duration known at compile time; takes no storage beyond
+// padding.
+template <uint32_t kDuration>
+class Duration {
+ public:
+  constexpr Duration() = default;
+  constexpr uint32_t expiration_duration() const { return kDuration; }
+};
+
+// Expiration duration set at run time.
+template <>
+class Duration<0> {
+ public:
+  constexpr Duration(uint32_t duration = 1000) : duration_{duration} {}
+  constexpr uint32_t expiration_duration() const { return duration_; }
+
+ private:
+  uint32_t duration_;
+};
+
+}  // namespace expiring_value_detail
+
 /**
  * @brief Keep value from update till expiration duration else return expired
  * value.
  *
- * @tparam T
+ * Timestamps are 32-bit and compared with wrap-safe unsigned arithmetic. An
+ * expired value latches, so a value that isn't updated for longer than the
+ * 49-day millis() period doesn't come back to life when the clock wraps, as
+ * long as it's read at least once in that period.
+ *
+ * The get() and update() overloads taking a timestamp allow one clock reading
+ * to be shared by several values, e.g. all fields of a PGN.
+ *
+ * A newly constructed value counts as updated at clock time 0.
+ *
+ * @tparam T Value type
+ * @tparam kExpirationDuration Expiration duration in ms, or 0 to set it at
+ * run time
+ * @tparam Clock Time source
  */
-template <typename T>
+template <typename T, uint32_t kExpirationDuration = 0,
+          typename Clock = MillisClock>
 class ExpiringValue {
  public:
-  ExpiringValue()
-      : value_{},
-        expiration_duration_{1000},
-        last_update_{0},
-        expired_value_{T{}} {}
+  constexpr ExpiringValue() : value_{}, expired_value_{} {}
 
-  ExpiringValue(T value, uint64_t expiration_duration, T expired_value)
+  /// Constructor for a run time expiration duration.
+  constexpr ExpiringValue(T value, uint32_t expiration_duration,
+                          T expired_value)
       : value_{value},
-        expiration_duration_{expiration_duration},
         expired_value_{expired_value},
-        last_update_{millis()} {}
+        duration_{expiration_duration} {
+    static_assert(kExpirationDuration == 0,
+                  "Expiration duration is a template parameter");
+  }
 
-  void update(T value) {
+  /// Constructor for a compile time expiration duration.
+  constexpr ExpiringValue(T value, T expired_value)
+      : value_{value}, expired_value_{expired_value} {
+    static_assert(kExpirationDuration != 0,
+                  "Expiration duration must be given");
+  }
+
+  void update(T value) { update(value, Clock::now()); }
+
+  void update(T value, uint32_t now) {
     value_ = value;
-    last_update_ = millis();
+    last_update_ = now;
+    expired_ = false;
   }
 
-  T get() const {
-    if (!is_expired()) {
+  T get() const { return get(Clock::now()); }
+
+  T get(uint32_t now) const {
+    if (!is_expired(now)) {
       return value_;
     } else {
       return expired_value_;
     }
   }
 
-  bool is_expired() const {
-    return millis() - last_update_ > expiration_duration_;
+  bool is_expired() const { return is_expired(Clock::now()); }
+
+  bool is_expired(uint32_t now) const {
+    if (!expired_ && now - last_update_ > duration_.expiration_duration()) {
+      expired_ = true;
+    }
+    return expired_;
   }
 
  private:
+  // Ordered so that the flag and a compile time duration fill the padding
+  // after the values
   T value_;
   T expired_value_;
-  uint64_t expiration_duration_;
-  uint64_t last_update_;
+  mutable bool expired_ = false;
+  expiring_value_detail::Duration<kExpirationDuration> duration_;
+  uint32_t last_update_ = 0;
 };
 
 }  // namespace sensesp
@@ -0,0 +1,226 @@
+#include "flash_counter_log.h"
+
+#include <Arduino.h>
+
+#include <sensesp/system/local_debug.h>
+
+#include <algorithm>
+
+namespace halmet {
+
+namespace {
+
+constexpr uint32_t kMagic = 0x4c434d48;  // "HMCL"
+
+// Header and record fields covered by their CRC
+constexpr size_t kCheckedSize = 12;
+
+uint32_t crc32(const void* data, size_t size) {
+  const uint8_t* bytes = static_cast<const uint8_t*>(data);
+  uint32_t crc = 0xffffffff;
+  for (size_t ii = 0; ii < size; ii++) {
+    crc ^= bytes[ii];
+    for (int bit = 0; bit < 8; bit++) {
+      crc = (crc >> 1) ^ (0xedb88320 & -(crc & 1));
+    }
+  }
+  return ~crc;
+}
+
+}  // namespace
+
+FlashCounterLog::FlashCounterLog(const char* partition_label)
+    : partition_{esp_partition_find_first(ESP_PARTITION_TYPE_DATA,
+                                          ESP_PARTITION_SUBTYPE_ANY,
+                                          partition_label)} {
+  if (partition_ == nullptr) {
+    debugE("FlashCounterLog: No data partition %s", partition_label);
+    return;
+  }
+  num_sectors_ = partition_->size / kSectorSize;
+  if (num_sectors_ < 2) {
+    debugE("FlashCounterLog: Partition %s is too small", partition_label);
+  }
+}
+
+size_t FlashCounterLog::slot_offset(int sector, uint32_t slot) const {
+  return sector * kSectorSize + (slot + 1) * kRecordSize;
+}
+
+bool FlashCounterLog::read_header(int sector, SectorHeader* header) {
+  return esp_partition_read(partition_, sector * kSectorSize, header,
+                            sizeof(*header)) == ESP_OK &&
+         header->magic == kMagic &&
+         header->crc == crc32(header, kCheckedSize);
+}
+
+bool FlashCounterLog::read_record(int sector, uint32_t slot, Record* record) {
+  return esp_partition_read(partition_, slot_offset(sector, slot), record,
+                            sizeof(*record)) == ESP_OK &&
+         record->crc == crc32(record, kCheckedSize);
+}
+
+bool FlashCounterLog::is_blank(int sector, uint32_t slot) {
+  uint8_t bytes[kRecordSize];
+  if (esp_partition_read(partition_, slot_offset(sector, slot), bytes,
+                         sizeof(bytes)) != ESP_OK) {
+    return false;
+  }
+  return std::all_of(bytes, bytes + kRecordSize,
+                     [](uint8_t byte) { return byte == 0xff; });
+}
+
+uint32_t FlashCounterLog::first_blank_slot(int sector) {
+  // Records are written in order, so the written slots precede the blank
+  // ones. A torn record is not blank.
+  uint32_t low = 0;
+  uint32_t high = kRecordsPerSector;
+  while (low < high) {
+    const uint32_t mid = (low + high) / 2;
+    if (is_blank(sector, mid)) {
+      high = mid;
+    } else {
+      low = mid + 1;
+    }
+  }
+  return low;
+}
+
+int FlashCounterLog::last_valid_slot(int sector, uint32_t end_slot,
+                                     Record* record) {
+  // Usually the last written record; only a reset during a write leaves an
+  // invalid one at the end
+  for (uint32_t slot = end_slot; slot-- > 0;) {
+    if (read_record(sector, slot, record)) {
+      return slot;
+    }
+  }
+  return -1;
+}
+
+bool FlashCounterLog::recover(uint64_t* value) {
+  const uint32_t start_us = micros();
+  if (!is_valid()) {
+    return false;
+  }
+
+  int newest = -1;
+  SectorHeader newest_header;
+  for (int sector = 0; sector < num_sectors_; sector++) {
+    SectorHeader header;
+    if (!read_header(sector, &header)) {
+      continue;
+    }
+    max_sector_erases_ = std::max(max_sector_erases_, header.erase_count);
+    if (newest < 0 ||
+        static_cast<int32_t>(header.sequence - newest_header.sequence) > 0) {
+      newest = sector;
+      newest_header = header;
+    }
+  }
+
+  bool found = false;
+  if (newest >= 0) {
+    current_sector_ = newest;
+    current_sequence_ = newest_header.sequence;
+    next_slot_ = first_blank_slot(newest);
+
+    Record record;
+    found = last_valid_slot(newest, next_slot_, &record) >= 0;
+    if (!found) {
+      // The sector was started ahead of time or a reset came right after
+      // it was started; the previous sector holds the last value. Keep
+      // appending to it while it has room.
+      const int previous = (newest + num_sectors_ - 1) % num_sectors_;
+      const uint32_t previous_end = first_blank_slot(previous);
+      SectorHeader header;
+      found = read_header(previous, &header) &&
+              header.sequence == newest_header.sequence - 1 &&
+              last_valid_slot(previous, previous_end, &record) >= 0;
+      if (found) {
+        current_sector_ = previous;
+        current_sequence_ = header.sequence;
+        next_slot_ = previous_end;
+        next_sector_ready_ = true;
+      }
+    }
+    if (found) {
+      *value = record.value;
+      record_sequence_ = record.sequence;
+    }
+  }
+
+  recovery_us_ = micros() - start_us;
+  return found;
+}
+
+bool FlashCounterLog::start_next_sector() {
+  const int next = next_sector();
+  SectorHeader header;
+  const uint32_t erase_count =
+      read_header(next, &header) ? header.erase_count + 1 : 1;
+  if (esp_partition_erase_range(partition_, next * kSectorSize,
+                                kSectorSize) != ESP_OK) {
+    debugE("FlashCounterLog: Erasing sector %d failed", next);
+    return false;
+  }
+  erases_++;
+
+  header.magic = kMagic;
+  header.sequence = current_sequence_ + 1;
+  header.erase_count = erase_count;
+  header.crc = crc32(&header, kCheckedSize);
+  if (esp_partition_write(partition_, next * kSectorSize, &header,
+                          sizeof(header)) != ESP_OK) {
+    debugE("FlashCounterLog: Writing sector %d failed", next);
+    return false;
+  }
+  next_sector_ready_ = true;
+  max_sector_erases_ = std::max(max_sector_erases_, erase_count);
+  return true;
+}
+
+bool FlashCounterLog::prepare_next_sector() {
+  if (!is_valid() || num_sectors_ < 3 || next_sector_ready_) {
+    return true;
+  }
+  return start_next_sector();
+}
+
+bool FlashCounterLog::append(uint64_t value) {
+  if (!is_valid()) {
+    return false;
+  }
+  const uint32_t start_us = micros();
+
+  bool ok = true;
+  if (current_sector_ < 0 || next_slot_ >= kRecordsPerSector) {
+    ok = next_sector_ready_ || start_next_sector();
+    if (ok) {
+      current_sector_ = next_sector();
+      current_sequence_++;
+      next_slot_ = 0;
+      next_sector_ready_ = false;
+    }
+  }
+  if (ok) {
+    Record record;
+    record.value = value;
+    record.sequence = ++record_sequence_;
+    record.crc = crc32(&record, kCheckedSize);
+    ok = esp_partition_write(partition_,
+                             slot_offset(current_sector_, next_slot_),
+                             &record, sizeof(record)) == ESP_OK;
+    // A failed slot is skipped
+    next_slot_++;
+  }
+  if (ok) {
+    appends_++;
+  }
+
+  last_append_us_ = micros() - start_us;
+  max_append_us_ = std::max(max_append_us_, last_append_us_);
+  return ok;
+}
+
+}  // namespace halmet
@@ -0,0 +1,125 @@
+#ifndef HALMET_SRC_FLASH_COUNTER_LOG_H_
+#define HALMET_SRC_FLASH_COUNTER_LOG_H_
+
+#include <esp_partition.h>
+
+#include <cstddef>
+#include <cstdint>
+
+namespace halmet {
+
+/**
+ * @brief Wear-leveled journal of a 64-bit counter in a raw flash partition.
+ *
+ * Each value is appended as a 16-byte record with a CRC, so a record torn
+ * by a reset is detected and the previous one is used. The partition is
+ * used as a ring of 4 kB sectors: once a sector is full, the oldest one is
+ * erased and continues the log. Every sector thus takes the same share of
+ * the erases. Each sector header holds a sequence number to find the
+ * newest sector and the sector's lifetime erase count.
+ *
+ * Recovery reads the sector headers and binary searches the newest sector
+ * for its last record: about a dozen small reads, however long the log has
+ * run. Appending takes one page program, plus a sector erase every
+ * kRecordsPerSector records unless prepare_next_sector() has already done
+ * it. Both block the CPU.
+ */
+class FlashCounterLog {
+ public:
+  static constexpr uint32_t kSectorSize = 4096;
+  static constexpr uint32_t kRecordSize = 16;
+  // The first record slot holds the sector header
+  static constexpr uint32_t kRecordsPerSector = kSectorSize / kRecordSize - 1;
+
+  /// Use the data partition with the given label.
+  FlashCounterLog(const char* partition_label);
+
+  /// Whether the partition was found and holds at least two sectors.
+  bool is_valid() const { return num_sectors_ >= 2; }
+
+  /**
+   * @brief Find the last value in the log.
+   *
+   * Must be called before the first append().
+   *
+   * @return False if the log holds no valid record.
+   */
+  bool recover(uint64_t* value);
+
+  /// Append a value; false on a flash error.
+  bool append(uint64_t value);
+
+  /**
+   * @brief Erase and start the sector after the current one ahead of time.
+   *
+   * Call while idle, so that appends don't have to erase. The started
+   * sector holds no record yet, so recovery falls back to the current one.
+   * Does nothing if the next sector is ready already, or with fewer than 3
+   * sectors, where the next sector holds the fallback for recovery.
+   *
+   * @return False on a flash error.
+   */
+  bool prepare_next_sector();
+
+  /// Duration (us) of the last recover() call.
+  uint32_t get_recovery_us() const { return recovery_us_; }
+  /// Duration (us) of the last and the longest append(), erases included.
+  uint32_t get_last_append_us() const { return last_append_us_; }
+  uint32_t get_max_append_us() const { return max_append_us_; }
+
+  /// Records appended and sectors erased since boot.
+  uint32_t get_appends() const { return appends_; }
+  uint32_t get_erases() const { return erases_; }
+
+  /// Highest lifetime erase count of any sector in the partition.
+  uint32_t get_max_sector_erases() const { return max_sector_erases_; }
+
+ protected:
+  struct SectorHeader {
+    uint32_t magic;
+    uint32_t sequence;
+    uint32_t erase_count;
+    uint32_t crc;
+  };
+
+  struct Record {
+    uint64_t value;
+    uint32_t sequence;
+    uint32_t crc;
+  };
+
+  bool read_header(int sector, SectorHeader* header);
+  bool read_record(int sector, uint32_t slot, Record* record);
+  bool is_blank(int sector, uint32_t slot);
+  uint32_t first_blank_slot(int sector);
+  /// Last valid record of a sector, or -1.
+  int last_valid_slot(int sector, uint32_t end_slot, Record* record);
+  /// Erase the sector after the current one and write its header.
+  bool start_next_sector();
+  int next_sector() const {
+    return current_sector_ < 0 ? 0 : (current_sector_ + 1) % num_sectors_;
+  }
+  size_t slot_offset(int sector, uint32_t slot) const;
+
+  const esp_partition_t* partition_;
+  int num_sectors_ = 0;
+
+  // Sector being appended to, or -1 before the first append of a new log
+  int current_sector_ = -1;
+  uint32_t current_sequence_ = 0;
+  uint32_t next_slot_ = 0;
+  uint32_t record_sequence_ = 0;
+  // The sector after the current one has been started
+  bool next_sector_ready_ = false;
+
+  uint32_t recovery_us_ = 0;
+  uint32_t last_append_us_ = 0;
+  uint32_t max_append_us_ = 0;
+  uint32_t appends_ = 0;
+  uint32_t erases_ = 0;
+  uint32_t max_sector_erases_ = 0;
+};
+
+}  // namespace halmet
+
+#endif  // HALMET_SRC_FLASH_COUNTER_LOG_H_
@@ -2,10 +2,8 @@
 
 #include <WString.h>
 
-#include <Adafruit_ADS1X15.h>
-
-#include <sensesp/sensors/sensor.h>
 #include <sensesp/system/valueproducer.h>
+#include <sensesp/transforms/lambda_transform.h>
 
 namespace {
 
@@ -17,29 +15,32 @@ constexpr float kMeasurementCurrent = 0.01;
 
 }  // namespace
 
-sensesp::FloatProducer* AnalogResistanceSender(Adafruit_ADS1115* ads1115,
-                                               int channel,
-                                               const String& name) {
-  String config_path;
-
-  config_path = "/Analog " + name + "/Resistance";
-  auto* analog_sender =
-      new sensesp::RepeatSensor<float>(500, [ads1115, channel]() {
-        const int16_t adc_output = ads1115->readADC_SingleEnded(channel);
-        const float adc_output_volts = ads1115->computeVolts(adc_output);
-#if 0        
+sensesp::FloatProducer* AnalogResistanceSender(
+    halmet::ADS1115Scanner* scanner, int channel, const String& config_path,
+    const halmet::ADS1115ChannelSettings& adc_settings, int sort_order) {
+  auto* adc_voltage =
+      scanner->enable_channel(channel, adc_settings, config_path);
+  adc_voltage->set_description(
+      "ADS1115 sampling parameters. Oversampling averages several "
+      "conversions into one value, trading update rate for lower noise.");
+  adc_voltage->set_sort_order(sort_order);
+
+  auto* analog_sender = new sensesp::LambdaTransform<float, float>(
+      [channel](float adc_output_volts) {
+#if 0
         if (channel == 0) {
           debugD("a%d_adc_output_volts: %f", channel, adc_output_volts);
         }
 #endif
         const auto value =
             kAnalogInputScale * adc_output_volts / kMeasurementCurrent;
-#if 0                
+#if 0
         if (channel == 0) {
           debugD("a%d_adc_resistance: %f", channel, value);
         }
 #endif
         return value;
       });
+  adc_voltage->connect_to(analog_sender);
   return analog_sender;
 }
@@ -1,13 +1,32 @@
 #ifndef __SRC_HALMET_ANALOG_H__
 #define __SRC_HALMET_ANALOG_H__
 
-#include <WString.h>
+#include "ads1115_scanner.h"
 
-#include <Adafruit_ADS1X15.h>
+#include <WString.h>
 
 #include <sensesp/system/valueproducer.h>
 
-sensesp::FloatProducer* AnalogResistanceSender(Adafruit_ADS1115* ads1115,
-                                               int channel, const String& name);
+// Slow, heavily averaged sampling for resistive tank senders
+constexpr halmet::ADS1115ChannelSettings kTankSenderADCSettings = {
+    4096,  // full_scale_mv
+    128,   // data_rate_sps
+    16,    // oversampling
+    1000   // interval_ms
+};
+
+// Fast, low-latency sampling for pressure senders
+constexpr halmet::ADS1115ChannelSettings kPressureSenderADCSettings = {
+    4096,  // full_scale_mv
+    860,   // data_rate_sps
+    1,     // oversampling
+    100    // interval_ms
+};
+
+// Sender resistance (ohm) of an ADS1115 input. config_path is the path of
+// the channel's ADC settings.
+sensesp::FloatProducer* AnalogResistanceSender(
+    halmet::ADS1115Scanner* scanner, int channel, const String& config_path,
+    const halmet::ADS1115ChannelSettings& adc_settings, int sort_order);
 
 #endif
@@ -1,5 +1,8 @@
 #include "halmet_digital.h"
 
+#include "debounced_digital_input.h"
+#include "pcnt_counter_input.h"
+#include "pulse_period_input.h"
 #include "rate_limiter.h"
 
 #include <Arduino.h>
@@ -9,6 +12,8 @@
 #include <sensesp/system/local_debug.h>
 #include <sensesp/system/valueproducer.h>
 #include <sensesp/transforms/frequency.h>
+#include <sensesp/transforms/linear.h>
+#include <sensesp/ui/ui_controls.h>
 
 #ifdef ENABLE_SIGNALK
 #include <sensesp/signalk/signalk_output.h>
@@ -24,14 +29,38 @@ constexpr float kDefaultFrequencyScale = 1.0;
 }  // namespace
 
 sensesp::FloatProducer* TachoDigitalSender(int pin, const String& path_prefix,
-                                           const String& sk_name,
-                                           int sort_order_base) {
+                                           int sort_order_base,
+                                           halmet::SensorTraceWriter* trace,
+                                           uint8_t trace_channel) {
   String config_path;
-#ifdef ENABLE_SIGNALK
-  String sk_path;
-#endif
 
-  auto* tacho_input = new sensesp::DigitalInputCounter(pin, INPUT, RISING, 500);
+  config_path = "/" + path_prefix + "/Hardware Counter";
+
+  auto* hardware_counter =
+      new sensesp::CheckboxConfig(false, "Hardware Pulse Counter", config_path);
+  hardware_counter->set_description(
+      "Count the pulses with the PCNT hardware counter instead of an "
+      "interrupt per pulse. Removes the interrupt load at high pulse rates "
+      "and filters out glitches. Requires a reboot to take effect.");
+  hardware_counter->set_sort_order(sort_order_base + 10);
+
+  sensesp::IntProducer* tacho_input;
+  if (hardware_counter->get_value()) {
+    config_path = "/" + path_prefix + "/Pulse Counter";
+    auto* pcnt_input =
+        new halmet::PCNTCounterInput(pin, INPUT, 500, config_path);
+    pcnt_input->set_description("Hardware pulse counter settings.");
+    pcnt_input->set_sort_order(sort_order_base + 50);
+    tacho_input = pcnt_input;
+  } else {
+    tacho_input = new sensesp::DigitalInputCounter(pin, INPUT, RISING, 500);
+  }
+
+  if (trace != nullptr) {
+    tacho_input->attach([tacho_input, trace, trace_channel]() {
+      trace->record_pulse_count(trace_channel, tacho_input->get());
+    });
+  }
 
 #if 0
   tacho_input->attach([path_prefix, tacho_input]() {
@@ -50,35 +79,83 @@ sensesp::FloatProducer* TachoDigitalSender(int pin, const String& path_prefix,
 
   tacho_input->connect_to(tacho_frequency);
 
-#ifdef ENABLE_SIGNALK
-  config_path = "/" + path_prefix + "/Revolutions SK Path";
-  sk_path = "propulsion." + sk_name + ".revolutions";
+  return tacho_frequency;
+}
 
-  auto* tacho_frequency_sk_output =
-      new sensesp::SKOutputFloat(sk_path, config_path);
+sensesp::FloatProducer* TachoPeriodSender(int pin, const String& path_prefix,
+                                          int sort_order_base,
+                                          halmet::SensorTraceWriter* trace,
+                                          uint8_t trace_channel) {
+  String config_path;
 
-  tacho_frequency_sk_output->set_description(
-      "Signal K path of the RPM output.");
-  tacho_frequency_sk_output->set_sort_order(sort_order_base + 200);
+  config_path = "/" + path_prefix + "/Period Measurement";
+
+  auto* tacho_input = new halmet::PulsePeriodInput(pin, INPUT, 50, config_path);
+
+  tacho_input->set_description(
+      "Pulse period measurement. The frequency is averaged over the most "
+      "recent pulses within the averaging window.");
+  tacho_input->set_sort_order(sort_order_base + 50);
+
+  if (trace != nullptr) {
+    // Record the pulses counted between updates, which a replay converts to
+    // a frequency like gate counter values
+    uint32_t last_count = 0;
+    tacho_input->attach(
+        [tacho_input, trace, trace_channel, last_count]() mutable {
+          const uint32_t count = tacho_input->get_pulse_count();
+          trace->record_pulse_count(trace_channel, count - last_count);
+          last_count = count;
+        });
+  }
+
+  // Same configuration path as the multiplier of the Frequency transform in
+  // TachoDigitalSender, so the setting carries over
+  config_path = "/" + path_prefix + "/Revolution Multiplier";
 
-  tacho_frequency->connect_to(tacho_frequency_sk_output);
-#endif
+  auto* tacho_frequency =
+      new sensesp::Linear(kDefaultFrequencyScale, 0, config_path);
+
+  tacho_frequency->set_description(
+      "The ratio of pulses to revolutions <em>per second</em>.");
+  tacho_frequency->set_sort_order(sort_order_base + 100);
+
+  tacho_input->connect_to(tacho_frequency);
 
   return tacho_frequency;
 }
 
-sensesp::BoolProducer* AlarmDigitalSender(int pin, const String& name,
-                                          int sort_order_base) {
-#ifdef ENABLE_SIGNALK
+halmet::DebouncedDigitalInput* AlarmDigitalSender(
+    int pin, const String& name, int sort_order_base,
+    halmet::SensorTraceWriter* trace, uint8_t trace_channel) {
   String config_path;
+#ifdef ENABLE_SIGNALK
   String sk_path;
 #endif
 
-  auto* alarm_input = new sensesp::DigitalInputState(pin, INPUT, 100);
+  config_path = "/Alarm " + name + "/Input";
+
+  auto* alarm_input =
+      new halmet::DebouncedDigitalInput(pin, INPUT, config_path);
 
-  alarm_input->connect_to(new sensesp::RateLimiter<bool>(1000));
+  alarm_input->set_description(
+      "Alarm input debouncing. Changes to the refresh interval require a "
+      "reboot to take effect.");
+  alarm_input->set_sort_order(sort_order_base + 50);
+
+  if (trace != nullptr) {
+    alarm_input->attach([alarm_input, trace, trace_channel]() {
+      trace->record_digital(trace_channel, alarm_input->get());
+    });
+  }
 
 #ifdef ENABLE_SIGNALK
+  // A flapping alarm is sent at most once a second, but its final state
+  // always gets through
+  auto* alarm_rate_limiter = new sensesp::RateLimiter<bool>(
+      1000, sensesp::RateLimiterMode::kLeadingTrailing);
+  alarm_input->connect_to(alarm_rate_limiter);
+
   config_path = "/Alarm " + name + "/SK Path";
   sk_path = "alarm." + name;
 
@@ -87,7 +164,7 @@ sensesp::BoolProducer* AlarmDigitalSender(int pin, const String& name,
   alarm_sk_output->set_description("Signal K path of the alarm output.");
   alarm_sk_output->set_sort_order(sort_order_base + 100);
 
-  alarm_input->connect_to(alarm_sk_output);
+  alarm_rate_limiter->connect_to(alarm_sk_output);
 #endif
 
   return alarm_input;
@@ -1,14 +1,33 @@
 #ifndef __SRC_HALMET_DIGITAL_H__
 #define __SRC_HALMET_DIGITAL_H__
 
+#include "debounced_digital_input.h"
+#include "sensor_trace.h"
+
 #include <WString.h>
 
 #include <sensesp/system/valueproducer.h>
 
-sensesp::FloatProducer* TachoDigitalSender(int pin, const String& path_prefix,
-                                           const String& sk_name,
-                                           int sort_order_base);
-sensesp::BoolProducer* AlarmDigitalSender(int pin, const String& name,
-                                          int sort_order_base);
+// If trace is given, the raw pulse counts or input states are recorded to
+// it as channel trace_channel.
+
+// Counts pulses over 500 ms, either with an interrupt per pulse or, if
+// selected in the "Hardware Counter" setting, with a PCNT hardware counter
+// unit. See PCNTCounterInput. The caller connects the returned frequency
+// to its outputs.
+
+sensesp::FloatProducer* TachoDigitalSender(
+    int pin, const String& path_prefix, int sort_order_base,
+    halmet::SensorTraceWriter* trace = nullptr, uint8_t trace_channel = 0);
+// Like TachoDigitalSender, but measures the pulse period instead of counting
+// pulses over a fixed interval. See PulsePeriodInput.
+sensesp::FloatProducer* TachoPeriodSender(
+    int pin, const String& path_prefix, int sort_order_base,
+    halmet::SensorTraceWriter* trace = nullptr, uint8_t trace_channel = 0);
+// Reports state changes of an alarm input as they happen, debounced. See
+// DebouncedDigitalInput.
+halmet::DebouncedDigitalInput* AlarmDigitalSender(
+    int pin, const String& name, int sort_order_base,
+    halmet::SensorTraceWriter* trace = nullptr, uint8_t trace_channel = 0);
 
 #endif
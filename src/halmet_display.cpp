@@ -1,59 +1,212 @@
 #include "halmet_display.h"
 
+#include "boot_profiler.h"
+#include "reaction_profiler.h"
+
 #include <Arduino.h>
 #include <WString.h>
 #include <Wire.h>
 
 #include <Adafruit_GFX.h>
 #include <Adafruit_SSD1306.h>
+#include <ReactESP.h>
 
 #include <sensesp/system/local_debug.h>
 
+#include <cstring>
+
 namespace {
 
 // OLED display width and height, in pixels
 constexpr int kScreenWidth = 128;
 constexpr int kScreenHeight = 64;
 
+// SSD1306 I2C address
+constexpr uint8_t kSSD1306Address = 0x3C;
+
+// Wait after the display initialization before drawing
+constexpr uint32_t kSSD1306StartupDelayMs = 100;
+
+// I2C control byte announcing that the following bytes are display data
+constexpr uint8_t kSSD1306DataControl = 0x40;
+
+// Bytes per I2C write, including the control byte. Matches the smallest
+// Wire buffer size the Adafruit library supports.
+constexpr int kI2CChunkSize = 32;
+
+// Bus clock used while pushing display data. The other devices on the bus
+// run at the default 100 kHz, so the clock is restored afterwards.
+constexpr uint32_t kI2CClockDuringFlush = 400000;
+constexpr uint32_t kI2CClockAfterFlush = 100000;
+
+Adafruit_SSD1306* BeginSSD1306(TwoWire* i2c) {
+  auto* display = new Adafruit_SSD1306(kScreenWidth, kScreenHeight, i2c);
+  if (!display->begin(SSD1306_SWITCHCAPVCC, kSSD1306Address)) {
+    debugD("SSD1306 allocation failed");
+    delete display;
+    return nullptr;
+  }
+  return display;
+}
+
+void DrawHostname(Adafruit_SSD1306* display, const char* hostname) {
+  display->setRotation(2);
+  display->clearDisplay();
+  display->setTextSize(1);
+  display->setTextColor(SSD1306_WHITE);
+  display->setCursor(0, 0);
+  display->printf("Host: %s\n", hostname);
+}
+
 }  // namespace
 
+SSD1306Renderer::SSD1306Renderer(Adafruit_SSD1306* display, TwoWire* i2c,
+                                 uint32_t frame_interval_ms)
+    : SSD1306Renderer(i2c, frame_interval_ms) {
+  // Assume that whatever is in the framebuffer now has already been sent
+  // (InitializeSSD1306 calls display()).
+  display_ = display;
+  memcpy(sent_buffer_, display_->getBuffer(), sizeof(sent_buffer_));
+}
+
+SSD1306Renderer::SSD1306Renderer(TwoWire* i2c, uint32_t frame_interval_ms)
+    : i2c_{i2c} {
+  halmet::ProfiledRepeat("Display flush", frame_interval_ms,
+                         [this]() { this->flush(); });
+}
+
+void SSD1306Renderer::attach(Adafruit_SSD1306* display) {
+  display_ = display;
+  for (int row = 0; row < kNumRows; row++) {
+    if (rows_[row].length() > 0) {
+      draw_row(row);
+    }
+  }
+  // Nothing has been sent yet, so make every page differ from the
+  // framebuffer
+  const uint8_t* buffer = display_->getBuffer();
+  for (size_t ii = 0; ii < sizeof(sent_buffer_); ii++) {
+    sent_buffer_[ii] = ~buffer[ii];
+  }
+  modified_ = true;
+}
+
+void SSD1306Renderer::set_row(int row, const String& text) {
+  if (row < 0 || row >= kNumRows || rows_[row] == text) {
+    return;
+  }
+  rows_[row] = text;
+  if (display_ != nullptr) {
+    draw_row(row);
+    modified_ = true;
+  }
+}
+
+void SSD1306Renderer::draw_row(int row) {
+  ClearRow(display_, row);
+  display_->setCursor(0, 8 * row);
+  display_->print(rows_[row].c_str());
+}
+
+void SSD1306Renderer::flush() {
+  if (!modified_ || display_ == nullptr) {
+    return;
+  }
+  modified_ = false;
+
+  // Compare page by page instead of mapping rows to pages, so that the
+  // result is independent of the display rotation. Runs of consecutive
+  // changed pages are sent in one go.
+  const uint8_t* buffer = display_->getBuffer();
+  bool sent = false;
+  int run_start = -1;
+  for (int page = 0; page <= kNumPages; page++) {
+    const bool changed =
+        page < kNumPages && memcmp(buffer + page * kPageSize,
+                                   sent_buffer_ + page * kPageSize,
+                                   kPageSize) != 0;
+    if (changed && run_start < 0) {
+      run_start = page;
+    } else if (!changed && run_start >= 0) {
+      send_pages(run_start, page - 1);
+      run_start = -1;
+      sent = true;
+    }
+  }
+  if (sent) {
+    frames_sent_++;
+  }
+}
+
+void SSD1306Renderer::send_pages(int first_page, int last_page) {
+  display_->ssd1306_command(SSD1306_PAGEADDR);
+  display_->ssd1306_command(first_page);
+  display_->ssd1306_command(last_page);
+  display_->ssd1306_command(SSD1306_COLUMNADDR);
+  display_->ssd1306_command(0);
+  display_->ssd1306_command(kScreenWidth - 1);
+
+  const uint8_t* buffer = display_->getBuffer();
+  const int start = first_page * kPageSize;
+  const int end = (last_page + 1) * kPageSize;
+
+  i2c_->setClock(kI2CClockDuringFlush);
+  for (int pos = start; pos < end; pos += kI2CChunkSize - 1) {
+    const int len = min(kI2CChunkSize - 1, end - pos);
+    i2c_->beginTransmission(kSSD1306Address);
+    i2c_->write(kSSD1306DataControl);
+    i2c_->write(buffer + pos, len);
+    i2c_->endTransmission();
+  }
+  i2c_->setClock(kI2CClockAfterFlush);
+
+  memcpy(sent_buffer_ + start, buffer + start, end - start);
+  bytes_sent_ += end - start;
+}
+
 bool InitializeSSD1306(Adafruit_SSD1306** display, TwoWire* i2c,
                        const char* hostname) {
-  *display = new Adafruit_SSD1306(kScreenWidth, kScreenHeight, i2c);
-  const bool init_successful = (*display)->begin(SSD1306_SWITCHCAPVCC, 0x3C);
-  if (!init_successful) {
-    debugD("SSD1306 allocation failed");
+  *display = BeginSSD1306(i2c);
+  if (*display == nullptr) {
     return false;
   }
-  delay(100);
-  (*display)->setRotation(2);
-  (*display)->clearDisplay();
-  (*display)->setTextSize(1);
-  (*display)->setTextColor(SSD1306_WHITE);
-  (*display)->setCursor(0, 0);
-  (*display)->printf("Host: %s\n", hostname);
+  delay(kSSD1306StartupDelayMs);
+  DrawHostname(*display, hostname);
   (*display)->display();
 
   return true;
 }
 
+void StartSSD1306(TwoWire* i2c, const String& hostname,
+                  SSD1306Renderer* renderer) {
+  auto* display = BeginSSD1306(i2c);
+  if (display == nullptr) {
+    return;
+  }
+  reactesp::ReactESP::app->onDelay(
+      kSSD1306StartupDelayMs, [display, hostname, renderer]() {
+        DrawHostname(display, hostname.c_str());
+        // The renderer sends the whole framebuffer on its next frame
+        renderer->attach(display);
+        halmet::RecordBootPhase("Display");
+      });
+}
+
 /// Clear a text row on an Adafruit graphics display
 void ClearRow(Adafruit_SSD1306* display, int row) {
   display->fillRect(0, 8 * row, kScreenWidth, 8, 0);
 }
 
-void PrintValue(Adafruit_SSD1306* display, int row, const String& title,
+void PrintValue(SSD1306Renderer* renderer, int row, const String& title,
                 float value) {
-  ClearRow(display, row);
-  display->setCursor(0, 8 * row);
-  display->printf("%s: %.1f", title.c_str(), value);
-  display->display();
+  char buf[32];
+  snprintf(buf, sizeof(buf), "%s: %.1f", title.c_str(), value);
+  renderer->set_row(row, buf);
 }
 
-void PrintValue(Adafruit_SSD1306* display, int row, const String& title,
+void PrintValue(SSD1306Renderer* renderer, int row, const String& title,
                 const String& value) {
-  ClearRow(display, row);
-  display->setCursor(0, 8 * row);
-  display->printf("%s: %s", title.c_str(), value.c_str());
-  display->display();
+  char buf[32];
+  snprintf(buf, sizeof(buf), "%s: %s", title.c_str(), value.c_str());
+  renderer->set_row(row, buf);
 }
@@ -6,14 +6,76 @@
 
 #include <Adafruit_SSD1306.h>
 
+#include <cstdint>
+
+/**
+ * @brief Text row renderer that only transmits changed display pages.
+ *
+ * Rows are drawn into the Adafruit_SSD1306 framebuffer but not sent
+ * immediately. On every frame clock tick, the framebuffer is compared with a
+ * copy of what was last sent and only the 8-pixel pages that differ are
+ * written to the display. Rows whose text hasn't changed are not redrawn at
+ * all.
+ *
+ * The display may also be attached after construction, once it has been
+ * initialized. Until then, the row texts are only stored.
+ */
+class SSD1306Renderer {
+ public:
+  SSD1306Renderer(Adafruit_SSD1306* display, TwoWire* i2c,
+                  uint32_t frame_interval_ms = 250);
+  SSD1306Renderer(TwoWire* i2c, uint32_t frame_interval_ms = 250);
+
+  /// Start drawing on an initialized display, beginning with all rows set
+  /// so far.
+  void attach(Adafruit_SSD1306* display);
+
+  /// Set the text of a row. The display is updated on the next frame.
+  void set_row(int row, const String& text);
+
+  /// Transmit all pages that changed since the last flush.
+  void flush();
+
+  /// Total number of framebuffer bytes sent over I2C.
+  uint32_t get_bytes_sent() const { return bytes_sent_; }
+
+  /// Number of frames in which at least one page was sent.
+  uint32_t get_frames_sent() const { return frames_sent_; }
+
+ protected:
+  void send_pages(int first_page, int last_page);
+
+  static constexpr int kNumRows = 8;
+  static constexpr int kNumPages = 8;
+  static constexpr int kPageSize = 128;
+
+  void draw_row(int row);
+
+  Adafruit_SSD1306* display_ = nullptr;
+  TwoWire* i2c_;
+  String rows_[kNumRows];
+  // Framebuffer contents as last sent to the display
+  uint8_t sent_buffer_[kNumPages * kPageSize];
+  bool modified_ = false;
+
+  uint32_t bytes_sent_ = 0;
+  uint32_t frames_sent_ = 0;
+};
+
 bool InitializeSSD1306(Adafruit_SSD1306** display, TwoWire* i2c,
                        const char* hostname);
 
+// Like InitializeSSD1306, but waits for the display in the event loop
+// instead of blocking, and attaches it to renderer once it is ready. Nothing
+// is attached if there is no display.
+void StartSSD1306(TwoWire* i2c, const String& hostname,
+                  SSD1306Renderer* renderer);
+
 void ClearRow(Adafruit_SSD1306* display, int row);
 
-void PrintValue(Adafruit_SSD1306* display, int row, const String& title,
+void PrintValue(SSD1306Renderer* renderer, int row, const String& title,
                 float value);
-void PrintValue(Adafruit_SSD1306* display, int row, const String& title,
+void PrintValue(SSD1306Renderer* renderer, int row, const String& title,
                 const String& value);
 
 #endif
@@ -0,0 +1,95 @@
+#include "n2k_bus.h"
+
+#include "reaction_profiler.h"
+
+#include <Arduino.h>
+#include <ReactESP.h>
+
+#include <sensesp/system/local_debug.h>
+
+namespace halmet {
+
+namespace {
+
+// Task stack size in bytes and priority. The priority is above the idle and
+// Arduino loop tasks but below the WiFi and TCP/IP tasks on the same core.
+constexpr uint32_t kTaskStackSize = 4096;
+constexpr UBaseType_t kTaskPriority = 5;
+constexpr BaseType_t kTaskCore = 0;
+
+constexpr uint32_t kStatisticsIntervalMs = 60000;
+
+#ifdef ARDUINO_ARCH_ESP32
+// The ESP32 TWAI (CAN) controller uses the SJA1000 PeliCAN register layout,
+// with each register on a 32-bit word.
+constexpr uint32_t kCANBase = 0x3ff6b000;
+volatile uint32_t* const kCANCommandRegister =
+    reinterpret_cast<volatile uint32_t*>(kCANBase + 0x04);
+volatile uint32_t* const kCANStatusRegister =
+    reinterpret_cast<volatile uint32_t*>(kCANBase + 0x08);
+// Status register: data overrun status
+constexpr uint32_t kCANStatusDataOverrun = 1 << 1;
+// Command register: clear data overrun
+constexpr uint32_t kCANCommandClearDataOverrun = 1 << 3;
+#endif
+
+}  // namespace
+
+N2kBus::N2kBus(tNMEA2000* nmea2000, N2kTxScheduler* scheduler, Mode mode)
+    : nmea2000_{nmea2000}, scheduler_{scheduler}, mode_{mode} {}
+
+void N2kBus::start() {
+  if (mode_ == Mode::kDedicatedTask) {
+    scheduler_->set_input_queue(&input_queue_);
+    xTaskCreatePinnedToCore(task_entry, "n2k", kTaskStackSize, this,
+                            kTaskPriority, nullptr, kTaskCore);
+  } else {
+    // No need to parse the messages at every single loop iteration; 1 ms
+    // will do
+    ProfiledRepeat("N2k receive", 1, [this]() { this->poll_rx(); });
+    ProfiledRepeat("N2k transmit", N2kTxScheduler::kTickMs,
+                   [this]() { scheduler_->tick(); });
+  }
+  ProfiledRepeat("N2k bus statistics", kStatisticsIntervalMs,
+                 [this]() { this->log_statistics(); });
+}
+
+void N2kBus::task_entry(void* arg) { static_cast<N2kBus*>(arg)->run_task(); }
+
+void N2kBus::run_task() {
+  uint32_t last_tick_ms = millis();
+  while (true) {
+    scheduler_->apply_inputs();
+    poll_rx();
+    const uint32_t now = millis();
+    if (now - last_tick_ms >= N2kTxScheduler::kTickMs) {
+      last_tick_ms = now;
+      scheduler_->tick();
+    }
+    vTaskDelay(1);
+  }
+}
+
+void N2kBus::poll_rx() {
+  nmea2000_->ParseMessages();
+  check_rx_overrun();
+}
+
+void N2kBus::check_rx_overrun() {
+#ifdef ARDUINO_ARCH_ESP32
+  // The NMEA2000_esp32 driver ignores the data overrun interrupt, so the
+  // status bit stays set until it is cleared here.
+  if (*kCANStatusRegister & kCANStatusDataOverrun) {
+    *kCANCommandRegister = kCANCommandClearDataOverrun;
+    rx_overruns_ = rx_overruns_ + 1;
+  }
+#endif
+}
+
+void N2kBus::log_statistics() {
+  debugD("N2k bus (%s): %u RX overruns, %u input overruns",
+         mode_ == Mode::kDedicatedTask ? "task" : "event loop",
+         (uint32_t)rx_overruns_, get_input_overruns());
+}
+
+}  // namespace halmet
@@ -0,0 +1,65 @@
+#ifndef HALMET_SRC_N2K_BUS_H_
+#define HALMET_SRC_N2K_BUS_H_
+
+#include "n2k_scheduler.h"
+
+#include <NMEA2000.h>
+
+#include <cstdint>
+
+namespace halmet {
+
+/**
+ * @brief Drives NMEA 2000 receive processing and the transmit scheduler.
+ *
+ * In event loop mode, message parsing and the scheduler ticks are ReactESP
+ * reactions sharing the main loop with all other reactions.
+ *
+ * In dedicated task mode, they run on a FreeRTOS task pinned to core 0,
+ * while the Arduino loop runs on core 1. CAN receive latency then no longer
+ * depends on the slowest reaction in the main loop. Sender input values are
+ * passed to the task through a lock-free queue, so the sender data is only
+ * accessed on the task.
+ *
+ * Create the senders, which register their messages with the scheduler,
+ * before calling start(). Later changes from other tasks must hold an
+ * N2kTxScheduler::Lock.
+ */
+class N2kBus {
+ public:
+  enum class Mode {
+    kEventLoop,
+    kDedicatedTask,
+  };
+
+  N2kBus(tNMEA2000* nmea2000, N2kTxScheduler* scheduler,
+         Mode mode = Mode::kEventLoop);
+
+  void start();
+
+  /// Number of times the CAN controller has lost received frames because
+  /// its receive FIFO was full.
+  uint32_t get_rx_overruns() const { return rx_overruns_; }
+
+  /// Number of sender input updates lost because the input queue was full.
+  uint32_t get_input_overruns() const {
+    return scheduler_->get_input_overruns();
+  }
+
+ protected:
+  static void task_entry(void* arg);
+  void run_task();
+  void poll_rx();
+  void check_rx_overrun();
+  void log_statistics();
+
+  tNMEA2000* nmea2000_;
+  N2kTxScheduler* scheduler_;
+  const Mode mode_;
+  N2kInputQueue input_queue_;
+  volatile uint32_t rx_overruns_ = 0;
+};
+
+}  // namespace halmet
+
+#endif  // HALMET_SRC_N2K_BUS_H_
@@ -0,0 +1,216 @@
+#include "n2k_message_logger.h"
+
+#include <Arduino.h>
+
+#include <sensesp/system/local_debug.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+namespace halmet {
+
+namespace {
+
+// The output task runs on core 0 at the lowest priority above idle. The
+// Arduino loop task runs at the same priority on core 1, so keeping the
+// logger off that core means formatting and a blocking serial port can't
+// take time slices from the event loop. On core 0 it only runs when the
+// NMEA 2000, WiFi and network tasks are idle.
+constexpr uint32_t kTaskStackSize = 3072;
+constexpr UBaseType_t kTaskPriority = 1;
+constexpr BaseType_t kTaskCore = 0;
+
+// Pause between output rounds once the buffer is empty
+constexpr uint32_t kIdleDelayMs = 20;
+
+// Sequence value of an entry that is being written
+constexpr uint32_t kWriting = UINT32_MAX;
+
+}  // namespace
+
+N2kMessageLogger::N2kMessageLogger(Print* output, const String& config_path)
+    : sensesp::Configurable{config_path}, output_{output} {
+  for (auto& entry : entries_) {
+    entry.sequence.store(kWriting, std::memory_order_relaxed);
+  }
+  load_configuration();
+  xTaskCreatePinnedToCore(task_entry, "n2k_log", kTaskStackSize, this,
+                          kTaskPriority, nullptr, kTaskCore);
+}
+
+void N2kMessageLogger::capture(const tN2kMsg& msg) {
+  if (!enabled_ || !matches_filter(msg)) {
+    return;
+  }
+
+  const uint32_t index = write_index_.load(std::memory_order_relaxed);
+  Entry& entry = entries_[index % kNumEntries];
+
+  // Mark the entry as being written so that a concurrent reader discards
+  // its copy
+  entry.sequence.store(kWriting, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+
+  entry.time_ms = msg.MsgTime;
+  entry.pgn = msg.PGN;
+  entry.source = msg.Source;
+  entry.destination = msg.Destination;
+  entry.priority = msg.Priority;
+  entry.data_len = msg.DataLen;
+  memcpy(entry.data, msg.Data, std::min<int>(msg.DataLen, kMaxDataLen));
+
+  entry.sequence.store(index, std::memory_order_release);
+  write_index_.store(index + 1, std::memory_order_release);
+}
+
+bool N2kMessageLogger::matches_filter(const tN2kMsg& msg) const {
+  if (source_filter_ != kAnySource && msg.Source != source_filter_) {
+    return false;
+  }
+  if (num_pgn_filters_ == 0) {
+    return true;
+  }
+  for (int ii = 0; ii < num_pgn_filters_; ii++) {
+    if (pgn_filters_[ii] == msg.PGN) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void N2kMessageLogger::task_entry(void* arg) {
+  static_cast<N2kMessageLogger*>(arg)->run_task();
+}
+
+void N2kMessageLogger::run_task() {
+  Entry entry;
+  uint32_t reported_dropped = 0;
+  while (true) {
+    while (read_next(entry)) {
+      print_entry(entry);
+    }
+    if (dropped_ != reported_dropped) {
+      output_->printf("N2k message log: %u messages dropped\n",
+                      dropped_ - reported_dropped);
+      reported_dropped = dropped_;
+    }
+    vTaskDelay(pdMS_TO_TICKS(kIdleDelayMs));
+  }
+}
+
+bool N2kMessageLogger::read_next(Entry& entry) {
+  while (true) {
+    const uint32_t write_index = write_index_.load(std::memory_order_acquire);
+    if (read_index_ == write_index) {
+      return false;
+    }
+    if (write_index - read_index_ > kNumEntries) {
+      // Fell behind; skip the messages that have been overwritten
+      dropped_ += write_index - read_index_ - kNumEntries;
+      read_index_ = write_index - kNumEntries;
+    }
+
+    const Entry& slot = entries_[read_index_ % kNumEntries];
+    const uint32_t sequence = slot.sequence.load(std::memory_order_acquire);
+    if (sequence == read_index_) {
+      entry.time_ms = slot.time_ms;
+      entry.pgn = slot.pgn;
+      entry.source = slot.source;
+      entry.destination = slot.destination;
+      entry.priority = slot.priority;
+      entry.data_len = slot.data_len;
+      memcpy(entry.data, slot.data, sizeof(entry.data));
+      std::atomic_thread_fence(std::memory_order_acquire);
+      if (slot.sequence.load(std::memory_order_relaxed) == read_index_) {
+        read_index_++;
+        return true;
+      }
+    }
+    // Overwritten while being copied
+    dropped_++;
+    read_index_++;
+  }
+}
+
+void N2kMessageLogger::print_entry(const Entry& entry) {
+  // Same format as tN2kMsg::Print(), with long payloads truncated
+  constexpr int kLineSize = 80 + 3 * kMaxDataLen;
+  char line[kLineSize];
+  int pos = snprintf(line, kLineSize,
+                     "%u : Pri:%u PGN:%u Source:%u Dest:%u Len:%u Data:",
+                     entry.time_ms, entry.priority, entry.pgn, entry.source,
+                     entry.destination, entry.data_len);
+  const int len = std::min<int>(entry.data_len, kMaxDataLen);
+  for (int ii = 0; ii < len && pos < kLineSize; ii++) {
+    pos += snprintf(line + pos, kLineSize - pos, ii == 0 ? "%02X" : ",%02X",
+                    entry.data[ii]);
+  }
+  if (entry.data_len > kMaxDataLen && pos < kLineSize) {
+    snprintf(line + pos, kLineSize - pos, ",...");
+  }
+  output_->println(line);
+}
+
+void N2kMessageLogger::parse_pgn_filter(const String& pgn_filter) {
+  num_pgn_filters_ = 0;
+  unsigned int start = 0;
+  while (start < pgn_filter.length() && num_pgn_filters_ < kMaxPGNFilters) {
+    const int comma = pgn_filter.indexOf(',', start);
+    const unsigned int end =
+        comma < 0 ? pgn_filter.length() : static_cast<unsigned int>(comma);
+    String item = pgn_filter.substring(start, end);
+    item.trim();
+    const uint32_t pgn = item.toInt();
+    if (pgn > 0) {
+      pgn_filters_[num_pgn_filters_++] = pgn;
+    }
+    start = end + 1;
+  }
+}
+
+String N2kMessageLogger::get_config_schema() {
+  return R"###({
+  "type": "object",
+  "properties": {
+    "enabled": {
+      "title": "Log received messages",
+      "type": "boolean"
+    },
+    "pgn_filter": {
+      "title": "PGNs to log, comma separated (empty for all)",
+      "type": "string"
+    },
+    "source_filter": {
+      "title": "Source address to log (255 for all)",
+      "type": "integer",
+      "minimum": 0,
+      "maximum": 255
+    }
+  }
+})###";
+}
+
+bool N2kMessageLogger::set_configuration(const JsonObject& config) {
+  const String expected[] = {"enabled", "pgn_filter", "source_filter"};
+  for (const auto& str : expected) {
+    if (!config.containsKey(str)) {
+      debugE("N2kMessageLogger: Missing configuration key %s", str.c_str());
+      return false;
+    }
+  }
+  enabled_ = config["enabled"];
+  const String& pgn_filter = config["pgn_filter"];
+  pgn_filter_ = pgn_filter;
+  parse_pgn_filter(pgn_filter_);
+  source_filter_ = config["source_filter"];
+  return true;
+}
+
+void N2kMessageLogger::get_configuration(JsonObject& config) {
+  config["enabled"] = enabled_;
+  config["pgn_filter"] = pgn_filter_;
+  config["source_filter"] = source_filter_;
+}
+
+}  // namespace halmet
@@ -0,0 +1,93 @@
+#ifndef HALMET_SRC_N2K_MESSAGE_LOGGER_H_
+#define HALMET_SRC_N2K_MESSAGE_LOGGER_H_
+
+#include <Arduino.h>
+#include <WString.h>
+
+#include <N2kMsg.h>
+
+#include <sensesp/system/configurable.h>
+
+#include <atomic>
+#include <cstdint>
+
+namespace halmet {
+
+/**
+ * @brief Background logger for received NMEA 2000 messages.
+ *
+ * capture() is meant to be the tNMEA2000 message handler. It only filters
+ * the message and copies it into a binary ring buffer, so it never blocks
+ * message parsing. A low-priority task formats the captured messages and
+ * writes them to the output in the background.
+ *
+ * If the output can't keep up, the oldest messages are overwritten and
+ * counted as dropped. Message payloads longer than kMaxDataLen bytes are
+ * truncated.
+ */
+class N2kMessageLogger : public sensesp::Configurable {
+ public:
+  N2kMessageLogger(Print* output, const String& config_path = "");
+
+  /// Capture a message. Safe to call from a single task or reaction.
+  void capture(const tN2kMsg& msg);
+
+  /// Messages captured into the ring buffer.
+  uint32_t get_captured() const {
+    return write_index_.load(std::memory_order_relaxed);
+  }
+
+  /// Messages overwritten before the output task got to them.
+  uint32_t get_dropped() const { return dropped_; }
+
+  String get_config_schema() override;
+  bool set_configuration(const JsonObject& config) override;
+  void get_configuration(JsonObject& config) override;
+
+ protected:
+  static constexpr int kNumEntries = 64;
+  static constexpr int kMaxDataLen = 32;
+  static constexpr int kMaxPGNFilters = 8;
+  // Source filter value that matches all sources
+  static constexpr uint8_t kAnySource = 255;
+
+  struct Entry {
+    // Index of the message in this slot, or kWriting while it is written
+    std::atomic<uint32_t> sequence{0};
+    uint32_t time_ms;
+    uint32_t pgn;
+    uint8_t source;
+    uint8_t destination;
+    uint8_t priority;
+    uint8_t data_len;  // Original payload length
+    uint8_t data[kMaxDataLen];
+  };
+
+  static void task_entry(void* arg);
+  void run_task();
+  /// Copy the next entry to entry. Return false if there is none.
+  bool read_next(Entry& entry);
+  void print_entry(const Entry& entry);
+
+  bool matches_filter(const tN2kMsg& msg) const;
+  void parse_pgn_filter(const String& pgn_filter);
+
+  Print* output_;
+
+  bool enabled_ = true;
+  String pgn_filter_;
+  uint32_t pgn_filters_[kMaxPGNFilters];
+  int num_pgn_filters_ = 0;
+  uint8_t source_filter_ = kAnySource;
+
+  Entry entries_[kNumEntries];
+  // Index of the next message to be written. Only written by capture().
+  std::atomic<uint32_t> write_index_{0};
+  // Index of the next message to be printed. Only used by the output task.
+  uint32_t read_index_ = 0;
+  uint32_t dropped_ = 0;
+};
+
+}  // namespace halmet
+
+#endif  // HALMET_SRC_N2K_MESSAGE_LOGGER_H_
@@ -0,0 +1,299 @@
+#include "n2k_scheduler.h"
+
+#include "boot_profiler.h"
+#include "reaction_profiler.h"
+
+#include <Arduino.h>
+#include <ReactESP.h>
+
+#include <sensesp/system/local_debug.h>
+
+#include <algorithm>
+
+namespace halmet {
+
+namespace {
+
+// Maximum number of messages handed to the NMEA 2000 stack per tick. At the
+// 10 ms tick this allows a sustained 400 messages/s, far more than the
+// configured PGNs need, while preventing bursts.
+constexpr int kMaxMessagesPerTick = 4;
+
+constexpr uint32_t kStatisticsIntervalMs = 60000;
+
+}  // namespace
+
+N2kTxScheduler::N2kTxScheduler(tNMEA2000* nmea2000)
+    : nmea2000_{nmea2000},
+      epoch_ms_{millis()},
+      mutex_{xSemaphoreCreateRecursiveMutex()} {
+  statistics_reaction_ =
+      ProfiledRepeat("N2k transmit statistics", kStatisticsIntervalMs,
+                     [this]() { this->log_statistics(); });
+}
+
+N2kTxScheduler::~N2kTxScheduler() {
+  // The reaction captures this
+  reactesp::ReactESP::app->remove(statistics_reaction_);
+  vSemaphoreDelete(mutex_);
+}
+
+int N2kTxScheduler::add(uint32_t pgn, uint32_t period_ms,
+                        N2kTxPriority priority, MessageBuilder builder) {
+  Lock lock(this);
+  Entry entry;
+  entry.active = true;
+  entry.priority = priority;
+  entry.period_ticks = std::max<uint32_t>(1, period_ms / kTickMs);
+  entry.phase_ticks = find_least_loaded_phase(entry.period_ticks);
+  entry.builder = builder;
+  entry.statistics.pgn = pgn;
+  entry.statistics.period_ms = entry.period_ticks * kTickMs;
+
+  // First due time: the first instant of the form
+  // epoch + phase + k * period that is not in the past.
+  const uint32_t now = millis();
+  const uint32_t period = entry.period_ticks * kTickMs;
+  const uint32_t first = epoch_ms_ + entry.phase_ticks * kTickMs;
+  if (static_cast<int32_t>(now - first) <= 0) {
+    entry.next_due_ms = first;
+  } else {
+    const uint32_t elapsed = now - first;
+    entry.next_due_ms = first + (elapsed + period - 1) / period * period;
+  }
+
+  update_wheel(entry, 1);
+
+  // Reuse a removed slot if there is one
+  for (size_t ii = 0; ii < entries_.size(); ii++) {
+    if (!entries_[ii].active) {
+      entries_[ii] = entry;
+      return static_cast<int>(ii);
+    }
+  }
+  entries_.push_back(entry);
+  due_.reserve(entries_.size());
+  return static_cast<int>(entries_.size()) - 1;
+}
+
+void N2kTxScheduler::remove(int slot) {
+  Lock lock(this);
+  if (slot < 0 || slot >= static_cast<int>(entries_.size()) ||
+      !entries_[slot].active) {
+    return;
+  }
+  update_wheel(entries_[slot], -1);
+  entries_[slot].active = false;
+  entries_[slot].builder = nullptr;
+}
+
+void N2kTxScheduler::request_send(int slot, uint32_t min_spacing_ms,
+                                  uint32_t request_time_us) {
+  Lock lock(this);
+  if (slot < 0 || slot >= static_cast<int>(entries_.size()) ||
+      !entries_[slot].active) {
+    return;
+  }
+  Entry& entry = entries_[slot];
+  const uint32_t now = millis();
+
+  if (!entry.requested) {
+    // Keep the timestamp of the first of several coalesced requests
+    entry.request_time_us = request_time_us;
+  }
+  entry.requested = true;
+  entry.request_not_before_ms = entry.last_sent_ms + min_spacing_ms;
+
+  if (entry.statistics.sent == 0 ||
+      static_cast<int32_t>(now - entry.request_not_before_ms) >= 0) {
+    send_requested(entry, now);
+  }
+  // Otherwise the request is served by tick() once the spacing has passed
+}
+
+void N2kTxScheduler::post_input(const N2kInputUpdate& update) {
+  if (input_queue_ == nullptr) {
+    update.apply(update);
+    return;
+  }
+  if (!input_queue_->push(update)) {
+    input_overruns_++;
+  }
+}
+
+void N2kTxScheduler::apply_inputs() {
+  if (input_queue_ == nullptr) {
+    return;
+  }
+  // The updates may read sender configuration, e.g. to request a send
+  Lock lock(this);
+  N2kInputUpdate update;
+  while (input_queue_->pop(update)) {
+    update.apply(update);
+  }
+}
+
+const N2kTxStatistics* N2kTxScheduler::get_statistics(int slot) const {
+  if (slot < 0 || slot >= static_cast<int>(entries_.size())) {
+    return nullptr;
+  }
+  return &entries_[slot].statistics;
+}
+
+void N2kTxScheduler::update_wheel(const Entry& entry, int delta) {
+  // Visit every wheel slot the entry fires in. Periods that don't divide
+  // the wheel size touch several slots over consecutive revolutions.
+  uint32_t pos = entry.phase_ticks % kWheelSlots;
+  const uint32_t step = entry.period_ticks % kWheelSlots;
+  for (int ii = 0; ii < kWheelSlots; ii++) {
+    wheel_load_[pos] += delta;
+    pos = (pos + step) % kWheelSlots;
+    if (pos == entry.phase_ticks % kWheelSlots) {
+      break;
+    }
+  }
+}
+
+uint32_t N2kTxScheduler::find_least_loaded_phase(uint32_t period_ticks) const {
+  const uint32_t step = period_ticks % kWheelSlots;
+  const uint32_t candidates = std::min<uint32_t>(period_ticks, kWheelSlots);
+
+  uint32_t best_phase = 0;
+  int best_max = INT32_MAX;
+  int best_sum = INT32_MAX;
+  for (uint32_t phase = 0; phase < candidates; phase++) {
+    int max_load = 0;
+    int sum_load = 0;
+    uint32_t pos = phase;
+    for (int ii = 0; ii < kWheelSlots; ii++) {
+      max_load = std::max<int>(max_load, wheel_load_[pos]);
+      sum_load += wheel_load_[pos];
+      pos = (pos + step) % kWheelSlots;
+      if (pos == phase) {
+        break;
+      }
+    }
+    if (max_load < best_max || (max_load == best_max && sum_load < best_sum)) {
+      best_phase = phase;
+      best_max = max_load;
+      best_sum = sum_load;
+    }
+  }
+  return best_phase;
+}
+
+void N2kTxScheduler::tick() {
+  Lock lock(this);
+  const uint32_t now = millis();
+
+  due_.clear();
+  for (size_t ii = 0; ii < entries_.size(); ii++) {
+    Entry& entry = entries_[ii];
+    if (!entry.active) {
+      continue;
+    }
+    if (static_cast<int32_t>(now - entry.next_due_ms) >= 0) {
+      due_.push_back(static_cast<int>(ii));
+    } else if (entry.requested &&
+               static_cast<int32_t>(now - entry.request_not_before_ms) >= 0) {
+      // Deferred out-of-cycle request. These are rare and already late, so
+      // they bypass the per-tick limit.
+      send_requested(entry, now);
+    }
+  }
+  if (due_.empty()) {
+    return;
+  }
+
+  // Highest priority first; within a priority, the most overdue first
+  std::sort(due_.begin(), due_.end(), [this](int a, int b) {
+    const Entry& ea = entries_[a];
+    const Entry& eb = entries_[b];
+    if (ea.priority != eb.priority) {
+      return ea.priority < eb.priority;
+    }
+    return static_cast<int32_t>(ea.next_due_ms - eb.next_due_ms) < 0;
+  });
+
+  const int num_to_send = std::min<int>(due_.size(), kMaxMessagesPerTick);
+  for (int ii = 0; ii < num_to_send; ii++) {
+    send(entries_[due_[ii]], now);
+  }
+}
+
+void N2kTxScheduler::send(Entry& entry, uint32_t now) {
+  N2kTxStatistics& stats = entry.statistics;
+
+  const uint32_t jitter = now - entry.next_due_ms;
+  stats.max_jitter_ms = std::max(stats.max_jitter_ms, jitter);
+  if (jitter >= kTickMs) {
+    stats.late++;
+  }
+
+  // Keep the phase: advance by whole periods, skipping any that were
+  // missed entirely.
+  const uint32_t period = entry.period_ticks * kTickMs;
+  do {
+    entry.next_due_ms += period;
+  } while (static_cast<int32_t>(now - entry.next_due_ms) >= 0);
+
+  transmit(entry, now);
+}
+
+void N2kTxScheduler::send_requested(Entry& entry, uint32_t now) {
+  if (transmit(entry, now)) {
+    entry.statistics.out_of_cycle++;
+    return;
+  }
+  // Don't retry on every tick while the builder declines or the CAN send
+  // buffer is full. The next periodic transmission carries the data.
+  entry.requested = false;
+}
+
+bool N2kTxScheduler::transmit(Entry& entry, uint32_t now) {
+  N2kTxStatistics& stats = entry.statistics;
+
+  tN2kMsg msg;
+  if (!entry.builder(msg, now)) {
+    stats.suppressed++;
+    return false;
+  }
+  if (!nmea2000_->SendMsg(msg)) {
+    stats.dropped++;
+    return false;
+  }
+  stats.sent++;
+  entry.last_sent_ms = now;
+  if (!first_message_sent_) {
+    first_message_sent_ = true;
+    RecordBootEvent(kFirstMessageBootEvent, stats.pgn);
+  }
+
+  // Any transmission, periodic or not, carries the latest data and thus
+  // satisfies a pending request.
+  if (entry.requested) {
+    entry.requested = false;
+    stats.last_request_latency_us = micros() - entry.request_time_us;
+    stats.max_request_latency_us =
+        std::max(stats.max_request_latency_us, stats.last_request_latency_us);
+  }
+  return true;
+}
+
+void N2kTxScheduler::log_statistics() {
+  Lock lock(this);
+  for (const auto& entry : entries_) {
+    if (!entry.active) {
+      continue;
+    }
+    const N2kTxStatistics& stats = entry.statistics;
+    debugD(
+        "N2k PGN %u every %u ms: %u sent, %u suppressed, %u late, %u dropped, "
+        "max jitter %u ms, %u out of cycle, max request latency %u us",
+        stats.pgn, stats.period_ms, stats.sent, stats.suppressed, stats.late,
+        stats.dropped, stats.max_jitter_ms, stats.out_of_cycle,
+        stats.max_request_latency_us);
+  }
+}
+
+}  // namespace halmet
@@ -0,0 +1,234 @@
+#ifndef HALMET_SRC_N2K_SCHEDULER_H_
+#define HALMET_SRC_N2K_SCHEDULER_H_
+
+#include "spsc_queue.h"
+
+#include <Arduino.h>
+#include <N2kMsg.h>
+#include <NMEA2000.h>
+#include <ReactESP.h>
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+namespace halmet {
+
+/// Transmit priority. Higher priority PGNs are sent first when several are
+/// due on the same scheduler tick.
+enum class N2kTxPriority : uint8_t {
+  kHigh = 0,  // Rapid update PGNs
+  kNormal = 1,
+  kLow = 2,
+};
+
+/**
+ * @brief Per-PGN transmit statistics.
+ */
+struct N2kTxStatistics {
+  uint32_t pgn = 0;
+  uint32_t period_ms = 0;
+  // Messages handed to the NMEA 2000 stack
+  uint32_t sent = 0;
+  // Messages the sender chose not to send, e.g. because all fields were N/A
+  uint32_t suppressed = 0;
+  // Messages sent more than one scheduler tick after their due time
+  uint32_t late = 0;
+  // Messages the NMEA 2000 stack refused, e.g. because the CAN send buffer
+  // was full
+  uint32_t dropped = 0;
+  // Largest deviation of the send time from the due time
+  uint32_t max_jitter_ms = 0;
+  // Messages sent out of cycle on request
+  uint32_t out_of_cycle = 0;
+  // Time from an out-of-cycle request to the message being handed to the
+  // NMEA 2000 stack
+  uint32_t last_request_latency_us = 0;
+  uint32_t max_request_latency_us = 0;
+};
+
+/**
+ * @brief A new input value for a sender.
+ *
+ * Values are carried as double, which represents all sender input types
+ * exactly. apply is called with the update on the side that owns the sender
+ * data.
+ */
+struct N2kInputUpdate {
+  void (*apply)(const N2kInputUpdate& update);
+  void* target;
+  double value;
+  // millis() timestamp of the value
+  uint32_t time_ms;
+  // micros() time of the event behind the value, e.g. the first edge of an
+  // alarm input. Out-of-cycle request latencies are measured from it.
+  uint32_t event_time_us;
+  uint8_t index;
+};
+
+using N2kInputQueue = SPSCQueue<N2kInputUpdate, 64>;
+
+/**
+ * @brief Central transmit scheduler for periodic NMEA 2000 messages.
+ *
+ * All senders register their PGN with the scheduler instead of running their
+ * own repeat reactions. Due times are kept relative to a common epoch so the
+ * PGNs don't drift against each other. When a PGN is added, it is given the
+ * phase offset that is least loaded on a timing wheel covering one second,
+ * which spreads the transmissions evenly instead of having them arrive in
+ * bursts. At most a fixed number of messages is sent per tick; due messages
+ * are sent in priority order and the rest wait for the next tick.
+ *
+ * A sender may also request an immediate out-of-cycle transmission, for
+ * example when an alarm changes state. Such requests are served right away
+ * unless the PGN was sent less than the minimum spacing ago, in which case
+ * the transmission is deferred until the spacing has passed. Out-of-cycle
+ * transmissions don't shift the periodic schedule.
+ *
+ * tick() is called by N2kBus, either in the event loop or on the NMEA 2000
+ * task. Sender input values reach the sender data through post_input(); when
+ * the NMEA 2000 task is used, they are queued and applied on that task so
+ * that the sender data is only ever accessed from one task.
+ *
+ * Register the messages before N2kBus::start(). Changes made afterwards on
+ * another task, e.g. add() and remove() through N2kSender::enable() and
+ * disable() or sender configuration written by the web UI, must hold a Lock:
+ * tick() holds it while it walks the entries and runs their builders.
+ */
+class N2kTxScheduler {
+ public:
+  /// Build the message to be sent at the tick time now (ms). Return false
+  /// to skip this transmission.
+  using MessageBuilder = std::function<bool(tN2kMsg&, uint32_t now)>;
+
+  // Scheduler tick and timing wheel resolution
+  static constexpr uint32_t kTickMs = 10;
+
+  // Boot event recorded with the PGN of the first message sent
+  static constexpr const char* kFirstMessageBootEvent =
+      "First NMEA 2000 message";
+
+  N2kTxScheduler(tNMEA2000* nmea2000);
+  ~N2kTxScheduler();
+
+  /// Send the due messages. Call every kTickMs.
+  void tick();
+
+  /**
+   * @brief Register a periodic message.
+   *
+   * @return Slot identifier to be used with remove() and get_statistics()
+   */
+  int add(uint32_t pgn, uint32_t period_ms, N2kTxPriority priority,
+          MessageBuilder builder);
+
+  /// Stop transmitting a registered message.
+  void remove(int slot);
+
+  /**
+   * @brief Send a registered message out of cycle.
+   *
+   * @param slot Slot returned by add()
+   * @param min_spacing_ms Minimum time since the previous transmission of
+   * the same slot
+   * @param request_time_us micros() timestamp of the triggering event, e.g.
+   * the alarm input edge, used for latency statistics
+   */
+  void request_send(int slot, uint32_t min_spacing_ms,
+                    uint32_t request_time_us);
+
+  const N2kTxStatistics* get_statistics(int slot) const;
+
+  /// Number of registered slots, including removed ones.
+  int get_num_slots() const { return static_cast<int>(entries_.size()); }
+
+  tNMEA2000* get_nmea2000() { return nmea2000_; }
+
+  /**
+   * @brief Pass a new input value to a sender.
+   *
+   * Applied right away if no input queue is set, otherwise queued until the
+   * next apply_inputs() call. Must be called from a single task.
+   */
+  void post_input(const N2kInputUpdate& update);
+
+  /// Apply all queued input updates.
+  void apply_inputs();
+
+  /// Queue input updates in queue instead of applying them directly.
+  void set_input_queue(N2kInputQueue* queue) { input_queue_ = queue; }
+
+  /// Number of input updates lost because the input queue was full.
+  uint32_t get_input_overruns() const { return input_overruns_; }
+
+  /**
+   * @brief Holds the scheduler lock for the lifetime of the object.
+   *
+   * The lock is recursive, so the scheduler methods, which take it
+   * themselves, may be called while it is held.
+   */
+  class Lock {
+   public:
+    explicit Lock(N2kTxScheduler* scheduler) : mutex_{scheduler->mutex_} {
+      xSemaphoreTakeRecursive(mutex_, portMAX_DELAY);
+    }
+    ~Lock() { xSemaphoreGiveRecursive(mutex_); }
+
+    Lock(const Lock&) = delete;
+    Lock& operator=(const Lock&) = delete;
+
+   private:
+    SemaphoreHandle_t mutex_;
+  };
+
+ protected:
+  // The timing wheel covers one second
+  static constexpr int kWheelSlots = 100;
+
+  struct Entry {
+    bool active = false;
+    N2kTxPriority priority = N2kTxPriority::kNormal;
+    uint32_t period_ticks = 0;
+    uint32_t phase_ticks = 0;
+    uint32_t next_due_ms = 0;
+    uint32_t last_sent_ms = 0;
+    // Pending out-of-cycle request
+    bool requested = false;
+    uint32_t request_time_us = 0;
+    uint32_t request_not_before_ms = 0;
+    MessageBuilder builder;
+    N2kTxStatistics statistics;
+  };
+
+  void send(Entry& entry, uint32_t now);
+  /// Serve a pending out-of-cycle request. A failed attempt drops it.
+  void send_requested(Entry& entry, uint32_t now);
+  /// Build and transmit a message. Return true if it was handed to the stack.
+  bool transmit(Entry& entry, uint32_t now);
+  void log_statistics();
+
+  /// Add (+1) or remove (-1) an entry's load from the timing wheel.
+  void update_wheel(const Entry& entry, int delta);
+  uint32_t find_least_loaded_phase(uint32_t period_ticks) const;
+
+  tNMEA2000* nmea2000_;
+  uint32_t epoch_ms_;
+  std::vector<Entry> entries_;
+  uint8_t wheel_load_[kWheelSlots] = {};
+  // Indices of due entries, reused between ticks
+  std::vector<int> due_;
+
+  N2kInputQueue* input_queue_ = nullptr;
+  uint32_t input_overruns_ = 0;
+
+  bool first_message_sent_ = false;
+
+  reactesp::RepeatReaction* statistics_reaction_;
+
+  // Guards entries_ and the sender data read by the builders
+  SemaphoreHandle_t mutex_;
+};
+
+}  // namespace halmet
+
+#endif  // HALMET_SRC_N2K_SCHEDULER_H_
@@ -2,8 +2,12 @@
 #define HALMET_SRC_N2K_SENDERS_H_
 
 #ifdef ENABLE_NMEA2000_OUTPUT
+#include "debounced_digital_input.h"
+#include "expiring_flag_set.h"
 #include "expiring_value.h"
+#include "n2k_scheduler.h"
 
+#include <Arduino.h>
 #include <N2kMessages.h>
 #include <NMEA2000.h>
 
@@ -15,25 +19,168 @@
 
 namespace halmet {
 
+/// What to do with a message whose data fields are all N/A, e.g. because the
+/// inputs are not connected.
+enum class N2kNAPolicy : uint8_t {
+  kSend = 0,       // Send at the regular rate
+  kSuppress = 1,   // Don't send
+  kHeartbeat = 2,  // Send at the heartbeat interval
+};
+
+const char kN2kNAPolicyNames[][10] = {"Send", "Suppress", "Heartbeat"};
+
 /**
  * @brief Base class for NMEA 2000 senders.
  *
+ * Senders don't transmit on their own; they register their PGN with the
+ * shared N2kTxScheduler, which calls build_message() when the PGN is due.
+ *
+ * Senders with optional data fields apply an N/A policy: messages that carry
+ * no valid data can be sent as usual, suppressed, or thinned to a heartbeat.
+ * The first all-N/A message after valid data is always sent on the heartbeat
+ * policy, so receivers see the data go away right away.
+ *
+ * build_message() may run on the NMEA 2000 task, so the configuration
+ * setters hold the scheduler lock.
  */
 class N2kSender : public sensesp::Configurable {
  public:
-  N2kSender(const String& config_path) : sensesp::Configurable{config_path} {}
-
-  virtual void enable() = 0;
+  N2kSender(const String& config_path, N2kTxScheduler* scheduler, uint32_t pgn,
+            uint32_t repeat_interval, N2kTxPriority priority)
+      : sensesp::Configurable{config_path},
+        scheduler_{scheduler},
+        pgn_{pgn},
+        repeat_interval_{repeat_interval},
+        priority_{priority} {}
+
+  /// Register the message with the scheduler. Call before N2kBus::start(),
+  /// normally from the constructor.
+  void enable() {
+    N2kTxScheduler::Lock lock(scheduler_);
+    if (this->slot_ < 0) {
+      this->slot_ = scheduler_->add(
+          pgn_, repeat_interval_, priority_,
+          [this](tN2kMsg& N2kMsg, uint32_t now) {
+            return this->build_message(N2kMsg, now);
+          });
+    }
+  }
 
   void disable() {
-    if (this->sender_reaction_ != nullptr) {
-      reactesp::ReactESP::app->remove(this->sender_reaction_);
-      this->sender_reaction_ = nullptr;
+    N2kTxScheduler::Lock lock(scheduler_);
+    if (this->slot_ >= 0) {
+      scheduler_->remove(this->slot_);
+      this->slot_ = -1;
     }
   }
 
+  const N2kTxStatistics* get_statistics() const {
+    return scheduler_->get_statistics(slot_);
+  }
+
+  void set_na_policy(N2kNAPolicy policy) {
+    N2kTxScheduler::Lock lock(scheduler_);
+    na_policy_ = policy;
+  }
+  void set_na_heartbeat_interval(uint32_t interval) {
+    N2kTxScheduler::Lock lock(scheduler_);
+    na_heartbeat_interval_ = interval;
+  }
+
  protected:
-  sensesp::RepeatReaction* sender_reaction_ = nullptr;
+  /**
+   * @brief Pass a new input value to target, an ExpiringValue member.
+   *
+   * The value is timestamped now and reaches target through the scheduler,
+   * which may apply it on the NMEA 2000 task.
+   */
+  template <typename V, typename T>
+  void set_input(V& target, T value) {
+    N2kInputUpdate update;
+    update.apply = [](const N2kInputUpdate& update) {
+      static_cast<V*>(update.target)
+          ->update(static_cast<T>(update.value), update.time_ms);
+    };
+    update.target = &target;
+    update.value = value;
+    update.time_ms = sensesp::MillisClock::now();
+    update.event_time_us = 0;
+    update.index = 0;
+    scheduler_->post_input(update);
+  }
+
+  /// Fill in the message. Return false to skip the transmission. All
+  /// values of the message are read at the scheduler tick time now (ms).
+  virtual bool build_message(tN2kMsg& N2kMsg, uint32_t now) = 0;
+
+  /// Apply the N/A policy. Return true if a message whose data fields are
+  /// all N/A (all_na) should be sent at time now.
+  bool allow_na_message(bool all_na, uint32_t now) {
+    if (!all_na) {
+      na_sent_ = false;
+      return true;
+    }
+    switch (na_policy_) {
+      case N2kNAPolicy::kSend:
+        return true;
+      case N2kNAPolicy::kHeartbeat:
+        if (!na_sent_ || now - na_last_sent_ >= na_heartbeat_interval_) {
+          na_sent_ = true;
+          na_last_sent_ = now;
+          return true;
+        }
+        return false;
+      case N2kNAPolicy::kSuppress:
+      default:
+        return false;
+    }
+  }
+
+  // Configuration of the N/A policy, to be included by the subclasses.
+  // The keys are optional so that configurations saved by earlier versions
+  // still load.
+  static constexpr const char* kNAPolicySchema = R"###(
+    "na_policy": {
+      "title": "Messages with all fields N/A",
+      "type": "string",
+      "enum": ["Send", "Suppress", "Heartbeat"]
+    },
+    "na_heartbeat_interval": {
+      "title": "Heartbeat interval for messages with all fields N/A (ms)",
+      "type": "integer"
+    })###";
+
+  void set_na_policy_configuration(const JsonObject& config) {
+    if (config.containsKey("na_policy")) {
+      const String& policy_str = config["na_policy"];
+      for (size_t ii = 0; ii < sizeof(kN2kNAPolicyNames) / 10; ii++) {
+        if (policy_str == kN2kNAPolicyNames[ii]) {
+          na_policy_ = (N2kNAPolicy)ii;
+          break;
+        }
+      }
+    }
+    if (config.containsKey("na_heartbeat_interval")) {
+      na_heartbeat_interval_ = config["na_heartbeat_interval"];
+    }
+  }
+
+  void get_na_policy_configuration(JsonObject& config) {
+    config["na_policy"] = kN2kNAPolicyNames[(int)na_policy_];
+    config["na_heartbeat_interval"] = na_heartbeat_interval_;
+  }
+
+  N2kTxScheduler* scheduler_;
+  const uint32_t pgn_;
+  const uint32_t repeat_interval_;  // In ms
+  const N2kTxPriority priority_;
+  int slot_ = -1;
+
+  N2kNAPolicy na_policy_ = N2kNAPolicy::kSend;
+  uint32_t na_heartbeat_interval_ = 10000;  // In ms
+  // An all-N/A message has been sent since the data was last valid
+  bool na_sent_ = false;
+  uint32_t na_last_sent_ = 0;
 };
 
 /**
@@ -43,52 +190,44 @@ class N2kSender : public sensesp::Configurable {
 class N2kEngineParameterRapidSender : public N2kSender {
  public:
   N2kEngineParameterRapidSender(const String& config_path,
-                                uint8_t engine_instance, tNMEA2000* nmea2000,
-                                bool enable = true)
-      : N2kSender{config_path},
-        engine_instance_{engine_instance},
-        nmea2000_{nmea2000},
-        repeat_interval_{100},  // In ms. Dictated by NMEA 2000 standard!
-        expiry_{1000},          // In ms. When the inputs expire.
-        engine_speed_{N2kDoubleNA, expiry_, N2kDoubleNA},
-        engine_boost_pressure_{N2kDoubleNA, expiry_, N2kDoubleNA},
-        engine_tilt_trim_{N2kInt8NA, expiry_, N2kInt8NA} {
+                                uint8_t engine_instance,
+                                N2kTxScheduler* scheduler, bool enable = true)
+      : N2kSender{config_path, scheduler, 127488,
+                  100,  // In ms. Dictated by NMEA 2000 standard!
+                  N2kTxPriority::kHigh},
+        engine_instance_{engine_instance} {
     if (enable) {
       this->enable();
     }
   }
 
-  void enable() override {
-    reactesp::ReactESP::app->onRepeat(repeat_interval_, [this]() {
-      tN2kMsg N2kMsg;
-      // At the moment, the PGN is sent regardless of whether all the
-      // values are invalid or not.
-      SetN2kEngineParamRapid(
-          N2kMsg, this->engine_instance_, this->engine_speed_.get(),
-          this->engine_boost_pressure_.get(), this->engine_tilt_trim_.get());
-      this->nmea2000_->SendMsg(N2kMsg);
-    });
-  }
-
   sensesp::LambdaConsumer<double> engine_speed_consumer_{
-      [this](double value) { this->engine_speed_.update(value); }};
+      [this](double value) { this->set_input(this->engine_speed_, value); }};
 
   sensesp::LambdaConsumer<double> engine_boost_pressure_consumer_{
-      [this](double value) { this->engine_boost_pressure_.update(value); }};
+      [this](double value) {
+        this->set_input(this->engine_boost_pressure_, value);
+      }};
 
   sensesp::LambdaConsumer<int8_t> engine_tilt_trim_consumer_{
-      [this](int8_t value) { this->engine_tilt_trim_.update(value); }};
+      [this](int8_t value) {
+        this->set_input(this->engine_tilt_trim_, value);
+      }};
 
   String get_config_schema() override {
-    return R"###({
+    String schema_template = R"###({
     "type": "object",
     "properties": {
-      "engine_instance": { "title": "Engine instance", "type": "integer" }
+      "engine_instance": { "title": "Engine instance", "type": "integer" },
+      $NA_POLICY$
     }
   })###";
+    schema_template.replace("$NA_POLICY$", kNAPolicySchema);
+    return schema_template;
   }
 
   bool set_configuration(const JsonObject& config) override {
+    N2kTxScheduler::Lock lock(scheduler_);
     const String expected[] = {"engine_instance"};
     for (const auto& str : expected) {
       if (!config.containsKey(str)) {
@@ -100,22 +239,40 @@ class N2kEngineParameterRapidSender : public N2kSender {
       }
     }
     engine_instance_ = config["engine_instance"];
+    set_na_policy_configuration(config);
     return true;
   }
 
   void get_configuration(JsonObject& config) override {
     config["engine_instance"] = engine_instance_;
+    get_na_policy_configuration(config);
   }
 
  protected:
-  uint32_t repeat_interval_;
-  uint32_t expiry_;
-  tNMEA2000* nmea2000_;
+  bool build_message(tN2kMsg& N2kMsg, uint32_t now) override {
+    const double engine_speed = this->engine_speed_.get(now);
+    const double engine_boost_pressure = this->engine_boost_pressure_.get(now);
+    const int8_t engine_tilt_trim = this->engine_tilt_trim_.get(now);
+    if (!allow_na_message(N2kIsNA(engine_speed) &&
+                              N2kIsNA(engine_boost_pressure) &&
+                              N2kIsNA(engine_tilt_trim),
+                          now)) {
+      return false;
+    }
+    SetN2kEngineParamRapid(N2kMsg, this->engine_instance_, engine_speed,
+                           engine_boost_pressure, engine_tilt_trim);
+    return true;
+  }
+
+  static constexpr uint32_t kExpiry = 1000;  // In ms. When the inputs expire.
 
   uint8_t engine_instance_;
-  sensesp::ExpiringValue<double> engine_speed_;
-  sensesp::ExpiringValue<double> engine_boost_pressure_;
-  sensesp::ExpiringValue<int8_t> engine_tilt_trim_;
+  sensesp::ExpiringValue<double, kExpiry> engine_speed_{N2kDoubleNA,
+                                                        N2kDoubleNA};
+  sensesp::ExpiringValue<double, kExpiry> engine_boost_pressure_{N2kDoubleNA,
+                                                                 N2kDoubleNA};
+  sensesp::ExpiringValue<int8_t, kExpiry> engine_tilt_trim_{N2kInt8NA,
+                                                            N2kInt8NA};
 };
 
 /**
@@ -125,76 +282,69 @@ class N2kEngineParameterRapidSender : public N2kSender {
 class N2kEngineParameterDynamicSender : public N2kSender {
  public:
   N2kEngineParameterDynamicSender(const String& config_path,
-                                  uint8_t engine_instance, tNMEA2000* nmea2000,
-                                  bool enable = true)
-      : N2kSender{config_path},
+                                  uint8_t engine_instance,
+                                  N2kTxScheduler* scheduler, bool enable = true)
+      : N2kSender{config_path, scheduler, 127489,
+                  500,  // In ms. Dictated by NMEA 2000 standard!
+                  N2kTxPriority::kNormal},
         engine_instance_{engine_instance},
-        nmea2000_{nmea2000},
-        repeat_interval_{500},  // In ms. Dictated by NMEA 2000 standard!
-        expiry_{5000},          // In ms. When the inputs expire.
-        oil_pressure_{N2kDoubleNA, expiry_, N2kDoubleNA},
-        oil_temperature_{N2kDoubleNA, expiry_, N2kDoubleNA},
-        coolant_temperature_{N2kDoubleNA, expiry_, N2kDoubleNA},
-        alternator_voltage_{N2kDoubleNA, expiry_, N2kDoubleNA},
-        fuel_rate_{N2kDoubleNA, expiry_, N2kDoubleNA},
-        total_engine_hours_{N2kDoubleNA, expiry_, N2kDoubleNA},
-        coolant_pressure_{N2kDoubleNA, expiry_, N2kDoubleNA},
-        fuel_pressure_{N2kDoubleNA, expiry_, N2kDoubleNA},
-        engine_load_{N2kInt8NA, expiry_, N2kInt8NA},
-        engine_torque_{N2kInt8NA, expiry_, N2kInt8NA},
-        // Status bits 1
-        check_engine_{false, expiry_, false},
-        over_temperature_{false, expiry_, false},
-        low_oil_pressure_{false, expiry_, false},
-        low_oil_level_{false, expiry_, false},
-        low_fuel_pressure_{false, expiry_, false},
-        low_system_voltage_{false, expiry_, false},
-        low_coolant_level_{false, expiry_, false},
-        water_flow_{false, expiry_, false},
-        water_in_fuel_{false, expiry_, false},
-        charge_indicator_{false, expiry_, false},
-        preheat_indicator_{false, expiry_, false},
-        high_boost_pressure_{false, expiry_, false},
-        rev_limit_exceeded_{false, expiry_, false},
-        egr_system_{false, expiry_, false},
-        throttle_position_sensor_{false, expiry_, false},
-        emergency_stop_{false, expiry_, false},
-        warning_level_1_{false, expiry_, false},
-        warning_level_2_{false, expiry_, false},
-        // Status bits 2
-        low_oi_power_reduction_{false, expiry_, false},
-        maintenance_needed_{false, expiry_, false},
-        engine_comm_error_{false, expiry_, false},
-        sub_or_secondary_throttle_{false, expiry_, false},
-        neutral_start_protect_{false, expiry_, false},
-        engine_shutting_down_{false, expiry_, false} {
+        oil_pressure_{N2kDoubleNA, N2kDoubleNA},
+        oil_temperature_{N2kDoubleNA, N2kDoubleNA},
+        coolant_temperature_{N2kDoubleNA, N2kDoubleNA},
+        alternator_voltage_{N2kDoubleNA, N2kDoubleNA},
+        fuel_rate_{N2kDoubleNA, N2kDoubleNA},
+        total_engine_hours_{N2kDoubleNA, N2kDoubleNA},
+        coolant_pressure_{N2kDoubleNA, N2kDoubleNA},
+        fuel_pressure_{N2kDoubleNA, N2kDoubleNA},
+        engine_load_{N2kInt8NA, N2kInt8NA},
+        engine_torque_{N2kInt8NA, N2kInt8NA},
+        status_flags_{kExpiry} {
     if (enable) {
       this->enable();
     }
   }
 
-  void enable() override {
-    if (this->sender_reaction_ == nullptr) {
-      this->sender_reaction_ =
-          reactesp::ReactESP::app->onRepeat(repeat_interval_, [this]() {
-            tN2kMsg N2kMsg;
-            SetN2kEngineDynamicParam(
-                N2kMsg, this->engine_instance_, this->oil_pressure_.get(),
-                this->oil_temperature_.get(), this->coolant_temperature_.get(),
-                this->alternator_voltage_.get(), this->fuel_rate_.get(),
-                this->total_engine_hours_.get(), this->coolant_pressure_.get(),
-                this->fuel_pressure_.get(), this->engine_load_.get(),
-                this->engine_torque_.get(), this->get_engine_status_1(),
-                this->get_engine_status_2());
-            this->nmea2000_->SendMsg(N2kMsg);
-          });
-    }
-  }
+  // Bit positions of the engine status flags. Bits 0-15 form Discrete
+  // Status 1 and bits 16-23 Discrete Status 2.
+  enum StatusFlag : uint8_t {
+    // Discrete Status 1
+    kCheckEngine = 0,
+    kOverTemperature,
+    kLowOilPressure,
+    kLowOilLevel,
+    kLowFuelPressure,
+    kLowSystemVoltage,
+    kLowCoolantLevel,
+    kWaterFlow,
+    kWaterInFuel,
+    kChargeIndicator,
+    kPreheatIndicator,
+    kHighBoostPressure,
+    kRevLimitExceeded,
+    kEGRSystem,
+    kThrottlePositionSensor,
+    kEmergencyStop,
+    // Discrete Status 2
+    kWarningLevel1,
+    kWarningLevel2,
+    kLowOiPowerReduction,
+    kMaintenanceNeeded,
+    kEngineCommError,
+    kSubOrSecondaryThrottle,
+    kNeutralStartProtect,
+    kEngineShuttingDown,
+    kNumStatusFlags
+  };
 
 // Define a macro for defining the consumer functions for each parameter.
 #define DEFINE_CONSUMER(name, type)               \
   sensesp::LambdaConsumer<type> name##_consumer_{ \
-      [this](type value) { this->name##_.update(value); }};
+      [this](type value) { this->set_input(this->name##_, value); }};
+// Status bit consumers additionally trigger an out-of-cycle transmission when
+// the bit changes.
+#define DEFINE_STATUS_CONSUMER(name, flag)        \
+  sensesp::LambdaConsumer<bool> name##_consumer_{ \
+      [this](bool value) { this->set_status_input(flag, value); }};
   DEFINE_CONSUMER(oil_pressure, double)
   DEFINE_CONSUMER(oil_temperature, double)
   DEFINE_CONSUMER(coolant_temperature, double)
@@ -206,188 +356,166 @@ class N2kEngineParameterDynamicSender : public N2kSender {
   DEFINE_CONSUMER(engine_load, int8_t)
   DEFINE_CONSUMER(engine_torque, int8_t)
   // Status bits 1
-  DEFINE_CONSUMER(check_engine, bool)
-  DEFINE_CONSUMER(over_temperature, bool)
-  DEFINE_CONSUMER(low_oil_pressure, bool)
-  DEFINE_CONSUMER(low_oil_level, bool)
-  DEFINE_CONSUMER(low_fuel_pressure, bool)
-  DEFINE_CONSUMER(low_system_voltage, bool)
-  DEFINE_CONSUMER(low_coolant_level, bool)
-  DEFINE_CONSUMER(water_flow, bool)
-  DEFINE_CONSUMER(water_in_fuel, bool)
-  DEFINE_CONSUMER(charge_indicator, bool)
-  DEFINE_CONSUMER(preheat_indicator, bool)
-  DEFINE_CONSUMER(high_boost_pressure, bool)
-  DEFINE_CONSUMER(rev_limit_exceeded, bool)
-  DEFINE_CONSUMER(egr_system, bool)
-  DEFINE_CONSUMER(throttle_position_sensor, bool)
-  DEFINE_CONSUMER(emergency_stop, bool)
+  DEFINE_STATUS_CONSUMER(check_engine, kCheckEngine)
+  DEFINE_STATUS_CONSUMER(over_temperature, kOverTemperature)
+  DEFINE_STATUS_CONSUMER(low_oil_pressure, kLowOilPressure)
+  DEFINE_STATUS_CONSUMER(low_oil_level, kLowOilLevel)
+  DEFINE_STATUS_CONSUMER(low_fuel_pressure, kLowFuelPressure)
+  DEFINE_STATUS_CONSUMER(low_system_voltage, kLowSystemVoltage)
+  DEFINE_STATUS_CONSUMER(low_coolant_level, kLowCoolantLevel)
+  DEFINE_STATUS_CONSUMER(water_flow, kWaterFlow)
+  DEFINE_STATUS_CONSUMER(water_in_fuel, kWaterInFuel)
+  DEFINE_STATUS_CONSUMER(charge_indicator, kChargeIndicator)
+  DEFINE_STATUS_CONSUMER(preheat_indicator, kPreheatIndicator)
+  DEFINE_STATUS_CONSUMER(high_boost_pressure, kHighBoostPressure)
+  DEFINE_STATUS_CONSUMER(rev_limit_exceeded, kRevLimitExceeded)
+  DEFINE_STATUS_CONSUMER(egr_system, kEGRSystem)
+  DEFINE_STATUS_CONSUMER(throttle_position_sensor, kThrottlePositionSensor)
+  DEFINE_STATUS_CONSUMER(emergency_stop, kEmergencyStop)
   // Status bits 2
-  DEFINE_CONSUMER(warning_level_1, bool)
-  DEFINE_CONSUMER(warning_level_2, bool)
-  DEFINE_CONSUMER(low_oi_power_reduction, bool)
-  DEFINE_CONSUMER(maintenance_needed, bool)
-  DEFINE_CONSUMER(engine_comm_error, bool)
-  DEFINE_CONSUMER(sub_or_secondary_throttle, bool)
-  DEFINE_CONSUMER(neutral_start_protect, bool)
-  DEFINE_CONSUMER(engine_shutting_down, bool)
+  DEFINE_STATUS_CONSUMER(warning_level_1, kWarningLevel1)
+  DEFINE_STATUS_CONSUMER(warning_level_2, kWarningLevel2)
+  DEFINE_STATUS_CONSUMER(low_oi_power_reduction, kLowOiPowerReduction)
+  DEFINE_STATUS_CONSUMER(maintenance_needed, kMaintenanceNeeded)
+  DEFINE_STATUS_CONSUMER(engine_comm_error, kEngineCommError)
+  DEFINE_STATUS_CONSUMER(sub_or_secondary_throttle, kSubOrSecondaryThrottle)
+  DEFINE_STATUS_CONSUMER(neutral_start_protect, kNeutralStartProtect)
+  DEFINE_STATUS_CONSUMER(engine_shutting_down, kEngineShuttingDown)
 #undef DEFINE_CONSUMER
+#undef DEFINE_STATUS_CONSUMER
+
+  /**
+   * @brief Measure the latency of a status bit from the edges of input.
+   *
+   * The out-of-cycle transmission of a change of flag is then timed from
+   * the first edge of the input change rather than from the status consumer
+   * call. input must feed the status consumer of flag, directly or through
+   * transforms.
+   */
+  void set_status_edge_source(StatusFlag flag,
+                              const DebouncedDigitalInput* input) {
+    edge_sources_[flag] = input;
+  }
 
   String get_config_schema() override {
     return R"###({
     "type": "object",
     "properties": {
-      "engine_instance": { "title": "Engine instance", "type": "integer" }
+      "engine_instance": { "title": "Engine instance", "type": "integer" },
+      "event_driven": {
+        "title": "Send immediately on status change",
+        "type": "boolean"
+      },
+      "min_event_interval": {
+        "title": "Minimum interval between status change transmissions (ms)",
+        "type": "integer"
+      }
     }
   })###";
   }
 
   bool set_configuration(const JsonObject& config) override {
+    N2kTxScheduler::Lock lock(scheduler_);
     const String expected[] = {"engine_instance"};
     for (const auto& str : expected) {
       if (!config.containsKey(str)) {
         debugE(
-            "N2kEngineParameterRapidSender: Missing configuration key "
+            "N2kEngineParameterDynamicSender: Missing configuration key "
             "%s",
             str.c_str());
         return false;
       }
     }
     engine_instance_ = config["engine_instance"];
+    // Optional keys, absent in configurations saved by earlier versions
+    if (config.containsKey("event_driven")) {
+      event_driven_ = config["event_driven"];
+    }
+    if (config.containsKey("min_event_interval")) {
+      min_event_interval_ = config["min_event_interval"];
+    }
     return true;
   }
 
   void get_configuration(JsonObject& config) override {
     config["engine_instance"] = engine_instance_;
+    config["event_driven"] = event_driven_;
+    config["min_event_interval"] = min_event_interval_;
   }
 
  protected:
-  sensesp::Reaction* sender_reaction_ = nullptr;
-
-  tN2kEngineDiscreteStatus1 get_engine_status_1() {
-    tN2kEngineDiscreteStatus1 status1 = 0;
-
-    // Get the status from each of the sensor checks
-#if 1  // HACK HACK
-    uint16_t status_bits = 0;
-    status_bits |= 0x0001 * check_engine_.get();
-    status_bits |= 0x0002 * over_temperature_.get();
-    status_bits |= 0x0004 * low_oil_pressure_.get();
-    status_bits |= 0x0008 * low_oil_level_.get();
-    status_bits |= 0x0010 * low_fuel_pressure_.get();
-    status_bits |= 0x0020 * low_system_voltage_.get();
-    status_bits |= 0x0040 * low_coolant_level_.get();
-    status_bits |= 0x0080 * water_flow_.get();
-    status_bits |= 0x0100 * water_in_fuel_.get();
-    status_bits |= 0x0200 * charge_indicator_.get();
-    status_bits |= 0x0400 * preheat_indicator_.get();
-    status_bits |= 0x0800 * high_boost_pressure_.get();
-    status_bits |= 0x1000 * rev_limit_exceeded_.get();
-    status_bits |= 0x2000 * egr_system_.get();
-    status_bits |= 0x4000 * throttle_position_sensor_.get();
-    status_bits |= 0x8000 * emergency_stop_.get();
-    status1.Status = status_bits;
-#else
-    status1.Bits.CheckEngine = check_engine_.get();
-    status1.Bits.OverTemperature = over_temperature_.get();
-    status1.Bits.LowOilPressure = low_oil_pressure_.get();
-    status1.Bits.LowOilLevel = low_oil_level_.get();
-    status1.Bits.LowFuelPressure = low_fuel_pressure_.get();
-    status1.Bits.LowSystemVoltage = low_system_voltage_.get();
-    status1.Bits.LowCoolantLevel = low_coolant_level_.get();
-    status1.Bits.WaterFlow = water_flow_.get();
-    status1.Bits.WaterInFuel = water_in_fuel_.get();
-    status1.Bits.ChargeIndicator = charge_indicator_.get();
-    status1.Bits.PreheatIndicator = preheat_indicator_.get();
-    status1.Bits.HighBoostPressure = high_boost_pressure_.get();
-    status1.Bits.RevLimitExceeded = rev_limit_exceeded_.get();
-    status1.Bits.EGRSystem = egr_system_.get();
-    status1.Bits.ThrottlePositionSensor = throttle_position_sensor_.get();
-    status1.Bits.EngineEmergencyStopMode = emergency_stop_.get();
-
-    // Set CheckEngine if any other status bit is set
-    status1.Bits.CheckEngine =
-        status1.Bits.OverTemperature || status1.Bits.LowOilPressure ||
-        status1.Bits.LowOilLevel || status1.Bits.LowFuelPressure ||
-        status1.Bits.LowSystemVoltage || status1.Bits.LowCoolantLevel ||
-        status1.Bits.WaterFlow || status1.Bits.WaterInFuel ||
-        status1.Bits.ChargeIndicator || status1.Bits.PreheatIndicator ||
-        status1.Bits.HighBoostPressure || status1.Bits.RevLimitExceeded ||
-        status1.Bits.EGRSystem || status1.Bits.ThrottlePositionSensor ||
-        status1.Bits.EngineEmergencyStopMode;
-#endif
-    return status1;
-  }
-
-  tN2kEngineDiscreteStatus2 get_engine_status_2() {
-    tN2kEngineDiscreteStatus2 status2 = 0;
-
-#if 1  // HACK HACK
-    uint16_t status_bits = 0;
-    status_bits |= 0x0001 * warning_level_1_.get();
-    status_bits |= 0x0002 * warning_level_2_.get();
-    status_bits |= 0x0004 * low_oi_power_reduction_.get();
-    status_bits |= 0x0008 * maintenance_needed_.get();
-    status_bits |= 0x0010 * engine_comm_error_.get();
-    status_bits |= 0x0020 * sub_or_secondary_throttle_.get();
-    status_bits |= 0x0040 * neutral_start_protect_.get();
-    status_bits |= 0x0080 * engine_shutting_down_.get();
-    status2.Status = status_bits;
-#else
-    status2.Bits.WarningLevel1 = warning_level_1_.get();
-    status2.Bits.WarningLevel2 = warning_level_2_.get();
-    status2.Bits.LowOiPowerReduction = low_oi_power_reduction_.get();
-    status2.Bits.MaintenanceNeeded = maintenance_needed_.get();
-    status2.Bits.EngineCommError = engine_comm_error_.get();
-    status2.Bits.SubOrSecondaryThrottle = sub_or_secondary_throttle_.get();
-    status2.Bits.NeutralStartProtect = neutral_start_protect_.get();
-    status2.Bits.EngineShuttingDown = engine_shutting_down_.get();
-#endif
-    return status2;
+  void set_status_input(StatusFlag flag, bool value) {
+    N2kInputUpdate update;
+    update.apply = [](const N2kInputUpdate& update) {
+      static_cast<N2kEngineParameterDynamicSender*>(update.target)
+          ->apply_status(update.index, update.value != 0, update.time_ms,
+                         update.event_time_us);
+    };
+    update.target = this;
+    update.value = value;
+    update.time_ms = sensesp::MillisClock::now();
+    // The observers of an input run synchronously, so its edge time is
+    // still that of the value being passed on
+    const DebouncedDigitalInput* edge_source = edge_sources_[flag];
+    update.event_time_us =
+        edge_source != nullptr ? edge_source->get_edge_time_us() : micros();
+    update.index = flag;
+    scheduler_->post_input(update);
+  }
+
+  void apply_status(uint8_t flag, bool value, uint32_t time_ms,
+                    uint32_t event_time_us) {
+    const bool changed =
+        ((this->status_flags_.get(time_ms) >> flag) & 1) != value;
+    this->status_flags_.update(flag, value, time_ms);
+    if (changed) {
+      this->on_status_changed(event_time_us);
+    }
+  }
+
+  void on_status_changed(uint32_t event_time_us) {
+    if (event_driven_ && this->slot_ >= 0) {
+      scheduler_->request_send(this->slot_, min_event_interval_,
+                               event_time_us);
+    }
+  }
+
+  bool build_message(tN2kMsg& N2kMsg, uint32_t now) override {
+    const uint32_t status = this->status_flags_.get(now);
+    SetN2kEngineDynamicParam(
+        N2kMsg, this->engine_instance_, this->oil_pressure_.get(now),
+        this->oil_temperature_.get(now), this->coolant_temperature_.get(now),
+        this->alternator_voltage_.get(now), this->fuel_rate_.get(now),
+        this->total_engine_hours_.get(now), this->coolant_pressure_.get(now),
+        this->fuel_pressure_.get(now), this->engine_load_.get(now),
+        this->engine_torque_.get(now),
+        tN2kEngineDiscreteStatus1(status & 0xffff),
+        tN2kEngineDiscreteStatus2((status >> 16) & 0xff));
+    return true;
   }
 
-  uint32_t repeat_interval_;
-  uint32_t expiry_;
-  tNMEA2000* nmea2000_;
+  static constexpr uint32_t kExpiry = 5000;  // In ms. When the inputs expire.
 
   uint8_t engine_instance_;
+  // Send the PGN out of cycle whenever a status bit changes
+  bool event_driven_ = true;
+  // Minimum spacing of the status change transmissions, in ms
+  uint32_t min_event_interval_ = 50;
   // Data to be transmitted
-  sensesp::ExpiringValue<double> oil_pressure_;
-  sensesp::ExpiringValue<double> oil_temperature_;
-  sensesp::ExpiringValue<double> coolant_temperature_;
-  sensesp::ExpiringValue<double> alternator_voltage_;
-  sensesp::ExpiringValue<double> fuel_rate_;
-  sensesp::ExpiringValue<double> total_engine_hours_;
-  sensesp::ExpiringValue<double> coolant_pressure_;
-  sensesp::ExpiringValue<double> fuel_pressure_;
-  sensesp::ExpiringValue<int8_t> engine_load_;
-  sensesp::ExpiringValue<int8_t> engine_torque_;
-  // Engine status 1 fields
-  sensesp::ExpiringValue<bool> check_engine_;
-  sensesp::ExpiringValue<bool> over_temperature_;
-  sensesp::ExpiringValue<bool> low_oil_pressure_;
-  sensesp::ExpiringValue<bool> low_oil_level_;
-  sensesp::ExpiringValue<bool> low_fuel_pressure_;
-  sensesp::ExpiringValue<bool> low_system_voltage_;
-  sensesp::ExpiringValue<bool> low_coolant_level_;
-  sensesp::ExpiringValue<bool> water_flow_;
-  sensesp::ExpiringValue<bool> water_in_fuel_;
-  sensesp::ExpiringValue<bool> charge_indicator_;
-  sensesp::ExpiringValue<bool> preheat_indicator_;
-  sensesp::ExpiringValue<bool> high_boost_pressure_;
-  sensesp::ExpiringValue<bool> rev_limit_exceeded_;
-  sensesp::ExpiringValue<bool> egr_system_;
-  sensesp::ExpiringValue<bool> throttle_position_sensor_;
-  sensesp::ExpiringValue<bool> emergency_stop_;
-  // Engine status 2 fields
-  sensesp::ExpiringValue<bool> warning_level_1_;
-  sensesp::ExpiringValue<bool> warning_level_2_;
-  sensesp::ExpiringValue<bool> low_oi_power_reduction_;
-  sensesp::ExpiringValue<bool> maintenance_needed_;
-  sensesp::ExpiringValue<bool> engine_comm_error_;
-  sensesp::ExpiringValue<bool> sub_or_secondary_throttle_;
-  sensesp::ExpiringValue<bool> neutral_start_protect_;
-  sensesp::ExpiringValue<bool> engine_shutting_down_;
+  sensesp::ExpiringValue<double, kExpiry> oil_pressure_;
+  sensesp::ExpiringValue<double, kExpiry> oil_temperature_;
+  sensesp::ExpiringValue<double, kExpiry> coolant_temperature_;
+  sensesp::ExpiringValue<double, kExpiry> alternator_voltage_;
+  sensesp::ExpiringValue<double, kExpiry> fuel_rate_;
+  sensesp::ExpiringValue<double, kExpiry> total_engine_hours_;
+  sensesp::ExpiringValue<double, kExpiry> coolant_pressure_;
+  sensesp::ExpiringValue<double, kExpiry> fuel_pressure_;
+  sensesp::ExpiringValue<int8_t, kExpiry> engine_load_;
+  sensesp::ExpiringValue<int8_t, kExpiry> engine_torque_;
+  // Engine status fields, indexed by StatusFlag
+  sensesp::ExpiringFlagSet<kNumStatusFlags> status_flags_;
+  // Inputs whose edge times the status change latencies are measured from
+  const DebouncedDigitalInput* edge_sources_[kNumStatusFlags] = {};
 };
 
 const char kN2kFluidLevelTankTypes[][12] = {
@@ -401,39 +529,22 @@ class N2kFluidLevelSender : public N2kSender {
  public:
   N2kFluidLevelSender(const String& config_path, uint8_t tank_instance,
                       tN2kFluidType tank_type, double tank_capacity,
-                      tNMEA2000* nmea2000, bool enable = true)
-      : N2kSender{config_path},
+                      N2kTxScheduler* scheduler, bool enable = true)
+      : N2kSender{config_path, scheduler, 127505,
+                  2500,  // In ms. Dictated by NMEA 2000 standard!
+                  N2kTxPriority::kLow},
         tank_instance_{tank_instance},
         tank_type_{tank_type},
         tank_capacity_{tank_capacity},
-        nmea2000_{nmea2000},
-        repeat_interval_{2500},  // In ms. Dictated by NMEA 2000 standard!
-        expiry_{10000}           // In ms. When the inputs expire.
-  {
-    tank_level_ =
-        sensesp::ExpiringValue<double>(N2kDoubleNA, expiry_, N2kDoubleNA);
+        tank_level_{N2kDoubleNA, N2kDoubleNA} {
     if (enable) {
       this->enable();
     }
   }
 
-  void enable() override {
-    if (this->sender_reaction_ == nullptr) {
-      this->sender_reaction_ =
-          reactesp::ReactESP::app->onRepeat(repeat_interval_, [this]() {
-            tN2kMsg N2kMsg;
-            // At the moment, the PGN is sent regardless of whether all
-            // the values are invalid or not.
-            SetN2kFluidLevel(N2kMsg, this->tank_instance_, this->tank_type_,
-                             this->tank_level_.get(), this->tank_capacity_);
-            this->nmea2000_->SendMsg(N2kMsg);
-          });
-    }
-  }
-
   sensesp::LambdaConsumer<double> tank_level_consumer_{[this](double value) {
     // Internal tank level is a ratio, NMEA 2000 wants a percentage.
-    this->tank_level_.update(100. * value);
+    this->set_input(this->tank_level_, 100. * value);
   }};
 
   String get_config_schema() override {
@@ -459,7 +570,8 @@ class N2kFluidLevelSender : public N2kSender {
     "tank_capacity": {
       "title": "Tank capacity (liters)",
       "type": "number"
-    }
+    },
+    $NA_POLICY$
   }
 })###";
 
@@ -471,10 +583,12 @@ class N2kFluidLevelSender : public N2kSender {
       }
     }
     schema_template.replace("$FLUID_TYPES$", fluid_types);
+    schema_template.replace("$NA_POLICY$", kNAPolicySchema);
     return schema_template;
   };
 
   bool set_configuration(const JsonObject& config) override {
+    N2kTxScheduler::Lock lock(scheduler_);
     const String expected[] = {"tank_instance", "tank_type", "tank_capacity"};
     for (const auto& str : expected) {
       if (!config.containsKey(str)) {
@@ -492,6 +606,7 @@ class N2kFluidLevelSender : public N2kSender {
       }
     }
     tank_capacity_ = config["tank_capacity"];
+    set_na_policy_configuration(config);
     return true;
   }
 
@@ -499,17 +614,26 @@ class N2kFluidLevelSender : public N2kSender {
     config["tank_instance"] = tank_instance_;
     config["tank_type"] = kN2kFluidLevelTankTypes[tank_type_];
     config["tank_capacity"] = tank_capacity_;
+    get_na_policy_configuration(config);
   }
 
  protected:
-  uint32_t repeat_interval_;
-  uint32_t expiry_;
-  tNMEA2000* nmea2000_;
+  bool build_message(tN2kMsg& N2kMsg, uint32_t now) override {
+    const double tank_level = this->tank_level_.get(now);
+    if (!allow_na_message(N2kIsNA(tank_level), now)) {
+      return false;
+    }
+    SetN2kFluidLevel(N2kMsg, this->tank_instance_, this->tank_type_,
+                     tank_level, this->tank_capacity_);
+    return true;
+  }
+
+  static constexpr uint32_t kExpiry = 10000;  // In ms. When the inputs expire.
 
   uint8_t tank_instance_;
   tN2kFluidType tank_type_;
-  double tank_capacity_;                       // in liters
-  sensesp::ExpiringValue<double> tank_level_;  // in percent
+  double tank_capacity_;  // in liters
+  sensesp::ExpiringValue<double, kExpiry> tank_level_;  // in percent
 };
 
 const char kN2kTemperatureSourceTypes[][35] = {
@@ -539,38 +663,20 @@ class N2kTemperatureExtSender : public N2kSender {
   N2kTemperatureExtSender(const String& config_path,
                           uint8_t temperature_instance,
                           tN2kTempSource temperature_source,
-                          tNMEA2000* nmea2000, bool enable = true)
-      : N2kSender{config_path},
+                          N2kTxScheduler* scheduler, bool enable = true)
+      : N2kSender{config_path, scheduler, 130316,
+                  2000,  // In ms. Dictated by NMEA 2000 standard!
+                  N2kTxPriority::kLow},
         temperature_instance_{temperature_instance},
         temperature_source_{temperature_source},
-        nmea2000_{nmea2000},
-        repeat_interval_{2000},  // In ms. Dictated by NMEA 2000 standard!
-        expiry_{10000}           // In ms. When the inputs expire.
-  {
-    temperature_ =
-        sensesp::ExpiringValue<double>(N2kDoubleNA, expiry_, N2kDoubleNA);
+        temperature_{N2kDoubleNA, N2kDoubleNA} {
     if (enable) {
       this->enable();
     }
   }
 
-  void enable() override {
-    if (this->sender_reaction_ == nullptr) {
-      this->sender_reaction_ =
-          reactesp::ReactESP::app->onRepeat(repeat_interval_, [this]() {
-            tN2kMsg N2kMsg;
-            // At the moment, the PGN is sent regardless of whether all
-            // the values are invalid or not.
-            SetN2kTemperatureExt(N2kMsg, 255, this->temperature_instance_,
-                                 this->temperature_source_,
-                                 this->temperature_.get(), N2kDoubleNA);
-            this->nmea2000_->SendMsg(N2kMsg);
-          });
-    }
-  }
-
   sensesp::LambdaConsumer<double> temperature_consumer_{
-      [this](double value) { this->temperature_.update(value); }};
+      [this](double value) { this->set_input(this->temperature_, value); }};
 
   String get_config_schema() override {
     String schema_template = R"###({
@@ -591,7 +697,8 @@ class N2kTemperatureExtSender : public N2kSender {
           $TEMP_TYPES$
         ]
       }
-    }
+    },
+    $NA_POLICY$
   }
 })###";
 
@@ -603,10 +710,12 @@ class N2kTemperatureExtSender : public N2kSender {
       }
     }
     schema_template.replace("$TEMP_TYPES$", fluid_types);
+    schema_template.replace("$NA_POLICY$", kNAPolicySchema);
     return schema_template;
   };
 
   bool set_configuration(const JsonObject& config) override {
+    N2kTxScheduler::Lock lock(scheduler_);
     const String expected[] = {"temperature_instance", "temperature_source"};
     for (const auto& str : expected) {
       if (!config.containsKey(str)) {
@@ -623,6 +732,7 @@ class N2kTemperatureExtSender : public N2kSender {
         break;
       }
     }
+    set_na_policy_configuration(config);
     return true;
   }
 
@@ -630,16 +740,25 @@ class N2kTemperatureExtSender : public N2kSender {
     config["temperature_instance"] = temperature_instance_;
     config["temperature_source"] =
         kN2kTemperatureSourceTypes[temperature_source_];
+    get_na_policy_configuration(config);
   }
 
  protected:
-  uint32_t repeat_interval_;
-  uint32_t expiry_;
-  tNMEA2000* nmea2000_;
+  bool build_message(tN2kMsg& N2kMsg, uint32_t now) override {
+    const double temperature = this->temperature_.get(now);
+    if (!allow_na_message(N2kIsNA(temperature), now)) {
+      return false;
+    }
+    SetN2kTemperatureExt(N2kMsg, 255, this->temperature_instance_,
+                         this->temperature_source_, temperature, N2kDoubleNA);
+    return true;
+  }
+
+  static constexpr uint32_t kExpiry = 10000;  // In ms. When the inputs expire.
 
   uint8_t temperature_instance_;
   tN2kTempSource temperature_source_;
-  sensesp::ExpiringValue<double> temperature_;  // in percent
+  sensesp::ExpiringValue<double, kExpiry> temperature_;  // in percent
 };
 
 }  // namespace halmet
@@ -0,0 +1,792 @@
+#include "native_benchmark.h"
+
+#include "curve_lookup_table.h"
+#include "expiring_flag_set.h"
+#include "expiring_value.h"
+#include "halmet_const.h"
+#include "n2k_scheduler.h"
+#include "n2k_senders.h"
+#include "pcnt_counter_input.h"
+
+#include <N2kMessages.h>
+#include <NMEA2000_native.h>
+#include <ReactESP.h>
+#include <native_hal.h>
+
+#include <sensesp/sensors/digital_input.h>
+#include <sensesp/system/lambda_consumer.h>
+#include <sensesp/transforms/curveinterpolator.h>
+#include <sensesp/transforms/lambda_transform.h>
+#include <sensesp/transforms/linear.h>
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <new>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace {
+
+// Heap allocations made through operator new. The replacement operators
+// below count every allocation of the native binary, which only runs the
+// benchmarks or the simulation.
+std::atomic<uint64_t> allocation_count{0};
+std::atomic<uint64_t> allocation_bytes{0};
+
+void* counted_allocation(std::size_t size) {
+  allocation_count.fetch_add(1, std::memory_order_relaxed);
+  allocation_bytes.fetch_add(size, std::memory_order_relaxed);
+  void* ptr = malloc(size == 0 ? 1 : size);
+  if (ptr == nullptr) {
+    throw std::bad_alloc();
+  }
+  return ptr;
+}
+
+}  // namespace
+
+void* operator new(std::size_t size) { return counted_allocation(size); }
+void* operator new[](std::size_t size) { return counted_allocation(size); }
+void operator delete(void* ptr) noexcept { free(ptr); }
+void operator delete[](void* ptr) noexcept { free(ptr); }
+void operator delete(void* ptr, std::size_t) noexcept { free(ptr); }
+void operator delete[](void* ptr, std::size_t) noexcept { free(ptr); }
+
+namespace halmet {
+
+namespace {
+
+// Minimum measured time of a benchmark run, as in Google Benchmark
+constexpr double kMinTimeNs = 0.5e9;
+constexpr uint64_t kMaxIterations = 1000000000;
+
+/// Keep the compiler from optimizing away the computation of value.
+template <typename T>
+inline void DoNotOptimize(T& value) {
+  asm volatile("" : : "g"(&value) : "memory");
+}
+
+uint64_t cpu_time_ns() {
+  timespec ts;
+  clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+  return uint64_t(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
+
+/**
+ * @brief Iteration control and measurements of one benchmark run.
+ *
+ * Benchmark functions do their setup and then loop while keep_running()
+ * returns true. Only the loop is measured.
+ */
+class BenchmarkState {
+ public:
+  BenchmarkState(uint64_t iterations)
+      : iterations_{iterations}, remaining_{iterations} {}
+
+  bool keep_running() {
+    if (remaining_ > 0) {
+      if (!running_) {
+        start();
+      }
+      remaining_--;
+      return true;
+    }
+    stop();
+    return false;
+  }
+
+  uint64_t get_iterations() const { return iterations_; }
+  double get_real_ns() const { return real_ns_; }
+  double get_cpu_ns() const { return cpu_ns_; }
+  uint64_t get_allocations() const { return allocations_; }
+  uint64_t get_allocated_bytes() const { return allocated_bytes_; }
+
+  /// Report an additional per-run value, like a Google Benchmark user
+  /// counter.
+  void set_counter(const char* name, double value) {
+    counters_.emplace_back(name, value);
+  }
+  const std::vector<std::pair<std::string, double>>& get_counters() const {
+    return counters_;
+  }
+
+ protected:
+  void start() {
+    running_ = true;
+    start_allocations_ = allocation_count.load();
+    start_allocated_bytes_ = allocation_bytes.load();
+    start_cpu_ns_ = cpu_time_ns();
+    start_real_ = std::chrono::steady_clock::now();
+  }
+
+  void stop() {
+    if (!running_) {
+      return;
+    }
+    const auto end_real = std::chrono::steady_clock::now();
+    cpu_ns_ = cpu_time_ns() - start_cpu_ns_;
+    real_ns_ =
+        std::chrono::duration<double, std::nano>(end_real - start_real_)
+            .count();
+    allocations_ = allocation_count.load() - start_allocations_;
+    allocated_bytes_ = allocation_bytes.load() - start_allocated_bytes_;
+    running_ = false;
+  }
+
+  const uint64_t iterations_;
+  uint64_t remaining_;
+  bool running_ = false;
+  std::chrono::steady_clock::time_point start_real_;
+  uint64_t start_cpu_ns_ = 0;
+  uint64_t start_allocations_ = 0;
+  uint64_t start_allocated_bytes_ = 0;
+  double real_ns_ = 0;
+  double cpu_ns_ = 0;
+  uint64_t allocations_ = 0;
+  uint64_t allocated_bytes_ = 0;
+  std::vector<std::pair<std::string, double>> counters_;
+};
+
+struct Benchmark {
+  const char* name;
+  void (*function)(BenchmarkState& state);
+};
+
+struct BenchmarkResult {
+  std::string name;
+  uint64_t iterations;
+  double real_ns;
+  double cpu_ns;
+  double allocations;
+  double allocated_bytes;
+  std::vector<std::pair<std::string, double>> counters;
+};
+
+/// Gives the benchmarks access to the protected message builder of a sender.
+template <typename S>
+class BenchmarkSender : public S {
+ public:
+  using S::S;
+  using S::build_message;
+};
+
+/// Scheduler without a bus, for senders that are built directly. Without an
+/// input queue, input values are applied immediately.
+struct SenderFixture {
+  tNMEA2000_native nmea2000;
+  N2kTxScheduler scheduler{&nmea2000};
+};
+
+/////////////////////////////////////////////////////////////////////
+// Sender message build. Every iteration builds a fresh message, as
+// N2kTxScheduler::transmit() does.
+
+void BM_RapidSender_BuildMessage(BenchmarkState& state) {
+  SenderFixture fixture;
+  BenchmarkSender<N2kEngineParameterRapidSender> sender(
+      "/Benchmark/Rapid", 0, &fixture.scheduler, false);
+  sender.engine_speed_consumer_.set_input(1500.);
+  sender.engine_boost_pressure_consumer_.set_input(120000.);
+  sender.engine_tilt_trim_consumer_.set_input(10);
+  uint32_t now = millis();
+  while (state.keep_running()) {
+    DoNotOptimize(now);
+    tN2kMsg msg;
+    bool send = sender.build_message(msg, now);
+    DoNotOptimize(send);
+    DoNotOptimize(msg);
+  }
+}
+
+void BM_RapidSender_BuildMessage_AllNA(BenchmarkState& state) {
+  SenderFixture fixture;
+  BenchmarkSender<N2kEngineParameterRapidSender> sender(
+      "/Benchmark/Rapid", 0, &fixture.scheduler, false);
+  sender.set_na_policy(N2kNAPolicy::kSuppress);
+  uint32_t now = millis();
+  while (state.keep_running()) {
+    DoNotOptimize(now);
+    tN2kMsg msg;
+    bool send = sender.build_message(msg, now);
+    DoNotOptimize(send);
+    DoNotOptimize(msg);
+  }
+}
+
+void BM_DynamicSender_BuildMessage(BenchmarkState& state) {
+  SenderFixture fixture;
+  BenchmarkSender<N2kEngineParameterDynamicSender> sender(
+      "/Benchmark/Dynamic", 0, &fixture.scheduler, false);
+  sender.oil_pressure_consumer_.set_input(400000.);
+  sender.oil_temperature_consumer_.set_input(360.);
+  sender.coolant_temperature_consumer_.set_input(350.);
+  sender.alternator_voltage_consumer_.set_input(14.2);
+  sender.total_engine_hours_consumer_.set_input(3600. * 1234);
+  sender.low_oil_level_consumer_.set_input(true);
+  sender.warning_level_1_consumer_.set_input(true);
+  uint32_t now = millis();
+  while (state.keep_running()) {
+    DoNotOptimize(now);
+    tN2kMsg msg;
+    bool send = sender.build_message(msg, now);
+    DoNotOptimize(send);
+    DoNotOptimize(msg);
+  }
+}
+
+void BM_FluidLevelSender_BuildMessage(BenchmarkState& state) {
+  SenderFixture fixture;
+  BenchmarkSender<N2kFluidLevelSender> sender(
+      "/Benchmark/Tank", 0, N2kft_Fuel, 200, &fixture.scheduler, false);
+  sender.tank_level_consumer_.set_input(0.75);
+  uint32_t now = millis();
+  while (state.keep_running()) {
+    DoNotOptimize(now);
+    tN2kMsg msg;
+    bool send = sender.build_message(msg, now);
+    DoNotOptimize(send);
+    DoNotOptimize(msg);
+  }
+}
+
+void BM_TemperatureSender_BuildMessage(BenchmarkState& state) {
+  SenderFixture fixture;
+  BenchmarkSender<N2kTemperatureExtSender> sender(
+      "/Benchmark/Temperature", 0, N2kts_ExhaustGasTemperature,
+      &fixture.scheduler, false);
+  sender.temperature_consumer_.set_input(600.);
+  uint32_t now = millis();
+  while (state.keep_running()) {
+    DoNotOptimize(now);
+    tN2kMsg msg;
+    bool send = sender.build_message(msg, now);
+    DoNotOptimize(send);
+    DoNotOptimize(msg);
+  }
+}
+
+/////////////////////////////////////////////////////////////////////
+// Sender inputs
+
+void BM_DynamicSender_StatusInput(BenchmarkState& state) {
+  SenderFixture fixture;
+  BenchmarkSender<N2kEngineParameterDynamicSender> sender(
+      "/Benchmark/Dynamic", 0, &fixture.scheduler, false);
+  bool value = false;
+  while (state.keep_running()) {
+    value = !value;
+    sender.low_oil_level_consumer_.set_input(value);
+  }
+}
+
+void BM_RapidSender_Input(BenchmarkState& state) {
+  SenderFixture fixture;
+  BenchmarkSender<N2kEngineParameterRapidSender> sender(
+      "/Benchmark/Rapid", 0, &fixture.scheduler, false);
+  double rpm = 1500;
+  while (state.keep_running()) {
+    DoNotOptimize(rpm);
+    sender.engine_speed_consumer_.set_input(rpm);
+  }
+}
+
+/////////////////////////////////////////////////////////////////////
+// Status flag packing: the ExpiringFlagSet of the dynamic sender against
+// the bank of one ExpiringValue<bool> per flag it replaced. The
+// bytes_per_sender counter is the storage of the 24 status flags of one
+// sender.
+
+constexpr size_t kNumStatusFlags = 24;
+constexpr uint32_t kStatusExpiryMs = 5000;
+
+using StatusFlagBank =
+    sensesp::ExpiringValue<bool, kStatusExpiryMs>[kNumStatusFlags];
+
+void init_status_flag_bank(StatusFlagBank& bank) {
+  for (auto& flag : bank) {
+    flag = sensesp::ExpiringValue<bool, kStatusExpiryMs>{false, false};
+  }
+}
+
+/// Compose the status word from the bank, as the dynamic sender did.
+uint32_t get_status_flag_bank(const StatusFlagBank& bank, uint32_t now) {
+  uint32_t status = 0;
+  for (size_t ii = 0; ii < kNumStatusFlags; ii++) {
+    status |= uint32_t(bank[ii].get(now)) << ii;
+  }
+  return status;
+}
+
+void BM_ExpiringFlagSet_Get(BenchmarkState& state) {
+  sensesp::ExpiringFlagSet<kNumStatusFlags> flags(kStatusExpiryMs);
+  uint32_t now = 1000;
+  for (size_t ii = 0; ii < kNumStatusFlags; ii += 3) {
+    flags.update(ii, true, now);
+  }
+  while (state.keep_running()) {
+    DoNotOptimize(now);
+    uint32_t status = flags.get(now);
+    DoNotOptimize(status);
+  }
+  state.set_counter("bytes_per_sender", sizeof(flags));
+}
+
+// Staggered updates make nearly every get() scan the per-flag timestamps
+void BM_ExpiringFlagSet_Get_Expiring(BenchmarkState& state) {
+  sensesp::ExpiringFlagSet<kNumStatusFlags> flags(kStatusExpiryMs);
+  uint32_t now = 1000;
+  size_t index = 0;
+  while (state.keep_running()) {
+    now += 300;
+    flags.update(index, true, now);
+    index = index == kNumStatusFlags - 1 ? 0 : index + 1;
+    uint32_t status = flags.get(now);
+    DoNotOptimize(status);
+  }
+  state.set_counter("bytes_per_sender", sizeof(flags));
+}
+
+void BM_ExpiringFlagSet_Update(BenchmarkState& state) {
+  sensesp::ExpiringFlagSet<kNumStatusFlags> flags(kStatusExpiryMs);
+  uint32_t now = 1000;
+  size_t index = 0;
+  while (state.keep_running()) {
+    DoNotOptimize(now);
+    flags.update(index, index & 1, now);
+    index = index == kNumStatusFlags - 1 ? 0 : index + 1;
+  }
+  DoNotOptimize(flags);
+  state.set_counter("bytes_per_sender", sizeof(flags));
+}
+
+void BM_ExpiringValueBoolBank_Get(BenchmarkState& state) {
+  StatusFlagBank bank;
+  init_status_flag_bank(bank);
+  uint32_t now = 1000;
+  for (size_t ii = 0; ii < kNumStatusFlags; ii += 3) {
+    bank[ii].update(true, now);
+  }
+  while (state.keep_running()) {
+    DoNotOptimize(now);
+    uint32_t status = get_status_flag_bank(bank, now);
+    DoNotOptimize(status);
+  }
+  state.set_counter("bytes_per_sender", sizeof(bank));
+}
+
+void BM_ExpiringValueBoolBank_Get_Expiring(BenchmarkState& state) {
+  StatusFlagBank bank;
+  init_status_flag_bank(bank);
+  uint32_t now = 1000;
+  size_t index = 0;
+  while (state.keep_running()) {
+    now += 300;
+    bank[index].update(true, now);
+    index = index == kNumStatusFlags - 1 ? 0 : index + 1;
+    uint32_t status = get_status_flag_bank(bank, now);
+    DoNotOptimize(status);
+  }
+  state.set_counter("bytes_per_sender", sizeof(bank));
+}
+
+void BM_ExpiringValueBoolBank_Update(BenchmarkState& state) {
+  StatusFlagBank bank;
+  init_status_flag_bank(bank);
+  uint32_t now = 1000;
+  size_t index = 0;
+  while (state.keep_running()) {
+    DoNotOptimize(now);
+    bank[index].update(index & 1, now);
+    index = index == kNumStatusFlags - 1 ? 0 : index + 1;
+  }
+  DoNotOptimize(bank);
+  state.set_counter("bytes_per_sender", sizeof(bank));
+}
+
+/////////////////////////////////////////////////////////////////////
+// ExpiringValue
+
+void BM_ExpiringValue_Get(BenchmarkState& state) {
+  sensesp::ExpiringValue<double, 5000> value{N2kDoubleNA, N2kDoubleNA};
+  uint32_t now = 1000;
+  value.update(42., now);
+  while (state.keep_running()) {
+    DoNotOptimize(now);
+    double result = value.get(now);
+    DoNotOptimize(result);
+  }
+}
+
+void BM_ExpiringValue_Get_Expired(BenchmarkState& state) {
+  sensesp::ExpiringValue<double, 5000> value{N2kDoubleNA, N2kDoubleNA};
+  uint32_t now = 1000;
+  value.update(42., now);
+  now += 10000;
+  while (state.keep_running()) {
+    DoNotOptimize(now);
+    double result = value.get(now);
+    DoNotOptimize(result);
+  }
+}
+
+void BM_ExpiringValue_GetMillis(BenchmarkState& state) {
+  sensesp::ExpiringValue<double, 5000> value{N2kDoubleNA, N2kDoubleNA};
+  value.update(42.);
+  while (state.keep_running()) {
+    double result = value.get();
+    DoNotOptimize(result);
+  }
+}
+
+/////////////////////////////////////////////////////////////////////
+// Scheduler tick with the senders of the simulation, including the frame
+// encoding of the NMEA 2000 library. Each iteration is one 10 ms tick.
+
+void BM_Scheduler_Tick(BenchmarkState& state) {
+  tNMEA2000_native nmea2000;
+  nmea2000.SetN2kCANSendFrameBufSize(250);
+  nmea2000.SetMode(tNMEA2000::N2km_NodeOnly, 71);
+  nmea2000.EnableForward(false);
+  nmea2000.Open();
+  N2kTxScheduler scheduler(&nmea2000);
+  N2kEngineParameterRapidSender rapid("/Benchmark/Rapid", 0, &scheduler);
+  N2kEngineParameterDynamicSender dynamic("/Benchmark/Dynamic", 0,
+                                          &scheduler);
+  N2kFluidLevelSender tank("/Benchmark/Tank", 0, N2kft_Fuel, 200,
+                           &scheduler);
+  N2kTemperatureExtSender temperature("/Benchmark/Temperature", 0,
+                                      N2kts_ExhaustGasTemperature,
+                                      &scheduler);
+  uint32_t ticks = 0;
+  while (state.keep_running()) {
+    // Refresh the inputs once a second so they don't expire
+    if (ticks++ % 100 == 0) {
+      rapid.engine_speed_consumer_.set_input(1500.);
+      dynamic.oil_temperature_consumer_.set_input(360.);
+      tank.tank_level_consumer_.set_input(0.75);
+      temperature.temperature_consumer_.set_input(600.);
+    }
+    native_hal::advance_time_ms(N2kTxScheduler::kTickMs);
+    scheduler.tick();
+    nmea2000.ParseMessages();
+  }
+}
+
+/////////////////////////////////////////////////////////////////////
+// Tacho pulse counter backends at a pulse frequency of kFrequencyHz on D1,
+// as created by TachoDigitalSender(): the sensesp::DigitalInputCounter of
+// the default mode, which takes an interrupt per pulse, and the
+// PCNTCounterInput of the "Hardware Counter" mode, which counts in the
+// simulated PCNT unit. Each iteration simulates 1 ms and runs the event
+// loop, so the backends emit their counts every 500 ms from their own read
+// reactions. The host time per iteration is mostly the simulation of the
+// edges and says little about the device.
+//
+// interrupts_per_s is the rate of interrupt handler calls dispatched by the
+// native HAL, i.e. the interrupt load the backend puts on the device CPU.
+// pulses_per_s is the rate the backend counted.
+
+constexpr uint32_t kPulseCounterReadMs = 500;
+
+void run_pulse_counter(BenchmarkState& state, sensesp::IntProducer& counter,
+                       uint32_t frequency_hz) {
+  uint64_t pulses = 0;
+  sensesp::LambdaConsumer<int> consumer{
+      [&pulses](int count) { pulses += count; }};
+  counter.connect_to(&consumer);
+  native_hal::set_pulse_generator(kDigitalInputPin1, [frequency_hz](uint64_t) {
+    return float(frequency_hz);
+  });
+  const uint64_t start_us = native_hal::now_us();
+  const uint64_t start_interrupts = native_hal::get_interrupt_count();
+  while (state.keep_running()) {
+    native_hal::advance_time_ms(1);
+    reactesp::ReactESP::app->tick();
+  }
+  const uint64_t interrupts =
+      native_hal::get_interrupt_count() - start_interrupts;
+  const double elapsed_s = (native_hal::now_us() - start_us) / 1e6;
+  native_hal::set_pulse_generator(kDigitalInputPin1, nullptr);
+  state.set_counter("interrupts_per_s", interrupts / elapsed_s);
+  state.set_counter("pulses_per_s", pulses / elapsed_s);
+}
+
+template <uint32_t kFrequencyHz>
+void BM_PulseCounter_Interrupt(BenchmarkState& state) {
+  {
+    sensesp::DigitalInputCounter counter(kDigitalInputPin1, INPUT, RISING,
+                                         kPulseCounterReadMs);
+    run_pulse_counter(state, counter, kFrequencyHz);
+  }
+  // Deletes the removed reactions, detaching the interrupt
+  reactesp::ReactESP::app->tick();
+}
+
+template <uint32_t kFrequencyHz>
+void BM_PulseCounter_PCNT(BenchmarkState& state) {
+  {
+    PCNTCounterInput counter(kDigitalInputPin1, INPUT, kPulseCounterReadMs);
+    run_pulse_counter(state, counter, kFrequencyHz);
+  }
+  reactesp::ReactESP::app->tick();
+}
+
+/////////////////////////////////////////////////////////////////////
+// Tank level conversion of one ADC sample: the chain of main.cpp
+// (resistance lambda, CurveInterpolator and the Linear volume) against a
+// CurveLookupTable with the resistance and volume conversions fused in.
+// The curves have kNumSamples samples of a nonlinear tank shape. The
+// inputs sweep 0-2000 ohms.
+//
+// The lookup table benchmark also reports its accuracy against the chain:
+// the largest and the mean absolute error over a fine sweep, in ppm of the
+// full-scale output.
+
+// ADS1115 input hardware scale factor and measurement current, as in
+// halmet_analog.cpp
+constexpr float kAnalogInputScale = 29. / 2.048;
+constexpr float kMeasurementCurrent = 0.01;
+constexpr float kOhmsPerVolt = kAnalogInputScale / kMeasurementCurrent;
+
+constexpr float kCurveMaxOhms = 1800;
+constexpr float kSweepMaxOhms = 2000;
+constexpr float kTankVolume = 0.2;
+constexpr int kNumCurveInputs = 1024;
+
+void add_tank_curve(sensesp::CurveInterpolator* curve, int num_samples) {
+  for (int ii = 0; ii < num_samples; ii++) {
+    const float ohms = kCurveMaxOhms * ii / (num_samples - 1);
+    curve->add_sample(sensesp::CurveInterpolator::Sample(
+        ohms, std::pow(ohms / kCurveMaxOhms, 1.5f)));
+  }
+}
+
+float curve_input_volts(int index, int num_inputs) {
+  return kSweepMaxOhms * index / num_inputs / kOhmsPerVolt;
+}
+
+/// The conversion chain of the analog tank inputs in main.cpp.
+struct LevelChain {
+  LevelChain(int num_samples) {
+    add_tank_curve(&level, num_samples);
+    resistance.connect_to(&level);
+    level.connect_to(&volume);
+  }
+
+  float convert(float volts) {
+    resistance.set_input(volts);
+    return volume.get();
+  }
+
+  sensesp::LambdaTransform<float, float> resistance{
+      [](float volts) { return kOhmsPerVolt * volts; }};
+  sensesp::CurveInterpolator level;
+  sensesp::Linear volume{kTankVolume, 0};
+};
+
+template <int kNumSamples>
+void BM_LevelCurve_Chain(BenchmarkState& state) {
+  LevelChain chain(kNumSamples);
+  float inputs[kNumCurveInputs];
+  for (int ii = 0; ii < kNumCurveInputs; ii++) {
+    inputs[ii] = curve_input_volts(ii, kNumCurveInputs);
+  }
+  int index = 0;
+  while (state.keep_running()) {
+    float volume = chain.convert(inputs[index]);
+    DoNotOptimize(volume);
+    index = (index + 1) & (kNumCurveInputs - 1);
+  }
+}
+
+template <int kNumSamples>
+void BM_LevelCurve_LookupTable(BenchmarkState& state) {
+  CurveLookupTable table(kOhmsPerVolt);
+  add_tank_curve(&table, kNumSamples);
+  table.set_output_scale(kTankVolume);
+
+  // Accuracy over a sweep with 100 points per table step
+  LevelChain chain(kNumSamples);
+  constexpr int kNumSweepInputs = 100 * CurveLookupTable::kNumSegments;
+  float max_error = 0;
+  double sum_error = 0;
+  int num_compared = 0;
+  for (int ii = 0; ii <= kNumSweepInputs; ii++) {
+    const float volts = curve_input_volts(ii, kNumSweepInputs);
+    const float expected = chain.convert(volts);
+    if (std::isnan(expected)) {
+      // CurveInterpolator divides by zero at the first sample input
+      continue;
+    }
+    table.set_input(volts);
+    const float error = std::fabs(table.get() - expected);
+    max_error = std::max(max_error, error);
+    sum_error += error;
+    num_compared++;
+  }
+  const double mean_error = sum_error / num_compared;
+  state.set_counter("max_error_ppm_fs", 1e6 * max_error / kTankVolume);
+  state.set_counter("mean_error_ppm_fs", 1e6 * mean_error / kTankVolume);
+
+  float inputs[kNumCurveInputs];
+  for (int ii = 0; ii < kNumCurveInputs; ii++) {
+    inputs[ii] = curve_input_volts(ii, kNumCurveInputs);
+  }
+  int index = 0;
+  while (state.keep_running()) {
+    table.set_input(inputs[index]);
+    float volume = table.get();
+    DoNotOptimize(volume);
+    index = (index + 1) & (kNumCurveInputs - 1);
+  }
+}
+
+const Benchmark kBenchmarks[] = {
+    {"BM_RapidSender_BuildMessage", BM_RapidSender_BuildMessage},
+    {"BM_RapidSender_BuildMessage_AllNA", BM_RapidSender_BuildMessage_AllNA},
+    {"BM_DynamicSender_BuildMessage", BM_DynamicSender_BuildMessage},
+    {"BM_FluidLevelSender_BuildMessage", BM_FluidLevelSender_BuildMessage},
+    {"BM_TemperatureSender_BuildMessage", BM_TemperatureSender_BuildMessage},
+    {"BM_DynamicSender_StatusInput", BM_DynamicSender_StatusInput},
+    {"BM_RapidSender_Input", BM_RapidSender_Input},
+    {"BM_ExpiringFlagSet_Get", BM_ExpiringFlagSet_Get},
+    {"BM_ExpiringFlagSet_Get_Expiring", BM_ExpiringFlagSet_Get_Expiring},
+    {"BM_ExpiringFlagSet_Update", BM_ExpiringFlagSet_Update},
+    {"BM_ExpiringValueBoolBank_Get", BM_ExpiringValueBoolBank_Get},
+    {"BM_ExpiringValueBoolBank_Get_Expiring",
+     BM_ExpiringValueBoolBank_Get_Expiring},
+    {"BM_ExpiringValueBoolBank_Update", BM_ExpiringValueBoolBank_Update},
+    {"BM_ExpiringValue_Get", BM_ExpiringValue_Get},
+    {"BM_ExpiringValue_Get_Expired", BM_ExpiringValue_Get_Expired},
+    {"BM_ExpiringValue_GetMillis", BM_ExpiringValue_GetMillis},
+    {"BM_Scheduler_Tick", BM_Scheduler_Tick},
+    {"BM_PulseCounter_Interrupt/100", BM_PulseCounter_Interrupt<100>},
+    {"BM_PulseCounter_Interrupt/1000", BM_PulseCounter_Interrupt<1000>},
+    {"BM_PulseCounter_Interrupt/10000", BM_PulseCounter_Interrupt<10000>},
+    {"BM_PulseCounter_Interrupt/50000", BM_PulseCounter_Interrupt<50000>},
+    {"BM_PulseCounter_PCNT/100", BM_PulseCounter_PCNT<100>},
+    {"BM_PulseCounter_PCNT/1000", BM_PulseCounter_PCNT<1000>},
+    {"BM_PulseCounter_PCNT/10000", BM_PulseCounter_PCNT<10000>},
+    {"BM_PulseCounter_PCNT/50000", BM_PulseCounter_PCNT<50000>},
+    {"BM_LevelCurve_Chain/3", BM_LevelCurve_Chain<3>},
+    {"BM_LevelCurve_Chain/11", BM_LevelCurve_Chain<11>},
+    {"BM_LevelCurve_LookupTable/3", BM_LevelCurve_LookupTable<3>},
+    {"BM_LevelCurve_LookupTable/11", BM_LevelCurve_LookupTable<11>},
+};
+
+/// Run a benchmark with enough iterations to take at least kMinTimeNs.
+BenchmarkResult run_benchmark(const Benchmark& benchmark) {
+  uint64_t iterations = 1;
+  while (true) {
+    BenchmarkState state(iterations);
+    benchmark.function(state);
+    const double real_ns = state.get_real_ns();
+    if (real_ns >= kMinTimeNs || iterations >= kMaxIterations) {
+      return BenchmarkResult{benchmark.name,
+                             iterations,
+                             real_ns / iterations,
+                             state.get_cpu_ns() / iterations,
+                             double(state.get_allocations()) / iterations,
+                             double(state.get_allocated_bytes()) / iterations,
+                             state.get_counters()};
+    }
+    // Aim a bit past the minimum time, growing by at most 10x per round
+    double multiplier = real_ns > 0 ? 1.4 * kMinTimeNs / real_ns : 10;
+    multiplier = std::min(multiplier, 10.);
+    iterations = std::min<uint64_t>(
+        kMaxIterations,
+        std::max<uint64_t>(iterations + 1, iterations * multiplier));
+  }
+}
+
+bool write_report(const char* path,
+                  const std::vector<BenchmarkResult>& results) {
+  FILE* file = fopen(path, "w");
+  if (file == nullptr) {
+    return false;
+  }
+  char date[32];
+  const time_t now = time(nullptr);
+  strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%S%z", localtime(&now));
+  char host_name[64] = "";
+  gethostname(host_name, sizeof(host_name) - 1);
+#ifdef __OPTIMIZE__
+  const char* build_type = "release";
+#else
+  const char* build_type = "debug";
+#endif
+
+  fprintf(file, "{\n  \"context\": {\n");
+  fprintf(file, "    \"date\": \"%s\",\n", date);
+  fprintf(file, "    \"host_name\": \"%s\",\n", host_name);
+  fprintf(file, "    \"executable\": \"halmet native\",\n");
+  fprintf(file, "    \"num_cpus\": %u,\n",
+          std::thread::hardware_concurrency());
+  fprintf(file, "    \"library_build_type\": \"%s\"\n", build_type);
+  fprintf(file, "  },\n  \"benchmarks\": [\n");
+  for (size_t ii = 0; ii < results.size(); ii++) {
+    const BenchmarkResult& result = results[ii];
+    fprintf(file, "    {\n");
+    fprintf(file, "      \"name\": \"%s\",\n", result.name.c_str());
+    fprintf(file, "      \"family_index\": %zu,\n", ii);
+    fprintf(file, "      \"per_family_instance_index\": 0,\n");
+    fprintf(file, "      \"run_name\": \"%s\",\n", result.name.c_str());
+    fprintf(file, "      \"run_type\": \"iteration\",\n");
+    fprintf(file, "      \"repetitions\": 1,\n");
+    fprintf(file, "      \"repetition_index\": 0,\n");
+    fprintf(file, "      \"threads\": 1,\n");
+    fprintf(file, "      \"iterations\": %llu,\n",
+            (unsigned long long)result.iterations);
+    fprintf(file, "      \"real_time\": %.4f,\n", result.real_ns);
+    fprintf(file, "      \"cpu_time\": %.4f,\n", result.cpu_ns);
+    fprintf(file, "      \"time_unit\": \"ns\",\n");
+    fprintf(file, "      \"allocs_per_iter\": %.4f,\n", result.allocations);
+    fprintf(file, "      \"bytes_per_iter\": %.4f", result.allocated_bytes);
+    for (const auto& counter : result.counters) {
+      fprintf(file, ",\n      \"%s\": %.4f", counter.first.c_str(),
+              counter.second);
+    }
+    fprintf(file, "\n");
+    fprintf(file, "    }%s\n", ii + 1 < results.size() ? "," : "");
+  }
+  fprintf(file, "  ]\n}\n");
+  return fclose(file) == 0;
+}
+
+}  // namespace
+
+int RunBenchmarks(const char* json_path, const char* filter) {
+  std::vector<BenchmarkResult> results;
+  printf("%-40s %12s %12s %12s %10s\n", "Benchmark", "Time (ns)", "CPU (ns)",
+         "Iterations", "Allocs");
+  for (const Benchmark& benchmark : kBenchmarks) {
+    if (filter != nullptr && strstr(benchmark.name, filter) == nullptr) {
+      continue;
+    }
+    results.push_back(run_benchmark(benchmark));
+    const BenchmarkResult& result = results.back();
+    printf("%-40s %12.1f %12.1f %12llu %10.2f\n", result.name.c_str(),
+           result.real_ns, result.cpu_ns,
+           (unsigned long long)result.iterations, result.allocations);
+    for (const auto& counter : result.counters) {
+      printf("    %s: %.1f\n", counter.first.c_str(), counter.second);
+    }
+  }
+  if (json_path != nullptr && !write_report(json_path, results)) {
+    fprintf(stderr, "Can't write %s\n", json_path);
+    return 1;
+  }
+  return 0;
+}
+
+}  // namespace halmet
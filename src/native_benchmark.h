@@ -0,0 +1,26 @@
+#ifndef HALMET_SRC_NATIVE_BENCHMARK_H_
+#define HALMET_SRC_NATIVE_BENCHMARK_H_
+
+namespace halmet {
+
+/**
+ * @brief Run the host-side micro-benchmarks of the NMEA 2000 hot paths.
+ *
+ * Measures the time and heap allocations per operation of the message
+ * build of every sender, the status flag packing and ExpiringValue::get(),
+ * and the interrupt rate of the tacho pulse counter backends.
+ * Results are printed as a table and optionally written as a JSON report in
+ * the Google Benchmark format, so two reports can be compared with its
+ * tools/compare.py.
+ *
+ * Only built in the native environment.
+ *
+ * @param json_path File to write the JSON report to, or nullptr
+ * @param filter Only run benchmarks whose name contains filter, or nullptr
+ * @return Process exit code
+ */
+int RunBenchmarks(const char* json_path, const char* filter);
+
+}  // namespace halmet
+
+#endif  // HALMET_SRC_NATIVE_BENCHMARK_H_
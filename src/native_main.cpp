@@ -0,0 +1,675 @@
+// Host simulation of the HALMET hardware graph.
+//
+// Built only in the native PlatformIO environment. The sensor graph of
+// main.cpp is built by the same BuildSensorGraph() call, and runs unmodified
+// with the ADS1115 scanner, display renderer and NMEA 2000 bus on top of the
+// native_hal stand-ins, driven by a virtual clock. The inputs are fed
+// through the simulated pins, ADC and 1-Wire bus.
+//
+// Usage:
+//   native [duration_s] [--record FILE]
+//     Run a scripted scenario: a tank sender resistance falling from full to
+//     half, tacho pulses on D1 for an engine speeding up from idle and
+//     stopping for the last tenth of the run, a warming oil temperature and
+//     a bouncing low oil level alarm switch on D2. Optionally record the raw
+//     inputs to a sensor trace.
+//   native [duration_s] --period-tacho
+//     Run the scenario with the "Period Mode" setting of the tacho input,
+//     which measures the RPM with PulsePeriodInput instead of a gate
+//     counter.
+//   native [duration_s] --pcnt-tacho
+//     Run the scenario with the "Hardware Counter" setting of the tacho
+//     input, which counts the pulses with the simulated PCNT hardware
+//     counter of PCNTCounterInput instead of an interrupt per pulse.
+//   native --replay FILE...
+//     Feed sensor traces recorded on the device (or with --record) through
+//     the graph as fast as possible. Pass the previous trace file before the
+//     current one to replay both.
+//   native --benchmark [FILE] [--filter NAME]
+//     Run the micro-benchmarks of the sender hot paths instead of the
+//     simulation, see native_benchmark.h. Optionally write a JSON report in
+//     the Google Benchmark format to FILE.
+//
+// A summary of the NMEA 2000 and I2C bus traffic is printed on exit, and for
+// the scripted scenario the error of the tacho RPM against the simulated
+// engine speed and the latency from the D2 switch edge to the alarm value.
+// The frame digest covers the time, identifier and payload of every frame
+// sent, so two replays of the same trace produce the same digest exactly
+// when the output is identical.
+
+// Unit test builds have their own main()
+#ifndef PIO_UNIT_TESTING
+
+#include "ads1115_scanner.h"
+#include "boot_profiler.h"
+#include "engine_hours_counter.h"
+#include "flash_counter_log.h"
+#include "halmet_const.h"
+#include "halmet_display.h"
+#include "n2k_bus.h"
+#include "n2k_scheduler.h"
+#include "native_benchmark.h"
+#include "onewire_temperature_bus.h"
+#include "sensor_graph.h"
+#include "sensor_trace.h"
+#include "sk_delta_batcher.h"
+
+#include <Arduino.h>
+#include <WString.h>
+#include <Wire.h>
+
+#include <Adafruit_ADS1X15.h>
+#include <Adafruit_SSD1306.h>
+#include <NMEA2000_native.h>
+#include <OneWire.h>
+#include <ReactESP.h>
+
+#include <sensesp/system/lambda_consumer.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iterator>
+#include <map>
+#include <utility>
+#include <vector>
+
+using namespace halmet;
+
+namespace {
+
+constexpr uint32_t kDefaultDurationS = 60;
+
+// ADS1115 input hardware scale factor and measurement current, as in
+// halmet_analog.cpp
+constexpr float kAnalogInputScale = 29. / 2.048;
+constexpr float kMeasurementCurrent = 0.01;
+
+// Tank sender resistances at the start and end of the run
+constexpr float kTankStartOhms = 1800;
+constexpr float kTankEndOhms = 900;
+
+// Tacho pulses per revolution and engine speeds at the start and end of the
+// run
+constexpr float kPulsesPerRevolution = 100;
+constexpr float kStartRpm = 700;
+constexpr float kEndRpm = 2400;
+
+// Oil temperatures (K) at the start and end of the run
+constexpr float kStartOilTemperature = 300;
+constexpr float kEndOilTemperature = 360;
+constexpr float kKelvinOffset = 273.15;
+
+// ROM serial number of the simulated oil temperature sensor
+constexpr uint64_t kOilTemperatureSerial = 1;
+
+// Gate time of the pulse counts of TachoDigitalSender, taken as the
+// interval of the first count of a replayed trace
+constexpr uint32_t kTachoIntervalMs = 500;
+
+// Update interval of the slowly changing scenario inputs
+constexpr uint64_t kInputUpdateUs = 100000;
+
+// Contact bounce of the alarm switch: the level toggles this many times,
+// this far apart, before settling
+constexpr int kAlarmBounces = 4;
+constexpr uint64_t kAlarmBounceUs = 700;
+constexpr uint64_t kAlarmOffsetUs = 41300;
+
+constexpr int kNumDigitalInputs = 4;
+constexpr gpio_num_t kDigitalInputPins[kNumDigitalInputs] = {
+    kDigitalInputPin1, kDigitalInputPin2, kDigitalInputPin3,
+    kDigitalInputPin4};
+
+reactesp::ReactESP app;
+
+// Tacho RPM error against the simulated engine speed
+uint32_t rpm_values = 0;
+double rpm_error_sum = 0;
+float rpm_max_error = 0;
+
+// Latency from the first edge of a D2 switch change to the alarm value
+uint64_t alarm_edge_us = 0;
+uint32_t alarm_changes = 0;
+uint64_t alarm_latency_sum_us = 0;
+uint64_t alarm_max_latency_us = 0;
+
+// Frames per PGN, in the order of the CAN identifier
+std::map<uint32_t, uint32_t> frames_per_pgn;
+
+// FNV-1a hash of all sent frames
+uint32_t frame_digest = 2166136261;
+
+// Replayed input values, each held from its time until the next one
+using InputSteps = std::vector<std::pair<uint64_t, float>>;
+
+void update_digest(const void* data, size_t size) {
+  const uint8_t* bytes = static_cast<const uint8_t*>(data);
+  for (size_t ii = 0; ii < size; ii++) {
+    frame_digest = (frame_digest ^ bytes[ii]) * 16777619;
+  }
+}
+
+uint32_t pgn_from_can_id(unsigned long id) {
+  uint32_t pgn = (id >> 8) & 0x3ffff;
+  // PDU1 format: the low byte is the destination address
+  if (((pgn >> 8) & 0xff) < 240) {
+    pgn &= 0x3ff00;
+  }
+  return pgn;
+}
+
+/**
+ * @brief Sensor trace writer storing to a host file.
+ */
+class FileTraceWriter : public SensorTraceWriter {
+ public:
+  FileTraceWriter(FILE* file) : file_{file} {
+    begin();
+    set_enabled(true);
+  }
+
+ protected:
+  void write(const uint8_t* data, size_t size) override {
+    fwrite(data, 1, size, file_);
+  }
+
+  FILE* file_;
+};
+
+bool read_file(const char* path, std::vector<uint8_t>& data) {
+  FILE* file = fopen(path, "rb");
+  if (file == nullptr) {
+    return false;
+  }
+  uint8_t chunk[4096];
+  size_t size;
+  while ((size = fread(chunk, 1, sizeof(chunk), file)) > 0) {
+    data.insert(data.end(), chunk, chunk + size);
+  }
+  fclose(file);
+  return true;
+}
+
+/// Read the records of the trace files in order. A trace started after a
+/// reboot restarts at a low time; it is shifted to continue after the
+/// previous one.
+bool read_traces(const std::vector<const char*>& paths,
+                 std::vector<SensorTraceRecord>& records) {
+  uint32_t last_ms = 0;
+  for (const char* path : paths) {
+    std::vector<uint8_t> data;
+    if (!read_file(path, data)) {
+      fprintf(stderr, "Can't read %s\n", path);
+      return false;
+    }
+    SensorTraceReader reader(data.data(), data.size());
+    if (!reader.is_valid()) {
+      fprintf(stderr, "%s is not a sensor trace\n", path);
+      return false;
+    }
+    bool first = true;
+    uint32_t offset_ms = 0;
+    SensorTraceRecord record;
+    while (reader.next(record)) {
+      if (first) {
+        offset_ms = record.time_ms < last_ms ? last_ms - record.time_ms : 0;
+        first = false;
+      }
+      record.time_ms += offset_ms;
+      last_ms = record.time_ms;
+      records.push_back(record);
+    }
+  }
+  return true;
+}
+
+/// The value of steps at time_us, or the first value before the first step.
+float step_value(const InputSteps& steps, uint64_t time_us) {
+  auto it = std::upper_bound(
+      steps.begin(), steps.end(), time_us,
+      [](uint64_t time, const std::pair<uint64_t, float>& step) {
+        return time < step.first;
+      });
+  return it == steps.begin() ? steps.front().second : std::prev(it)->second;
+}
+
+/// Set the configuration the scenario needs before the graph loads it.
+void preset_configuration(bool period_tacho, bool pcnt_tacho) {
+  // NMEA 2000 output is off by default
+  native_hal::set_configuration("/NMEA 2000/NMEA 2000 Enabled",
+                                "{\"value\":true}");
+  char json[64];
+  snprintf(json, sizeof(json), "{\"multiplier\":%g,\"offset\":0}",
+           1 / kPulsesPerRevolution);
+  native_hal::set_configuration("/Tacho D1/Revolution Multiplier", json);
+  // Saved more often than by default to exercise the journal
+  native_hal::set_configuration("/Tacho D1/Engine Hours",
+                                "{\"duration\":0,\"save_interval_s\":10}");
+  if (period_tacho) {
+    native_hal::set_configuration("/Tacho D1/Period Mode",
+                                  "{\"value\":true}");
+  }
+  if (pcnt_tacho) {
+    native_hal::set_configuration("/Tacho D1/Hardware Counter",
+                                  "{\"value\":true}");
+  }
+}
+
+/// Run the event loop until the virtual time end_us. Time jumps straight to
+/// the next reaction or to the next input change of the scripted scenario.
+void run_until(uint64_t end_us,
+               const std::function<uint64_t(uint64_t)>& inputs = nullptr) {
+  uint64_t next_input_us = inputs ? inputs(native_hal::now_us()) : UINT64_MAX;
+  while (native_hal::now_us() < end_us) {
+    const uint64_t next_us =
+        std::min({app.get_next_due_us(), next_input_us, end_us});
+    native_hal::set_time_us(next_us);
+    if (next_us >= next_input_us) {
+      next_input_us = inputs(next_us);
+    }
+    app.tick();
+  }
+}
+
+/// Switch an alarm input to level, bouncing.
+void switch_alarm_input(int pin, int level) {
+  alarm_edge_us = native_hal::now_us();
+  native_hal::set_pin_level(pin, level);
+  for (int ii = 1; ii <= kAlarmBounces; ii++) {
+    app.onDelayMicros(ii * kAlarmBounceUs, [pin, ii, level]() {
+      native_hal::set_pin_level(pin, ii % 2 == 0 ? level : !level);
+    });
+  }
+}
+
+float interpolate(float start, float end, float progress) {
+  return start + progress * (end - start);
+}
+
+/// Simulated engine speed at progress through the scripted scenario.
+float scenario_rpm(float progress) {
+  return progress < 0.9 ? interpolate(kStartRpm, kEndRpm, progress) : 0;
+}
+
+/// Share of the simulated time end_us during which a bus was busy, in %.
+double bus_percent(uint64_t busy_us, uint64_t end_us) {
+  return end_us > 0 ? 100. * busy_us / end_us : 0;
+}
+
+void print_usage(const char* program) {
+  fprintf(stderr,
+          "Usage:\n"
+          "  %s [duration_s] [--record FILE] [--period-tacho | "
+          "--pcnt-tacho]\n"
+          "  %s --replay FILE...\n"
+          "  %s --benchmark [FILE] [--filter NAME]\n",
+          program, program, program);
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  uint32_t duration_s = kDefaultDurationS;
+  const char* record_path = nullptr;
+  std::vector<const char*> replay_paths;
+  bool benchmark = false;
+  const char* benchmark_path = nullptr;
+  const char* benchmark_filter = nullptr;
+  bool period_tacho = false;
+  bool pcnt_tacho = false;
+  for (int ii = 1; ii < argc; ii++) {
+    if (strcmp(argv[ii], "--benchmark") == 0) {
+      benchmark = true;
+      if (ii + 1 < argc && argv[ii + 1][0] != '-') {
+        benchmark_path = argv[++ii];
+      }
+    } else if (strcmp(argv[ii], "--filter") == 0 && ii + 1 < argc) {
+      benchmark_filter = argv[++ii];
+    } else if (strcmp(argv[ii], "--period-tacho") == 0) {
+      period_tacho = true;
+    } else if (strcmp(argv[ii], "--pcnt-tacho") == 0) {
+      pcnt_tacho = true;
+    } else if (strcmp(argv[ii], "--record") == 0 && ii + 1 < argc) {
+      record_path = argv[++ii];
+    } else if (strcmp(argv[ii], "--replay") == 0) {
+      while (ii + 1 < argc) {
+        replay_paths.push_back(argv[++ii]);
+      }
+    } else {
+      char* end = nullptr;
+      duration_s = strtoul(argv[ii], &end, 10);
+      if (argv[ii][0] == '-' || *end != '\0' || duration_s == 0) {
+        print_usage(argv[0]);
+        return 1;
+      }
+    }
+  }
+  if (benchmark) {
+    return RunBenchmarks(benchmark_path, benchmark_filter);
+  }
+  const bool replay = !replay_paths.empty();
+
+  std::vector<SensorTraceRecord> replay_records;
+  if (replay && !read_traces(replay_paths, replay_records)) {
+    return 1;
+  }
+
+  FileTraceWriter* trace = nullptr;
+  FILE* record_file = nullptr;
+  if (record_path != nullptr) {
+    record_file = fopen(record_path, "wb");
+    if (record_file == nullptr) {
+      fprintf(stderr, "Can't open %s\n", record_path);
+      return 1;
+    }
+    trace = new FileTraceWriter(record_file);
+  }
+
+  /////////////////////////////////////////////////////////////////////
+  // Hardware, as set up in main.cpp. A replay doesn't sample the ADS1115;
+  // the recorded values are fed to the scanner channels instead.
+
+  auto* i2c = new TwoWire(0);
+  i2c->begin(kSDAPin, kSCLPin);
+
+  auto* ads1115 = new Adafruit_ADS1115();
+  ads1115->begin(kADS1115Address, i2c);
+  ads1115->set_noise(0.0005);
+
+  auto* ads1115_scanner = new ADS1115Scanner(
+      replay ? nullptr : ads1115, -1, "/System/Analog Input Scanner");
+  ads1115_scanner->set_trace_writer(trace);
+
+  auto* nmea2000 = new tNMEA2000_native();
+  nmea2000->SetN2kCANSendFrameBufSize(250);
+  nmea2000->SetN2kCANReceiveFrameBufSize(250);
+  nmea2000->SetMode(tNMEA2000::N2km_NodeOnly, 71);
+  nmea2000->EnableForward(false);
+  nmea2000->set_frame_observer(
+      [](unsigned long id, unsigned char len, const unsigned char* buf) {
+        frames_per_pgn[pgn_from_can_id(id)]++;
+        const uint32_t now = millis();
+        update_digest(&now, sizeof(now));
+        update_digest(&id, sizeof(id));
+        update_digest(buf, len);
+      });
+  nmea2000->Open();
+
+  auto* n2k_scheduler = new N2kTxScheduler(nmea2000);
+  auto* n2k_bus = new N2kBus(nmea2000, n2k_scheduler);
+
+  // Signal K deltas, batched as in main.cpp. Only the message rates are
+  // measured; there is no websocket.
+  auto* sk_batcher =
+      new SKDeltaBatcher(1000, 5000, "/System/Signal K Batching");
+
+  Adafruit_SSD1306* display = nullptr;
+  SSD1306Renderer* display_renderer = nullptr;
+  if (InitializeSSD1306(&display, i2c, "halmet")) {
+    display_renderer = new SSD1306Renderer(display, i2c);
+  }
+
+  // The alarm inputs idle high, like the switches of the scenario when
+  // open
+  for (int ii = 1; ii < kNumDigitalInputs; ii++) {
+    native_hal::set_pin_level(kDigitalInputPins[ii], HIGH);
+  }
+
+  /////////////////////////////////////////////////////////////////////
+  // The sensor graph of main.cpp
+
+  preset_configuration(period_tacho, pcnt_tacho);
+
+  ADS1115Scanner* const adc_scanners[] = {ads1115_scanner};
+  auto* onewire = new OneWire(kOneWirePin);
+
+  SensorGraphContext graph_context = {};
+  graph_context.adc_scanners = adc_scanners;
+  graph_context.num_adc_scanners =
+      sizeof(adc_scanners) / sizeof(adc_scanners[0]);
+  graph_context.onewire = onewire;
+  graph_context.sensor_trace = trace;
+  graph_context.sk_batcher = sk_batcher;
+  graph_context.n2k_scheduler = n2k_scheduler;
+  graph_context.display_renderer = display_renderer;
+  const SensorGraph graph = BuildSensorGraph(graph_context);
+
+  if (!replay) {
+    const uint64_t run_us = uint64_t(duration_s) * 1000000;
+    if (graph.tacho_frequency != nullptr) {
+      graph.tacho_frequency->connect_to(
+          new sensesp::LambdaConsumer<float>([run_us](float frequency) {
+            const float expected =
+                scenario_rpm(float(native_hal::now_us()) / run_us);
+            const float error = fabsf(60 * frequency - expected);
+            rpm_values++;
+            rpm_error_sum += error;
+            rpm_max_error = std::max(rpm_max_error, error);
+          }));
+    }
+
+    graph.alarm_inputs[0]->connect_to(
+        new sensesp::LambdaConsumer<bool>([](bool value) {
+          static int last_value = -1;
+          if (last_value >= 0 && value != last_value) {
+            const uint64_t latency_us = native_hal::now_us() - alarm_edge_us;
+            alarm_changes++;
+            alarm_latency_sum_us += latency_us;
+            alarm_max_latency_us = std::max(alarm_max_latency_us, latency_us);
+          }
+          last_value = value;
+        }));
+  }
+
+  n2k_bus->start();
+  RecordBootPhase("Setup");
+
+  uint64_t end_us = 0;
+  uint32_t ignored_records = 0;
+
+  if (!replay) {
+    ///////////////////////////////////////////////////////////////////
+    // Scripted scenario
+
+    end_us = uint64_t(duration_s) * 1000000;
+    auto progress = [end_us]() {
+      return float(native_hal::now_us()) / end_us;
+    };
+
+    onewire->add_ds18b20(kOilTemperatureSerial, [end_us](uint64_t time_us) {
+      return interpolate(kStartOilTemperature, kEndOilTemperature,
+                         float(time_us) / end_us) -
+             kKelvinOffset;
+    });
+
+    // Low oil level alarm (active low) in the last third of the run, off the
+    // grid of the input updates
+    app.onDelayMicros(end_us * 2 / 3 + kAlarmOffsetUs,
+                      []() { switch_alarm_input(kDigitalInputPin2, LOW); });
+
+    native_hal::set_pulse_generator(
+        kDigitalInputPin1, [end_us](uint64_t time_us) {
+          return scenario_rpm(float(time_us) / end_us) / 60 *
+                 kPulsesPerRevolution;
+        });
+    run_until(end_us, [&](uint64_t now_us) -> uint64_t {
+      // Called at the start and at every input update
+      const float p = progress();
+      ads1115->set_input_voltage(
+          0, interpolate(kTankStartOhms, kTankEndOhms, p) *
+                 kMeasurementCurrent / kAnalogInputScale);
+      return now_us + kInputUpdateUs;
+    });
+  } else {
+    ///////////////////////////////////////////////////////////////////
+    // Trace replay. The recorded pulse counts are regenerated as pulses on
+    // D1 at the recorded rate, and the temperatures are read by the
+    // simulated 1-Wire sensor. The ADC values and alarm input levels are
+    // applied at their recorded times, with the event loop run up to that
+    // time in between.
+
+    static InputSteps tacho_steps;
+    static InputSteps temperature_steps;
+    uint32_t last_count_ms = 0;
+    for (const SensorTraceRecord& record : replay_records) {
+      const uint64_t time_us = uint64_t(record.time_ms) * 1000;
+      if (record.type == SensorTraceType::kPulseCount &&
+          record.channel == 0) {
+        if (tacho_steps.empty()) {
+          last_count_ms = record.time_ms - std::min(record.time_ms,
+                                                    kTachoIntervalMs);
+          tacho_steps.emplace_back(0, 0);
+        }
+        const uint32_t interval_ms = record.time_ms - last_count_ms;
+        // The count applies to the interval up to the record
+        tacho_steps.emplace_back(
+            uint64_t(last_count_ms) * 1000,
+            interval_ms > 0 ? 1000.f * record.value / interval_ms : 0);
+        last_count_ms = record.time_ms;
+      } else if (record.type == SensorTraceType::kTemperature &&
+                 record.channel == 0) {
+        temperature_steps.emplace_back(time_us,
+                                       record.temperature - kKelvinOffset);
+      }
+    }
+    if (!tacho_steps.empty()) {
+      // No pulses after the last count
+      tacho_steps.emplace_back(uint64_t(last_count_ms) * 1000, 0);
+      native_hal::set_pulse_generator(kDigitalInputPin1, [](uint64_t time_us) {
+        return step_value(tacho_steps, time_us);
+      });
+    }
+    if (!temperature_steps.empty()) {
+      onewire->add_ds18b20(kOilTemperatureSerial, [](uint64_t time_us) {
+        return step_value(temperature_steps, time_us);
+      });
+    }
+
+    for (const SensorTraceRecord& record : replay_records) {
+      run_until(uint64_t(record.time_ms) * 1000);
+
+      switch (record.type) {
+        case SensorTraceType::kADCCounts: {
+          ADS1115Channel* channel =
+              ads1115_scanner->get_channel(record.channel);
+          if (channel != nullptr) {
+            channel->emit_counts(record.value, record.samples);
+          } else {
+            ignored_records++;
+          }
+          break;
+        }
+        case SensorTraceType::kPulseCount:
+        case SensorTraceType::kTemperature:
+          if (record.channel != 0) {
+            ignored_records++;
+          }
+          break;
+        case SensorTraceType::kDigitalLow:
+        case SensorTraceType::kDigitalHigh:
+          if (record.channel > 0 && record.channel < kNumDigitalInputs) {
+            native_hal::set_pin_level(kDigitalInputPins[record.channel],
+                                      record.value);
+          } else {
+            ignored_records++;
+          }
+          break;
+      }
+    }
+    // Let the last values propagate to the bus
+    run_until(native_hal::now_us() + 1000000);
+    end_us = native_hal::now_us();
+  }
+
+  if (trace != nullptr) {
+    trace->flush();
+    fclose(record_file);
+  }
+
+  /////////////////////////////////////////////////////////////////////
+  // Summary
+
+  printf("Simulated %.1f s\n", end_us / 1e6);
+  if (replay) {
+    printf("Replayed %zu records, %u without a matching input\n",
+           replay_records.size(), ignored_records);
+  }
+  if (rpm_values > 0) {
+    printf("Tacho: %u RPM values, mean error %.2f rpm, max error %.2f rpm\n",
+           rpm_values, rpm_error_sum / rpm_values, rpm_max_error);
+  }
+  if (alarm_changes > 0) {
+    printf("Alarm D2: %u changes, mean latency %.2f ms, max latency %.2f ms\n",
+           alarm_changes, alarm_latency_sum_us / 1e3 / alarm_changes,
+           alarm_max_latency_us / 1e3);
+  }
+  if (graph.engine_hours != nullptr) {
+    // Restore the journal as on the next boot
+    const FlashCounterLog& log = graph.engine_hours->get_log();
+    FlashCounterLog restored_log(EngineHoursCounter::kDefaultPartition);
+    uint64_t restored_ms = 0;
+    restored_log.recover(&restored_ms);
+    printf(
+        "Engine hours: %.1f s, %u saves, max save %.2f ms, %u erases "
+        "(%.1f per engine hour), restored %.1f s in %u us\n",
+        graph.engine_hours->get_total_ms() / 1e3, log.get_appends(),
+        log.get_max_append_us() / 1e3, log.get_erases(),
+        graph.engine_hours->get_erases_per_hour(), restored_ms / 1e3,
+        restored_log.get_recovery_us());
+  }
+  printf(
+      "Boot: setup done at %.1f ms, first NMEA 2000 message at %.1f ms, "
+      "1-Wire search done at %.1f ms\n",
+      GetBootPhaseTime("Setup") / 1e3,
+      GetBootPhaseTime(N2kTxScheduler::kFirstMessageBootEvent) / 1e3,
+      GetBootPhaseTime("1-Wire search") / 1e3);
+  OneWireTemperatureBus* onewire_bus = graph.onewire_bus;
+  printf(
+      "1-Wire: %u cycles, cycle time %u ms, loop blocking %u us per "
+      "cycle, max stall %u us\n",
+      onewire_bus->get_cycles(), onewire_bus->get_cycle_time_ms(),
+      onewire_bus->get_cycle_blocking_us(), onewire_bus->get_max_stall_us());
+  printf(
+      "SK deltas: %.1f/s (%.0f B/s) unbatched, %.1f/s (%.0f B/s) batched\n",
+      sk_batcher->get_input_frame_rate(), sk_batcher->get_input_byte_rate(),
+      sk_batcher->get_output_frame_rate(), sk_batcher->get_output_byte_rate());
+  if (trace != nullptr) {
+    printf("Recorded %u trace bytes to %s\n", trace->get_bytes_recorded(),
+           record_path);
+  }
+  printf("NMEA 2000: %u frames sent, bus load %.1f %%, digest %08x\n",
+         nmea2000->get_frames_sent(),
+         bus_percent(nmea2000->get_bus_time_us(), end_us), frame_digest);
+  for (const auto& item : frames_per_pgn) {
+    printf("  PGN %6u: %u frames\n", item.first, item.second);
+  }
+  for (int slot = 0; slot < n2k_scheduler->get_num_slots(); slot++) {
+    const N2kTxStatistics* stats = n2k_scheduler->get_statistics(slot);
+    printf(
+        "  PGN %6u every %u ms: %u sent, %u suppressed, %u late, "
+        "max jitter %u ms",
+        stats->pgn, stats->period_ms, stats->sent, stats->suppressed,
+        stats->late, stats->max_jitter_ms);
+    if (stats->out_of_cycle > 0) {
+      printf(", %u out of cycle, max latency from the input edge %.2f ms",
+             stats->out_of_cycle, stats->max_request_latency_us / 1e3);
+    }
+    printf("\n");
+  }
+  printf("I2C: %u transactions, %llu bytes, bus utilization %.1f %%\n",
+         i2c->get_transactions(), (unsigned long long)i2c->get_bytes(),
+         bus_percent(i2c->get_busy_us(), end_us));
+  printf("ADS1115: %u conversions, scanner max stall %u us\n",
+         ads1115->get_conversions(), ads1115_scanner->get_max_stall_us());
+  if (display_renderer) {
+    printf("Display: %u frames, %u bytes\n",
+           display_renderer->get_frames_sent(),
+           display_renderer->get_bytes_sent());
+  }
+  return 0;
+}
+
+#endif  // PIO_UNIT_TESTING
@@ -0,0 +1,399 @@
+#include "onewire_temperature_bus.h"
+
+#include "boot_profiler.h"
+#include "reaction_profiler.h"
+
+#include <ReactESP.h>
+
+#include <sensesp/system/local_debug.h>
+
+#include <algorithm>
+#include <cstdio>
+
+namespace halmet {
+
+namespace {
+
+// Family codes of the supported sensors
+constexpr uint8_t kFamilyDS18S20 = 0x10;
+constexpr uint8_t kFamilyDS1822 = 0x22;
+constexpr uint8_t kFamilyDS18B20 = 0x28;
+
+constexpr uint8_t kConvertT = 0x44;
+constexpr uint8_t kReadScratchpad = 0xBE;
+constexpr uint8_t kWriteScratchpad = 0x4E;
+constexpr uint8_t kReadPowerSupply = 0xB4;
+
+constexpr uint8_t kMinResolution = 9;
+constexpr uint8_t kMaxResolution = 12;
+
+// Conversion time at 12 bits; each bit less halves it
+constexpr uint32_t kMaxConversionTimeUs = 750000;
+
+constexpr float kKelvinOffset = 273.15;
+
+// How often the bus timing is reported
+constexpr uint32_t kStatisticsIntervalMs = 10000;
+
+String address_to_string(const std::array<uint8_t, 8>& address) {
+  char buf[24];
+  snprintf(buf, sizeof(buf), "%02x:%02x:%02x:%02x:%02x:%02x:%02x:%02x",
+           address[0], address[1], address[2], address[3], address[4],
+           address[5], address[6], address[7]);
+  return String(buf);
+}
+
+bool parse_address(const String& str, std::array<uint8_t, 8>& address) {
+  unsigned int bytes[8];
+  if (sscanf(str.c_str(), "%x:%x:%x:%x:%x:%x:%x:%x", &bytes[0], &bytes[1],
+             &bytes[2], &bytes[3], &bytes[4], &bytes[5], &bytes[6],
+             &bytes[7]) != 8) {
+    return false;
+  }
+  for (int ii = 0; ii < 8; ii++) {
+    address[ii] = bytes[ii];
+  }
+  return true;
+}
+
+}  // namespace
+
+OneWireTemperatureSensor::OneWireTemperatureSensor(OneWireTemperatureBus* bus,
+                                                   uint8_t resolution,
+                                                   const String& config_path)
+    : sensesp::FloatProducer{},
+      sensesp::Configurable{config_path},
+      bus_{bus},
+      resolution_{resolution} {
+  load_configuration();
+  resolution_ = constrain(resolution_, kMinResolution, kMaxResolution);
+}
+
+uint32_t OneWireTemperatureSensor::get_conversion_time_ms() const {
+  // The DS18S20 always converts at full length
+  const uint8_t bits =
+      address_[0] == kFamilyDS18S20 ? kMaxResolution : resolution_;
+  return ((kMaxConversionTimeUs >> (kMaxResolution - bits)) + 999) / 1000;
+}
+
+String OneWireTemperatureSensor::get_config_schema() {
+  return R"###({
+  "type": "object",
+  "properties": {
+    "address": {
+      "title": "1-Wire address",
+      "type": "string",
+      "description": "Leave empty to use the first unassigned sensor"
+    },
+    "resolution": {
+      "title": "Resolution (bits)",
+      "type": "integer",
+      "enum": [9, 10, 11, 12],
+      "description": "9 bits: 0.5 C in 94 ms; 12 bits: 0.0625 C in 750 ms"
+    }
+  }
+})###";
+}
+
+bool OneWireTemperatureSensor::set_configuration(const JsonObject& config) {
+  if (!config.containsKey("address")) {
+    debugE("OneWireTemperatureSensor: Missing configuration key address");
+    return false;
+  }
+  has_address_ = parse_address(config["address"].as<String>(), address_);
+  found_ = false;
+  // Configurations saved by sensesp::OneWireTemperature have no resolution
+  if (config.containsKey("resolution")) {
+    resolution_ = config["resolution"];
+    resolution_ = constrain(resolution_, kMinResolution, kMaxResolution);
+  }
+  resolution_applied_ = false;
+  if (bus_ != nullptr) {
+    bus_->addresses_assigned_ = false;
+  }
+  return true;
+}
+
+void OneWireTemperatureSensor::get_configuration(JsonObject& config) {
+  config["address"] = has_address_ ? address_to_string(address_) : "";
+  config["resolution"] = resolution_;
+}
+
+OneWireTemperatureBus::OneWireTemperatureBus(OneWire* onewire,
+                                             uint32_t read_interval_ms)
+    : onewire_{onewire} {
+  // The search runs in the event loop so that it doesn't delay the boot
+  onewire_->reset_search();
+  reactesp::ReactESP::app->onDelay(0, [this]() { this->search_next(); });
+
+  ProfiledRepeat("1-Wire conversion", read_interval_ms,
+                 [this]() { this->start_cycle(); });
+  ProfiledRepeat("1-Wire statistics", kStatisticsIntervalMs,
+                 [this]() { this->update_statistics(); });
+}
+
+OneWireTemperatureSensor* OneWireTemperatureBus::add_sensor(
+    uint8_t resolution, const String& config_path) {
+  auto* sensor = new OneWireTemperatureSensor(this, resolution, config_path);
+  sensors_.push_back(sensor);
+  // Sensors without an address are assigned one at the next cycle, once all
+  // sensors with a configured address have been added.
+  addresses_assigned_ = false;
+  return sensor;
+}
+
+void OneWireTemperatureBus::search_next() {
+  std::array<uint8_t, 8> address;
+  uint32_t start_us = micros();
+  const bool found = onewire_->search(address.data());
+  add_stall(start_us);
+  if (found) {
+    if (OneWire::crc8(address.data(), 7) == address[7] &&
+        (address[0] == kFamilyDS18S20 || address[0] == kFamilyDS1822 ||
+         address[0] == kFamilyDS18B20)) {
+      devices_.push_back(address);
+    }
+    reactesp::ReactESP::app->onDelay(0, [this]() { this->search_next(); });
+    return;
+  }
+
+  // Parasite-powered sensors pull the bus low in the read slot
+  start_us = micros();
+  if (onewire_->reset()) {
+    onewire_->skip();
+    onewire_->write(kReadPowerSupply);
+    parasite_powered_ = onewire_->read_bit() == 0;
+  }
+  add_stall(start_us);
+
+  search_done_ = true;
+  RecordBootPhase("1-Wire search");
+  debugI("1-Wire bus: %d temperature sensors%s", int(devices_.size()),
+         parasite_powered_ ? ", parasite powered" : "");
+}
+
+void OneWireTemperatureBus::assign_addresses() {
+  addresses_assigned_ = true;
+  for (auto* sensor : sensors_) {
+    if (sensor->has_address_) {
+      sensor->found_ = std::find(devices_.begin(), devices_.end(),
+                                 sensor->address_) != devices_.end();
+      if (!sensor->found_) {
+        debugW("1-Wire sensor %s not found",
+               address_to_string(sensor->address_).c_str());
+      }
+    }
+  }
+  for (auto* sensor : sensors_) {
+    if (sensor->has_address_) {
+      continue;
+    }
+    for (const auto& address : devices_) {
+      const bool claimed =
+          std::any_of(sensors_.begin(), sensors_.end(),
+                      [&address](const OneWireTemperatureSensor* other) {
+                        return other->has_address_ &&
+                               other->address_ == address;
+                      });
+      if (!claimed) {
+        sensor->address_ = address;
+        sensor->has_address_ = true;
+        sensor->found_ = true;
+        sensor->save_configuration();
+        break;
+      }
+    }
+    if (!sensor->has_address_) {
+      debugW("1-Wire bus: No unassigned sensor left for %s",
+             sensor->config_path_.c_str());
+    }
+  }
+}
+
+void OneWireTemperatureBus::start_cycle() {
+  if (cycle_active_) {
+    // The conversions and reads take longer than the read interval
+    skipped_cycles_++;
+    return;
+  }
+  if (!search_done_) {
+    return;
+  }
+  if (!addresses_assigned_) {
+    assign_addresses();
+  }
+
+  blocking_us_ = 0;
+  bool any_found = false;
+  for (auto* sensor : sensors_) {
+    if (sensor->found_) {
+      any_found = true;
+      if (!sensor->resolution_applied_) {
+        apply_resolution(sensor);
+      }
+    }
+  }
+  if (!any_found) {
+    return;
+  }
+
+  const uint32_t start_us = micros();
+  if (!onewire_->reset()) {
+    add_stall(start_us);
+    debugW("1-Wire bus: No presence pulse");
+    return;
+  }
+  onewire_->skip();
+  // Parasite-powered sensors draw their conversion current through the
+  // strong pull-up, which stays on until the next reset
+  onewire_->write(kConvertT, parasite_powered_ ? 1 : 0);
+  add_stall(start_us);
+
+  cycle_start_ms_ = millis();
+  cycle_active_ = true;
+  for (auto* sensor : sensors_) {
+    sensor->read_pending_ = sensor->found_;
+  }
+  read_next();
+}
+
+void OneWireTemperatureBus::read_next() {
+  const uint32_t elapsed_ms = millis() - cycle_start_ms_;
+
+  // Read the sensor whose conversion finished first, if it is done
+  OneWireTemperatureSensor* next = nullptr;
+  for (auto* sensor : sensors_) {
+    if (sensor->read_pending_ &&
+        (next == nullptr || ready_time_ms(sensor) < ready_time_ms(next))) {
+      next = sensor;
+    }
+  }
+  if (next != nullptr && ready_time_ms(next) <= elapsed_ms) {
+    next->read_pending_ = false;
+    read_sensor(next);
+    // Continue with the next one on a later loop iteration
+    reactesp::ReactESP::app->onDelay(0, [this]() { this->read_next(); });
+    return;
+  }
+  if (next != nullptr) {
+    reactesp::ReactESP::app->onDelay(ready_time_ms(next) - elapsed_ms,
+                                     [this]() { this->read_next(); });
+    return;
+  }
+
+  cycle_active_ = false;
+  cycles_++;
+  cycle_time_ms_ = elapsed_ms;
+  cycle_blocking_us_ = blocking_us_;
+}
+
+uint32_t OneWireTemperatureBus::ready_time_ms(
+    const OneWireTemperatureSensor* sensor) const {
+  if (!parasite_powered_) {
+    return sensor->get_conversion_time_ms();
+  }
+  // Reading a sensor would cut the power of those still converting
+  uint32_t ready_ms = 0;
+  for (const auto* other : sensors_) {
+    if (other->found_) {
+      ready_ms = std::max(ready_ms, other->get_conversion_time_ms());
+    }
+  }
+  return ready_ms;
+}
+
+void OneWireTemperatureBus::apply_resolution(
+    OneWireTemperatureSensor* sensor) {
+  if (sensor->address_[0] == kFamilyDS18S20) {
+    // Fixed 9-bit resolution, extended with the count registers
+    sensor->resolution_applied_ = true;
+    return;
+  }
+  uint8_t scratchpad[9];
+  if (!read_scratchpad(sensor->address_, scratchpad)) {
+    return;
+  }
+  const uint8_t config = ((sensor->resolution_ - kMinResolution) << 5) | 0x1f;
+  if (scratchpad[4] != config) {
+    // Keep the alarm thresholds TH and TL
+    const uint32_t start_us = micros();
+    onewire_->reset();
+    onewire_->select(sensor->address_.data());
+    onewire_->write(kWriteScratchpad);
+    onewire_->write(scratchpad[2]);
+    onewire_->write(scratchpad[3]);
+    onewire_->write(config);
+    add_stall(start_us);
+  }
+  sensor->resolution_applied_ = true;
+}
+
+bool OneWireTemperatureBus::read_scratchpad(
+    const std::array<uint8_t, 8>& address, uint8_t* scratchpad) {
+  const uint32_t start_us = micros();
+  if (!onewire_->reset()) {
+    add_stall(start_us);
+    return false;
+  }
+  onewire_->select(address.data());
+  onewire_->write(kReadScratchpad);
+  onewire_->read_bytes(scratchpad, 9);
+  add_stall(start_us);
+
+  // A missing sensor reads as all ones, a shorted bus as all zeros; both
+  // have a valid CRC.
+  const bool all_ones = std::all_of(scratchpad, scratchpad + 9,
+                                    [](uint8_t byte) { return byte == 0xff; });
+  const bool all_zeros = std::all_of(scratchpad, scratchpad + 9,
+                                     [](uint8_t byte) { return byte == 0; });
+  return !all_ones && !all_zeros &&
+         OneWire::crc8(scratchpad, 8) == scratchpad[8];
+}
+
+void OneWireTemperatureBus::read_sensor(OneWireTemperatureSensor* sensor) {
+  uint8_t scratchpad[9];
+  if (!read_scratchpad(sensor->address_, scratchpad)) {
+    sensor->read_errors_++;
+    debugW("1-Wire sensor %s: Read failed",
+           address_to_string(sensor->address_).c_str());
+    return;
+  }
+
+  int16_t raw = (scratchpad[1] << 8) | scratchpad[0];
+  float celsius;
+  if (sensor->address_[0] == kFamilyDS18S20) {
+    // Half degrees, refined with COUNT_REMAIN and COUNT_PER_C
+    celsius = (raw >> 1) - 0.25;
+    if (scratchpad[7] != 0) {
+      celsius += float(scratchpad[7] - scratchpad[6]) / scratchpad[7];
+    }
+  } else {
+    const uint8_t bits = kMinResolution + ((scratchpad[4] >> 5) & 0x3);
+    if (bits != sensor->resolution_) {
+      // The sensor has lost its configuration, e.g. on a power glitch
+      sensor->resolution_applied_ = false;
+    }
+    // The low bits are undefined at lower resolutions
+    raw &= ~((1 << (kMaxResolution - bits)) - 1);
+    celsius = raw / 16.;
+  }
+  sensor->emit(celsius + kKelvinOffset);
+}
+
+void OneWireTemperatureBus::add_stall(uint32_t start_us) {
+  const uint32_t stall_us = micros() - start_us;
+  if (stall_us > max_stall_us_) {
+    max_stall_us_ = stall_us;
+  }
+  blocking_us_ += stall_us;
+}
+
+void OneWireTemperatureBus::update_statistics() {
+  debugD(
+      "1-Wire bus: %d sensors, cycle %u ms, %u us loop blocking per cycle, "
+      "max loop stall %u us, %u cycles skipped",
+      int(sensors_.size()), cycle_time_ms_, cycle_blocking_us_, max_stall_us_,
+      skipped_cycles_);
+}
+
+}  // namespace halmet
@@ -0,0 +1,162 @@
+#ifndef HALMET_SRC_ONEWIRE_TEMPERATURE_BUS_H_
+#define HALMET_SRC_ONEWIRE_TEMPERATURE_BUS_H_
+
+#include <Arduino.h>
+#include <OneWire.h>
+#include <WString.h>
+
+#include <sensesp/system/configurable.h>
+#include <sensesp/system/valueproducer.h>
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+namespace halmet {
+
+class OneWireTemperatureBus;
+
+/**
+ * @brief A DS18B20 (or DS18S20, DS1822) temperature sensor on a 1-Wire bus.
+ *
+ * Emits the temperature in Kelvin once per bus cycle. The sensor ROM
+ * address is configured, or taken from the first unclaimed sensor found on
+ * the bus and saved. Instances are created by
+ * OneWireTemperatureBus::add_sensor().
+ */
+class OneWireTemperatureSensor : public sensesp::FloatProducer,
+                                 public sensesp::Configurable {
+ public:
+  OneWireTemperatureSensor(OneWireTemperatureBus* bus, uint8_t resolution,
+                           const String& config_path);
+
+  /// Whether the configured sensor is present on the bus.
+  bool is_found() const { return found_; }
+
+  /// Conversion resolution in bits, 9..12.
+  uint8_t get_resolution() const { return resolution_; }
+
+  /// Datasheet conversion time (ms) at the configured resolution.
+  uint32_t get_conversion_time_ms() const;
+
+  /// Number of readouts that failed since boot.
+  uint32_t get_read_errors() const { return read_errors_; }
+
+  String get_config_schema() override;
+  bool set_configuration(const JsonObject& config) override;
+  void get_configuration(JsonObject& config) override;
+
+ protected:
+  friend class OneWireTemperatureBus;
+
+  OneWireTemperatureBus* bus_;
+  std::array<uint8_t, 8> address_ = {};
+  bool has_address_ = false;
+  bool found_ = false;
+  uint8_t resolution_;
+
+  // Maintained by the bus
+  bool resolution_applied_ = false;
+  bool read_pending_ = false;
+  uint32_t read_errors_ = 0;
+};
+
+/**
+ * @brief Non-blocking reader for all temperature sensors on a 1-Wire bus.
+ *
+ * Replaces the per-sensor conversions of sensesp::OneWireTemperature, where
+ * each sensor started its own conversion and the conversions of a bus were
+ * spread over the read interval. Here, a single Skip ROM Convert T starts
+ * the conversions of all sensors at once, and the bus returns to the event
+ * loop while they run. Each sensor's scratchpad is then read as soon as its
+ * own conversion time has passed, one sensor per loop iteration, so a 9-bit
+ * sensor is read 94 ms into the cycle even if another one takes 750 ms. With
+ * parasite-powered sensors on the bus, the strong pull-up must stay on and
+ * all reads wait for the slowest conversion.
+ *
+ * The devices on the bus are searched for after setup(), one per event
+ * loop iteration, and the conversion cycles start once the search is done.
+ *
+ * The event loop is still blocked while a reset and the bytes of a single
+ * command are clocked out: about 11 ms per scratchpad read at standard
+ * speed. The bus measures that blocking time and the duration of the
+ * conversion cycles.
+ */
+class OneWireTemperatureBus {
+ public:
+  OneWireTemperatureBus(OneWire* onewire, uint32_t read_interval_ms = 1000);
+
+  /**
+   * @brief Add a temperature sensor.
+   *
+   * @param resolution Default conversion resolution in bits, 9..12
+   * @param config_path Configuration path of the sensor address and
+   *   resolution
+   */
+  OneWireTemperatureSensor* add_sensor(uint8_t resolution = 12,
+                                       const String& config_path = "");
+
+  /// Number of sensors found on the bus by the startup search.
+  size_t get_num_devices() const { return devices_.size(); }
+
+  /// Whether any sensor on the bus is parasite powered.
+  bool is_parasite_powered() const { return parasite_powered_; }
+
+  /// Number of completed conversion cycles since boot.
+  uint32_t get_cycles() const { return cycles_; }
+
+  /// Time (ms) from Convert T to the last scratchpad read of the last cycle.
+  uint32_t get_cycle_time_ms() const { return cycle_time_ms_; }
+
+  /// Time (us) the last cycle kept the event loop busy in total.
+  uint32_t get_cycle_blocking_us() const { return cycle_blocking_us_; }
+
+  /// Longest time (us) a single bus operation has kept the event loop busy.
+  uint32_t get_max_stall_us() const { return max_stall_us_; }
+
+  void reset_max_stall() { max_stall_us_ = 0; }
+
+ protected:
+  friend class OneWireTemperatureSensor;
+
+  /// Find the next device on the bus, one per event loop iteration.
+  void search_next();
+  void assign_addresses();
+  void start_cycle();
+  void read_next();
+
+  /// Write the resolution to the sensor if it differs.
+  void apply_resolution(OneWireTemperatureSensor* sensor);
+  /// Read and check a scratchpad; false if no valid data was received.
+  bool read_scratchpad(const std::array<uint8_t, 8>& address,
+                       uint8_t* scratchpad);
+  void read_sensor(OneWireTemperatureSensor* sensor);
+
+  /// Conversion time of the sensor on this bus.
+  uint32_t ready_time_ms(const OneWireTemperatureSensor* sensor) const;
+
+  /// Account for a blocking bus operation that started at start_us.
+  void add_stall(uint32_t start_us);
+  void update_statistics();
+
+  OneWire* onewire_;
+  std::vector<std::array<uint8_t, 8>> devices_;
+  std::vector<OneWireTemperatureSensor*> sensors_;
+  bool parasite_powered_ = false;
+  bool search_done_ = false;
+  bool addresses_assigned_ = false;
+
+  bool cycle_active_ = false;
+  uint32_t cycle_start_ms_ = 0;
+  uint32_t blocking_us_ = 0;
+
+  uint32_t cycles_ = 0;
+  uint32_t skipped_cycles_ = 0;
+  uint32_t cycle_time_ms_ = 0;
+  uint32_t cycle_blocking_us_ = 0;
+  uint32_t max_stall_us_ = 0;
+};
+
+}  // namespace halmet
+
+#endif  // HALMET_SRC_ONEWIRE_TEMPERATURE_BUS_H_
@@ -0,0 +1,152 @@
+#include "pcnt_counter_input.h"
+
+#include "reaction_profiler.h"
+
+#include <Arduino.h>
+#include <ReactESP.h>
+#include <driver/pcnt.h>
+
+#include <sensesp/system/local_debug.h>
+
+#include <algorithm>
+
+namespace halmet {
+
+namespace {
+
+constexpr uint32_t kDefaultFilterNs = 10000;
+
+// The filter threshold is counted in APB clock (80 MHz) cycles, up to 1023
+constexpr uint32_t kFilterCyclesPerUs = 80;
+constexpr uint32_t kMaxFilterCycles = 1023;
+
+// Counter units taken by an input
+bool unit_in_use[PCNT_UNIT_MAX] = {};
+
+/// Index of the first free counter unit, or PCNT_UNIT_MAX if none.
+int find_free_unit() {
+  int unit = PCNT_UNIT_0;
+  while (unit < PCNT_UNIT_MAX && unit_in_use[unit]) {
+    unit++;
+  }
+  return unit;
+}
+
+}  // namespace
+
+PCNTCounterInput::PCNTCounterInput(uint8_t pin, int pin_mode,
+                                   uint32_t read_interval_ms,
+                                   const String& config_path)
+    : sensesp::Configurable{config_path}, filter_ns_{kDefaultFilterNs} {
+  load_configuration();
+
+  const int free_unit = find_free_unit();
+  if (free_unit >= PCNT_UNIT_MAX) {
+    debugE("PCNTCounterInput: No counter unit left for pin %d", pin);
+    return;
+  }
+  const auto unit = static_cast<pcnt_unit_t>(free_unit);
+
+  pcnt_config_t config = {};
+  config.pulse_gpio_num = pin;
+  config.ctrl_gpio_num = PCNT_PIN_NOT_USED;
+  config.lctrl_mode = PCNT_MODE_KEEP;
+  config.hctrl_mode = PCNT_MODE_KEEP;
+  config.pos_mode = PCNT_COUNT_INC;
+  config.neg_mode = PCNT_COUNT_DIS;
+  config.counter_h_lim = kCounterLimit;
+  config.counter_l_lim = 0;
+  config.unit = unit;
+  config.channel = PCNT_CHANNEL_0;
+  if (pcnt_unit_config(&config) != ESP_OK) {
+    debugE("PCNTCounterInput: Can't configure counter unit %d", unit);
+    return;
+  }
+  unit_in_use[unit] = true;
+  unit_ = unit;
+
+  // pcnt_unit_config() enables the pull-up of the pulse pin
+  pinMode(pin, pin_mode);
+
+  apply_filter();
+  pcnt_counter_pause(unit);
+  pcnt_counter_clear(unit);
+  pcnt_counter_resume(unit);
+
+  read_reaction_ = ProfiledRepeat("PCNT counter read", read_interval_ms,
+                                  [this]() { this->read(); });
+}
+
+PCNTCounterInput::~PCNTCounterInput() {
+  if (unit_ < 0) {
+    return;
+  }
+  reactesp::ReactESP::app->remove(read_reaction_);
+  pcnt_counter_pause(static_cast<pcnt_unit_t>(unit_));
+  unit_in_use[unit_] = false;
+}
+
+void PCNTCounterInput::apply_filter() {
+  if (unit_ < 0) {
+    return;
+  }
+  const auto unit = static_cast<pcnt_unit_t>(unit_);
+  if (filter_ns_ == 0) {
+    pcnt_filter_disable(unit);
+    return;
+  }
+  const uint32_t cycles =
+      std::min(filter_ns_ * kFilterCyclesPerUs / 1000, kMaxFilterCycles);
+  pcnt_set_filter_value(unit, cycles);
+  pcnt_filter_enable(unit);
+}
+
+void PCNTCounterInput::read() {
+  // The counter keeps running; the pulses since the previous read are the
+  // difference of the counter values, modulo the counter limit
+  int16_t count;
+  if (pcnt_get_counter_value(static_cast<pcnt_unit_t>(unit_), &count) !=
+      ESP_OK) {
+    return;
+  }
+  int pulses = count - last_count_;
+  if (pulses < 0) {
+    pulses += kCounterLimit;
+  }
+  last_count_ = count;
+  this->emit(pulses);
+}
+
+String PCNTCounterInput::get_config_schema() {
+  return R"###({
+  "type": "object",
+  "properties": {
+    "filter_ns": {
+      "title": "Glitch filter (ns)",
+      "description": "Ignore pulses shorter than this. 0 disables the filter.",
+      "type": "integer",
+      "minimum": 0,
+      "maximum": 12787
+    }
+  }
+})###";
+}
+
+bool PCNTCounterInput::set_configuration(const JsonObject& config) {
+  const String expected[] = {"filter_ns"};
+  for (const auto& str : expected) {
+    if (!config.containsKey(str)) {
+      debugE("PCNTCounterInput: Missing configuration key %s", str.c_str());
+      return false;
+    }
+  }
+  filter_ns_ = config["filter_ns"];
+  apply_filter();
+  return true;
+}
+
+void PCNTCounterInput::get_configuration(JsonObject& config) {
+  config["filter_ns"] = filter_ns_;
+}
+
+}  // namespace halmet
@@ -0,0 +1,64 @@
+#ifndef HALMET_SRC_PCNT_COUNTER_INPUT_H_
+#define HALMET_SRC_PCNT_COUNTER_INPUT_H_
+
+#include <Arduino.h>
+#include <ReactESP.h>
+#include <WString.h>
+
+#include <sensesp/system/configurable.h>
+#include <sensesp/system/valueproducer.h>
+
+#include <cstdint>
+
+namespace halmet {
+
+/**
+ * @brief Pulse counter input using the ESP32 PCNT peripheral.
+ *
+ * A drop-in replacement for sensesp::DigitalInputCounter counting rising
+ * edges: emits the number of pulses seen during each read interval. The
+ * pulses are counted by a hardware counter unit and read once per interval,
+ * so the CPU doesn't take an interrupt per pulse. The glitch filter of the
+ * unit rejects pulses shorter than the configured filter time, at most
+ * 12.7 us.
+ *
+ * The 16-bit counter wraps at kCounterLimit, so at most kCounterLimit
+ * pulses may arrive per read interval: 64 kHz with a 500 ms interval.
+ *
+ * The ESP32 has eight counter units; each input takes the first free one
+ * and releases it when destroyed.
+ */
+class PCNTCounterInput : public sensesp::IntProducer,
+                         public sensesp::Configurable {
+ public:
+  PCNTCounterInput(uint8_t pin, int pin_mode = INPUT,
+                   uint32_t read_interval_ms = 500,
+                   const String& config_path = "");
+  ~PCNTCounterInput();
+
+  /// False if no counter unit was available or it couldn't be set up. The
+  /// input then emits nothing.
+  bool is_valid() const { return unit_ >= 0; }
+
+  String get_config_schema() override;
+  bool set_configuration(const JsonObject& config) override;
+  void get_configuration(JsonObject& config) override;
+
+ protected:
+  // The counter resets to zero on reaching this value
+  static constexpr int16_t kCounterLimit = 32000;
+
+  void apply_filter();
+  void read();
+
+  // Counter unit, or -1 if none
+  int unit_ = -1;
+  // Glitch filter time (ns), or 0 to disable the filter
+  uint32_t filter_ns_;
+  int16_t last_count_ = 0;
+  reactesp::RepeatReaction* read_reaction_ = nullptr;
+};
+
+}  // namespace halmet
+
+#endif  // HALMET_SRC_PCNT_COUNTER_INPUT_H_
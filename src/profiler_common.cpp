@@ -0,0 +1,22 @@
+#include "profiler_common.h"
+
+#ifdef ARDUINO_ARCH_ESP32
+#include <sensesp/net/http_server.h>
+#endif
+
+namespace halmet {
+
+#ifdef ARDUINO_ARCH_ESP32
+void AddProfileJSONHandler(sensesp::HTTPServer* server, const char* uri,
+                           String (*get_json)()) {
+  server->add_handler(new sensesp::HTTPRequestHandler(
+      1 << HTTP_GET, uri, [get_json](httpd_req_t* req) {
+        const String json = get_json();
+        httpd_resp_set_type(req, "application/json");
+        httpd_resp_sendstr(req, json.c_str());
+        return ESP_OK;
+      }));
+}
+#endif
+
+}  // namespace halmet
@@ -0,0 +1,64 @@
+#ifndef HALMET_SRC_PROFILER_COMMON_H_
+#define HALMET_SRC_PROFILER_COMMON_H_
+
+#include <Arduino.h>
+#include <WString.h>
+
+namespace sensesp {
+class HTTPServer;
+}
+
+namespace halmet {
+
+// Pieces shared by the boot and reaction profilers.
+
+/**
+ * @brief Guards profiler statistics that are updated on any task or in
+ * interrupt handlers, and read on the HTTP server task.
+ *
+ * A spinlock critical section, so keep the sections short: copy the
+ * statistics out before formatting them.
+ */
+class ProfilerMutex {
+ public:
+#ifdef ARDUINO_ARCH_ESP32
+  void lock() { portENTER_CRITICAL_SAFE(&mux_); }
+  void unlock() { portEXIT_CRITICAL_SAFE(&mux_); }
+
+ private:
+  portMUX_TYPE mux_ = portMUX_INITIALIZER_UNLOCKED;
+#else
+  // The host build is single-threaded
+  void lock() {}
+  void unlock() {}
+#endif
+};
+
+/// Holds a ProfilerMutex for the lifetime of the object.
+class ProfilerLock {
+ public:
+  explicit ProfilerLock(ProfilerMutex& mutex) : mutex_{mutex} {
+    mutex_.lock();
+  }
+  ~ProfilerLock() { mutex_.unlock(); }
+
+  ProfilerLock(const ProfilerLock&) = delete;
+  ProfilerLock& operator=(const ProfilerLock&) = delete;
+
+ private:
+  ProfilerMutex& mutex_;
+};
+
+/**
+ * @brief Serve the JSON document returned by get_json at uri.
+ *
+ * get_json runs on the HTTP server task, which handles one request at a
+ * time. It can thus keep its snapshot of the statistics in static storage
+ * to spare the task stack.
+ */
+void AddProfileJSONHandler(sensesp::HTTPServer* server, const char* uri,
+                           String (*get_json)());
+
+}  // namespace halmet
+
+#endif  // HALMET_SRC_PROFILER_COMMON_H_
@@ -0,0 +1,135 @@
+#include "pulse_period_input.h"
+
+#include "reaction_profiler.h"
+
+#include <Arduino.h>
+
+#include <sensesp/system/local_debug.h>
+
+#include <algorithm>
+
+namespace halmet {
+
+namespace {
+
+constexpr uint32_t kDefaultWindowMs = 100;
+constexpr uint32_t kDefaultMaxPulses = 16;
+constexpr uint32_t kDefaultStopTimeoutMs = 2000;
+
+}  // namespace
+
+PulsePeriodInput::PulsePeriodInput(uint8_t pin, int pin_mode,
+                                   uint32_t update_interval_ms,
+                                   const String& config_path)
+    : sensesp::Configurable{config_path},
+      window_ms_{kDefaultWindowMs},
+      max_pulses_{kDefaultMaxPulses},
+      stop_timeout_ms_{kDefaultStopTimeoutMs} {
+  load_configuration();
+
+  pinMode(pin, pin_mode);
+  ProfiledInterrupt("Pulse period edges", pin, RISING,
+                    [this]() { this->on_edge(); });
+  ProfiledRepeat("Pulse period update", update_interval_ms,
+                 [this]() { this->update(); });
+}
+
+void PulsePeriodInput::on_edge() {
+  const uint32_t count = edge_count_;
+  edge_times_us_[count % kNumEdges] = micros();
+  edge_count_ = count + 1;
+}
+
+void PulsePeriodInput::update() {
+  // Edges arriving from here on don't overwrite the timestamps used below,
+  // as long as there are fewer than kNumEdges - kMaxPulses of them.
+  const uint32_t count = edge_count_;
+  const uint32_t now_us = micros();
+  if (count < 2) {
+    this->emit(0);
+    return;
+  }
+
+  const uint32_t stop_timeout_us = stop_timeout_ms_ * 1000;
+  const uint32_t last_us = edge_times_us_[(count - 1) % kNumEdges];
+  const uint32_t since_last_us = now_us - last_us;
+  uint32_t span_us = last_us - edge_times_us_[(count - 2) % kNumEdges];
+  if (since_last_us > stop_timeout_us || span_us > stop_timeout_us ||
+      span_us == 0) {
+    // Stopped, or the first pulse after a stop
+    this->emit(0);
+    return;
+  }
+
+  // Extend the average over as many periods as fit in the window
+  const uint32_t max_periods =
+      std::min(std::min(count, kNumEdges) - 1, max_pulses_);
+  const uint32_t window_us = window_ms_ * 1000;
+  uint32_t periods = 1;
+  for (uint32_t ii = 2; ii <= max_periods; ii++) {
+    const uint32_t span =
+        last_us - edge_times_us_[(count - 1 - ii) % kNumEdges];
+    if (span > window_us) {
+      break;
+    }
+    periods = ii;
+    span_us = span;
+  }
+
+  float frequency = 1e6f * periods / span_us;
+  // An overdue pulse means that the frequency has dropped below the last
+  // measurement
+  if (since_last_us > span_us / periods) {
+    frequency = std::min(frequency, 1e6f / since_last_us);
+  }
+  this->emit(frequency);
+}
+
+String PulsePeriodInput::get_config_schema() {
+  return R"###({
+  "type": "object",
+  "properties": {
+    "window_ms": {
+      "title": "Averaging window (ms)",
+      "description": "Longest time span of the pulses averaged into one value",
+      "type": "integer",
+      "minimum": 1
+    },
+    "max_pulses": {
+      "title": "Maximum pulses averaged",
+      "type": "integer",
+      "minimum": 1,
+      "maximum": 16
+    },
+    "stop_timeout_ms": {
+      "title": "Stop timeout (ms)",
+      "description": "Output zero after this time without pulses",
+      "type": "integer",
+      "minimum": 1
+    }
+  }
+})###";
+}
+
+bool PulsePeriodInput::set_configuration(const JsonObject& config) {
+  const String expected[] = {"window_ms", "max_pulses", "stop_timeout_ms"};
+  for (const auto& str : expected) {
+    if (!config.containsKey(str)) {
+      debugE("PulsePeriodInput: Missing configuration key %s", str.c_str());
+      return false;
+    }
+  }
+  window_ms_ = config["window_ms"];
+  max_pulses_ = config["max_pulses"];
+  max_pulses_ = std::min(std::max(max_pulses_, uint32_t(1)), kMaxPulses);
+  stop_timeout_ms_ = config["stop_timeout_ms"];
+  return true;
+}
+
+void PulsePeriodInput::get_configuration(JsonObject& config) {
+  config["window_ms"] = window_ms_;
+  config["max_pulses"] = max_pulses_;
+  config["stop_timeout_ms"] = stop_timeout_ms_;
+}
+
+}  // namespace halmet
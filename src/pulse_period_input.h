@@ -0,0 +1,71 @@
+#ifndef HALMET_SRC_PULSE_PERIOD_INPUT_H_
+#define HALMET_SRC_PULSE_PERIOD_INPUT_H_
+
+#include <Arduino.h>
+#include <WString.h>
+
+#include <sensesp/system/configurable.h>
+#include <sensesp/system/valueproducer.h>
+
+#include <cstdint>
+
+namespace halmet {
+
+/**
+ * @brief Pulse frequency input measuring the period between pulses.
+ *
+ * Emits the pulse frequency (Hz) every update interval. Each rising edge is
+ * timestamped with the microsecond timer in the interrupt handler. The
+ * frequency is computed from the time spanned by the most recent pulses:
+ * as many as fit in the averaging window, up to a maximum count, but at
+ * least one period. At high speeds many short periods are averaged, while
+ * at idle the output follows every single period.
+ *
+ * A gate counter with a 500 ms interval resolves a 100 Hz input to 2 Hz;
+ * here the resolution is limited by the timestamp jitter, a few us per
+ * period.
+ *
+ * If the next pulse is overdue, the output falls off as the inverse of the
+ * time since the last pulse, so a stopping engine is tracked without
+ * waiting for a pulse. Without pulses for the stop timeout, the output is
+ * zero.
+ */
+class PulsePeriodInput : public sensesp::FloatProducer,
+                         public sensesp::Configurable {
+ public:
+  PulsePeriodInput(uint8_t pin, int pin_mode = INPUT,
+                   uint32_t update_interval_ms = 50,
+                   const String& config_path = "");
+
+  /// Total number of pulses seen.
+  uint32_t get_pulse_count() const { return edge_count_; }
+
+  String get_config_schema() override;
+  bool set_configuration(const JsonObject& config) override;
+  void get_configuration(JsonObject& config) override;
+
+ protected:
+  // Number of edge timestamps kept; a power of two
+  static constexpr uint32_t kNumEdges = 32;
+  // Edges that may arrive during one update without disturbing it
+  static constexpr uint32_t kMaxPulses = kNumEdges / 2;
+
+  void on_edge();
+  void update();
+
+  // Longest time span to average over
+  uint32_t window_ms_;
+  // Maximum number of periods to average over, 1..kMaxPulses
+  uint32_t max_pulses_;
+  // Output zero after this time without pulses
+  uint32_t stop_timeout_ms_;
+
+  // Ring buffer of the micros() timestamps of the latest edges, written by
+  // the interrupt handler
+  volatile uint32_t edge_times_us_[kNumEdges] = {};
+  volatile uint32_t edge_count_ = 0;
+};
+
+}  // namespace halmet
+
+#endif  // HALMET_SRC_PULSE_PERIOD_INPUT_H_
@@ -1,32 +1,95 @@
 #ifndef HALMET_SRC_RATE_LIMITER_H_
 #define HALMET_SRC_RATE_LIMITER_H_
 
+#include <Arduino.h>
+#include <ReactESP.h>
+
 #include <sensesp/transforms/transform.h>
 
 namespace sensesp {
 
+enum class RateLimiterMode {
+  /// Pass the first value of a window and drop the rest.
+  kLeading,
+  /// Hold the values of a window and emit the latest one at its end.
+  kTrailing,
+  /// Pass the first value of a window at once and the latest of the rest
+  /// at its end.
+  kLeadingTrailing,
+};
+
 /**
  * @brief Transform that limits the output rate to a specified minimum delay.
  *
+ * Consecutive outputs are at least min_delay_ms apart. In the trailing
+ * modes, values arriving within the delay are coalesced: only the latest is
+ * kept and emitted when the delay has passed, so the final state of a burst
+ * is never lost. Optionally, values equal to the last output are dropped.
+ *
  * @tparam T
  */
 template <typename T>
 class RateLimiter : public Transform<T, T> {
  public:
-  RateLimiter(unsigned int min_delay_ms, const String& config_path = "")
-      : Transform<T, T>(config_path), min_delay_ms_{min_delay_ms} {}
+  RateLimiter(unsigned int min_delay_ms,
+              RateLimiterMode mode = RateLimiterMode::kLeading,
+              bool changes_only = false, const String& config_path = "")
+      : Transform<T, T>(config_path),
+        min_delay_ms_{min_delay_ms},
+        mode_{mode},
+        changes_only_{changes_only} {}
 
   void set_input(T input, uint8_t input_channel = 0) {
-    unsigned long current_time = millis();
-    if (current_time - last_output_time_ > min_delay_ms_) {
-      this->emit(input);
-      last_output_time_ = current_time;
+    const unsigned long current_time = millis();
+    const bool window_open = has_output_time_ && !flush_scheduled_ &&
+                             current_time - last_output_time_ < min_delay_ms_;
+    if (!window_open && !flush_scheduled_ &&
+        mode_ != RateLimiterMode::kTrailing) {
+      output(input, current_time);
+      return;
+    }
+    if (mode_ == RateLimiterMode::kLeading) {
+      return;
+    }
+
+    // Latest value wins
+    pending_ = input;
+    has_pending_ = true;
+    if (!flush_scheduled_) {
+      const unsigned long window_start =
+          window_open ? last_output_time_ : current_time;
+      const unsigned long delay = window_start + min_delay_ms_ - current_time;
+      flush_scheduled_ = true;
+      reactesp::ReactESP::app->onDelay(delay, [this]() { this->flush(); });
     }
   }
 
  private:
+  void output(const T& value, unsigned long current_time) {
+    if (changes_only_ && has_output_time_ && value == this->get()) {
+      return;
+    }
+    last_output_time_ = current_time;
+    has_output_time_ = true;
+    this->emit(value);
+  }
+
+  void flush() {
+    flush_scheduled_ = false;
+    if (has_pending_) {
+      has_pending_ = false;
+      output(pending_, millis());
+    }
+  }
+
   unsigned long min_delay_ms_;
+  RateLimiterMode mode_;
+  bool changes_only_;
   unsigned long last_output_time_ = 0;
+  bool has_output_time_ = false;
+  T pending_{};
+  bool has_pending_ = false;
+  bool flush_scheduled_ = false;
 };
 
 }  // namespace sensesp
@@ -0,0 +1,188 @@
+#include "reaction_profiler.h"
+
+#ifdef REACTION_PROFILER
+
+#include "profiler_common.h"
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+
+#include <algorithm>
+#include <cstring>
+
+namespace halmet {
+
+namespace {
+
+struct ReactionProfile {
+  const char* name;
+  // Repeat interval, or 0 for interrupt reactions
+  uint32_t interval_ms;
+  uint32_t calls;
+  uint64_t total_us;
+  uint32_t max_us;
+  uint32_t max_lateness_us;
+  // micros() at the start of the previous call
+  uint32_t last_start_us;
+  uint32_t duration_histogram[kNumProfileBuckets];
+  uint32_t lateness_histogram[kNumProfileBuckets];
+};
+
+ReactionProfile profiles[kMaxProfiledReactions];
+int num_profiles = 0;
+ReactionProfile loop_profile = {"loop"};
+
+// The statistics are updated on the loop task and in interrupt handlers,
+// and read on the HTTP server task.
+ProfilerMutex profile_mutex;
+
+int bucket_index(uint32_t value_us) {
+  if (value_us < 8) {
+    return 0;
+  }
+  const int index = 31 - __builtin_clz(value_us) - 2;
+  return index < kNumProfileBuckets ? index : kNumProfileBuckets - 1;
+}
+
+ReactionProfile* add_profile(const char* name, uint32_t interval_ms) {
+  if (num_profiles >= kMaxProfiledReactions) {
+    return nullptr;
+  }
+  ReactionProfile* profile = &profiles[num_profiles++];
+  profile->name = name;
+  profile->interval_ms = interval_ms;
+  return profile;
+}
+
+void record_call(ReactionProfile* profile, uint32_t start_us,
+                 uint32_t end_us) {
+  const uint32_t duration_us = end_us - start_us;
+  ProfilerLock lock(profile_mutex);
+  if (profile->interval_ms > 0 && profile->calls > 0) {
+    const uint32_t due_us =
+        profile->last_start_us + profile->interval_ms * 1000;
+    const int32_t lateness_us = start_us - due_us;
+    if (lateness_us > 0) {
+      profile->max_lateness_us =
+          std::max<uint32_t>(profile->max_lateness_us, lateness_us);
+    }
+    profile->lateness_histogram[bucket_index(std::max(lateness_us, 0))]++;
+  }
+  profile->last_start_us = start_us;
+  profile->calls++;
+  profile->total_us += duration_us;
+  profile->max_us = std::max(profile->max_us, duration_us);
+  profile->duration_histogram[bucket_index(duration_us)]++;
+}
+
+void add_histogram(JsonObject& object, const char* key,
+                   const uint32_t (&histogram)[kNumProfileBuckets]) {
+  JsonArray array = object[key].to<JsonArray>();
+  for (uint32_t count : histogram) {
+    array.add(count);
+  }
+}
+
+}  // namespace
+
+reactesp::RepeatReaction* ProfiledRepeat(const char* name,
+                                         uint32_t interval_ms,
+                                         reactesp::react_callback callback) {
+  ReactionProfile* profile = add_profile(name, interval_ms);
+  if (profile == nullptr) {
+    return reactesp::ReactESP::app->onRepeat(interval_ms, callback);
+  }
+  return reactesp::ReactESP::app->onRepeat(
+      interval_ms, [profile, callback]() {
+        const uint32_t start_us = micros();
+        callback();
+        record_call(profile, start_us, micros());
+      });
+}
+
+reactesp::ISRReaction* ProfiledInterrupt(const char* name, uint8_t pin_number,
+                                         int mode,
+                                         reactesp::react_callback callback) {
+  ReactionProfile* profile = add_profile(name, 0);
+  if (profile == nullptr) {
+    return reactesp::ReactESP::app->onInterrupt(pin_number, mode, callback);
+  }
+  return reactesp::ReactESP::app->onInterrupt(
+      pin_number, mode, [profile, callback]() {
+        const uint32_t start_us = micros();
+        callback();
+        record_call(profile, start_us, micros());
+      });
+}
+
+void ProfiledLoopTick(reactesp::ReactESP* app) {
+  const uint32_t start_us = micros();
+  app->tick();
+  record_call(&loop_profile, start_us, micros());
+}
+
+String GetReactionProfileJSON() {
+  // Copy the statistics first so that the lock isn't held while the JSON
+  // document is allocated. Static; see AddProfileJSONHandler().
+  static ReactionProfile snapshot[kMaxProfiledReactions];
+  ReactionProfile loop;
+  int count;
+  {
+    ProfilerLock lock(profile_mutex);
+    count = num_profiles;
+    memcpy(snapshot, profiles, count * sizeof(ReactionProfile));
+    loop = loop_profile;
+  }
+
+  JsonDocument doc;
+  doc["uptime_ms"] = millis();
+  JsonArray limits = doc["bucket_limits_us"].to<JsonArray>();
+  for (int ii = 0; ii < kNumProfileBuckets - 1; ii++) {
+    limits.add(8 << ii);
+  }
+
+  JsonObject loop_json = doc["loop"].to<JsonObject>();
+  loop_json["calls"] = loop.calls;
+  loop_json["total_us"] = loop.total_us;
+  loop_json["max_us"] = loop.max_us;
+  add_histogram(loop_json, "duration_histogram", loop.duration_histogram);
+
+  // Interrupt handlers don't necessarily run within the loop, so only the
+  // repeat reactions count as profiled loop time
+  uint64_t profiled_us = 0;
+  JsonArray reactions = doc["reactions"].to<JsonArray>();
+  for (int ii = 0; ii < count; ii++) {
+    const ReactionProfile& profile = snapshot[ii];
+    JsonObject reaction = reactions.add<JsonObject>();
+    reaction["name"] = profile.name;
+    reaction["type"] = profile.interval_ms > 0 ? "repeat" : "interrupt";
+    reaction["interval_ms"] = profile.interval_ms;
+    reaction["calls"] = profile.calls;
+    reaction["total_us"] = profile.total_us;
+    reaction["max_us"] = profile.max_us;
+    add_histogram(reaction, "duration_histogram",
+                  profile.duration_histogram);
+    if (profile.interval_ms > 0) {
+      reaction["max_lateness_us"] = profile.max_lateness_us;
+      add_histogram(reaction, "lateness_histogram",
+                    profile.lateness_histogram);
+      profiled_us += profile.total_us;
+    }
+  }
+  doc["unprofiled_us"] =
+      loop.total_us > profiled_us ? loop.total_us - profiled_us : 0;
+
+  String json;
+  serializeJson(doc, json);
+  return json;
+}
+
+#ifdef ARDUINO_ARCH_ESP32
+void AddReactionProfileHandler(sensesp::HTTPServer* server) {
+  AddProfileJSONHandler(server, "/api/reactions", GetReactionProfileJSON);
+}
+#endif
+
+}  // namespace halmet
+
+#endif  // REACTION_PROFILER
@@ -0,0 +1,80 @@
+#ifndef HALMET_SRC_REACTION_PROFILER_H_
+#define HALMET_SRC_REACTION_PROFILER_H_
+
+#include <ReactESP.h>
+#include <WString.h>
+
+#include <cstdint>
+
+#ifdef REACTION_PROFILER
+namespace sensesp {
+class HTTPServer;
+}
+#endif
+
+namespace halmet {
+
+// Optional per-reaction profiling of the event loop.
+//
+// Register the HALMET reactions through ProfiledRepeat() and
+// ProfiledInterrupt() instead of calling ReactESP directly. Unless the build
+// defines REACTION_PROFILER, these are plain pass-throughs.
+//
+// With REACTION_PROFILER, every call of a named reaction is timed with
+// micros(). The profiler records the call count, the total and maximum
+// execution time and, for repeat reactions, the lateness of each call
+// relative to the previous call plus the interval. Execution times and
+// lateness are also counted in fixed log2 histograms. All statistics live
+// in a static table, so the hot path doesn't allocate.
+//
+// The loop itself is timed with ProfiledLoopTick(). Loop time not spent in
+// named reactions is reported as unprofiled; it is spent in the SensESP
+// internal reactions, e.g. OneWire, Signal K and the HTTP server.
+
+#ifdef REACTION_PROFILER
+
+// Maximum number of named reactions. Further reactions run unprofiled.
+constexpr int kMaxProfiledReactions = 24;
+
+// Histogram bucket ii counts values below 8 << ii us. The last bucket
+// counts everything larger.
+constexpr int kNumProfileBuckets = 12;
+
+reactesp::RepeatReaction* ProfiledRepeat(const char* name,
+                                         uint32_t interval_ms,
+                                         reactesp::react_callback callback);
+
+reactesp::ISRReaction* ProfiledInterrupt(const char* name, uint8_t pin_number,
+                                         int mode,
+                                         reactesp::react_callback callback);
+
+/// Run one event loop iteration, timing it as a whole.
+void ProfiledLoopTick(reactesp::ReactESP* app);
+
+/// Return all statistics as a JSON document.
+String GetReactionProfileJSON();
+
+/// Serve the statistics at /api/reactions.
+void AddReactionProfileHandler(sensesp::HTTPServer* server);
+
+#else
+
+inline reactesp::RepeatReaction* ProfiledRepeat(
+    const char* name, uint32_t interval_ms,
+    reactesp::react_callback callback) {
+  return reactesp::ReactESP::app->onRepeat(interval_ms, callback);
+}
+
+inline reactesp::ISRReaction* ProfiledInterrupt(
+    const char* name, uint8_t pin_number, int mode,
+    reactesp::react_callback callback) {
+  return reactesp::ReactESP::app->onInterrupt(pin_number, mode, callback);
+}
+
+inline void ProfiledLoopTick(reactesp::ReactESP* app) { app->tick(); }
+
+#endif  // REACTION_PROFILER
+
+}  // namespace halmet
+
+#endif  // HALMET_SRC_REACTION_PROFILER_H_
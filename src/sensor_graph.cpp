@@ -0,0 +1,533 @@
+#include "sensor_graph.h"
+
+#include "analog_channels.h"
+#include "any_transform.h"
+#include "boot_profiler.h"
+#include "halmet_const.h"
+#include "halmet_digital.h"
+#include "reaction_profiler.h"
+#ifdef ENABLE_NMEA2000_OUTPUT
+#include "n2k_senders.h"
+#endif
+
+#include <Arduino.h>
+#include <WString.h>
+
+#include <N2kTypes.h>
+
+#ifdef ENABLE_SIGNALK
+#include <sensesp/signalk/signalk_output.h>
+#endif
+#include <sensesp/system/lambda_consumer.h>
+#include <sensesp/transforms/lambda_transform.h>
+#include <sensesp/transforms/moving_average.h>
+#include <sensesp/ui/ui_controls.h>
+
+namespace halmet {
+
+namespace {
+
+// Analog inputs. Each enabled channel gets the ADC channel, the conversion
+// curve, the Signal K outputs and the NMEA 2000 connections of its sender
+// type. To add an input, e.g. on an external ADS1115, add an entry here and
+// its scanner to SensorGraphContext::adc_scanners.
+constexpr AnalogChannel kAnalogChannels[] = {
+    // ADC, ADC channel, input, SK fluid, N2k fluid type, N2k instance,
+    // enabled, sort order, display row
+    HALMET_TANK_CHANNEL(0, 0, "A1", "fuel", N2kft_Fuel, 0, true, 1000, 2),
+    HALMET_TANK_CHANNEL(0, 1, "A2", "fuel", N2kft_Water, 1, false, 2000, -1),
+    HALMET_TANK_CHANNEL(0, 2, "A3", "fuel", N2kft_GrayWater, 2, false, 3000,
+                        -1),
+    HALMET_PRESSURE_CHANNEL(0, 3, "A4", "propulsion.main.oilPressure", false,
+                            4000, -1),
+};
+
+// Store alarm states in an array for local display output
+bool alarm_states[4] = {false, false, false, false};
+
+}  // namespace
+
+SensorGraph BuildSensorGraph(const SensorGraphContext& context) {
+  SensorGraph graph = {};
+  SensorTraceWriter* sensor_trace = context.sensor_trace;
+  SSD1306Renderer* display_renderer = context.display_renderer;
+#ifdef ENABLE_SIGNALK
+  SKDeltaBatcher* sk_batcher = context.sk_batcher;
+#endif
+
+  /////////////////////////////////////////////////////////////////////
+  // NMEA 2000 sender objects
+
+  auto* enable_n2k_output = new sensesp::CheckboxConfig(
+      false, "NMEA 2000 Output Enabled", "/NMEA 2000/NMEA 2000 Enabled");
+  enable_n2k_output->set_description(
+      "Enable NMEA 2000 output. If disabled, no NMEA 2000 "
+      "messages will be sent, regardless of other settings.");
+  enable_n2k_output->set_sort_order(500);
+
+#ifdef ENABLE_NMEA2000_OUTPUT
+  N2kTxScheduler* n2k_scheduler = context.n2k_scheduler;
+  N2kEngineParameterDynamicSender* n2k_engine_dynamic_sender = nullptr;
+
+  if (enable_n2k_output->get_value()) {
+    // Create the NMEA 2000 sender objects when enabled
+
+    n2k_engine_dynamic_sender = new N2kEngineParameterDynamicSender(
+        "/NMEA 2000/Engine Dynamic", 0, n2k_scheduler);
+    n2k_engine_dynamic_sender->set_sort_order(520);
+  }
+#endif
+
+  ///////////////////////////////////////////////////////////////////
+  // Analog inputs
+
+  AnalogChannelOutputs analog_outputs = {};
+  analog_outputs.scanners = context.adc_scanners;
+  analog_outputs.num_scanners = context.num_adc_scanners;
+#ifdef ENABLE_SIGNALK
+  analog_outputs.sk_batcher = sk_batcher;
+#endif
+#ifdef ENABLE_NMEA2000_OUTPUT
+  if (enable_n2k_output->get_value()) {
+    analog_outputs.n2k_scheduler = n2k_scheduler;
+  }
+  analog_outputs.n2k_engine_dynamic_sender = n2k_engine_dynamic_sender;
+#endif
+  analog_outputs.display_renderer = display_renderer;
+
+  for (const auto& channel : kAnalogChannels) {
+    AnalogChannelSender(channel, analog_outputs);
+  }
+  RecordBootPhase("Analog inputs");
+
+  ///////////////////////////////////////////////////////////////////
+  // Digital input D1 (ac tachometer)
+
+  auto* d1_rpm_output_enable = new sensesp::CheckboxConfig(
+      true, "Enable RPM Output", "/Tacho D1/Enabled");
+  d1_rpm_output_enable->set_description(
+      "Enable RPM input D1. Requires a reboot to take effect.");
+  d1_rpm_output_enable->set_sort_order(5000);
+
+  auto* d1_period_measurement = new sensesp::CheckboxConfig(
+      false, "Measure Pulse Period", "/Tacho D1/Period Mode");
+  d1_period_measurement->set_description(
+      "Compute the RPM from the time between pulses instead of counting "
+      "pulses over 500 ms. Gives faster updates and a finer resolution at "
+      "low pulse rates. Requires a reboot to take effect.");
+  d1_period_measurement->set_sort_order(5010);
+
+  if (d1_rpm_output_enable->get_value()) {
+    // Connect the tacho senders. Engine name is "main". The batched output
+    // below is the only publisher of the revolutions path.
+    const bool period_measurement = d1_period_measurement->get_value();
+    auto* d1_tacho_frequency =
+        period_measurement
+            ? TachoPeriodSender(kDigitalInputPin1, "Tacho D1", 5100,
+                                sensor_trace, 0)
+            : TachoDigitalSender(kDigitalInputPin1, "Tacho D1", 5100,
+                                 sensor_trace, 0);
+    graph.tacho_frequency = d1_tacho_frequency;
+
+#ifdef ENABLE_SIGNALK
+    d1_tacho_frequency
+        ->connect_to(sk_batcher->add("propulsion.main.revolutions", 0.05f))
+        ->connect_to(new sensesp::SKOutput<float>(
+            "propulsion.main.revolutions", "",
+            new sensesp::SKMetadata("Hz", "Main Engine Revolutions")));
+#endif
+    auto* engine_hours = new halmet::EngineHoursCounter(
+        60, halmet::EngineHoursCounter::kDefaultPartition,
+        "/Tacho D1/Engine Hours");
+    engine_hours->set_description(
+        "Engine hours based on the D1 tacho input, in seconds. Saved to "
+        "flash every save interval while the engine runs and when it "
+        "stops.");
+    engine_hours->set_sort_order(5400);
+    d1_tacho_frequency->connect_to(engine_hours);
+    graph.engine_hours = engine_hours;
+
+#ifdef ENABLE_SIGNALK
+    // create and connect the engine hours output object
+    engine_hours
+        ->connect_to(sk_batcher->add("propulsion.main.runTime", 10.0f))
+        ->connect_to(new sensesp::SKOutput<float>(
+            "propulsion.main.runTime", "",
+            new sensesp::SKMetadata("s", "Main Engine running time")));
+#endif
+    // create a propulsion state lambda transform
+    auto* propulsion_state =
+        new sensesp::LambdaTransform<float, String>([](bool freq) {
+          if (freq > 0) {
+            return "started";
+          } else {
+            return "stopped";
+          }
+        });
+
+    // connect the tacho frequency to the propulsion state lambda transform
+    d1_tacho_frequency->connect_to(propulsion_state);
+#ifdef ENABLE_SIGNALK
+    // create and connect the propulsion state output object
+    propulsion_state
+        ->connect_to(sk_batcher->add<String>("propulsion.main.state"))
+        ->connect_to(new sensesp::SKOutput<String>(
+            "propulsion.main.state", "",
+            new sensesp::SKMetadata("", "Main Engine State")));
+#endif
+
+    auto* d1_engine_rpm = new sensesp::LambdaTransform<float, float>(
+        [](float value) -> float { return value * 60; });
+    if (period_measurement) {
+      // The period measurement averages over its window already
+      d1_tacho_frequency->connect_to(d1_engine_rpm);
+    } else {
+      auto* d1_tacho_frequency_avg = new sensesp::MovingAverage(10);
+      d1_tacho_frequency->connect_to(d1_tacho_frequency_avg)
+          ->connect_to(d1_engine_rpm);
+    }
+
+#ifdef ENABLE_NMEA2000_OUTPUT
+    if (enable_n2k_output->get_value()) {
+      // Create the NMEA 2000 sender objects when enabled
+      auto* n2k_engine_rapid_sender = new N2kEngineParameterRapidSender(
+          "/NMEA 2000/Engine Rapid Update", 0, n2k_scheduler);
+      n2k_engine_rapid_sender->set_description(
+          "PGN 127488 (Engine Rapid Update) parameters.");
+      n2k_engine_rapid_sender->set_sort_order(510);
+
+      // Connect outputs to the N2k senders.
+      d1_engine_rpm->connect_to(
+          &(n2k_engine_rapid_sender->engine_speed_consumer_));
+    }
+#endif
+
+    if (display_renderer != nullptr) {
+      d1_engine_rpm->connect_to(
+          new sensesp::LambdaConsumer<float>([display_renderer](float value) {
+            PrintValue(display_renderer, 3, "RPM D1", value);
+          }));
+    }
+  }
+
+  ///////////////////////////////////////////////////////////////////
+  // Digital input D2 (alarm low_oil_level)
+
+  auto* d2_alarm_input = AlarmDigitalSender(kDigitalInputPin2, "D2", 2100,
+                                           sensor_trace, 1);
+  d2_alarm_input->connect_to(new sensesp::LambdaConsumer<bool>(
+      [](bool value) { alarm_states[1] = value; }));
+  graph.alarm_inputs[0] = d2_alarm_input;
+
+#ifdef ENABLE_NMEA2000_OUTPUT
+  if (n2k_engine_dynamic_sender) {
+    d2_alarm_input->connect_to(
+        &(n2k_engine_dynamic_sender->low_oil_level_consumer_));
+    n2k_engine_dynamic_sender->set_status_edge_source(
+        N2kEngineParameterDynamicSender::kLowOilLevel, d2_alarm_input);
+  }
+#endif
+
+  ///////////////////////////////////////////////////////////////////
+  // Digital input D3 (alarm warning_level_1)
+
+  auto* d3_alarm_input = AlarmDigitalSender(kDigitalInputPin3, "D3", 2200,
+                                           sensor_trace, 2);
+  // In this example, d3_alarm_input is active low, so invert the value.
+  auto* d3_alarm_inverted =
+      d3_alarm_input->connect_to(new sensesp::LambdaTransform<bool, bool>(
+          [](bool value) { return !value; }));
+  d3_alarm_inverted->connect_to(new sensesp::LambdaConsumer<bool>(
+      [](bool value) { alarm_states[2] = value; }));
+  graph.alarm_inputs[1] = d3_alarm_input;
+
+#ifdef ENABLE_NMEA2000_OUTPUT
+  if (n2k_engine_dynamic_sender) {
+    // NOTE: This is just an example -- normally temperature alarms would not be
+    // active-low (inverted).
+    d3_alarm_inverted->connect_to(
+        &(n2k_engine_dynamic_sender->warning_level_1_consumer_));
+    n2k_engine_dynamic_sender->set_status_edge_source(
+        N2kEngineParameterDynamicSender::kWarningLevel1, d3_alarm_input);
+  }
+#endif
+
+  ///////////////////////////////////////////////////////////////////
+  // Digital input D4 (alarm warning_level_2)
+
+  auto* d4_alarm_input = AlarmDigitalSender(kDigitalInputPin4, "D4", 2300,
+                                           sensor_trace, 3);
+  d4_alarm_input->connect_to(new sensesp::LambdaConsumer<bool>(
+      [](bool value) { alarm_states[3] = value; }));
+  graph.alarm_inputs[2] = d4_alarm_input;
+
+#ifdef ENABLE_NMEA2000_OUTPUT
+  if (n2k_engine_dynamic_sender) {
+    // NOTE: This is just an example -- normally alarms would not be
+    // active-low (inverted).
+    d4_alarm_input->connect_to(
+        &(n2k_engine_dynamic_sender->warning_level_2_consumer_));
+    n2k_engine_dynamic_sender->set_status_edge_source(
+        N2kEngineParameterDynamicSender::kWarningLevel2, d4_alarm_input);
+  }
+#endif
+  RecordBootPhase("Digital inputs");
+
+  ///////////////////////////////////////////////////////////////////
+  // 1-Wire Temperature Sensors
+
+  // A single Convert T starts the conversions of all sensors on the bus,
+  // and each one is read as soon as its own conversion is done. The bus is
+  // searched in the event loop, after setup().
+  auto* onewire_bus =
+      new halmet::OneWireTemperatureBus(context.onewire, 1000);
+  graph.onewire_bus = onewire_bus;
+
+  // Any alarm of the 3 1-Wire temperature sensors, each on its own input
+  // channel. Sensors that never report, e.g. optional ones left disabled
+  // below, are ignored. Nothing is emitted while a sensor that has reported
+  // has been silent for 5 s. The heartbeat keeps the NMEA 2000 over
+  // temperature flag from expiring while the result doesn't change.
+  auto* any_temperature_alarm = new sensesp::AnyTransform<3>(5000, 2000);
+
+  ///////////////////////////////////////////////////////////////////
+  // 1-Wire temperature sensor 1 (Engine Oil Temperature)
+
+#if 1  // OPTIONAL
+  auto* main_engine_oil_temperature =
+      onewire_bus->add_sensor(12, "/Temperature 1/OneWire");
+  main_engine_oil_temperature->set_description(
+      "Engine oil temperature sensor on the 1-Wire bus.");
+  main_engine_oil_temperature->set_sort_order(6000);
+  if (sensor_trace != nullptr) {
+    main_engine_oil_temperature->connect_to(
+        new sensesp::LambdaConsumer<float>([sensor_trace](float value) {
+          sensor_trace->record_temperature(0, value);
+        }));
+  }
+
+#ifdef ENABLE_SIGNALK
+  // connect the sensors to Signal K output paths
+  auto* main_engine_oil_temperature_metadata =
+      new sensesp::SKMetadata("K",                       // units
+                              "Engine Oil Temperature",  // display name
+                              "Engine Oil Temperature",  // description
+                              "Oil Temperature",         // short name
+                              10.                        // timeout, in seconds
+      );
+  auto* oil_temp_sk_output = new sensesp::SKOutput<float>(
+      "propulsion.main.oilTemperature", "/Temperature 1/SK Path",
+      main_engine_oil_temperature_metadata);
+  oil_temp_sk_output->set_sort_order(6100);
+  main_engine_oil_temperature
+      ->connect_to(sk_batcher->add(oil_temp_sk_output->get_sk_path(), 0.1f))
+      ->connect_to(oil_temp_sk_output);
+#endif
+
+  const auto* oil_temperature_limit = new sensesp::ParamInfo[1]{
+      {"oil_temperature_limit", "Oil Temperature Limit"}};
+
+  const auto alarm_temp_high_comparator = [](float temperature,
+                                             float limit) -> bool {
+    return temperature > limit;
+  };
+
+  constexpr float kInitialOilTemperatureAlarm = 383;
+
+  auto* sender_oil_temp_alarm =
+      new sensesp::LambdaTransform<float, bool, float>(
+          alarm_temp_high_comparator, kInitialOilTemperatureAlarm,
+          oil_temperature_limit, "/Temperature 1/Oil Temperature Alarm");
+  sender_oil_temp_alarm->set_description(
+      "Alarm if the oil temperature exceeds the set limit. Value in Kelvin.");
+  sender_oil_temp_alarm->set_sort_order(6200);
+
+  main_engine_oil_temperature->connect_to(sender_oil_temp_alarm);
+
+  sender_oil_temp_alarm->connect_to(any_temperature_alarm, 0);
+
+#ifdef ENABLE_NMEA2000_OUTPUT
+  if (n2k_engine_dynamic_sender) {
+    // Connect the oil temperature output to N2k dynamic sender
+    main_engine_oil_temperature->connect_to(
+        &(n2k_engine_dynamic_sender->oil_temperature_consumer_));
+  }
+#endif
+#endif
+
+  ///////////////////////////////////////////////////////////////////
+  // 1-Wire temperature sensor 2 (Engine Coolant Temperature)
+
+#if 0  // OPTIONAL
+  auto* main_engine_coolant_temperature =
+      onewire_bus->add_sensor(12, "/Temperature 2/OneWire");
+  main_engine_coolant_temperature->set_description(
+      "Engine coolant temperature sensor on the 1-Wire bus.");
+  main_engine_coolant_temperature->set_sort_order(7000);
+
+#ifdef ENABLE_SIGNALK
+  auto* main_engine_coolant_temperature_metadata =
+      new sensesp::SKMetadata("K",                           // units
+                              "Engine Coolant Temperature",  // display name
+                              "Engine Coolant Temperature",  // description
+                              "Coolant Temperature",         // short name
+                              10.  // timeout, in seconds
+      );
+  auto* main_engine_coolant_temperature_sk_output =
+      new sensesp::SKOutput<float>("propulsion.main.coolantTemperature",
+                                   "/Temperature 2/Coolant Temperature SK Path",
+                                   main_engine_coolant_temperature_metadata);
+  main_engine_coolant_temperature_sk_output->set_sort_order(7100);
+  main_engine_coolant_temperature
+      ->connect_to(sk_batcher->add(
+          main_engine_coolant_temperature_sk_output->get_sk_path(), 0.1f))
+      ->connect_to(main_engine_coolant_temperature_sk_output);
+
+  auto* main_engine_temperature_metadata =
+      new sensesp::SKMetadata("K",                   // units
+                              "Engine Temperature",  // display name
+                              "Engine Temperature",  // description
+                              "Temperature",         // short name
+                              10.                    // timeout, in seconds
+      );
+  auto* main_engine_temperature_sk_output = new sensesp::SKOutput<float>(
+      "propulsion.main.temperature", "/Temperature 2/Temperature SK Path",
+      main_engine_temperature_metadata);
+  main_engine_temperature_sk_output->set_sort_order(7200);
+  // transmit coolant temperature as overall engine temperature as well
+  main_engine_coolant_temperature
+      ->connect_to(sk_batcher->add(
+          main_engine_temperature_sk_output->get_sk_path(), 0.1f))
+      ->connect_to(main_engine_temperature_sk_output);
+#endif
+
+  const auto* coolant_temperature_limit = new sensesp::ParamInfo[1]{
+      {"coolant_temperature_limit", "Coolant Temperature Limit"}};
+
+  const auto alarm_coolant_temp_high_comparator = [](float temperature,
+                                              float limit) -> bool {
+    return temperature > limit;
+  };
+
+  auto* sender_coolant_temp_alarm =
+      new sensesp::LambdaTransform<float, bool, float>(
+          alarm_coolant_temp_high_comparator,
+          373,                        // Default value for parameter
+          coolant_temperature_limit,  // Parameter UI description
+          "/Temperature 2/Coolant Temperature Alarm");
+  sender_coolant_temp_alarm->set_description(
+      "Alarm if the coolant temperature exceeds the set limit. Value in "
+      "Kelvin.");
+  sender_coolant_temp_alarm->set_sort_order(6200);
+
+  main_engine_coolant_temperature->connect_to(sender_coolant_temp_alarm);
+
+  sender_coolant_temp_alarm->connect_to(any_temperature_alarm, 1);
+
+#ifdef ENABLE_NMEA2000_OUTPUT
+  if (n2k_engine_dynamic_sender) {
+    // Connect the coolant temperature output to N2k dynamic sender
+    main_engine_coolant_temperature->connect_to(
+        &(n2k_engine_dynamic_sender->temperature_consumer_));
+  }
+#endif
+#endif
+
+  ///////////////////////////////////////////////////////////////////
+  // 1-Wire temperature sensor 3 (Wet Exhaust Temperature)
+
+#if 0  // OPTIONAL
+  auto* main_engine_exhaust_temperature =
+      onewire_bus->add_sensor(9, "/Temperature 3/OneWire");
+  main_engine_exhaust_temperature->set_sort_order(8000);
+  main_engine_exhaust_temperature->set_description(
+      "Engine wet exhaust temperature sensor on the 1-Wire bus.");
+  main_engine_exhaust_temperature->set_sort_order(8100);
+
+#ifdef ENABLE_SIGNALK
+  auto* main_engine_exhaust_temperature_metadata =
+      new sensesp::SKMetadata("K",                        // units
+                              "Wet Exhaust Temperature",  // display name
+                              "Wet Exhaust Temperature",  // description
+                              "Exhaust Temperature",      // short name
+                              10.                         // timeout, in seconds
+      );
+  auto* main_engine_exhaust_temperature_sk_path = new sensesp::SKOutput<float>(
+      "propulsion.main.wetExhaustTemperature", "/Temperature 3/SK Path",
+      main_engine_exhaust_temperature_metadata);
+  main_engine_exhaust_temperature_sk_path->set_sort_order(8200);
+  // propulsion.*.wetExhaustTemperature is a non-standard path
+  main_engine_exhaust_temperature
+      ->connect_to(sk_batcher->add(
+          main_engine_exhaust_temperature_sk_path->get_sk_path(), 0.1f))
+      ->connect_to(main_engine_exhaust_temperature_sk_path);
+#endif
+
+  const auto* exhaust_temperature_limit = new sensesp::ParamInfo[1]{
+      {"exhaust_temperature_limit", "Exhaust Temperature Limit"}};
+
+  const auto alarm_exhaust_temp_high_comparator = [](float temperature,
+                                              float limit) -> bool {
+    return temperature > limit;
+  };
+
+  auto* sender_exhaust_temp_alarm =
+      new sensesp::LambdaTransform<float, bool, float>(
+          alarm_exhaust_temp_high_comparator,
+          333,                        // Default value for parameter
+          exhaust_temperature_limit,  // Parameter UI description
+          "/Temperature 3/Coolant Temperature Alarm");
+  sender_exhaust_temp_alarm->set_description(
+      "Alarm if the coolant temperature exceeds the set limit. Value in "
+      "Kelvin.");
+  sender_exhaust_temp_alarm->set_sort_order(8300);
+
+  main_engine_exhaust_temperature->connect_to(sender_exhaust_temp_alarm);
+
+  sender_exhaust_temp_alarm->connect_to(any_temperature_alarm, 2);
+
+#ifdef ENABLE_NMEA2000_OUTPUT
+  if (enable_n2k_output->get_value()) {
+    // Create the NMEA 2000 sender objects when enabled
+    auto* n2k_exhaust_temp_sender = new N2kTemperatureExtSender(
+        "/Temperature 3/NMEA 2000", 0, N2kts_ExhaustGasTemperature,
+        n2k_scheduler);
+    n2k_exhaust_temp_sender->set_sort_order(8400);
+
+    // Connect the coolant temperature output to N2k dynamic sender
+    main_engine_exhaust_temperature->connect_to(
+        &(n2k_exhaust_temp_sender->temperature_consumer_));
+  }
+#endif
+#endif
+
+#ifdef ENABLE_NMEA2000_OUTPUT
+  if (n2k_engine_dynamic_sender) {
+    // Connect the any temperature alarm to N2k dynamic sender
+    any_temperature_alarm->connect_to(
+        &(n2k_engine_dynamic_sender->over_temperature_consumer_));
+  }
+#endif
+  RecordBootPhase("1-Wire sensors");
+
+  ///////////////////////////////////////////////////////////////////
+  // Display setup
+
+  if (display_renderer != nullptr) {
+    // Create a poor man's "christmas tree" display for the alarms
+    ProfiledRepeat("Display alarms", 1000, [display_renderer]() {
+      constexpr auto alarm_states_sz =
+          sizeof(alarm_states) / sizeof(alarm_states[0]);
+      char state_string[alarm_states_sz + 1];
+      for (int ii = 0; ii < alarm_states_sz; ii++) {
+        state_string[ii] = alarm_states[ii] ? '*' : '_';
+      }
+      state_string[alarm_states_sz] = '\0';
+      PrintValue(display_renderer, 4, "Alarm", state_string);
+    });
+  }
+
+  return graph;
+}
+
+}  // namespace halmet
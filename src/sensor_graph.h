@@ -0,0 +1,68 @@
+#ifndef HALMET_SRC_SENSOR_GRAPH_H_
+#define HALMET_SRC_SENSOR_GRAPH_H_
+
+#include "ads1115_scanner.h"
+#include "debounced_digital_input.h"
+#include "engine_hours_counter.h"
+#include "halmet_display.h"
+#include "n2k_scheduler.h"
+#include "onewire_temperature_bus.h"
+#include "sensor_trace.h"
+#include "sk_delta_batcher.h"
+
+#include <OneWire.h>
+
+#include <sensesp/system/valueproducer.h>
+
+#include <cstddef>
+
+namespace halmet {
+
+/**
+ * @brief The hardware and outputs the sensor graph is connected to.
+ *
+ * Set up by main.cpp on the device and by native_main.cpp in the host
+ * simulation. Optional pointers that are null are skipped.
+ */
+struct SensorGraphContext {
+  // One scanner per ADS1115, see AnalogChannelOutputs::scanners
+  ADS1115Scanner* const* adc_scanners;
+  size_t num_adc_scanners;
+  // The 1-Wire bus of the temperature sensors
+  OneWire* onewire;
+  // Optional
+  SensorTraceWriter* sensor_trace;
+  // Required with ENABLE_SIGNALK
+  SKDeltaBatcher* sk_batcher;
+  // Required with ENABLE_NMEA2000_OUTPUT
+  N2kTxScheduler* n2k_scheduler;
+  // Optional
+  SSD1306Renderer* display_renderer;
+};
+
+/**
+ * @brief The parts of the sensor graph the caller may observe.
+ */
+struct SensorGraph {
+  // Tacho D1 frequency in revolutions per second, or nullptr if disabled
+  sensesp::FloatProducer* tacho_frequency;
+  // Or nullptr if the tacho is disabled
+  EngineHoursCounter* engine_hours;
+  // Alarm inputs D2 to D4
+  DebouncedDigitalInput* alarm_inputs[3];
+  OneWireTemperatureBus* onewire_bus;
+};
+
+/**
+ * @brief Build the HALMET sensor graph.
+ *
+ * Creates the analog channels, the tacho, alarm and 1-Wire temperature
+ * inputs with their transforms, and connects them to the Signal K,
+ * NMEA 2000 and display outputs. Call once, after the app has been
+ * created.
+ */
+SensorGraph BuildSensorGraph(const SensorGraphContext& context);
+
+}  // namespace halmet
+
+#endif  // HALMET_SRC_SENSOR_GRAPH_H_
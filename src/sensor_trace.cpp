@@ -0,0 +1,195 @@
+#include "sensor_trace.h"
+
+#include <Arduino.h>
+
+#include <cstring>
+
+namespace halmet {
+
+namespace {
+
+constexpr uint8_t kMagic[4] = {'H', 'T', 'R', 'C'};
+
+constexpr int kTypeShift = 5;
+constexpr uint8_t kChannelMask = 0x1f;
+
+uint8_t* write_varint(uint8_t* out, uint32_t value) {
+  while (value >= 0x80) {
+    *out++ = (value & 0x7f) | 0x80;
+    value >>= 7;
+  }
+  *out++ = value;
+  return out;
+}
+
+uint32_t zigzag_encode(int32_t value) {
+  return (static_cast<uint32_t>(value) << 1) ^ (value >> 31);
+}
+
+int32_t zigzag_decode(uint32_t value) {
+  return static_cast<int32_t>(value >> 1) ^ -static_cast<int32_t>(value & 1);
+}
+
+}  // namespace
+
+void SensorTraceWriter::begin() {
+  uint8_t header[kHeaderSize] = {kMagic[0], kMagic[1], kMagic[2], kMagic[3],
+                                 kVersion,  0,         0,         0};
+  if (used_ + kHeaderSize > kBufferSize) {
+    flush();
+  }
+  memcpy(buffer_ + used_, header, kHeaderSize);
+  used_ += kHeaderSize;
+  bytes_recorded_ += kHeaderSize;
+  has_time_base_ = false;
+}
+
+uint8_t* SensorTraceWriter::start_record(SensorTraceType type,
+                                         uint8_t channel) {
+  if (used_ + kMaxRecordSize > kBufferSize) {
+    flush();
+  }
+  const uint32_t now = millis();
+  const uint32_t delta = has_time_base_ ? now - last_time_ms_ : now;
+  last_time_ms_ = now;
+  has_time_base_ = true;
+
+  uint8_t* out = buffer_ + used_;
+  *out++ = (static_cast<uint8_t>(type) << kTypeShift) |
+           (channel & kChannelMask);
+  return write_varint(out, delta);
+}
+
+void SensorTraceWriter::finish_record(uint8_t* end) {
+  const size_t size = end - (buffer_ + used_);
+  used_ += size;
+  bytes_recorded_ += size;
+}
+
+void SensorTraceWriter::record_adc_counts(uint8_t channel, int32_t sum,
+                                          uint8_t samples) {
+  if (!enabled_) {
+    return;
+  }
+  uint8_t* out = start_record(SensorTraceType::kADCCounts, channel);
+  out = write_varint(out, zigzag_encode(sum));
+  *out++ = samples;
+  finish_record(out);
+}
+
+void SensorTraceWriter::record_pulse_count(uint8_t channel, uint32_t count) {
+  if (!enabled_) {
+    return;
+  }
+  uint8_t* out = start_record(SensorTraceType::kPulseCount, channel);
+  finish_record(write_varint(out, count));
+}
+
+void SensorTraceWriter::record_temperature(uint8_t channel,
+                                           float temperature) {
+  if (!enabled_) {
+    return;
+  }
+  uint8_t* out = start_record(SensorTraceType::kTemperature, channel);
+  // Both the ESP32 and the replay hosts are little endian
+  memcpy(out, &temperature, sizeof(temperature));
+  finish_record(out + sizeof(temperature));
+}
+
+void SensorTraceWriter::record_digital(uint8_t channel, bool level) {
+  if (!enabled_) {
+    return;
+  }
+  finish_record(start_record(level ? SensorTraceType::kDigitalHigh
+                                   : SensorTraceType::kDigitalLow,
+                             channel));
+}
+
+void SensorTraceWriter::flush() {
+  if (used_ == 0) {
+    return;
+  }
+  // write() may start a new trace in the emptied buffer
+  const size_t size = used_;
+  used_ = 0;
+  write(buffer_, size);
+}
+
+SensorTraceReader::SensorTraceReader(const uint8_t* data, size_t size)
+    : pos_{data}, end_{data + size} {
+  if (size >= SensorTraceWriter::kHeaderSize &&
+      memcmp(data, kMagic, sizeof(kMagic)) == 0 &&
+      data[4] == SensorTraceWriter::kVersion) {
+    valid_ = true;
+    pos_ += SensorTraceWriter::kHeaderSize;
+  }
+}
+
+bool SensorTraceReader::read_varint(uint32_t& value) {
+  value = 0;
+  for (int shift = 0; shift < 35; shift += 7) {
+    if (pos_ >= end_) {
+      return false;
+    }
+    const uint8_t byte = *pos_++;
+    value |= static_cast<uint32_t>(byte & 0x7f) << shift;
+    if ((byte & 0x80) == 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+bool SensorTraceReader::next(SensorTraceRecord& record) {
+  if (!valid_ || pos_ >= end_) {
+    return false;
+  }
+  const uint8_t head = *pos_++;
+  record.type = static_cast<SensorTraceType>(head >> kTypeShift);
+  record.channel = head & kChannelMask;
+  record.value = 0;
+  record.samples = 0;
+  record.temperature = 0;
+
+  uint32_t delta;
+  if (!read_varint(delta)) {
+    return false;
+  }
+  time_ms_ += delta;
+  record.time_ms = time_ms_;
+
+  uint32_t value;
+  switch (record.type) {
+    case SensorTraceType::kADCCounts:
+      if (!read_varint(value) || pos_ >= end_) {
+        return false;
+      }
+      record.value = zigzag_decode(value);
+      record.samples = *pos_++;
+      break;
+    case SensorTraceType::kPulseCount:
+      if (!read_varint(value)) {
+        return false;
+      }
+      record.value = value;
+      break;
+    case SensorTraceType::kTemperature:
+      if (end_ - pos_ < static_cast<ptrdiff_t>(sizeof(record.temperature))) {
+        return false;
+      }
+      memcpy(&record.temperature, pos_, sizeof(record.temperature));
+      pos_ += sizeof(record.temperature);
+      break;
+    case SensorTraceType::kDigitalLow:
+    case SensorTraceType::kDigitalHigh:
+      record.value = record.type == SensorTraceType::kDigitalHigh;
+      break;
+    default:
+      // Unknown record type; the rest of the trace can't be decoded
+      valid_ = false;
+      return false;
+  }
+  return true;
+}
+
+}  // namespace halmet
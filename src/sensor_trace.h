@@ -0,0 +1,138 @@
+#ifndef HALMET_SRC_SENSOR_TRACE_H_
+#define HALMET_SRC_SENSOR_TRACE_H_
+
+#include <cstddef>
+#include <cstdint>
+
+namespace halmet {
+
+/**
+ * @brief Kinds of raw input recorded in a sensor trace.
+ *
+ * Digital levels are encoded in the record type to save the payload byte.
+ */
+enum class SensorTraceType : uint8_t {
+  kADCCounts = 0,    // Sum of the ADS1115 counts of one output value
+  kPulseCount = 1,   // Pulses counted in one counter read interval
+  kTemperature = 2,  // Temperature (K)
+  kDigitalLow = 3,
+  kDigitalHigh = 4,
+};
+
+/**
+ * @brief One decoded trace record.
+ */
+struct SensorTraceRecord {
+  // millis() timestamp
+  uint32_t time_ms;
+  SensorTraceType type;
+  // Input number within its kind: ADS1115 channel, digital input (0 for D1)
+  // or temperature sensor index. 0..31.
+  uint8_t channel;
+  // ADC count sum or pulse count
+  int32_t value;
+  // Number of ADC conversions in value
+  uint8_t samples;
+  float temperature;
+};
+
+/**
+ * @brief Encoder for the binary sensor trace format.
+ *
+ * A trace starts with an 8-byte header: the magic "HTRC", a version byte
+ * and three reserved bytes. Each record then consists of
+ *
+ *   - one byte holding the record type (high 3 bits) and channel (low 5
+ *     bits),
+ *   - the time since the previous record in milliseconds as an unsigned
+ *     LEB128 varint; the first record after the header holds the absolute
+ *     millis() time,
+ *   - the payload: a zigzag varint count sum followed by a sample count byte
+ *     for ADC counts, a varint for pulse counts, the 4 raw bytes of the
+ *     float for temperatures, and nothing for digital levels.
+ *
+ * A digital level thus takes two bytes, and a typical ADC value five.
+ * Values are stored exactly as the sensors produced them, so a replay
+ * reproduces the downstream values bit for bit.
+ *
+ * Records are collected in a RAM buffer and handed to write() when the
+ * buffer fills up or on flush().
+ */
+class SensorTraceWriter {
+ public:
+  static constexpr uint8_t kVersion = 1;
+  static constexpr size_t kHeaderSize = 8;
+
+  virtual ~SensorTraceWriter() = default;
+
+  void record_adc_counts(uint8_t channel, int32_t sum, uint8_t samples);
+  void record_pulse_count(uint8_t channel, uint32_t count);
+  void record_temperature(uint8_t channel, float temperature);
+  void record_digital(uint8_t channel, bool level);
+
+  /// Write out the buffered records.
+  void flush();
+
+  bool is_enabled() const { return enabled_; }
+
+  /// Total number of trace bytes produced, including buffered ones.
+  uint32_t get_bytes_recorded() const { return bytes_recorded_; }
+
+ protected:
+  static constexpr size_t kBufferSize = 512;
+  // Largest encoded record: type, 5-byte time delta, 5-byte value and the
+  // sample count
+  static constexpr size_t kMaxRecordSize = 12;
+
+  /// Start a new trace: buffer the header and reset the time base.
+  void begin();
+
+  void set_enabled(bool enabled) { enabled_ = enabled; }
+
+  /// Store encoded trace bytes. May call begin() to continue in a new
+  /// trace once data has been stored.
+  virtual void write(const uint8_t* data, size_t size) = 0;
+
+  /// Encode the record head and return the position after it.
+  uint8_t* start_record(SensorTraceType type, uint8_t channel);
+  void finish_record(uint8_t* end);
+
+  bool enabled_ = false;
+  uint8_t buffer_[kBufferSize];
+  size_t used_ = 0;
+  // Timestamp of the previous record, or unset at the start of a trace
+  uint32_t last_time_ms_ = 0;
+  bool has_time_base_ = false;
+  uint32_t bytes_recorded_ = 0;
+};
+
+/**
+ * @brief Decoder for traces produced by SensorTraceWriter.
+ */
+class SensorTraceReader {
+ public:
+  /// The trace data must stay valid while the reader is used.
+  SensorTraceReader(const uint8_t* data, size_t size);
+
+  /// True if the data starts with a supported trace header.
+  bool is_valid() const { return valid_; }
+
+  /**
+   * @brief Decode the next record.
+   *
+   * @return false at the end of the trace or on a truncated record
+   */
+  bool next(SensorTraceRecord& record);
+
+ protected:
+  bool read_varint(uint32_t& value);
+
+  const uint8_t* pos_;
+  const uint8_t* end_;
+  bool valid_ = false;
+  uint32_t time_ms_ = 0;
+};
+
+}  // namespace halmet
+
+#endif  // HALMET_SRC_SENSOR_TRACE_H_
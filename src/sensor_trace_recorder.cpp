@@ -0,0 +1,121 @@
+#include "sensor_trace_recorder.h"
+
+#include "reaction_profiler.h"
+
+#include <Arduino.h>
+#include <FS.h>
+#include <ReactESP.h>
+#include <SPIFFS.h>
+
+#include <sensesp/system/local_debug.h>
+
+namespace halmet {
+
+namespace {
+
+constexpr uint32_t kDefaultMaxSizeKb = 128;
+constexpr uint32_t kMinSizeKb = 8;
+
+// Buffered records are written at least this often, so at most this much
+// data is lost on a reset
+constexpr uint32_t kFlushIntervalMs = 10000;
+
+}  // namespace
+
+SensorTraceRecorder::SensorTraceRecorder(const String& config_path)
+    : sensesp::Configurable{config_path}, max_size_kb_{kDefaultMaxSizeKb} {
+  load_configuration();
+  ProfiledRepeat("Sensor trace flush", kFlushIntervalMs,
+                 [this]() { this->flush(); });
+}
+
+void SensorTraceRecorder::start() {
+  // Keep the trace of the previous boot, which may hold the problem that
+  // caused the reset
+  if (SPIFFS.exists(kTraceFile)) {
+    rotate();
+  }
+  file_size_ = 0;
+  begin();
+  set_enabled(true);
+  started_ = true;
+  debugD("Sensor trace recording to %s, up to %u kB", kTraceFile,
+         max_size_kb_);
+}
+
+void SensorTraceRecorder::rotate() {
+  SPIFFS.remove(kPreviousFile);
+  SPIFFS.rename(kTraceFile, kPreviousFile);
+}
+
+void SensorTraceRecorder::write(const uint8_t* data, size_t size) {
+  File file = SPIFFS.open(kTraceFile, FILE_APPEND);
+  if (!file) {
+    debugE("Sensor trace: Can't open %s; recording stopped", kTraceFile);
+    set_enabled(false);
+    return;
+  }
+  const size_t written = file.write(data, size);
+  file.close();
+  file_size_ += written;
+  if (written != size) {
+    debugE("Sensor trace: File system full; recording stopped");
+    set_enabled(false);
+    return;
+  }
+  if (file_size_ >= max_size_kb_ * 1024 / 2) {
+    // The data just written continued the current file's time base, so
+    // the switch to a new file happens only now.
+    rotate();
+    file_size_ = 0;
+    begin();
+  }
+}
+
+String SensorTraceRecorder::get_config_schema() {
+  return R"###({
+  "type": "object",
+  "properties": {
+    "enabled": {
+      "title": "Record raw sensor inputs",
+      "type": "boolean"
+    },
+    "max_size_kb": {
+      "title": "Flash space for the trace (kB)",
+      "type": "integer",
+      "minimum": 8
+    }
+  }
+})###";
+}
+
+bool SensorTraceRecorder::set_configuration(const JsonObject& config) {
+  const String expected[] = {"enabled", "max_size_kb"};
+  for (const auto& str : expected) {
+    if (!config.containsKey(str)) {
+      debugE("SensorTraceRecorder: Missing configuration key %s",
+             str.c_str());
+      return false;
+    }
+  }
+  enabled_config_ = config["enabled"];
+  max_size_kb_ = config["max_size_kb"];
+  if (max_size_kb_ < kMinSizeKb) {
+    max_size_kb_ = kMinSizeKb;
+  }
+  if (enabled_config_ && !started_) {
+    start();
+  } else if (started_) {
+    // Changes of the enabled setting take effect at once
+    flush();
+    set_enabled(enabled_config_);
+  }
+  return true;
+}
+
+void SensorTraceRecorder::get_configuration(JsonObject& config) {
+  config["enabled"] = enabled_config_;
+  config["max_size_kb"] = max_size_kb_;
+}
+
+}  // namespace halmet
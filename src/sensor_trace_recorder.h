@@ -0,0 +1,56 @@
+#ifndef HALMET_SRC_SENSOR_TRACE_RECORDER_H_
+#define HALMET_SRC_SENSOR_TRACE_RECORDER_H_
+
+#include "sensor_trace.h"
+
+#include <WString.h>
+
+#include <sensesp/system/configurable.h>
+
+#include <cstdint>
+
+namespace halmet {
+
+/**
+ * @brief Records raw sensor inputs to a trace file on flash.
+ *
+ * The trace is kept in two files on SPIFFS, kTraceFile and kPreviousFile.
+ * Once the current file reaches half the configured size, it replaces the
+ * previous one and a new file is started, so the flash always holds the
+ * most recent stretch of data. Each file is a complete trace that can be
+ * replayed on its own, or after the previous file.
+ *
+ * Records are buffered in RAM and written out when the buffer is full and
+ * every kFlushIntervalMs, from the event loop. Recording starts a new trace
+ * on every boot.
+ *
+ * Must be created after the SensESP app, which mounts the file system.
+ */
+class SensorTraceRecorder : public SensorTraceWriter,
+                            public sensesp::Configurable {
+ public:
+  static constexpr const char* kTraceFile = "/trace.bin";
+  static constexpr const char* kPreviousFile = "/trace.old";
+
+  SensorTraceRecorder(const String& config_path = "");
+
+  String get_config_schema() override;
+  bool set_configuration(const JsonObject& config) override;
+  void get_configuration(JsonObject& config) override;
+
+ protected:
+  void write(const uint8_t* data, size_t size) override;
+
+  /// Start recording into a new trace file.
+  void start();
+  void rotate();
+
+  bool enabled_config_ = false;
+  uint32_t max_size_kb_;
+  uint32_t file_size_ = 0;
+  bool started_ = false;
+};
+
+}  // namespace halmet
+
+#endif  // HALMET_SRC_SENSOR_TRACE_RECORDER_H_
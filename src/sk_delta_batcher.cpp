@@ -0,0 +1,129 @@
+#include "sk_delta_batcher.h"
+
+#include "reaction_profiler.h"
+
+#include <sensesp/system/local_debug.h>
+
+namespace halmet {
+
+namespace {
+
+constexpr uint32_t kMinWindowMs = 10;
+
+// Length of a delta without values, with the source and timestamp as
+// SensESP sends them:
+// {"updates":[{"source":{"label":"halmet","type":"signalk"},
+//  "timestamp":"2024-01-01T00:00:00.000Z","values":[]}]}
+constexpr size_t kDeltaEnvelopeLength = 111;
+// {"path":"","value":}
+constexpr size_t kEntryOverheadLength = 20;
+
+// How often the message rates are computed and reported
+constexpr uint32_t kStatisticsIntervalMs = 10000;
+
+}  // namespace
+
+size_t SKBatchedValueBase::entry_length(size_t value_length) const {
+  return kEntryOverheadLength + path_length_ + value_length;
+}
+
+SKDeltaBatcher::SKDeltaBatcher(uint32_t window_ms, uint32_t refresh_ms,
+                               const String& config_path)
+    : sensesp::Configurable{config_path},
+      window_ms_{window_ms},
+      refresh_ms_{refresh_ms} {
+  load_configuration();
+  if (window_ms_ < kMinWindowMs) {
+    window_ms_ = kMinWindowMs;
+  }
+
+  statistics_start_ms_ = millis();
+  ProfiledRepeat("SK delta batch", window_ms_, [this]() { this->flush(); });
+  ProfiledRepeat("SK delta statistics", kStatisticsIntervalMs,
+                 [this]() { this->update_statistics(); });
+}
+
+void SKDeltaBatcher::count_input(size_t entry_length) {
+  input_frames_++;
+  input_bytes_ += kDeltaEnvelopeLength + entry_length;
+}
+
+void SKDeltaBatcher::flush() {
+  const uint32_t now = millis();
+  size_t length = 0;
+  int entries = 0;
+  for (auto* value : values_) {
+    const size_t entry_length = value->flush(now, refresh_ms_);
+    if (entry_length > 0) {
+      length += entry_length;
+      entries++;
+    }
+  }
+  if (entries > 0) {
+    // Entries are separated by commas
+    output_frames_++;
+    output_bytes_ += kDeltaEnvelopeLength + length + entries - 1;
+  }
+}
+
+void SKDeltaBatcher::update_statistics() {
+  const uint32_t now = millis();
+  const uint32_t elapsed_ms = now - statistics_start_ms_;
+  statistics_start_ms_ = now;
+  if (elapsed_ms == 0) {
+    return;
+  }
+
+  input_frame_rate_ = 1000. * input_frames_ / elapsed_ms;
+  input_byte_rate_ = 1000. * input_bytes_ / elapsed_ms;
+  output_frame_rate_ = 1000. * output_frames_ / elapsed_ms;
+  output_byte_rate_ = 1000. * output_bytes_ / elapsed_ms;
+  input_frames_ = 0;
+  input_bytes_ = 0;
+  output_frames_ = 0;
+  output_bytes_ = 0;
+
+  debugD(
+      "SK deltas: %.1f/s (%.0f B/s) unbatched, %.1f/s (%.0f B/s) batched",
+      input_frame_rate_, input_byte_rate_, output_frame_rate_,
+      output_byte_rate_);
+}
+
+String SKDeltaBatcher::get_config_schema() {
+  return R"###({
+  "type": "object",
+  "properties": {
+    "window_ms": {
+      "title": "Batching window (ms)",
+      "type": "integer",
+      "minimum": 10,
+      "description": "Requires a reboot to take effect."
+    },
+    "refresh_ms": {
+      "title": "Resend unchanged values after (ms)",
+      "type": "integer",
+      "minimum": 0
+    }
+  }
+})###";
+}
+
+bool SKDeltaBatcher::set_configuration(const JsonObject& config) {
+  const String expected[] = {"window_ms", "refresh_ms"};
+  for (const auto& str : expected) {
+    if (!config.containsKey(str)) {
+      debugE("SKDeltaBatcher: Missing configuration key %s", str.c_str());
+      return false;
+    }
+  }
+  window_ms_ = config["window_ms"];
+  refresh_ms_ = config["refresh_ms"];
+  return true;
+}
+
+void SKDeltaBatcher::get_configuration(JsonObject& config) {
+  config["window_ms"] = window_ms_;
+  config["refresh_ms"] = refresh_ms_;
+}
+
+}  // namespace halmet
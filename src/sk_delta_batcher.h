@@ -0,0 +1,210 @@
+#ifndef HALMET_SRC_SK_DELTA_BATCHER_H_
+#define HALMET_SRC_SK_DELTA_BATCHER_H_
+
+#include <Arduino.h>
+#include <WString.h>
+
+#include <sensesp/system/configurable.h>
+#include <sensesp/transforms/transform.h>
+
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <type_traits>
+#include <vector>
+
+namespace halmet {
+
+class SKDeltaBatcher;
+
+namespace sk_batch {
+
+// Change tests of the batched values: numbers by the minimum change,
+// anything else by inequality
+
+template <typename T>
+typename std::enable_if<std::is_arithmetic<T>::value &&
+                            !std::is_same<T, bool>::value,
+                        bool>::type
+changed(const T& value, const T& last, const T& min_change) {
+  if (std::isnan(double(value)) || std::isnan(double(last)) ||
+      !(min_change > 0)) {
+    return !(value == last);
+  }
+  return std::fabs(double(value) - double(last)) >= double(min_change);
+}
+
+template <typename T>
+typename std::enable_if<!std::is_arithmetic<T>::value ||
+                            std::is_same<T, bool>::value,
+                        bool>::type
+changed(const T& value, const T& last, const T& min_change) {
+  return !(value == last);
+}
+
+// Length of a value in the JSON of a delta
+
+template <typename T>
+typename std::enable_if<std::is_arithmetic<T>::value &&
+                            !std::is_same<T, bool>::value,
+                        size_t>::type
+json_length(const T& value) {
+  return snprintf(nullptr, 0, "%g", double(value));
+}
+
+inline size_t json_length(bool value) { return value ? 4 : 5; }
+
+inline size_t json_length(const String& value) {
+  return value.length() + 2;
+}
+
+}  // namespace sk_batch
+
+/**
+ * @brief A Signal K value batched by an SKDeltaBatcher.
+ *
+ * Connect between the producer and the SK output. Created by
+ * SKDeltaBatcher::add().
+ */
+class SKBatchedValueBase {
+ public:
+  virtual ~SKBatchedValueBase() = default;
+
+ protected:
+  friend class SKDeltaBatcher;
+
+  SKBatchedValueBase(SKDeltaBatcher* batcher, const String& sk_path)
+      : batcher_{batcher}, path_length_{sk_path.length()} {}
+
+  /// Length of the delta entry of a value with value_length.
+  size_t entry_length(size_t value_length) const;
+
+  /**
+   * @brief Emit the latest input if it is due.
+   *
+   * @return The length of the delta entry, or 0 if nothing was emitted.
+   */
+  virtual size_t flush(uint32_t now, uint32_t refresh_ms) = 0;
+
+  SKDeltaBatcher* batcher_;
+  const size_t path_length_;
+};
+
+template <typename T>
+class SKBatchedValue : public sensesp::Transform<T, T>,
+                       public SKBatchedValueBase {
+ public:
+  SKBatchedValue(SKDeltaBatcher* batcher, const String& sk_path,
+                 T min_change)
+      : sensesp::Transform<T, T>(""),
+        SKBatchedValueBase(batcher, sk_path),
+        min_change_{min_change} {}
+
+  void set_input(T input, uint8_t input_channel = 0) override;
+
+ protected:
+  size_t flush(uint32_t now, uint32_t refresh_ms) override {
+    if (!updated_) {
+      return 0;
+    }
+    if (has_output_ && !sk_batch::changed(latest_, this->get(), min_change_) &&
+        now - last_output_ms_ < refresh_ms) {
+      return 0;
+    }
+    updated_ = false;
+    has_output_ = true;
+    last_output_ms_ = now;
+    this->emit(latest_);
+    return entry_length(sk_batch::json_length(latest_));
+  }
+
+  const T min_change_;
+  T latest_{};
+  // An input has arrived since the last output
+  bool updated_ = false;
+  bool has_output_ = false;
+  uint32_t last_output_ms_ = 0;
+};
+
+/**
+ * @brief Batches Signal K outputs into one delta per window.
+ *
+ * Every SK output emission becomes a delta message of its own on the
+ * websocket, unless it's emitted in the same event loop iteration as
+ * others, which the SensESP delta queue sends together. The batcher holds
+ * the latest input of each of its values and emits all that are due at the
+ * end of each window, so they go out as a single delta.
+ *
+ * A value is due if it has changed by at least its minimum change since
+ * its last output, or if it has been unchanged for the refresh interval,
+ * so that Signal K consumers don't time it out. A value whose producer
+ * has gone silent is not repeated.
+ *
+ * The message rate and size are estimated from the JSON of the values,
+ * both for a delta per input and for the batched deltas.
+ */
+class SKDeltaBatcher : public sensesp::Configurable {
+ public:
+  SKDeltaBatcher(uint32_t window_ms = 1000, uint32_t refresh_ms = 5000,
+                 const String& config_path = "");
+
+  /**
+   * @brief Add a batched value.
+   *
+   * @param sk_path Signal K path of the output, for the message size
+   * @param min_change Smallest change of a number that is sent before the
+   *   refresh interval, or 0 to send every change
+   */
+  template <typename T>
+  SKBatchedValue<T>* add(const String& sk_path, T min_change = T{}) {
+    auto* value = new SKBatchedValue<T>(this, sk_path, min_change);
+    values_.push_back(value);
+    return value;
+  }
+
+  /// Delta messages and bytes per second that unbatched outputs would send.
+  float get_input_frame_rate() const { return input_frame_rate_; }
+  float get_input_byte_rate() const { return input_byte_rate_; }
+
+  /// Delta messages and bytes per second sent after batching.
+  float get_output_frame_rate() const { return output_frame_rate_; }
+  float get_output_byte_rate() const { return output_byte_rate_; }
+
+  String get_config_schema() override;
+  bool set_configuration(const JsonObject& config) override;
+  void get_configuration(JsonObject& config) override;
+
+ protected:
+  template <typename T>
+  friend class SKBatchedValue;
+
+  /// Count an input as the lone delta it would be without batching.
+  void count_input(size_t entry_length);
+  void flush();
+  void update_statistics();
+
+  uint32_t window_ms_;
+  uint32_t refresh_ms_;
+  std::vector<SKBatchedValueBase*> values_;
+
+  uint32_t input_frames_ = 0;
+  uint32_t input_bytes_ = 0;
+  uint32_t output_frames_ = 0;
+  uint32_t output_bytes_ = 0;
+  uint32_t statistics_start_ms_ = 0;
+  float input_frame_rate_ = 0;
+  float input_byte_rate_ = 0;
+  float output_frame_rate_ = 0;
+  float output_byte_rate_ = 0;
+};
+
+template <typename T>
+void SKBatchedValue<T>::set_input(T input, uint8_t input_channel) {
+  latest_ = input;
+  updated_ = true;
+  batcher_->count_input(entry_length(sk_batch::json_length(input)));
+}
+
+}  // namespace halmet
+
+#endif  // HALMET_SRC_SK_DELTA_BATCHER_H_
@@ -0,0 +1 @@
+#include "spsc_queue.h"
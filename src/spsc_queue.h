@@ -0,0 +1,62 @@
+#ifndef HALMET_SRC_SPSC_QUEUE_H_
+#define HALMET_SRC_SPSC_QUEUE_H_
+
+#include <atomic>
+#include <cstddef>
+
+namespace halmet {
+
+/**
+ * @brief Lock-free single-producer, single-consumer ring buffer.
+ *
+ * One task may call push() and another pop() without further
+ * synchronization. The producer only writes head_ and the consumer only
+ * writes tail_; the acquire/release ordering makes an element visible to the
+ * consumer only after it has been completely written.
+ *
+ * @tparam T Element type. Should be cheap to copy.
+ * @tparam N Capacity. One slot is kept free to tell full from empty, so N - 1
+ * elements fit.
+ */
+template <typename T, std::size_t N>
+class SPSCQueue {
+  static_assert(N >= 2, "SPSCQueue needs at least two slots");
+
+ public:
+  /// Add an element. Return false if the queue is full.
+  bool push(const T& value) {
+    const std::size_t head = head_.load(std::memory_order_relaxed);
+    const std::size_t next = (head + 1) % N;
+    if (next == tail_.load(std::memory_order_acquire)) {
+      return false;
+    }
+    buffer_[head] = value;
+    head_.store(next, std::memory_order_release);
+    return true;
+  }
+
+  /// Remove the oldest element. Return false if the queue is empty.
+  bool pop(T& value) {
+    const std::size_t tail = tail_.load(std::memory_order_relaxed);
+    if (tail == head_.load(std::memory_order_acquire)) {
+      return false;
+    }
+    value = buffer_[tail];
+    tail_.store((tail + 1) % N, std::memory_order_release);
+    return true;
+  }
+
+  bool empty() const {
+    return tail_.load(std::memory_order_acquire) ==
+           head_.load(std::memory_order_acquire);
+  }
+
+ private:
+  T buffer_[N];
+  std::atomic<std::size_t> head_{0};
+  std::atomic<std::size_t> tail_{0};
+};
+
+}  // namespace halmet
+
+#endif  // HALMET_SRC_SPSC_QUEUE_H_
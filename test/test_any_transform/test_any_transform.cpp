@@ -0,0 +1,177 @@
+// Unit tests of the BitmaskTransform family. Run with `pio test -e native`.
+
+#include "any_transform.h"
+
+#include <ReactESP.h>
+#include <native_hal.h>
+#include <unity.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+using sensesp::AllTransform;
+using sensesp::AnyTransform;
+using sensesp::CountTransform;
+using sensesp::MajorityTransform;
+
+namespace {
+
+constexpr uint32_t kExpirationMs = 5000;
+constexpr uint32_t kHeartbeatMs = 2000;
+
+reactesp::ReactESP* app = nullptr;
+uint64_t start_us = 0;
+std::vector<int> outputs;
+
+// Run the event loop until time_ms after the start of the test
+void run_until(uint32_t time_ms) {
+  const uint64_t end_us = start_us + uint64_t(time_ms) * 1000;
+  while (app->get_next_due_us() <= end_us) {
+    native_hal::set_time_us(
+        std::max(app->get_next_due_us(), native_hal::now_us()));
+    app->tick();
+  }
+  native_hal::set_time_us(end_us);
+}
+
+template <typename T>
+T* record(T* transform) {
+  transform->attach(
+      [transform]() { outputs.push_back(int(transform->get())); });
+  return transform;
+}
+
+void assert_outputs(const std::vector<int>& expected) {
+  TEST_ASSERT_EQUAL_UINT(expected.size(), outputs.size());
+  for (size_t ii = 0; ii < expected.size(); ii++) {
+    TEST_ASSERT_EQUAL_INT(expected[ii], outputs[ii]);
+  }
+}
+
+}  // namespace
+
+void setUp() {
+  // A fresh event loop per test. The clock only runs forwards, so each test
+  // starts well after the previous one.
+  app = new reactesp::ReactESP();
+  native_hal::advance_time_ms(60000);
+  start_us = native_hal::now_us();
+  outputs.clear();
+}
+
+void tearDown() {}
+
+void test_one_of_three_inputs_connected() {
+  // As with only the first of three optional 1-Wire sensors installed
+  auto* any = record(new AnyTransform<3>(kExpirationMs, 0));
+  any->set_input(false, 0);
+  run_until(1000);
+  any->set_input(true, 0);
+  // The absent inputs never expire
+  run_until(30000);
+  any->set_input(true, 0);
+  any->set_input(false, 0);
+  assert_outputs({false, true, false});
+}
+
+void test_late_input_joins_the_result() {
+  auto* any = record(new AnyTransform<3>(kExpirationMs, 0));
+  any->set_input(false, 0);
+  run_until(1000);
+  any->set_input(true, 2);
+  assert_outputs({false, true});
+}
+
+void test_all_of_the_present_inputs() {
+  auto* all = record(new AllTransform<3>(kExpirationMs, 0));
+  all->set_input(true, 0);
+  all->set_input(true, 1);
+  all->set_input(false, 2);
+  all->set_input(true, 2);
+  assert_outputs({true, false, true});
+}
+
+void test_majority_of_the_present_inputs() {
+  auto* majority = record(new MajorityTransform<5>(kExpirationMs, 0));
+  majority->set_input(true, 0);
+  majority->set_input(false, 1);
+  // 2 of 3 present
+  majority->set_input(true, 3);
+  // 2 of 4 present
+  majority->set_input(false, 4);
+  assert_outputs({true, false, true, false});
+}
+
+void test_count() {
+  auto* count = record(new CountTransform<4>(kExpirationMs, 0));
+  count->set_input(true, 0);
+  count->set_input(true, 3);
+  count->set_input(false, 0);
+  count->set_input(false, 1);
+  assert_outputs({1, 2, 1});
+}
+
+void test_stale_input_holds_back_the_output() {
+  auto* any = record(new AnyTransform<2>(kExpirationMs, 0));
+  any->set_input(false, 0);
+  any->set_input(false, 1);
+  run_until(kExpirationMs + 1);
+  // Input 1 has expired
+  any->set_input(true, 0);
+  any->set_input(false, 0);
+  assert_outputs({false});
+  // Fresh again; the unchanged result is emitted again
+  run_until(kExpirationMs + 100);
+  any->set_input(false, 1);
+  any->set_input(true, 0);
+  assert_outputs({false, false, true});
+}
+
+void test_no_expiry() {
+  auto* any = record(new AnyTransform<2>(0, 0));
+  any->set_input(false, 0);
+  any->set_input(false, 1);
+  run_until(10 * kExpirationMs);
+  any->set_input(true, 0);
+  assert_outputs({false, true});
+}
+
+void test_heartbeat_repeats_the_result_while_fresh() {
+  auto* any = record(new AnyTransform<2>(kExpirationMs, kHeartbeatMs));
+  // Nothing to repeat yet
+  run_until(kHeartbeatMs + 1);
+  assert_outputs({});
+
+  any->set_input(true, 0);
+  any->set_input(false, 1);
+  run_until(2 * kHeartbeatMs + 1);
+  assert_outputs({true, true});
+
+  // The inputs expire kExpirationMs after their update, between the
+  // heartbeats at 3 and 4 times kHeartbeatMs
+  run_until(10 * kHeartbeatMs);
+  assert_outputs({true, true, true});
+}
+
+void test_out_of_range_channel_is_ignored() {
+  auto* any = record(new AnyTransform<2>(kExpirationMs, 0));
+  any->set_input(true, 2);
+  any->set_input(false, 0);
+  any->set_input(true, 31);
+  assert_outputs({false});
+}
+
+int main(int argc, char** argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_one_of_three_inputs_connected);
+  RUN_TEST(test_late_input_joins_the_result);
+  RUN_TEST(test_all_of_the_present_inputs);
+  RUN_TEST(test_majority_of_the_present_inputs);
+  RUN_TEST(test_count);
+  RUN_TEST(test_stale_input_holds_back_the_output);
+  RUN_TEST(test_no_expiry);
+  RUN_TEST(test_heartbeat_repeats_the_result_while_fresh);
+  RUN_TEST(test_out_of_range_channel_is_ignored);
+  return UNITY_END();
+}
@@ -0,0 +1,127 @@
+// Unit tests of ExpiringValue. Run with `pio test -e native`.
+
+#include "expiring_value.h"
+
+#include <native_hal.h>
+#include <unity.h>
+
+#include <cstdint>
+
+using sensesp::ExpiringValue;
+
+namespace {
+
+constexpr uint32_t kDuration = 1000;
+
+struct FakeClock {
+  static uint32_t now() { return now_ms; }
+  static uint32_t now_ms;
+};
+
+uint32_t FakeClock::now_ms = 0;
+
+}  // namespace
+
+void setUp() { FakeClock::now_ms = 0; }
+
+void tearDown() {}
+
+void test_fresh_until_the_duration_has_passed() {
+  ExpiringValue<int, 0, FakeClock> value(0, kDuration, -1);
+  FakeClock::now_ms = 5000;
+  value.update(42);
+
+  FakeClock::now_ms = 5000 + kDuration;
+  TEST_ASSERT_FALSE(value.is_expired());
+  TEST_ASSERT_EQUAL_INT(42, value.get());
+
+  FakeClock::now_ms = 5000 + kDuration + 1;
+  TEST_ASSERT_TRUE(value.is_expired());
+  TEST_ASSERT_EQUAL_INT(-1, value.get());
+}
+
+void test_compile_time_duration() {
+  ExpiringValue<int, kDuration, FakeClock> value(0, -1);
+  value.update(7, 100);
+  TEST_ASSERT_EQUAL_INT(7, value.get(100 + kDuration));
+  TEST_ASSERT_EQUAL_INT(-1, value.get(100 + kDuration + 1));
+}
+
+void test_new_value_counts_as_updated_at_time_zero() {
+  ExpiringValue<int, 0, FakeClock> value(3, kDuration, -1);
+  TEST_ASSERT_EQUAL_INT(3, value.get(kDuration));
+  TEST_ASSERT_EQUAL_INT(-1, value.get(kDuration + 1));
+}
+
+void test_update_revives_an_expired_value() {
+  ExpiringValue<int, 0, FakeClock> value(0, kDuration, -1);
+  TEST_ASSERT_TRUE(value.is_expired(kDuration + 1));
+  value.update(5, 2 * kDuration);
+  TEST_ASSERT_FALSE(value.is_expired(2 * kDuration));
+  TEST_ASSERT_EQUAL_INT(5, value.get(2 * kDuration));
+}
+
+void test_millis_wrap_around() {
+  ExpiringValue<int, 0, FakeClock> value(0, kDuration, -1);
+  const uint32_t update_ms = UINT32_MAX - 100;
+  value.update(9, update_ms);
+
+  // 200 ms later, past the wrap
+  TEST_ASSERT_FALSE(value.is_expired(update_ms + 200));
+  TEST_ASSERT_EQUAL_INT(9, value.get(update_ms + 200));
+  TEST_ASSERT_TRUE(value.is_expired(update_ms + kDuration + 1));
+}
+
+void test_expired_value_latches_across_wrap() {
+  ExpiringValue<int, 0, FakeClock> value(0, kDuration, -1);
+  value.update(1, 1000);
+  TEST_ASSERT_TRUE(value.is_expired(1000 + kDuration + 1));
+
+  // A full millis() period later, the timestamp difference is small again
+  TEST_ASSERT_TRUE(value.is_expired(1000 + 10));
+  TEST_ASSERT_EQUAL_INT(-1, value.get(1000 + 10));
+}
+
+void test_default_clock_is_millis() {
+  ExpiringValue<int> value(0, kDuration, -1);
+  native_hal::set_time_us(uint64_t(10000) * 1000);
+  value.update(11);
+  native_hal::advance_time_ms(kDuration);
+  TEST_ASSERT_EQUAL_INT(11, value.get());
+  native_hal::advance_time_ms(1);
+  TEST_ASSERT_EQUAL_INT(-1, value.get());
+}
+
+void test_default_clock_wraps_like_millis() {
+  ExpiringValue<int> value(0, kDuration, -1);
+  // 100 ms before millis() wraps around after 2^32 ms
+  native_hal::set_time_us((uint64_t(1) << 32) * 1000 - 100000);
+  value.update(12);
+  native_hal::advance_time_ms(500);
+  TEST_ASSERT_EQUAL_INT(12, value.get());
+  native_hal::advance_time_ms(kDuration);
+  TEST_ASSERT_EQUAL_INT(-1, value.get());
+}
+
+void test_compact_layout() {
+  // The flag and a compile time duration share the padding after the
+  // values
+  TEST_ASSERT_LESS_OR_EQUAL(2 * sizeof(double) + 8,
+                            sizeof(ExpiringValue<double, kDuration>));
+  TEST_ASSERT_LESS_OR_EQUAL(8u, sizeof(ExpiringValue<int8_t, kDuration>));
+}
+
+int main(int argc, char** argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_fresh_until_the_duration_has_passed);
+  RUN_TEST(test_compile_time_duration);
+  RUN_TEST(test_new_value_counts_as_updated_at_time_zero);
+  RUN_TEST(test_update_revives_an_expired_value);
+  RUN_TEST(test_millis_wrap_around);
+  RUN_TEST(test_expired_value_latches_across_wrap);
+  // The native clock never runs backwards; keep these in time order
+  RUN_TEST(test_default_clock_is_millis);
+  RUN_TEST(test_default_clock_wraps_like_millis);
+  RUN_TEST(test_compact_layout);
+  return UNITY_END();
+}
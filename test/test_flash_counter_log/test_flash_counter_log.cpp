@@ -0,0 +1,178 @@
+// Unit tests of FlashCounterLog recovery. Run with `pio test -e native`.
+
+#include "flash_counter_log.h"
+
+#include <esp_partition.h>
+#include <unity.h>
+
+#include <cstdint>
+#include <cstring>
+
+using halmet::FlashCounterLog;
+
+namespace {
+
+constexpr const char* kPartition = "enghours";
+
+const esp_partition_t* partition() {
+  return esp_partition_find_first(ESP_PARTITION_TYPE_DATA,
+                                  ESP_PARTITION_SUBTYPE_ANY, kPartition);
+}
+
+int num_sectors() { return partition()->size / FlashCounterLog::kSectorSize; }
+
+size_t slot_offset(int sector, uint32_t slot) {
+  return sector * FlashCounterLog::kSectorSize +
+         (slot + 1) * FlashCounterLog::kRecordSize;
+}
+
+// Program part of a record, as a reset during the write would
+void tear_record(int sector, uint32_t slot) {
+  const uint8_t partial[6] = {0x12, 0x34, 0x56, 0x78, 0x9a, 0xbc};
+  TEST_ASSERT_EQUAL_INT(
+      ESP_OK, esp_partition_write(partition(), slot_offset(sector, slot),
+                                  partial, sizeof(partial)));
+}
+
+// A new log on the same partition, as after a reboot
+uint64_t recover_value() {
+  FlashCounterLog log(kPartition);
+  uint64_t value = 0;
+  TEST_ASSERT_TRUE(log.recover(&value));
+  return value;
+}
+
+void append_values(FlashCounterLog& log, uint64_t first, uint64_t last) {
+  for (uint64_t value = first; value <= last; value++) {
+    TEST_ASSERT_TRUE(log.append(value));
+  }
+}
+
+}  // namespace
+
+void setUp() {
+  esp_partition_erase_range(partition(), 0, partition()->size);
+}
+
+void tearDown() {}
+
+void test_empty_log_has_no_value() {
+  FlashCounterLog log(kPartition);
+  TEST_ASSERT_TRUE(log.is_valid());
+  uint64_t value = 42;
+  TEST_ASSERT_FALSE(log.recover(&value));
+  TEST_ASSERT_EQUAL_UINT64(42, value);
+}
+
+void test_recovers_the_last_value() {
+  FlashCounterLog log(kPartition);
+  uint64_t value;
+  log.recover(&value);
+  append_values(log, 1, 10);
+  TEST_ASSERT_EQUAL_UINT64(10, recover_value());
+}
+
+void test_torn_record_falls_back_to_the_previous_one() {
+  {
+    FlashCounterLog log(kPartition);
+    uint64_t value;
+    log.recover(&value);
+    append_values(log, 1, 3);
+  }
+  tear_record(0, 3);
+  TEST_ASSERT_EQUAL_UINT64(3, recover_value());
+
+  // Appending continues after the torn slot
+  FlashCounterLog log(kPartition);
+  uint64_t value;
+  log.recover(&value);
+  TEST_ASSERT_TRUE(log.append(4));
+  TEST_ASSERT_EQUAL_UINT64(4, recover_value());
+}
+
+void test_wraps_around_the_sectors() {
+  FlashCounterLog log(kPartition);
+  uint64_t value;
+  log.recover(&value);
+  const uint64_t count =
+      uint64_t(2 * num_sectors() + 1) * FlashCounterLog::kRecordsPerSector + 5;
+  append_values(log, 1, count);
+  TEST_ASSERT_EQUAL_UINT64(count, recover_value());
+  TEST_ASSERT_EQUAL_UINT32(3, log.get_max_sector_erases());
+
+  FlashCounterLog restored(kPartition);
+  restored.recover(&value);
+  TEST_ASSERT_EQUAL_UINT32(3, restored.get_max_sector_erases());
+}
+
+void test_started_sector_without_record_falls_back_to_the_previous() {
+  {
+    FlashCounterLog log(kPartition);
+    uint64_t value;
+    log.recover(&value);
+    append_values(log, 1, 3);
+    TEST_ASSERT_TRUE(log.prepare_next_sector());
+    TEST_ASSERT_EQUAL_UINT32(2, log.get_erases());
+  }
+  TEST_ASSERT_EQUAL_UINT64(3, recover_value());
+
+  // The previous sector still has room, and the started one is kept
+  FlashCounterLog log(kPartition);
+  uint64_t value;
+  log.recover(&value);
+  TEST_ASSERT_TRUE(log.prepare_next_sector());
+  append_values(log, 4, 5);
+  TEST_ASSERT_EQUAL_UINT32(0, log.get_erases());
+  TEST_ASSERT_EQUAL_UINT64(5, recover_value());
+}
+
+void test_full_sector_moves_on_to_the_prepared_one() {
+  FlashCounterLog log(kPartition);
+  uint64_t value;
+  log.recover(&value);
+  append_values(log, 1, FlashCounterLog::kRecordsPerSector);
+  TEST_ASSERT_TRUE(log.prepare_next_sector());
+  const uint32_t erases = log.get_erases();
+
+  // No erase in the append that moves on
+  TEST_ASSERT_TRUE(log.append(FlashCounterLog::kRecordsPerSector + 1));
+  TEST_ASSERT_EQUAL_UINT32(erases, log.get_erases());
+  TEST_ASSERT_EQUAL_UINT64(FlashCounterLog::kRecordsPerSector + 1,
+                           recover_value());
+}
+
+void test_interrupted_erase_is_ignored() {
+  {
+    FlashCounterLog log(kPartition);
+    uint64_t value;
+    log.recover(&value);
+    append_values(log, 1, FlashCounterLog::kRecordsPerSector);
+  }
+  // A header left half written in the next sector
+  const uint8_t partial[4] = {0x48, 0x4d, 0x00, 0x00};
+  esp_partition_write(partition(), FlashCounterLog::kSectorSize, partial,
+                      sizeof(partial));
+  TEST_ASSERT_EQUAL_UINT64(FlashCounterLog::kRecordsPerSector,
+                           recover_value());
+
+  // The sector is erased again when the log moves on
+  FlashCounterLog log(kPartition);
+  uint64_t value;
+  log.recover(&value);
+  TEST_ASSERT_TRUE(log.append(FlashCounterLog::kRecordsPerSector + 1));
+  TEST_ASSERT_EQUAL_UINT32(1, log.get_erases());
+  TEST_ASSERT_EQUAL_UINT64(FlashCounterLog::kRecordsPerSector + 1,
+                           recover_value());
+}
+
+int main(int argc, char** argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_empty_log_has_no_value);
+  RUN_TEST(test_recovers_the_last_value);
+  RUN_TEST(test_torn_record_falls_back_to_the_previous_one);
+  RUN_TEST(test_wraps_around_the_sectors);
+  RUN_TEST(test_started_sector_without_record_falls_back_to_the_previous);
+  RUN_TEST(test_full_sector_moves_on_to_the_prepared_one);
+  RUN_TEST(test_interrupted_erase_is_ignored);
+  return UNITY_END();
+}
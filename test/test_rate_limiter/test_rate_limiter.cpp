@@ -0,0 +1,168 @@
+// Unit tests of RateLimiter. Run with `pio test -e native`.
+
+#include "rate_limiter.h"
+
+#include <ReactESP.h>
+#include <native_hal.h>
+#include <unity.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+using sensesp::RateLimiter;
+using sensesp::RateLimiterMode;
+
+namespace {
+
+constexpr unsigned int kMinDelayMs = 100;
+
+// Output values with their times relative to the start of the test
+using Outputs = std::vector<std::pair<uint32_t, int>>;
+
+reactesp::ReactESP* app = nullptr;
+uint64_t start_us = 0;
+Outputs outputs;
+
+uint32_t elapsed_ms() {
+  return (native_hal::now_us() - start_us) / 1000;
+}
+
+// Run the event loop until time_ms after the start of the test
+void run_until(uint32_t time_ms) {
+  const uint64_t end_us = start_us + uint64_t(time_ms) * 1000;
+  while (app->get_next_due_us() <= end_us) {
+    native_hal::set_time_us(
+        std::max(app->get_next_due_us(), native_hal::now_us()));
+    app->tick();
+  }
+  native_hal::set_time_us(end_us);
+}
+
+void input_at(RateLimiter<int>& limiter, uint32_t time_ms, int value) {
+  run_until(time_ms);
+  limiter.set_input(value);
+}
+
+RateLimiter<int>* make_limiter(RateLimiterMode mode,
+                               bool changes_only = false) {
+  auto* limiter = new RateLimiter<int>(kMinDelayMs, mode, changes_only);
+  limiter->attach(
+      [limiter]() { outputs.emplace_back(elapsed_ms(), limiter->get()); });
+  return limiter;
+}
+
+void assert_outputs(const Outputs& expected) {
+  TEST_ASSERT_EQUAL_UINT(expected.size(), outputs.size());
+  for (size_t ii = 0; ii < expected.size(); ii++) {
+    TEST_ASSERT_EQUAL_UINT32(expected[ii].first, outputs[ii].first);
+    TEST_ASSERT_EQUAL_INT(expected[ii].second, outputs[ii].second);
+  }
+}
+
+}  // namespace
+
+void setUp() {
+  // A fresh event loop per test. The clock only runs forwards, so each test
+  // starts a second after the previous one.
+  app = new reactesp::ReactESP();
+  native_hal::advance_time_ms(1000);
+  start_us = native_hal::now_us();
+  outputs.clear();
+}
+
+void tearDown() {}
+
+void test_leading_passes_the_first_value_of_a_window() {
+  auto* limiter = make_limiter(RateLimiterMode::kLeading);
+  input_at(*limiter, 0, 1);
+  input_at(*limiter, 10, 2);
+  input_at(*limiter, 99, 3);
+  input_at(*limiter, 100, 4);
+  input_at(*limiter, 150, 5);
+  run_until(1000);
+  assert_outputs({{0, 1}, {100, 4}});
+}
+
+void test_trailing_emits_the_latest_value_at_the_end_of_the_window() {
+  auto* limiter = make_limiter(RateLimiterMode::kTrailing);
+  input_at(*limiter, 0, 1);
+  input_at(*limiter, 30, 2);
+  input_at(*limiter, 60, 3);
+  run_until(99);
+  TEST_ASSERT_EQUAL_UINT(0, outputs.size());
+  // A value after the flush opens a new window from its arrival
+  input_at(*limiter, 250, 4);
+  run_until(1000);
+  assert_outputs({{100, 3}, {350, 4}});
+}
+
+void test_leading_trailing_keeps_the_final_state_of_a_burst() {
+  auto* limiter = make_limiter(RateLimiterMode::kLeadingTrailing);
+  input_at(*limiter, 0, 1);
+  input_at(*limiter, 20, 0);
+  input_at(*limiter, 40, 1);
+  input_at(*limiter, 60, 0);
+  run_until(1000);
+  assert_outputs({{0, 1}, {100, 0}});
+}
+
+void test_leading_trailing_defers_a_value_inside_the_window() {
+  auto* limiter = make_limiter(RateLimiterMode::kLeadingTrailing);
+  input_at(*limiter, 0, 1);
+  input_at(*limiter, 50, 2);
+  // Values arriving while a flush is scheduled are coalesced into it
+  input_at(*limiter, 120, 3);
+  input_at(*limiter, 400, 4);
+  run_until(1000);
+  assert_outputs({{0, 1}, {100, 2}, {200, 3}, {400, 4}});
+}
+
+void test_leading_trailing_without_burst_emits_once() {
+  auto* limiter = make_limiter(RateLimiterMode::kLeadingTrailing);
+  input_at(*limiter, 0, 1);
+  run_until(1000);
+  assert_outputs({{0, 1}});
+}
+
+void test_changes_only_drops_repeated_values() {
+  auto* limiter = make_limiter(RateLimiterMode::kLeading, true);
+  input_at(*limiter, 0, 1);
+  input_at(*limiter, 200, 1);
+  input_at(*limiter, 400, 2);
+  input_at(*limiter, 600, 2);
+  run_until(1000);
+  assert_outputs({{0, 1}, {400, 2}});
+}
+
+void test_changes_only_drops_a_trailing_value_equal_to_the_output() {
+  auto* limiter = make_limiter(RateLimiterMode::kLeadingTrailing, true);
+  input_at(*limiter, 0, 1);
+  input_at(*limiter, 30, 0);
+  input_at(*limiter, 60, 1);
+  run_until(1000);
+  // The burst ended where it started
+  assert_outputs({{0, 1}});
+}
+
+void test_first_value_always_passes_with_changes_only() {
+  auto* limiter = make_limiter(RateLimiterMode::kTrailing, true);
+  // Equal to the default-constructed output value
+  input_at(*limiter, 0, 0);
+  run_until(1000);
+  assert_outputs({{100, 0}});
+}
+
+int main(int argc, char** argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_leading_passes_the_first_value_of_a_window);
+  RUN_TEST(test_trailing_emits_the_latest_value_at_the_end_of_the_window);
+  RUN_TEST(test_leading_trailing_keeps_the_final_state_of_a_burst);
+  RUN_TEST(test_leading_trailing_defers_a_value_inside_the_window);
+  RUN_TEST(test_leading_trailing_without_burst_emits_once);
+  RUN_TEST(test_changes_only_drops_repeated_values);
+  RUN_TEST(test_changes_only_drops_a_trailing_value_equal_to_the_output);
+  RUN_TEST(test_first_value_always_passes_with_changes_only);
+  return UNITY_END();
+}